@@ -4,10 +4,17 @@
 #include "AbstractFileMonitor.h"
 #include "DagNode.h"
 #include "MonteCarloAnalysis.h"
+#include "RbException.h"
+#include "RbSettings.h"
 #include "RlUserInterface.h"
+#include "StringUtilities.h"
 
 #include <algorithm>
 #include <cmath>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <sstream>
 
 
 using namespace RevBayesCore;
@@ -20,7 +27,11 @@ using namespace RevBayesCore;
  */
 MonteCarloAnalysis::MonteCarloAnalysis(MonteCarloSampler *m, size_t r) : Cloneable(), Parallelizable(),
     replicates( r ),
-    runs(r,NULL)
+    runs(r,NULL),
+    replicate_rngs(),
+    checkpoint_file( "" ),
+    checkpoint_interval( 0 ),
+    restored_from_checkpoint( false )
 {
     
     runs[0] = m;
@@ -30,7 +41,11 @@ MonteCarloAnalysis::MonteCarloAnalysis(MonteCarloSampler *m, size_t r) : Cloneab
 
 MonteCarloAnalysis::MonteCarloAnalysis(const MonteCarloAnalysis &a) : Cloneable(), Parallelizable(a),
     replicates( a.replicates ),
-    runs(a.replicates,NULL)
+    runs(a.replicates,NULL),
+    replicate_rngs( a.replicate_rngs ),
+    checkpoint_file( a.checkpoint_file ),
+    checkpoint_interval( a.checkpoint_interval ),
+    restored_from_checkpoint( a.restored_from_checkpoint )
 {
     
     // create replicate Monte Carlo samplers
@@ -84,7 +99,11 @@ MonteCarloAnalysis& MonteCarloAnalysis::operator=(const MonteCarloAnalysis &a)
         }
         runs = std::vector<MonteCarloSampler*>(a.replicates,NULL);
         
-        replicates      = a.replicates;
+        replicates                  = a.replicates;
+        replicate_rngs              = a.replicate_rngs;
+        checkpoint_file             = a.checkpoint_file;
+        checkpoint_interval         = a.checkpoint_interval;
+        restored_from_checkpoint    = a.restored_from_checkpoint;
         
         // create replicate Monte Carlo samplers
         for (size_t i=0; i < replicates; ++i)
@@ -159,6 +178,8 @@ void MonteCarloAnalysis::burnin(size_t generations, size_t tuningInterval, bool
         
     }
     
+    initializeReplicateRandomNumberGenerators();
+    
     if ( verbose == true && runs[0] != NULL && process_active == true )
     {
         // Let user know what we are doing
@@ -177,44 +198,85 @@ void MonteCarloAnalysis::burnin(size_t generations, size_t tuningInterval, bool
     }
     
     
-    // Run the chain
-    size_t num_stars = 0;
-    for (size_t k=1; k<=generations; ++k)
+    // the first replicate of this process prints the progress
+    size_t progress_replicate = 0;
+    while ( progress_replicate < replicates && runs[progress_replicate] == NULL ) ++progress_replicate;
+    
+    // Run the chains
+    // the replicates do not need to be synchronized during burnin, so each one runs on its own in a separate thread
+    // the flags are chars and not bools because std::vector<bool> is not safe to write from several threads
+    std::vector<std::string> errors = std::vector<std::string>(replicates, "");
+    std::vector<char> failed = std::vector<char>(replicates, false);
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+#   pragma omp parallel for schedule(dynamic) num_threads(num_threads) if(num_threads > 1 && replicates > 1)
+    for (int i=0; i<int(replicates); ++i)
     {
-                
-        if ( verbose == true && process_active == true)
+        
+        if ( runs[i] == NULL )
         {
-            size_t progress = 68 * (double) k / (double) generations;
-            if ( progress > num_stars )
-            {
-                
-                for ( ; num_stars < progress; ++num_stars )
-                {
-                    std::cout << "*";
-                }
-                std::cout.flush();
-            
-            }
+            continue;
         }
         
-        for (size_t i=0; i<replicates; ++i)
+        RandomNumberFactory::randomNumberFactoryInstance().setThreadRandomNumberGenerator( replicate_rngs.empty() ? NULL : &replicate_rngs[i] );
+        
+        try
         {
-
-            if ( runs[i] != NULL )
+            size_t num_stars = 0;
+            for (size_t k=1; k<=generations; ++k)
             {
+                
+                if ( verbose == true && process_active == true && size_t(i) == progress_replicate )
+                {
+                    size_t progress = 68 * (double) k / (double) generations;
+                    if ( progress > num_stars )
+                    {
+                        
+                        for ( ; num_stars < progress; ++num_stars )
+                        {
+                            std::cout << "*";
+                        }
+                        std::cout.flush();
+                        
+                    }
+                }
+                
                 runs[i]->nextCycle(false);
-        
+                
                 // check for autotuning
                 if ( k % tuningInterval == 0 && k != generations )
                 {
-            
+                    
                     runs[i]->tune();
                 }
                 
             }
-            
+        }
+        catch (RbException &e)
+        {
+            errors[i] = e.getMessage();
+            failed[i] = true;
+        }
+        catch (std::exception &e)
+        {
+            errors[i] = e.what();
+            failed[i] = true;
+        }
+        catch (...)
+        {
+            errors[i] = "Unknown error in replicate " + StringUtilities::toString(i+1) + ".";
+            failed[i] = true;
         }
         
+        RandomNumberFactory::randomNumberFactoryInstance().setThreadRandomNumberGenerator( NULL );
+        
+    }
+    
+    for (size_t i=0; i<replicates; ++i)
+    {
+        if ( failed[i] == true )
+        {
+            throw RbException( errors[i] );
+        }
     }
     
     if ( verbose == true && process_active == true )
@@ -250,6 +312,70 @@ void MonteCarloAnalysis::disableScreenMonitors(bool all)
 }
 
 
+/**
+ * Get the name of the checkpoint file for this process.
+ * If the analysis runs on several processes, then each process writes the state of its own samplers into a separate file.
+ */
+std::string MonteCarloAnalysis::getCheckpointFileName(const std::string &f) const
+{
+    
+    if ( num_processes > 1 )
+    {
+        std::stringstream ss;
+        ss << f << "_pid_" << pid;
+        return ss.str();
+    }
+    
+    return f;
+}
+
+
+/**
+ * Get the next generation after g at which all replicates need to be at the same generation.
+ * This is the case when we write a checkpoint, when a convergence rule compares the replicates
+ * or when a threshold rule tells us to stop.
+ * In between, the replicates can run independently of each other.
+ * We synchronize at least every 100 generations so that time-based stopping rules are checked regularly,
+ * and every generation if the replicates are not run in parallel anyway.
+ */
+size_t MonteCarloAnalysis::getNextSynchronizationGeneration(size_t g, RbVector<StoppingRule> &rules) const
+{
+    
+    size_t num_threads = RbSettings::userSettings().getNumberOfThreads();
+    size_t max_block_length = ( num_threads > 1 && replicates > 1 ? 100 : 1 );
+    
+    size_t next = g + 1;
+    while ( next - g < max_block_length )
+    {
+        
+        if ( checkpoint_interval > 0 && next % checkpoint_interval == 0 )
+        {
+            break;
+        }
+        
+        bool synchronize = false;
+        for (size_t i=0; i<rules.size() && synchronize == false; ++i)
+        {
+            
+            if ( rules[i].checkAtIteration(next) == true )
+            {
+                synchronize = rules[i].isConvergenceRule() || rules[i].stop( next );
+            }
+            
+        }
+        
+        if ( synchronize == true )
+        {
+            break;
+        }
+        
+        ++next;
+    }
+    
+    return next;
+}
+
+
 size_t MonteCarloAnalysis::getCurrentGeneration( void ) const
 {
     
@@ -284,6 +410,98 @@ const Model& MonteCarloAnalysis::getModel( void ) const
 }
 
 
+/**
+ * Restore the complete state of the analysis from a checkpoint written by writeCheckpoint.
+ * The analysis needs to be set up with the same model, moves, monitors and number of replicates.
+ * A following call to run continues exactly as the analysis would have if it had not been interrupted.
+ *
+ * \param[in]   f   The name of the checkpoint file.
+ */
+void MonteCarloAnalysis::initializeFromCheckpoint(const std::string &f)
+{
+    
+    std::string fn = getCheckpointFileName( f );
+    std::ifstream in( fn.c_str() );
+    if ( in.is_open() == false )
+    {
+        throw RbException("Could not open checkpoint file '" + fn + "'.");
+    }
+    
+    std::string header = "";
+    std::getline(in, header);
+    if ( header != "RevBayes checkpoint 1" )
+    {
+        throw RbException("The file '" + fn + "' is not a RevBayes checkpoint file.");
+    }
+    
+    MonteCarloSampler::readCheckpointToken(in, "rng");
+    std::string rng_state = MonteCarloSampler::readCheckpointString(in);
+    
+    MonteCarloSampler::readCheckpointToken(in, "replicates");
+    size_t n = 0;
+    size_t num_rngs = 0;
+    in >> n >> num_rngs;
+    if ( n != replicates || (num_rngs != 0 && num_rngs != replicates) )
+    {
+        throw RbException("The checkpoint was written for a different number of replicates.");
+    }
+    
+    std::vector<RandomNumberGenerator> rngs = std::vector<RandomNumberGenerator>( num_rngs );
+    for (size_t i = 0; i < num_rngs; ++i)
+    {
+        rngs[i].setState( MonteCarloSampler::readCheckpointString(in) );
+    }
+    
+    for (size_t i = 0; i < replicates; ++i)
+    {
+        MonteCarloSampler::readCheckpointToken(in, "replicate");
+        size_t j = 0;
+        bool present = false;
+        in >> j >> present;
+        if ( j != i || present != (runs[i] != NULL) )
+        {
+            throw RbException("The checkpoint was written for a different assignment of replicates to processes.");
+        }
+        
+        if ( runs[i] != NULL )
+        {
+            runs[i]->readCheckpoint( in );
+        }
+    }
+    
+    MonteCarloSampler::readCheckpointToken(in, "end");
+    
+    // the random number generators need to be restored last because recomputing the probabilities could use them
+    GLOBAL_RNG->setState( rng_state );
+    replicate_rngs = rngs;
+    
+    restored_from_checkpoint = true;
+    
+}
+
+
+/**
+ * Create the random number streams of the replicates.
+ * If there is more than one replicate, each replicate draws its random numbers from its own stream,
+ * so that the replicates can run in parallel threads and give the same results for any number of threads.
+ * The streams are substreams of a generator seeded from the global random number generator and are kept across runs.
+ */
+void MonteCarloAnalysis::initializeReplicateRandomNumberGenerators( void )
+{
+    
+    if ( replicates > 1 && replicate_rngs.size() != replicates )
+    {
+        RandomNumberGenerator replicate_rng = RandomNumberGenerator( GLOBAL_RNG->uniform64() );
+        replicate_rngs = std::vector<RandomNumberGenerator>( replicates );
+        for (size_t i = 0; i < replicates; ++i)
+        {
+            replicate_rngs[i] = replicate_rng.getSubstream( i );
+        }
+    }
+    
+}
+
+
 void MonteCarloAnalysis::initializeFromTrace( RbVector<ModelTrace> traces )
 {
     size_t n_samples = traces[0].getSamples();
@@ -398,6 +616,9 @@ void MonteCarloAnalysis::resetReplicates( void )
         throw RbException("Bug: No template sampler found!");
     }
     
+    // the new replicates get new random number streams
+    replicate_rngs.clear();
+    
     // create replicate Monte Carlo samplers
     bool no_sampler_set = true;
     for (size_t i = 0; i < replicates; ++i)
@@ -552,15 +773,17 @@ void MonteCarloAnalysis::run( size_t kIterations, RbVector<StoppingRule> rules,
     }
 
     // reset the counters for the move schedules
+    // unless we continue from a checkpoint, which already contains the counters
     for (size_t i=0; i<replicates; ++i)
     {
         
-        if ( runs[i] != NULL )
+        if ( runs[i] != NULL && restored_from_checkpoint == false )
         {
             runs[i]->reset();
         }
         
     }
+    restored_from_checkpoint = false;
 
     // reset the stopping rules
     for (size_t i=0; i<rules.size(); ++i)
@@ -571,23 +794,22 @@ void MonteCarloAnalysis::run( size_t kIterations, RbVector<StoppingRule> rules,
         
     }
 
+    initializeReplicateRandomNumberGenerators();
+    
     // Run the chain
     bool finished = false;
     bool converged = false;
     do {
         
-        ++gen;
-        for (size_t i=0; i<replicates; ++i)
+        // run the replicates independently until they need to be synchronized
+        size_t next_gen = getNextSynchronizationGeneration(gen, rules);
+        runReplicates(gen+1, next_gen);
+        gen = next_gen;
+        
+        // write the checkpoint
+        if ( checkpoint_interval > 0 && gen % checkpoint_interval == 0 )
         {
-            
-            if ( runs[i] != NULL )
-            {
-                runs[i]->nextCycle(true);
-            
-                // Monitor
-                runs[i]->monitor(gen);
-            }
-            
+            writeCheckpoint();
         }
         
         converged = true;
@@ -728,20 +950,18 @@ void MonteCarloAnalysis::runPriorSampler( size_t kIterations, RbVector<StoppingR
     }
     
     
+    initializeReplicateRandomNumberGenerators();
+    
     // Run the chain
     bool finished = false;
     bool converged = false;
     size_t gen = runs[0]->getCurrentGeneration();
     do {
-        ++gen;
-        for (size_t i=0; i<replicates; ++i)
-        {
-            runs[i]->nextCycle(true);
-            
-            // Monitor
-            runs[i]->monitor(gen);
-            
-        }
+        
+        // run the replicates independently until they need to be synchronized
+        size_t next_gen = getNextSynchronizationGeneration(gen, rules);
+        runReplicates(gen+1, next_gen);
+        gen = next_gen;
         
         converged = true;
         size_t numConvergenceRules = 0;
@@ -771,6 +991,69 @@ void MonteCarloAnalysis::runPriorSampler( size_t kIterations, RbVector<StoppingR
 }
 
 
+/**
+ * Run all replicates of this process from the first to the last generation (inclusive).
+ * The replicates are independent of each other, hence they run in separate threads,
+ * each one drawing from its own random number stream.
+ */
+void MonteCarloAnalysis::runReplicates(size_t first, size_t last)
+{
+    
+    std::vector<std::string> errors = std::vector<std::string>(replicates, "");
+    std::vector<char> failed = std::vector<char>(replicates, false);
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+#   pragma omp parallel for schedule(dynamic) num_threads(num_threads) if(num_threads > 1 && replicates > 1)
+    for (int i=0; i<int(replicates); ++i)
+    {
+        
+        if ( runs[i] == NULL )
+        {
+            continue;
+        }
+        
+        RandomNumberFactory::randomNumberFactoryInstance().setThreadRandomNumberGenerator( replicate_rngs.empty() ? NULL : &replicate_rngs[i] );
+        
+        try
+        {
+            for (size_t gen=first; gen<=last; ++gen)
+            {
+                runs[i]->nextCycle(true);
+                
+                // Monitor
+                runs[i]->monitor(gen);
+            }
+        }
+        catch (RbException &e)
+        {
+            errors[i] = e.getMessage();
+            failed[i] = true;
+        }
+        catch (std::exception &e)
+        {
+            errors[i] = e.what();
+            failed[i] = true;
+        }
+        catch (...)
+        {
+            errors[i] = "Unknown error in replicate " + StringUtilities::toString(i+1) + ".";
+            failed[i] = true;
+        }
+        
+        RandomNumberFactory::randomNumberFactoryInstance().setThreadRandomNumberGenerator( NULL );
+        
+    }
+    
+    for (size_t i=0; i<replicates; ++i)
+    {
+        if ( failed[i] == true )
+        {
+            throw RbException( errors[i] );
+        }
+    }
+    
+}
+
+
 /**
  * Set the active PID of this specific Monte Carlo analysis.
  */
@@ -782,6 +1065,19 @@ void MonteCarloAnalysis::setActivePIDSpecialized(size_t a, size_t n)
 }
 
 
+/**
+ * Set the file into which we write a checkpoint every i generations during a run.
+ * An interval of 0 disables the checkpoints.
+ */
+void MonteCarloAnalysis::setCheckpointFile(const std::string &f, size_t i)
+{
+    
+    checkpoint_file     = f;
+    checkpoint_interval = ( f == "" ? 0 : i );
+    
+}
+
+
 /**
  * Set the model by delegating the model to the Monte Carlo samplers (replicates).
  */
@@ -813,3 +1109,56 @@ void MonteCarloAnalysis::setModel(Model *m)
     resetReplicates();
 
 }
+
+
+/**
+ * Write the complete state of the analysis into the checkpoint file.
+ * We first write into a temporary file and then rename it, so that the previous checkpoint
+ * stays intact if the program is interrupted while writing.
+ */
+void MonteCarloAnalysis::writeCheckpoint( void ) const
+{
+    
+    std::string fn = getCheckpointFileName( checkpoint_file );
+    std::string tmp_fn = fn + ".tmp";
+    
+    std::ofstream out( tmp_fn.c_str(), std::ios::out | std::ios::trunc );
+    if ( out.is_open() == false )
+    {
+        throw RbException("Could not open checkpoint file '" + tmp_fn + "'.");
+    }
+    
+    out << "RevBayes checkpoint 1\n";
+    out << "rng ";
+    MonteCarloSampler::writeCheckpointString(out, GLOBAL_RNG->getState());
+    out << "replicates " << replicates << " " << replicate_rngs.size() << "\n";
+    for (size_t i = 0; i < replicate_rngs.size(); ++i)
+    {
+        MonteCarloSampler::writeCheckpointString(out, replicate_rngs[i].getState());
+    }
+    for (size_t i = 0; i < replicates; ++i)
+    {
+        out << "replicate " << i << " " << (runs[i] != NULL) << "\n";
+        if ( runs[i] != NULL )
+        {
+            runs[i]->writeCheckpoint( out );
+        }
+    }
+    out << "end\n";
+    
+    out.close();
+    if ( out.fail() == true )
+    {
+        throw RbException("Could not write checkpoint file '" + tmp_fn + "'.");
+    }
+    
+#	ifdef RB_WIN
+    // rename does not replace an existing file on windows
+    std::remove( fn.c_str() );
+#	endif
+    if ( std::rename( tmp_fn.c_str(), fn.c_str() ) != 0 )
+    {
+        throw RbException("Could not replace checkpoint file '" + fn + "'.");
+    }
+    
+}
@@ -5,9 +5,11 @@
 #include "MonteCarloSampler.h"
 #include "ModelTrace.h"
 #include "Parallelizable.h"
+#include "RandomNumberGenerator.h"
 #include "RbVector.h"
 #include "StoppingRule.h"
 
+#include <string>
 #include <vector>
 
 
@@ -46,6 +48,7 @@ namespace RevBayesCore {
         void                                                disableScreenMonitors(bool all);
         size_t                                              getCurrentGeneration(void) const;                               //!< Get the current generations number
         const Model&                                        getModel(void) const;
+        void                                                initializeFromCheckpoint(const std::string &f);                 //!< Restore the complete state of the analysis from a checkpoint file
         void                                                initializeFromTrace( RbVector<ModelTrace> traces );
         void                                                printPerformanceSummary(void) const;
         void                                                removeMonitors(void);                                           //!< Remove all monitors
@@ -55,14 +58,25 @@ namespace RevBayesCore {
         void                                                run(size_t k, RbVector<StoppingRule> r, bool verbose=true);
 #endif
         void                                                runPriorSampler(size_t k, RbVector<StoppingRule> r);
+        void                                                setCheckpointFile(const std::string &f, size_t i);             //!< Set the file and the interval for writing checkpoints during a run
         void                                                setModel(Model *m);
+        void                                                writeCheckpoint(void) const;                                    //!< Write the complete state of the analysis into the checkpoint file
         
     protected:
+        std::string                                         getCheckpointFileName(const std::string &f) const;              //!< The name of the checkpoint file of this process
+        size_t                                              getNextSynchronizationGeneration(size_t g, RbVector<StoppingRule> &r) const;   //!< The next generation at which all replicates need to be at the same generation
+        void                                                initializeReplicateRandomNumberGenerators(void);                //!< Create the random number streams of the replicates
+        void                                                runReplicates(size_t first, size_t last);                       //!< Run all replicates from the first to the last generation
         void                                                setActivePIDSpecialized(size_t i, size_t n);                    //!< Set the number of processes for this class.
         void                                                resetReplicates(void);
         
         size_t                                              replicates;
         std::vector<MonteCarloSampler*>                     runs;
+        std::vector<RandomNumberGenerator>                  replicate_rngs;                                                 //!< The random number streams of the replicates (empty if there is only one replicate)
+        
+        std::string                                         checkpoint_file;                                                //!< The file into which we write checkpoints (empty if none)
+        size_t                                              checkpoint_interval;                                            //!< Write a checkpoint every so many generations (0 if never)
+        bool                                                restored_from_checkpoint;                                       //!< Was the state restored from a checkpoint and not yet used by a run?
         
     };
     
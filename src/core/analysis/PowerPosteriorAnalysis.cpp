@@ -10,9 +10,15 @@
 #include "RbException.h"
 #include "RbFileManager.h"
 #include "RbOptions.h"
+#include "RbSettings.h"
 #include "SequenctialMoveSchedule.h"
+#include "StringUtilities.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
 #include <typeinfo>
 
 
@@ -27,7 +33,9 @@ PowerPosteriorAnalysis::PowerPosteriorAnalysis(MonteCarloSampler *m, const std::
     powers(),
     sampler( m ),
     sampleFreq( 100 ),
-    processors_per_likelihood( k )
+    processors_per_likelihood( k ),
+    num_adaptive_stones( 0 ),
+    stone_seed( 0 )
 {
     
     initMPI();
@@ -39,7 +47,9 @@ PowerPosteriorAnalysis::PowerPosteriorAnalysis(const PowerPosteriorAnalysis &a)
     powers( a.powers ),
     sampler( a.sampler->clone() ),
     sampleFreq( a.sampleFreq ),
-    processors_per_likelihood( a.processors_per_likelihood )
+    processors_per_likelihood( a.processors_per_likelihood ),
+    num_adaptive_stones( a.num_adaptive_stones ),
+    stone_seed( a.stone_seed )
 {
     
 }
@@ -70,6 +80,8 @@ PowerPosteriorAnalysis& PowerPosteriorAnalysis::operator=(const PowerPosteriorAn
         sampler                         = a.sampler->clone();
         sampleFreq                      = a.sampleFreq;
         processors_per_likelihood       = a.processors_per_likelihood;
+        num_adaptive_stones             = a.num_adaptive_stones;
+        stone_seed                      = a.stone_seed;
         
     }
     
@@ -154,6 +166,113 @@ PowerPosteriorAnalysis* PowerPosteriorAnalysis::clone( void ) const
 }
 
 
+/**
+ * Compute the powers of n new stones.
+ * For each interval between neighboring powers we estimate the variance of the log of the stepping-stone ratio
+ * from the likelihood samples of the stone with the smaller power (using the delta method),
+ * and we bisect the n intervals with the largest variance.
+ */
+std::vector<double> PowerPosteriorAnalysis::computeAdaptivePowers( size_t n ) const
+{
+    
+    std::vector<size_t> order = getStoneOrder();
+    
+    std::vector<double> variances;
+    for (size_t k = 0; k+1 < order.size(); ++k)
+    {
+        double beta_diff = powers[order[k]] - powers[order[k+1]];
+        std::vector<double> samples = readStoneLikelihoods( order[k+1] );
+        
+        double variance = 0.0;
+        size_t num_samples = samples.size();
+        if ( num_samples > 1 && beta_diff > 0.0 )
+        {
+            double max = samples[0];
+            for (size_t j = 1; j < num_samples; ++j)
+            {
+                if ( max < samples[j] )
+                {
+                    max = samples[j];
+                }
+            }
+            
+            double mean = 0.0;
+            double mean_squares = 0.0;
+            for (size_t j = 0; j < num_samples; ++j)
+            {
+                double w = exp( (samples[j]-max)*beta_diff );
+                mean += w / num_samples;
+                mean_squares += w * w / num_samples;
+            }
+            
+            variance = (mean_squares - mean*mean) / (num_samples * mean*mean);
+        }
+        
+        variances.push_back( variance );
+    }
+    
+    std::vector<double> new_powers;
+    for (size_t i = 0; i < n; ++i)
+    {
+        size_t max_index = variances.size();
+        for (size_t k = 0; k < variances.size(); ++k)
+        {
+            if ( variances[k] > 0.0 && ( max_index == variances.size() || variances[k] > variances[max_index] ) )
+            {
+                max_index = k;
+            }
+        }
+        
+        // there is no interval left with an uncertain ratio
+        if ( max_index == variances.size() )
+        {
+            break;
+        }
+        
+        new_powers.push_back( (powers[order[max_index]] + powers[order[max_index+1]]) / 2.0 );
+        variances[max_index] = -1.0;
+    }
+    
+    return new_powers;
+}
+
+
+std::string PowerPosteriorAnalysis::getStoneFileName( size_t idx ) const
+{
+    
+    RbFileManager fm = RbFileManager(filename);
+    std::string stoneFileName = fm.getFileNameWithoutExtension() + "_stone_" + idx + "." + fm.getFileExtension();
+    
+    RbFileManager f = RbFileManager(fm.getFilePath(), stoneFileName);
+    
+    return f.getFullFileName();
+}
+
+
+/**
+ * Get the indices of the stones sorted by decreasing power, which is the order expected by the marginal likelihood estimators.
+ * Adaptively placed stones are appended to the powers, so their indices are not sorted.
+ */
+std::vector<size_t> PowerPosteriorAnalysis::getStoneOrder( void ) const
+{
+    
+    std::vector<std::pair<double, size_t> > sorted_powers;
+    for (size_t i = 0; i < powers.size(); ++i)
+    {
+        sorted_powers.push_back( std::pair<double, size_t>( -powers[i], i ) );
+    }
+    std::sort( sorted_powers.begin(), sorted_powers.end() );
+    
+    std::vector<size_t> order;
+    for (size_t i = 0; i < sorted_powers.size(); ++i)
+    {
+        order.push_back( sorted_powers[i].second );
+    }
+    
+    return order;
+}
+
+
 void PowerPosteriorAnalysis::initMPI( void )
 {
     
@@ -170,6 +289,45 @@ void PowerPosteriorAnalysis::initMPI( void )
 }
 
 
+/**
+ * Read the likelihood samples of the idx-th stone from its file.
+ */
+std::vector<double> PowerPosteriorAnalysis::readStoneLikelihoods( size_t idx ) const
+{
+    
+    std::vector<double> samples;
+    
+    std::ifstream inStream;
+    inStream.open( getStoneFileName( idx ).c_str(), std::fstream::in);
+    if ( inStream.is_open() == false )
+    {
+        throw RbException( "Problem reading stone " + StringUtilities::toString(idx+1) + " from file " + getStoneFileName( idx ) + "." );
+    }
+    
+    bool header = true;
+    std::string line = "";
+    while ( std::getline (inStream,line) )
+    {
+        // we need to skip the header line
+        if ( header == true )
+        {
+            header = false;
+            continue;
+        }
+        
+        std::vector<std::string> columns;
+        StringUtilities::stringSplit( line, "\t", columns );
+        if ( columns.size() > 2 )
+        {
+            samples.push_back( atof( columns[2].c_str() ) );
+        }
+    }
+    inStream.close();
+    
+    return samples;
+}
+
+
 void PowerPosteriorAnalysis::runAll(size_t gen)
 {
 
@@ -186,26 +344,42 @@ void PowerPosteriorAnalysis::runAll(size_t gen)
         std::cout << "Running power posterior analysis ..." << std::endl;
     }
     
-    // compute which block of the data this process needs to compute
-//    size_t stone_block_start = size_t(floor( (double(pid)   / num_processes ) * powers.size()) );
-//    size_t stone_block_end   = size_t(floor( (double(pid+1) / num_processes ) * powers.size()) );
+    // the seed of the random number streams of the stones
+    stone_seed = GLOBAL_RNG->uniform64();
     
-    size_t stone_block_start =  floor( ( floor( pid   /double(processors_per_likelihood)) / (double(num_processes) / processors_per_likelihood) ) * powers.size() );
-    size_t stone_block_end   =  floor( ( ceil( (pid+1)/double(processors_per_likelihood)) / (double(num_processes) / processors_per_likelihood) ) * powers.size() );
-    
-    // Run the chain
-    for (size_t i = stone_block_start; i < stone_block_end; ++i)
+    // Run the initial stones
+    std::vector<size_t> stones;
+    for (size_t i = 0; i < powers.size(); ++i)
     {
-    
-        // run the i-th stone
-        runStone(i, gen);
+        stones.push_back( i );
+    }
+    runStones( stones, gen );
+    
+    // place the additional stones where the stepping-stone ratios are most uncertain
+    // we add as many stones at once as we can run in parallel
+    const size_t num_threads = RbSettings::userSettings().getNumberOfThreads();
+    const size_t num_parallel_stones = (num_threads > 0 ? num_threads : 1) * std::max<size_t>( 1, num_processes / processors_per_likelihood );
+    size_t num_added_stones = 0;
+    while ( num_added_stones < num_adaptive_stones )
+    {
+        
+        std::vector<double> new_powers = computeAdaptivePowers( std::min( num_adaptive_stones - num_added_stones, num_parallel_stones ) );
+        if ( new_powers.empty() == true )
+        {
+            break;
+        }
+        
+        stones.clear();
+        for (size_t i = 0; i < new_powers.size(); ++i)
+        {
+            stones.push_back( powers.size() );
+            powers.push_back( new_powers[i] );
+        }
+        runStones( stones, gen );
         
+        num_added_stones += new_powers.size();
     }
     
-#ifdef RB_MPI
-    // wait until all chains complete
-    MPI::COMM_WORLD.Barrier();
-#endif
     if ( process_active == true )
     {
         summarizeStones();
@@ -214,15 +388,19 @@ void PowerPosteriorAnalysis::runAll(size_t gen)
 }
 
 
-
 void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen)
 {
     
-    // create the directory if necessary
-    RbFileManager fm = RbFileManager(filename);
-    std::string stoneFileName = fm.getFileNameWithoutExtension() + "_stone_" + idx + "." + fm.getFileExtension();
+    runStone( sampler, idx, gen, process_active );
+    
+}
 
-    RbFileManager f = RbFileManager(fm.getFilePath(), stoneFileName);
+
+void PowerPosteriorAnalysis::runStone(MonteCarloSampler *s, size_t idx, size_t gen, bool verbose)
+{
+    
+    // create the directory if necessary
+    RbFileManager f = RbFileManager( getStoneFileName( idx ) );
     f.createDirectoryForFile();
     
     std::fstream outStream;
@@ -230,7 +408,7 @@ void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen)
     outStream << "state\t" << "power\t" << "likelihood" << std::endl;
     
     // reset the sampler
-    sampler->reset();
+    s->reset();
 
     
     size_t burnin = size_t( ceil( 0.25*gen ) );
@@ -239,7 +417,7 @@ void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen)
     size_t digits = size_t( ceil( log10( powers.size() ) ) );
     
     // print output for users
-    if ( process_active ==true )
+    if ( verbose == true )
     {
         std::cout << "Step ";
         for (size_t d = size_t( ceil( log10( idx+1.1 ) ) ); d < digits; d++ )
@@ -251,23 +429,23 @@ void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen)
     }
     
     // set the power of this sampler
-    sampler->setLikelihoodHeat( powers[idx] );
+    s->setLikelihoodHeat( powers[idx] );
     
     std::stringstream ss;
     ss << "_stone_" << idx;
-    sampler->addFileMonitorExtension( ss.str(), false);
+    s->addFileMonitorExtension( ss.str(), false);
     
     
     // Monitor
-    sampler->startMonitors(gen, false);
-    sampler->writeMonitorHeaders();
-    sampler->monitor(0);
+    s->startMonitors(gen, false);
+    s->writeMonitorHeaders();
+    s->monitor(0);
     
     double p = powers[idx];
     for (size_t k=1; k<=gen; ++k)
     {
         
-        if ( process_active == true )
+        if ( verbose == true )
         {
             if ( k % printInterval == 0 )
             {
@@ -276,22 +454,22 @@ void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen)
             }
         }
         
-        sampler->nextCycle( true );
+        s->nextCycle( true );
 
         // Monitor
-        sampler->monitor(k);
+        s->monitor(k);
         
         // sample the likelihood
         if ( k > burnin && k % sampleFreq == 0 )
         {
             // compute the joint likelihood
-            double likelihood = sampler->getModelLnProbability();
+            double likelihood = s->getModelLnProbability();
             outStream << k << "\t" << p << "\t" << likelihood << std::endl;
         }
             
     }
     
-    if ( process_active == true )
+    if ( verbose == true )
     {
         std::cout << std::endl;
     }
@@ -299,11 +477,125 @@ void PowerPosteriorAnalysis::runStone(size_t idx, size_t gen)
     outStream.close();
     
     // Monitor
-    sampler->finishMonitors( 1 );
+    s->finishMonitors( 1 );
     
 }
 
 
+/**
+ * Run the given stones. Each process runs its block of the stones and the stones of a block run in parallel threads.
+ * Every stone starts from its own copy of the sampler after burnin and uses the random number stream of its index,
+ * so the result of a stone does not depend on which process or thread runs it.
+ * We run the stones in waves of one stone per thread and copy the sampler before each wave, because copying the sampler is not thread safe.
+ */
+void PowerPosteriorAnalysis::runStones(const std::vector<size_t> &stones, size_t gen)
+{
+    
+    // compute which block of the stones this process needs to compute
+    size_t num_stones = stones.size();
+    size_t stone_block_start =  floor( ( floor( pid   /double(processors_per_likelihood)) / (double(num_processes) / processors_per_likelihood) ) * num_stones );
+    size_t stone_block_end   =  floor( ( ceil( (pid+1)/double(processors_per_likelihood)) / (double(num_processes) / processors_per_likelihood) ) * num_stones );
+    
+    RandomNumberGenerator stone_rng = RandomNumberGenerator( stone_seed );
+    
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+    const size_t wave_length = ( num_threads > 1 ? size_t(num_threads) : 1 );
+    for (size_t wave_start = stone_block_start; wave_start < stone_block_end; wave_start += wave_length)
+    {
+        
+        size_t wave_end = std::min( wave_start + wave_length, stone_block_end );
+        const int wave_size = int( wave_end - wave_start );
+        
+        // only a single stone at a time prints its progress
+        bool verbose = ( process_active == true && wave_length == 1 );
+        
+        std::vector<MonteCarloSampler*> samplers = std::vector<MonteCarloSampler*>(wave_size, NULL);
+        std::vector<RandomNumberGenerator> stone_rngs = std::vector<RandomNumberGenerator>(wave_size);
+        for (int i=0; i<wave_size; ++i)
+        {
+            samplers[i] = sampler->clone();
+            stone_rngs[i] = stone_rng.getSubstream( stones[wave_start+i] );
+            
+            // the screen monitors of the other stones would write to the screen at the same time
+            if ( verbose == false )
+            {
+                samplers[i]->disableScreenMonitor( true, 0 );
+            }
+        }
+        
+        std::vector<std::string> errors = std::vector<std::string>(wave_size, "");
+        std::vector<char> failed = std::vector<char>(wave_size, false);
+#       pragma omp parallel for schedule(dynamic) num_threads(num_threads) if(num_threads > 1 && wave_size > 1)
+        for (int i=0; i<wave_size; ++i)
+        {
+            
+            RandomNumberFactory::randomNumberFactoryInstance().setThreadRandomNumberGenerator( &stone_rngs[i] );
+            
+            try
+            {
+                // run the i-th stone of this wave
+                runStone( samplers[i], stones[wave_start+i], gen, verbose );
+            }
+            catch (RbException &e)
+            {
+                errors[i] = e.getMessage();
+                failed[i] = true;
+            }
+            catch (std::exception &e)
+            {
+                errors[i] = e.what();
+                failed[i] = true;
+            }
+            catch (...)
+            {
+                errors[i] = "Unknown error in step " + StringUtilities::toString( stones[wave_start+i]+1 ) + ".";
+                failed[i] = true;
+            }
+            
+            RandomNumberFactory::randomNumberFactoryInstance().setThreadRandomNumberGenerator( NULL );
+            
+        }
+        
+        for (int i=0; i<wave_size; ++i)
+        {
+            delete samplers[i];
+        }
+        
+        for (int i=0; i<wave_size; ++i)
+        {
+            if ( failed[i] == true )
+            {
+                throw RbException( errors[i] );
+            }
+        }
+        
+        if ( process_active == true && verbose == false )
+        {
+            for (size_t i=wave_start; i<wave_end; ++i)
+            {
+                std::cout << "Step " << (stones[i]+1) << " / " << powers.size() << std::endl;
+            }
+        }
+        
+    }
+    
+#ifdef RB_MPI
+    // wait until all chains complete
+    MPI::COMM_WORLD.Barrier();
+#endif
+    
+}
+
+
+void PowerPosteriorAnalysis::setAdaptiveStones(size_t n)
+{
+    num_adaptive_stones = n;
+}
+
+
+/**
+ * Combine the stones into a single file with the stones ordered by decreasing power.
+ */
 void PowerPosteriorAnalysis::summarizeStones( void )
 {
     // create the directory if necessary
@@ -315,16 +607,15 @@ void PowerPosteriorAnalysis::summarizeStones( void )
     outStream << "state\t" << "power\t" << "likelihood" << std::endl;
 
     // Append each stone
-    for (size_t idx = 0; idx < powers.size(); ++idx)
+    std::vector<size_t> order = getStoneOrder();
+    for (size_t i = 0; i < order.size(); ++i)
     {
-        RbFileManager fm = RbFileManager(filename);
-        std::string stoneFileName = fm.getFileNameWithoutExtension() + "_stone_" + idx + "." + fm.getFileExtension();
-        
-        RbFileManager f = RbFileManager(fm.getFilePath(), stoneFileName);
+        size_t idx = order[i];
+        std::string stoneFileName = getStoneFileName( idx );
 
         // read the i-th stone
         std::ifstream inStream;
-        inStream.open( f.getFullFileName().c_str(), std::fstream::in);
+        inStream.open( stoneFileName.c_str(), std::fstream::in);
         if (inStream.is_open())
         {
             bool header = true;
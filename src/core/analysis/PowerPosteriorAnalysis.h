@@ -5,6 +5,10 @@
 #include "Parallelizable.h"
 #include "RbVector.h"
 
+#include <boost/cstdint.hpp>
+#include <string>
+#include <vector>
+
 namespace RevBayesCore {
     
     class MonteCarloSampler;
@@ -16,6 +20,13 @@ namespace RevBayesCore {
      * where the likelihood during each analysis run is raised to the given power.
      * The likelihood values and the current powers are stored in a file.
      *
+     * The stones are independent of each other. Each stone runs on its own copy of the sampler (after burnin)
+     * and draws its random numbers from its own stream, so that the stones can run in parallel threads
+     * and the results do not depend on the number of threads or processes.
+     *
+     * Optionally, additional stones are placed adaptively: after the initial stones we repeatedly bisect the intervals
+     * between neighboring powers where the variance of the estimated stepping-stone ratio is largest.
+     *
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna)
@@ -37,12 +48,19 @@ namespace RevBayesCore {
         void                                    runAll(size_t g);
         void                                    runStone(size_t idx, size_t g);
         void                                    summarizeStones(void);
+        void                                    setAdaptiveStones(size_t n);
         void                                    setPowers(const std::vector<double> &p);
         void                                    setSampleFreq(size_t sf);
         
     private:
         
+        std::vector<double>                     computeAdaptivePowers(size_t n) const;                                          //!< Compute the powers of n new stones where the stepping-stone ratios are most uncertain
+        std::string                             getStoneFileName(size_t idx) const;
+        std::vector<size_t>                     getStoneOrder(void) const;                                                      //!< The stone indices sorted by decreasing power
         void                                    initMPI(void);
+        std::vector<double>                     readStoneLikelihoods(size_t idx) const;
+        void                                    runStone(MonteCarloSampler *s, size_t idx, size_t g, bool verbose);
+        void                                    runStones(const std::vector<size_t> &stones, size_t g);                        //!< Run the given stones of this process in parallel threads
         
         // members
         std::string                             filename;
@@ -50,6 +68,8 @@ namespace RevBayesCore {
         MonteCarloSampler*                      sampler;
         size_t                                  sampleFreq;                                                                     //!< The rate of the distribution
         size_t                                  processors_per_likelihood;
+        size_t                                  num_adaptive_stones;                                                            //!< The number of stones placed adaptively after the initial stones
+        boost::uint64_t                         stone_seed;                                                                     //!< The seed of the random number streams of the stones
 
     };
     
@@ -14,11 +14,16 @@
 #include "SingleRandomMoveSchedule.h"
 #include "RandomMoveSchedule.h"
 #include "ExtendedNewickTreeMonitor.h"
+#include "StochasticNode.h"
+#include "TopologyNode.h"
+#include "Tree.h"
 
 #include <unistd.h>
 
 #include <cmath>
 #include <iomanip>
+#include <limits>
+#include <map>
 #include <sstream>
 #include <typeinfo>
 
@@ -255,6 +260,47 @@ bool Mcmc::isChainActive(void)
 }
 
 
+/**
+ * Get the value of a variable in the format that we store in a checkpoint.
+ * Values are printed with all digits so that reading them back in restores them exactly.
+ * Trees are stored node by node (index, age, branch length and children) in the order of the nodes in the tree,
+ * because the newick representation would neither keep all digits nor the node indices and their order.
+ */
+std::string Mcmc::getCheckpointValue(const DagNode *n) const
+{
+    
+    std::stringstream ss;
+    ss.precision( std::numeric_limits<double>::digits10 + 2 );
+    
+    const StochasticNode<Tree> *tree_node = dynamic_cast< const StochasticNode<Tree>* >( n );
+    if ( tree_node != NULL )
+    {
+        const Tree &tau = tree_node->getValue();
+        size_t num_nodes = tau.getNumberOfNodes();
+        
+        ss << "tree " << num_nodes << "\n";
+        for (size_t i = 0; i < num_nodes; ++i)
+        {
+            const TopologyNode &node = tau.getNode( i );
+            ss << node.getIndex() << " " << node.getAge() << " " << node.getBranchLength() << " ";
+            ss << node.isFossil() << " " << node.isSampledAncestor() << " " << node.getNumberOfChildren();
+            for (size_t j = 0; j < node.getNumberOfChildren(); ++j)
+            {
+                ss << " " << node.getChild( j ).getIndex();
+            }
+            ss << " " << node.getName() << "\n";
+        }
+        
+    }
+    else
+    {
+        n->printValue(ss, ",", -1, true, false, false);
+    }
+    
+    return ss.str();
+}
+
+
 /**
  * Get the model instance.
  */
@@ -577,6 +623,128 @@ void Mcmc::printOperatorSummary(void) const
 }
 
 
+/**
+ * Restore the state of this chain from a checkpoint written by writeCheckpoint.
+ * The sampler needs to be initialized for the same model, moves and monitors as the one that wrote the checkpoint.
+ * We restore the values of all stochastic variables, the state of the moves and of the move schedule,
+ * and truncate the monitor files to the size they had when the checkpoint was written.
+ *
+ * \param[in]   in   The stream of the checkpoint file.
+ */
+void Mcmc::readCheckpoint(std::istream &in)
+{
+    
+    if ( schedule == NULL )
+    {
+        throw RbException("The MCMC needs to be initialized before it can be restored from a checkpoint.");
+    }
+    
+    readCheckpointToken(in, "mcmc");
+    size_t idx = 0;
+    in >> idx >> generation;
+    if ( idx != chain_idx )
+    {
+        throw RbException("The checkpoint belongs to a different chain.");
+    }
+    
+    readCheckpointToken(in, "heats");
+    in >> chain_likelihood_heat >> chain_posterior_heat >> chain_active;
+    
+    readCheckpointToken(in, "schedule");
+    schedule->setState( readCheckpointString(in) );
+    
+    readCheckpointToken(in, "moves");
+    size_t num_moves = 0;
+    in >> num_moves;
+    if ( num_moves != moves.size() )
+    {
+        throw RbException("The checkpoint was written for a different set of moves.");
+    }
+    for (size_t i = 0; i < num_moves; ++i)
+    {
+        size_t num_tried = 0;
+        size_t num_accepted = 0;
+        std::string tuning = "";
+        in >> num_tried >> num_accepted >> tuning;
+        
+        std::string name = readCheckpointString(in);
+        if ( name != moves[i].getMoveName() )
+        {
+            throw RbException("The checkpoint was written for a different set of moves.");
+        }
+        
+        moves[i].setNumberTried( num_tried );
+        moves[i].setNumberAccepted( num_accepted );
+        
+        // moves without a tuning parameter stored NaN
+        double tp = atof( tuning.c_str() );
+        if ( RbMath::isFinite( tp ) == true )
+        {
+            moves[i].setMoveTuningParameter( tp );
+        }
+    }
+    
+    readCheckpointToken(in, "monitors");
+    size_t num_monitors = 0;
+    in >> num_monitors;
+    if ( num_monitors != monitors.size() )
+    {
+        throw RbException("The checkpoint was written for a different set of monitors.");
+    }
+    std::vector<std::streamoff> offsets = std::vector<std::streamoff>(num_monitors, -1);
+    for (size_t i = 0; i < num_monitors; ++i)
+    {
+        in >> offsets[i];
+    }
+    
+    readCheckpointToken(in, "variables");
+    size_t num_variables = 0;
+    in >> num_variables;
+    std::vector<DagNode *> &dag_nodes = model->getDagNodes();
+    for (size_t i = 0; i < num_variables; ++i)
+    {
+        readCheckpointToken(in, "variable");
+        size_t node_index = 0;
+        in >> node_index;
+        std::string name  = readCheckpointString(in);
+        std::string value = readCheckpointString(in);
+        
+        if ( node_index >= dag_nodes.size() || dag_nodes[node_index]->getName() != name )
+        {
+            throw RbException("The checkpoint was written for a different model (variable '" + name + "' not found).");
+        }
+        
+        setValueFromCheckpoint( dag_nodes[node_index], value );
+    }
+    
+    readCheckpointToken(in, "end");
+    
+    // recompute the probabilities of the restored state
+    for (std::vector<DagNode *>::iterator it=dag_nodes.begin(); it!=dag_nodes.end(); ++it)
+    {
+        (*it)->touch( true );
+    }
+    for (std::vector<DagNode *>::iterator it=dag_nodes.begin(); it!=dag_nodes.end(); ++it)
+    {
+        (*it)->getLnProbability();
+    }
+    for (std::vector<DagNode *>::iterator it=dag_nodes.begin(); it!=dag_nodes.end(); ++it)
+    {
+        (*it)->keep();
+    }
+    
+    // only the active chain writes into the monitor files
+    if ( chain_active == true && process_active == true )
+    {
+        for (size_t i = 0; i < num_monitors; ++i)
+        {
+            monitors[i].truncateFile( offsets[i] );
+        }
+    }
+    
+}
+
+
 void Mcmc::replaceDag(const RbVector<Move> &mvs, const RbVector<Monitor> &mons)
 {
     
@@ -834,6 +1002,123 @@ void Mcmc::setModel( Model *m )
 }
 
 
+/**
+ * Set the value of a variable from the representation stored in a checkpoint (see getCheckpointValue).
+ */
+void Mcmc::setValueFromCheckpoint(DagNode *n, const std::string &v)
+{
+    
+    StochasticNode<Tree> *tree_node = dynamic_cast< StochasticNode<Tree>* >( n );
+    if ( tree_node != NULL )
+    {
+        const Tree &current_tree = tree_node->getValue();
+        
+        // we reuse the taxa of the current tree because they hold more information than just the name
+        std::map<std::string, Taxon> taxa;
+        for (size_t i = 0; i < current_tree.getNumberOfNodes(); ++i)
+        {
+            const TopologyNode &node = current_tree.getNode( i );
+            if ( node.getName() != "" )
+            {
+                taxa.insert( std::pair<std::string, Taxon>(node.getName(), node.getTaxon()) );
+            }
+        }
+        
+        std::stringstream ss(v);
+        std::string token = "";
+        size_t num_nodes = 0;
+        ss >> token >> num_nodes;
+        std::string line;
+        std::getline(ss, line);
+        
+        std::vector<size_t> order = std::vector<size_t>(num_nodes, 0);
+        std::vector<TopologyNode*> nodes = std::vector<TopologyNode*>(num_nodes, NULL);
+        std::vector<std::vector<size_t> > children = std::vector<std::vector<size_t> >(num_nodes);
+        std::vector<double> branch_lengths = std::vector<double>(num_nodes, 0.0);
+        std::vector<bool> is_child = std::vector<bool>(num_nodes, false);
+        for (size_t i = 0; i < num_nodes; ++i)
+        {
+            std::getline(ss, line);
+            std::stringstream ls(line);
+            
+            size_t index = 0;
+            std::string age = "";
+            std::string branch_length = "";
+            bool fossil = false;
+            bool sampled_ancestor = false;
+            size_t num_children = 0;
+            ls >> index >> age >> branch_length >> fossil >> sampled_ancestor >> num_children;
+            if ( ls.fail() || index >= num_nodes || nodes[index] != NULL )
+            {
+                throw RbException("Malformed tree in checkpoint for variable '" + n->getName() + "'.");
+            }
+            order[i] = index;
+            for (size_t j = 0; j < num_children; ++j)
+            {
+                size_t child = 0;
+                ls >> child;
+                children[index].push_back( child );
+                is_child[child] = true;
+            }
+            
+            // the remainder of the line is the name of the node
+            std::string name = "";
+            ls.get();
+            std::getline(ls, name);
+            
+            TopologyNode *node = NULL;
+            if ( name == "" )
+            {
+                node = new TopologyNode( index );
+            }
+            else if ( taxa.find( name ) != taxa.end() )
+            {
+                node = new TopologyNode( taxa[name], index );
+            }
+            else
+            {
+                node = new TopologyNode( name, index );
+            }
+            node->setAge( atof( age.c_str() ), false );
+            node->setFossil( fossil );
+            node->setSampledAncestor( sampled_ancestor );
+            branch_lengths[index] = atof( branch_length.c_str() );
+            nodes[index] = node;
+        }
+        
+        TopologyNode *root = NULL;
+        for (size_t i = 0; i < num_nodes; ++i)
+        {
+            for (size_t j = 0; j < children[i].size(); ++j)
+            {
+                nodes[i]->addChild( nodes[children[i][j]] );
+                nodes[children[i][j]]->setParent( nodes[i] );
+            }
+            if ( is_child[i] == false )
+            {
+                root = nodes[i];
+            }
+        }
+        
+        // set the branch lengths last, because linking the nodes recomputes them from the ages
+        for (size_t i = 0; i < num_nodes; ++i)
+        {
+            nodes[i]->setBranchLength( branch_lengths[i] );
+        }
+        
+        Tree *tau = current_tree.clone();
+        tau->setRoot( root, false );
+        tau->orderNodes( order );
+        tree_node->setValue( tau );
+    }
+    else
+    {
+        n->setValueFromString( v );
+    }
+    
+}
+
+
 void Mcmc::setScheduleType(const std::string &s)
 {
     
@@ -861,6 +1146,63 @@ void Mcmc::startMonitors( size_t num_cycles, bool reopen )
     
 }
 
+/**
+ * Write the complete state of this chain into a checkpoint.
+ * This contains the generation, the heats, the state of the move schedule and of all moves,
+ * the current sizes of the monitor files and the values of all stochastic variables.
+ * All numbers are written with all digits so that a chain resumed by readCheckpoint continues exactly as if it was never stopped.
+ *
+ * \param[in]   out   The stream of the checkpoint file.
+ */
+void Mcmc::writeCheckpoint(std::ostream &out)
+{
+    
+    out.precision( std::numeric_limits<double>::digits10 + 2 );
+    
+    out << "mcmc " << chain_idx << " " << generation << "\n";
+    out << "heats " << chain_likelihood_heat << " " << chain_posterior_heat << " " << chain_active << "\n";
+    
+    out << "schedule ";
+    writeCheckpointString(out, schedule != NULL ? schedule->getState() : "");
+    
+    out << "moves " << moves.size() << "\n";
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        out << moves[i].getNumberTried() << " " << moves[i].getNumberAccepted() << " " << moves[i].getMoveTuningParameter() << " ";
+        writeCheckpointString(out, moves[i].getMoveName());
+    }
+    
+    out << "monitors " << monitors.size() << "\n";
+    for (size_t i = 0; i < monitors.size(); ++i)
+    {
+        out << monitors[i].getFileOffset() << "\n";
+    }
+    
+    // we only need the values of the free stochastic variables because all other values are determined by those
+    const std::vector<DagNode *> &dag_nodes = model->getDagNodes();
+    std::vector<size_t> variables;
+    for (size_t i = 0; i < dag_nodes.size(); ++i)
+    {
+        if ( dag_nodes[i]->isStochastic() == true && dag_nodes[i]->isClamped() == false )
+        {
+            variables.push_back( i );
+        }
+    }
+    
+    out << "variables " << variables.size() << "\n";
+    for (size_t i = 0; i < variables.size(); ++i)
+    {
+        const DagNode *the_node = dag_nodes[ variables[i] ];
+        out << "variable " << variables[i] << " ";
+        writeCheckpointString(out, the_node->getName());
+        writeCheckpointString(out, getCheckpointValue( the_node ));
+    }
+    
+    out << "end\n";
+    
+}
+
+
 /**
  * Write the header for each of the monitors.
  */
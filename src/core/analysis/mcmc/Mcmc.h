@@ -51,6 +51,7 @@ namespace RevBayesCore {
         void                                                nextCycle(bool advanceCycle);
         bool                                                isChainActive(void);
         void                                                printOperatorSummary(void) const;
+        void                                                readCheckpoint(std::istream &in);                                                       //!< Restore the state of the chain from a checkpoint
         void                                                redrawStartingValues(void);                                                             //!< Redraw the starting values.
         void                                                removeMonitors(void);
         void                                                reset(void);                                                                            //!< Reset the sampler and set all the counters back to 0.
@@ -63,13 +64,16 @@ namespace RevBayesCore {
         void                                                setScheduleType(const std::string &s);                                                  //!< Set the type of the move schedule
         void                                                startMonitors(size_t numCycles, bool reopen);                                           //!< Start the monitors
         void                                                tune(void);                                                                             //!< Tune the sampler and its moves.
+        void                                                writeCheckpoint(std::ostream &out);                                                     //!< Write the state of the chain into a checkpoint
         void                                                writeMonitorHeaders(void);                                                              //!< Write the headers of the monitors
         
         
     protected:
+        std::string                                         getCheckpointValue(const DagNode *n) const;                                             //!< Get the value of a variable as stored in a checkpoint
         void                                                initializeMonitors(void);                                                               //!< Assign model and mcmc ptrs to monitors
         void                                                replaceDag(const RbVector<Move> &mvs, const RbVector<Monitor> &mons);
         void                                                setActivePIDSpecialized(size_t i, size_t n);                                                      //!< Set the number of processes for this class.
+        void                                                setValueFromCheckpoint(DagNode *n, const std::string &v);                               //!< Set the value of a variable from its checkpoint representation
 
         
         bool                                                chain_active;
@@ -6,25 +6,28 @@
 #include "RbException.h"
 
 #include <iostream>
+#include <limits>
 #include <vector>
 #include <cmath>
 
-#ifdef RB_MPI
-#include <mpi.h>
-#endif
-
 using namespace RevBayesCore;
 
-Mcmcmc::Mcmcmc(const Model& m, const RbVector<Move> &mv, const RbVector<Monitor> &mn, std::string sT, size_t nc, size_t si, double dt) : MonteCarloSampler( ),
+Mcmcmc::Mcmcmc(const Model& m, const RbVector<Move> &mv, const RbVector<Monitor> &mn, std::string sT, size_t nc, size_t si, double dt, size_t ns) : MonteCarloSampler( ),
     num_chains(nc),
     schedule_type(sT),
     current_generation(0),
     swap_interval(si),
+    swaps_per_round(ns),
     active_chain_index( 0 ),
     delta( dt ),
     generation( 0 ),
     numAttemptedSwaps( 0 ),
-    numAcceptedSwaps( 0 )
+    numAcceptedSwaps( 0 ),
+    swap_rng(),
+    swap_rng_initialized( false )
+#ifdef RB_MPI
+    ,swap_comm( MPI_COMM_NULL )
+#endif
 {
     
     // initialize container sizes
@@ -42,13 +45,19 @@ Mcmcmc::Mcmcmc(const Model& m, const RbVector<Move> &mv, const RbVector<Monitor>
     initializeChains();
 }
 
-Mcmcmc::Mcmcmc(const Mcmcmc &m) : MonteCarloSampler(m)
+Mcmcmc::Mcmcmc(const Mcmcmc &m) : MonteCarloSampler(m),
+    swap_rng(),
+    swap_rng_initialized( false )
+#ifdef RB_MPI
+    ,swap_comm( MPI_COMM_NULL )
+#endif
 {
     
     delta               = m.delta;
     num_chains          = m.num_chains;
     heat_ranks          = m.heat_ranks;
     swap_interval       = m.swap_interval;
+    swaps_per_round     = m.swaps_per_round;
     active_chain_index  = m.active_chain_index;
     schedule_type       = m.schedule_type;
     pid_per_chain       = m.pid_per_chain;
@@ -88,6 +97,79 @@ Mcmcmc::~Mcmcmc(void)
     }
     chains.clear();
     delete base_chain;
+    
+#ifdef RB_MPI
+    if ( swap_comm != MPI_COMM_NULL )
+    {
+        MPI_Comm_free( &swap_comm );
+    }
+#endif
+}
+
+
+/**
+ * Decide whether we accept to swap the heats of the chains j and k.
+ * The decision only uses the swap random number generator and the synchronized chain values,
+ * hence every process makes exactly the same decision.
+ */
+bool Mcmcmc::acceptSwap(size_t j, size_t k)
+{
+    
+    double lnProposalRatio = 0.0;
+    
+    ++numAttemptedSwaps;
+    
+    // compute exchange ratio
+    double bj = chain_heats[j];
+    double bk = chain_heats[k];
+    double lnPj = chain_values[j];
+    double lnPk = chain_values[k];
+    double lnR = bj * (lnPk - lnPj) + bk * (lnPj - lnPk) + lnProposalRatio;
+    
+    // determine whether we accept or reject the chain swap
+    bool accept = false;
+    double u = swap_rng.uniform01();
+    if (lnR >= 0)
+    {
+        accept = true;
+    }
+    else if (lnR < -100)
+    {
+        accept = false;
+    }
+    else if (u < exp(lnR))
+    {
+        accept = true;
+    }
+    else
+    {
+        accept = false;
+    }
+    
+    // on accept, swap beta values and active chains
+    if ( accept == true )
+    {
+        
+        // swap active chain
+        if (active_chain_index == j)
+        {
+            active_chain_index = k;
+        }
+        else if (active_chain_index == k)
+        {
+            active_chain_index = j;
+        }
+        
+        chain_heats[j] = bk;
+        chain_heats[k] = bj;
+        size_t tmp = heat_ranks[j];
+        heat_ranks[j] = heat_ranks[k];
+        heat_ranks[k] = tmp;
+        
+        ++numAcceptedSwaps;
+    }
+    
+    return accept;
 }
 
 
@@ -275,6 +357,42 @@ void Mcmcmc::initializeChains(void)
 }
 
 
+/**
+ * Initialize the swap engine the first time we swap chains.
+ * We create a communicator containing only the processes of this sampler
+ * and seed the swap random number generator identically on all of them.
+ * This is done lazily because all processes of this sampler need to participate.
+ */
+void Mcmcmc::initializeSwapEngine(void)
+{
+    
+#ifdef RB_MPI
+    if ( swap_comm == MPI_COMM_NULL )
+    {
+        MPI_Group world_group;
+        MPI_Group swap_group;
+        MPI_Comm_group( MPI_COMM_WORLD, &world_group );
+        int range[1][3] = { { int(active_PID), int(active_PID + num_processes - 1), 1 } };
+        MPI_Group_range_incl( world_group, 1, range, &swap_group );
+        MPI_Comm_create_group( MPI_COMM_WORLD, swap_group, 0, &swap_comm );
+        MPI_Group_free( &swap_group );
+        MPI_Group_free( &world_group );
+    }
+#endif
+    
+    if ( swap_rng_initialized == false )
+    {
+        boost::uint64_t seed = GLOBAL_RNG->uniform64();
+#ifdef RB_MPI
+        MPI_Bcast( &seed, 1, MPI_UINT64_T, 0, swap_comm );
+#endif
+        swap_rng.setSeed( seed );
+        swap_rng_initialized = true;
+    }
+    
+}
+
+
 void Mcmcmc::initializeSampler( bool priorOnly )
 {
     
@@ -336,10 +454,7 @@ void Mcmcmc::nextCycle(bool advanceCycle)
 #endif
         
         // perform chain swap
-        for (size_t i = 0; i < num_chains; ++i)
-        {
-            swapChains();
-        }
+        swapChains();
     }
     
 }
@@ -358,6 +473,56 @@ void Mcmcmc::printOperatorSummary(void) const
 }
 
 
+/**
+ * Restore the state of this sampler from a checkpoint written by writeCheckpoint.
+ * Every process only restores the chains it owns.
+ */
+void Mcmcmc::readCheckpoint(std::istream &in)
+{
+    
+    readCheckpointToken(in, "mcmcmc");
+    size_t n = 0;
+    in >> n >> current_generation >> generation;
+    if ( n != num_chains )
+    {
+        throw RbException("The checkpoint was written for a different number of chains.");
+    }
+    
+    readCheckpointToken(in, "swaps");
+    in >> numAttemptedSwaps >> numAcceptedSwaps >> delta >> swap_rng_initialized;
+    swap_rng.setState( readCheckpointString(in) );
+    
+    readCheckpointToken(in, "active");
+    in >> active_chain_index;
+    
+    readCheckpointToken(in, "heats");
+    for (size_t i = 0; i < num_chains; ++i)
+    {
+        in >> chain_heats[i] >> heat_ranks[i];
+    }
+    
+    for (size_t i = 0; i < num_chains; ++i)
+    {
+        if ( chains[i] != NULL )
+        {
+            readCheckpointToken(in, "chain");
+            size_t j = 0;
+            in >> j;
+            if ( j != i )
+            {
+                throw RbException("The checkpoint was written for a different assignment of chains to processes.");
+            }
+            chains[i]->readCheckpoint( in );
+        }
+    }
+    
+    readCheckpointToken(in, "end");
+    
+    setCurrentGeneration( current_generation );
+    
+}
+
+
 void Mcmcmc::redrawStartingValues( void )
 {
     
@@ -495,6 +660,14 @@ void Mcmcmc::setActivePIDSpecialized(size_t i, size_t n)
     pid_per_chain.resize(num_chains, 0);
     heat_ranks.resize(num_chains, 0);
     
+#ifdef RB_MPI
+    // the processes of this sampler have changed
+    if ( swap_comm != MPI_COMM_NULL )
+    {
+        MPI_Comm_free( &swap_comm );
+    }
+#endif
+    
     initializeChains();
 }
 
@@ -519,163 +692,45 @@ void Mcmcmc::startMonitors(size_t num_cycles, bool reopen)
 }
 
 
+/**
+ * Synchronize the posterior probabilities and the heats of all chains across the processes.
+ * Every process contributes a (posterior, heat) tuple for each chain it owns
+ * and a single all-gather gives every process the tuples of all chains.
+ */
 void Mcmcmc::synchronizeValues(void)
 {
     
-    // synchronize chain values
-    double results[num_chains];
-    for (size_t j = 0; j < num_chains; ++j)
-    {
-        results[j] = 0.0;
-    }
+    // the values of the chains owned by this process
+    std::vector<double> local_values = std::vector<double>(2 * num_chains, 0.0);
     for (size_t j = 0; j < num_chains; ++j)
     {
         
-        if ( chains[j] != NULL )
+        if ( chains[j] != NULL && pid == pid_per_chain[j] )
         {
-            results[j] = chains[j]->getModelLnProbability();
+            local_values[2*j]   = chains[j]->getModelLnProbability();
+            local_values[2*j+1] = chains[j]->getChainPosteriorHeat();
         }
         
     }
     
 #ifdef RB_MPI
-    if ( active_PID != pid )
-    {
-//        MPI::COMM_WORLD.Send(&results, int(num_chains), MPI::DOUBLE, (int)active_PID, 0);
-        for (size_t i=0; i<num_chains; ++i)
-        {
-            if ( pid == pid_per_chain[i] )
-            {
-                MPI::COMM_WORLD.Send(&results[i], 1, MPI::DOUBLE, (int)active_PID, 0);
-            }
-            
-        }
-        
-    }
-#endif
-    
-    if ( active_PID == pid )
-    {
-#ifdef RB_MPI
-
-        for (size_t j = 0; j < num_chains; ++j)
-        {
-                
-            // ignore self
-            if (pid != pid_per_chain[j])
-            {
-                MPI::COMM_WORLD.Recv(&results[j], 1, MPI::DOUBLE, int(pid_per_chain[j]), 0);
-            }
-            
-        }
-#endif
-        for (size_t i = 0; i < num_chains; ++i)
-        {
-            chain_values[i] = results[i];
-        }
-    }
-    
-#ifdef RB_MPI
-    if ( active_PID == pid )
-    {
-        for (size_t i=1; i<num_processes; ++i)
-        {
-            for (size_t j=0; j<num_chains; ++j)
-            {
-                MPI::COMM_WORLD.Send(&chain_values[j], 1, MPI::DOUBLE, int(active_PID+i), 0);
-            }
-//            MPI::COMM_WORLD.Bcast(&chain_values[i], 1, MPI::DOUBLE, (int)active_PID);
-        }
-    }
-    else
-    {
-        for (size_t i=0; i<num_chains; ++i)
-        {
-            MPI::COMM_WORLD.Recv(&chain_values[i], 1, MPI::DOUBLE, int(active_PID), 0);
-        }
-        
-    }
-#endif
-    
-}
-
-void Mcmcmc::synchronizeHeats(void)
-{
+    std::vector<double> all_values = std::vector<double>(2 * num_chains * num_processes, 0.0);
+    MPI_Allgather( &local_values[0], int(2 * num_chains), MPI_DOUBLE, &all_values[0], int(2 * num_chains), MPI_DOUBLE, swap_comm );
     
-    // synchronize heat values
-    double heats[num_chains];
     for (size_t j = 0; j < num_chains; ++j)
     {
-        heats[j] = 0.0;
+        size_t offset = 2 * num_chains * (pid_per_chain[j] - active_PID);
+        chain_values[j] = all_values[offset + 2*j];
+        chain_heats[j]  = all_values[offset + 2*j+1];
     }
+#else
     for (size_t j = 0; j < num_chains; ++j)
     {
-        if (chains[j] != NULL)
-        {
-            heats[j] = chains[j]->getChainPosteriorHeat();
-        }
-    }
-    
-#ifdef RB_MPI
-    // share the heats accross processes
-    if ( active_PID != pid )
-    {
-//        MPI::COMM_WORLD.Send(&heats, (int)num_chains, MPI::DOUBLE, (int)active_PID, 0);
-        for (size_t i=0; i<num_chains; ++i)
-        {
-            if ( pid == pid_per_chain[i] )
-            {
-                MPI::COMM_WORLD.Send(&heats[i], 1, MPI::DOUBLE, (int)active_PID, 0);
-            }
-            
-        }
-        
+        chain_values[j] = local_values[2*j];
+        chain_heats[j]  = local_values[2*j+1];
     }
 #endif
     
-    if ( active_PID == pid )
-    {
-#ifdef RB_MPI
-        for (size_t j = 0; j < num_chains; ++j)
-        {
-            
-            // ignore self
-            if (pid != pid_per_chain[j])
-            {
-                MPI::COMM_WORLD.Recv(&heats[j], 1, MPI::DOUBLE, int(pid_per_chain[j]), 0);
-            }
-            
-        }
-
-#endif
-        for (size_t i = 0; i < num_chains; ++i)
-        {
-            chain_heats[i] = heats[i];
-        }
-    }
-#ifdef RB_MPI
-    if ( active_PID == pid )
-    {
-        for (size_t i=1; i<num_processes; ++i)
-        {
-            
-            for (size_t j = 0; j < num_chains; ++j)
-            {
-                MPI::COMM_WORLD.Send(&chain_heats[j], 1, MPI::DOUBLE, int(active_PID+i), 0);
-            }
-        }
-    }
-    else
-    {
-        for (size_t i=0; i<num_chains; ++i)
-        {
-            MPI::COMM_WORLD.Recv(&chain_heats[i], 1, MPI::DOUBLE, int(active_PID), 0);
-        }
-        
-    }
-//    MPI::COMM_WORLD.Bcast(&chain_heats, (int)num_chains, MPI::DOUBLE, (int)active_PID);
-#endif
-    
 }
 
 
@@ -689,128 +744,43 @@ void Mcmcmc::swapChains(void)
         return;
     }
     
-    // send all chain values to pid 0
-    synchronizeValues();
+    initializeSwapEngine();
     
-    // send all chain heats to pid 0
-    synchronizeHeats();
+    // share the posteriors and heats of all chains with all processes
+    synchronizeValues();
    
     // swap chains
-    swapNeighborChains();
-//    swapRandomChains();
-    
-
-}
-
-
-
-void Mcmcmc::swapNeighborChains(void)
-{
-    
-    double lnProposalRatio = 0.0;
-    
-    // randomly pick the indices of two chains
-    int j = 0;
-    int k = 0;
-    
-    // swap?
-    bool accept = false;
-    
-    j = int(GLOBAL_RNG->uniform01() * (num_chains-1));
-    k = j + 1;
-        
-    ++numAttemptedSwaps;
-    
-    // compute exchange ratio
-    double bj = chain_heats[j];
-    double bk = chain_heats[k];
-    double lnPj = chain_values[j];
-    double lnPk = chain_values[k];
-    double lnR = bj * (lnPk - lnPj) + bk * (lnPj - lnPk) + lnProposalRatio;
-        
-    // determine whether we accept or reject the chain swap
-    double u = GLOBAL_RNG->uniform01();
-    if (lnR >= 0)
-    {
-        accept = true;
-    }
-    else if (lnR < -100)
-    {
-        accept = false;
-    }
-    else if (u < exp(lnR))
-    {
-        accept = true;
-    }
-    else
-    {
-        accept = false;
-    }
-    
-
-#ifdef RB_MPI
-    if ( active_PID == pid )
+    // all processes make the same decisions, so no further communication is needed
+    for (size_t i = 0; i < swaps_per_round; ++i)
     {
-        for (size_t i = 1; i < num_processes; ++i)
-        {
-            MPI::COMM_WORLD.Send(&j, 1, MPI_INT, int(i+active_PID), 0);
-            MPI::COMM_WORLD.Send(&k, 1, MPI_INT, int(i+active_PID), 0);
-            MPI::COMM_WORLD.Send(&accept, 1, MPI::BOOL, int(i+active_PID), 0);
-        }
-    }
-    else
-    {
-        MPI::COMM_WORLD.Recv(&j, 1, MPI_INT, int(active_PID), 0);
-        MPI::COMM_WORLD.Recv(&k, 1, MPI_INT, int(active_PID), 0);
-        MPI::COMM_WORLD.Recv(&accept, 1, MPI::BOOL, int(active_PID), 0);
+        swapNeighborChains();
+//        swapRandomChains();
     }
-//    MPI::COMM_WORLD.Bcast(&j, 1, MPI_INT, (int)active_PID);
-//    MPI::COMM_WORLD.Bcast(&k, 1, MPI_INT, (int)active_PID);
-//    MPI::COMM_WORLD.Bcast(&accept, 1, MPI::BOOL, (int)active_PID);
-#endif
     
-    // on accept, swap beta values and active chains
-    if (accept == true )
+    // update the heats of the chains of this process
+    for (size_t i = 0; i < num_chains; ++i)
     {
         
-        // swap active chain
-        if (active_chain_index == j)
-        {
-            active_chain_index = k;
-        }
-        else if (active_chain_index == k)
-        {
-            active_chain_index = j;
-        }
-        
-        double bj = chain_heats[j];
-        double bk = chain_heats[k];
-        chain_heats[j] = bk;
-        chain_heats[k] = bj;
-        size_t tmp = heat_ranks[j];
-        heat_ranks[j] = heat_ranks[k];
-        heat_ranks[k] = tmp;
-        
-        
-        for (size_t i=0; i<num_chains; ++i)
+        if ( chains[i] != NULL )
         {
-            
-            if ( chains[i] != NULL )
-            {
-                chains[i]->setChainPosteriorHeat( chain_heats[i] );
-                chains[i]->setChainActive( chain_heats[i] == 1.0 );
-            }
+            chains[i]->setChainPosteriorHeat( chain_heats[i] );
+            chains[i]->setChainActive( chain_heats[i] == 1.0 );
         }
         
-        ++numAcceptedSwaps;
     }
 
+}
+
+
+
+void Mcmcmc::swapNeighborChains(void)
+{
+    
+    // randomly pick the indices of two neighboring chains
+    size_t j = size_t(swap_rng.uniform01() * (num_chains-1));
+    size_t k = j + 1;
     
-    // update the chains accross processes
-    // this is necessary because only process 0 does the swap
-    // all the other processes need to be told that there was a swap
-//    updateChainState(j);
-//    updateChainState(k);
+    acceptSwap(j, k);
     
 }
 
@@ -819,105 +789,15 @@ void Mcmcmc::swapNeighborChains(void)
 void Mcmcmc::swapRandomChains(void)
 {
     
-    double lnProposalRatio = 0.0;
-    
     // randomly pick the indices of two chains
-    int j = 0;
-    int k = 0;
-    
-    // swap?
-    bool accept = false;
-    
-    if ( pid == active_PID )
-    {
-        j = int(GLOBAL_RNG->uniform01() * num_chains);
-        if (num_chains > 1)
-        {
-            do {
-                k = int(GLOBAL_RNG->uniform01() * num_chains);
-            }
-            while(j == k);
-        }
-        
-        ++numAttemptedSwaps;
-            
-        // compute exchange ratio
-        double bj = chain_heats[j];
-        double bk = chain_heats[k];
-        double lnPj = chain_values[j];
-        double lnPk = chain_values[k];
-        double lnR = bj * (lnPk - lnPj) + bk * (lnPj - lnPk) + lnProposalRatio;
-            
-        // determine whether we accept or reject the chain swap
-        double u = GLOBAL_RNG->uniform01();
-        if (lnR >= 0)
-        {
-            accept = true;
-        }
-        else if (lnR < -100)
-        {
-            accept = false;
-        }
-        else if (u < exp(lnR))
-        {
-            accept = true;
-        }
-        else
-        {
-            accept = false;
-        }
-        
-        
-        // on accept, swap beta values and active chains
-        if (accept == true )
-        {
-            
-            // swap active chain
-            if (active_chain_index == j)
-            {
-                active_chain_index = k;
-            }
-            else if (active_chain_index == k)
-            {
-                active_chain_index = j;
-            }
-            
-            chain_heats[j] = bk;
-            chain_heats[k] = bj;
-            size_t tmp = heat_ranks[j];
-            heat_ranks[j] = heat_ranks[k];
-            heat_ranks[k] = tmp;
-            
-            ++numAcceptedSwaps;
-        }
-        
-        
-    }
-
-#ifdef RB_MPI
-    if ( active_PID == pid )
-    {
-        for (size_t i = 1; i < num_processes; ++i)
-        {
-            MPI::COMM_WORLD.Send(&j, 1, MPI_INT, int(active_PID+i), 0);
-            MPI::COMM_WORLD.Send(&k, 1, MPI_INT, int(active_PID+i), 0);
-        }
-    }
-    else
-    {
-        MPI::COMM_WORLD.Recv(&j, 1, MPI_INT, int(active_PID), 0);
-        MPI::COMM_WORLD.Recv(&k, 1, MPI_INT, int(active_PID), 0);
+    size_t j = size_t(swap_rng.uniform01() * num_chains);
+    size_t k = 0;
+    do {
+        k = size_t(swap_rng.uniform01() * num_chains);
     }
-//    MPI::COMM_WORLD.Bcast(&j, 1, MPI_INT, (int)active_PID);
-//    MPI::COMM_WORLD.Bcast(&k, 1, MPI_INT, (int)active_PID);
-#endif
-    
+    while(j == k);
     
-    // update the chains accross processes
-    // this is necessary because only process 0 does the swap
-    // all the other processes need to be told that there was a swap
-//    updateChainState(j);
-//    updateChainState(k);
+    acceptSwap(j, k);
     
 }
 
@@ -939,38 +819,37 @@ void Mcmcmc::tune( void )
 }
 
 
-void Mcmcmc::updateChainState(size_t j)
+/**
+ * Write the state of this sampler into a checkpoint.
+ * We store the swap statistics, the heats of all chains and the complete state of each chain of this process.
+ */
+void Mcmcmc::writeCheckpoint(std::ostream &out)
 {
     
-#ifdef RB_MPI
-    // update heat
-    if ( active_PID == pid )
-    {
-        for (size_t i = 1; i < num_processes; ++i)
-        {
-            MPI::COMM_WORLD.Send(&chain_heats[j], 1, MPI::DOUBLE, int(active_PID+i), 0);
-        }
-    }
-    else
-    {
-        MPI::COMM_WORLD.Recv(&chain_heats[j], 1, MPI::DOUBLE, int(active_PID), 0);
-    }
-//    MPI::COMM_WORLD.Bcast(&chain_heats[j], 1, MPI::DOUBLE, (int)active_PID);
-#endif
+    out.precision( std::numeric_limits<double>::digits10 + 2 );
     
-    if ( chains[j] != NULL )
+    out << "mcmcmc " << num_chains << " " << current_generation << " " << generation << "\n";
+    out << "swaps " << numAttemptedSwaps << " " << numAcceptedSwaps << " " << delta << " " << swap_rng_initialized << " ";
+    writeCheckpointString(out, swap_rng.getState());
+    out << "active " << active_chain_index << "\n";
+    out << "heats";
+    for (size_t i = 0; i < num_chains; ++i)
     {
-        chains[j]->setChainPosteriorHeat( chain_heats[j] );
+        out << " " << chain_heats[i] << " " << heat_ranks[i];
     }
+    out << "\n";
     
-    for (size_t i=0; i<num_chains; ++i)
+    for (size_t i = 0; i < num_chains; ++i)
     {
         if ( chains[i] != NULL )
         {
-            chains[i]->setChainActive( chain_heats[i] == 1.0 );
+            out << "chain " << i << "\n";
+            chains[i]->writeCheckpoint( out );
         }
     }
     
+    out << "end\n";
+    
 }
 
 
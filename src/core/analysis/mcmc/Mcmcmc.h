@@ -6,9 +6,14 @@
 #include "Monitor.h"
 #include "MonteCarloSampler.h"
 #include "Move.h"
+#include "RandomNumberGenerator.h"
 
 #include <vector>
 
+#ifdef RB_MPI
+#include <mpi.h>
+#endif
+
 namespace RevBayesCore {
     
     /**
@@ -27,7 +32,7 @@ namespace RevBayesCore {
     class Mcmcmc : public MonteCarloSampler {
         
     public:
-        Mcmcmc(const Model& m, const RbVector<Move> &mv, const RbVector<Monitor> &mn, std::string sT="random", size_t nc=4, size_t si=100, double dt=0.1);
+        Mcmcmc(const Model& m, const RbVector<Move> &mv, const RbVector<Monitor> &mn, std::string sT="random", size_t nc=4, size_t si=100, double dt=0.1, size_t ns=4);
         Mcmcmc(const Mcmcmc &m);
         virtual                                ~Mcmcmc(void);                                       //!< Virtual destructor
         
@@ -45,6 +50,7 @@ namespace RevBayesCore {
         void                                    monitor(unsigned long g);
         void                                    nextCycle(bool advanceCycle);
         void                                    printOperatorSummary(void) const;
+        void                                    readCheckpoint(std::istream &in);                   //!< Restore the state of the sampler from a checkpoint
         void                                    redrawStartingValues(void);                         //!< Redraw the starting values.
         void                                    removeMonitors(void);
         void                                    reset(void);                                        //!< Reset the sampler for a new run.
@@ -53,6 +59,7 @@ namespace RevBayesCore {
         void                                    setNumberOfProcesses(size_t i);                     //!< Set the number of processes for this replication.
         void                                    startMonitors(size_t numCycles, bool reopen);       //!< Start the monitors
         void                                    tune(void);                                         //!< Tune the sampler and its moves.
+        void                                    writeCheckpoint(std::ostream &out);                 //!< Write the complete state of the sampler into a checkpoint
         void                                    writeMonitorHeaders(void);                          //!< Write the headers of the monitors.
 
         
@@ -62,13 +69,13 @@ namespace RevBayesCore {
         
     private:
         void                                    initializeChains(void);
+        void                                    initializeSwapEngine(void);                         //!< Set up the communicator and the random number generator for the swaps
         void                                    swapChains(void);
         void                                    swapNeighborChains(void);
         void                                    swapRandomChains(void);
-        void                                    synchronizeValues(void);
-        void                                    synchronizeHeats(void);
-        void                                    updateChainState(size_t j);
+        void                                    synchronizeValues(void);                            //!< Gather the posterior and heat of every chain on every process
         double                                  computeBeta(double d, size_t i);                    // incremental temperature schedule
+        bool                                    acceptSwap(size_t j, size_t k);                     //!< Decide whether the heats of the chains j and k are swapped
         
         size_t                                  num_chains;
         std::vector<size_t>                     heat_ranks;
@@ -79,6 +86,7 @@ namespace RevBayesCore {
         std::string                             schedule_type;
         size_t                                  current_generation;
         size_t                                  swap_interval;
+        size_t                                  swaps_per_round;                                    // number of swap attempts every swap interval
         
         size_t                                  active_chain_index;                                 // index of coldest chain, i.e. which one samples the posterior
         double                                  delta;                                              // delta-T, temperature increment for computeBeta
@@ -89,6 +97,12 @@ namespace RevBayesCore {
         unsigned long                           generation;
         unsigned long                           numAttemptedSwaps;
         unsigned long                           numAcceptedSwaps;
+        
+        RandomNumberGenerator                   swap_rng;                                           // identical on all processes so that every process makes the same swap decisions
+        bool                                    swap_rng_initialized;
+#ifdef RB_MPI
+        MPI_Comm                                swap_comm;                                          // the processes of this sampler
+#endif
     };
     
 }
@@ -61,11 +61,68 @@ size_t MonteCarloSampler::getCurrentGeneration( void ) const
 }
 
 
+/**
+ * Read a string from a checkpoint.
+ * Strings are stored with their length first so that they may contain white spaces and newlines (e.g., the value of a variable).
+ */
+std::string MonteCarloSampler::readCheckpointString( std::istream &in )
+{
+    
+    size_t length = 0;
+    in >> length;
+    
+    // skip the single separator after the length
+    in.get();
+    
+    std::string s( length, ' ' );
+    if ( length > 0 )
+    {
+        in.read( &s[0], length );
+    }
+    
+    if ( in.fail() )
+    {
+        throw RbException("Unexpected end of the checkpoint file.");
+    }
+    
+    return s;
+}
+
+
+/**
+ * Read the next token from a checkpoint and make sure that it is the one we expected.
+ * Otherwise the checkpoint is either corrupt or does not belong to this analysis.
+ */
+void MonteCarloSampler::readCheckpointToken( std::istream &in, const std::string &t )
+{
+    
+    std::string token = "";
+    in >> token;
+    
+    if ( token != t )
+    {
+        throw RbException("Malformed checkpoint file: expected '" + t + "' but found '" + token + "'.");
+    }
+    
+}
+
+
 void MonteCarloSampler::setCurrentGeneration( size_t g )
 {
     generation = g;
 }
 
+
+/**
+ * Write a string into a checkpoint so that it can be read by readCheckpointString.
+ */
+void MonteCarloSampler::writeCheckpointString( std::ostream &out, const std::string &s )
+{
+    
+    out << s.size() << " " << s << "\n";
+    
+}
+
 std::ostream& RevBayesCore::operator<<(std::ostream& o, const MonteCarloSampler& x)
 {
     o << "MonteCarloSampler";
@@ -11,6 +11,8 @@
 #include "RbVector.h"
 #include "SequenctialMoveSchedule.h"
 
+#include <iostream>
+#include <string>
 #include <vector>
 
 namespace RevBayesCore {
@@ -55,6 +57,7 @@ namespace RevBayesCore {
         virtual void                            monitor(unsigned long g) = 0;
         virtual void                            nextCycle(bool advanceCycle) = 0;
         virtual void                            printOperatorSummary(void) const = 0;
+        virtual void                            readCheckpoint(std::istream &in) = 0;               //!< Restore the state of the sampler from a checkpoint
         virtual void                            redrawStartingValues(void) = 0;                     //!< Redraw the starting values.
         virtual void                            removeMonitors(void) = 0;
         virtual void                            reset(void) = 0;                                    //!< Reset the sampler for a new run.
@@ -63,11 +66,17 @@ namespace RevBayesCore {
         virtual void                            setModel(Model *m) = 0;
         virtual void                            startMonitors(size_t numCycles, bool reopen) = 0;   //!< Start the monitors
         virtual void                            tune(void) = 0;                                     //!< Tune the sampler and its moves.
+        virtual void                            writeCheckpoint(std::ostream &out) = 0;             //!< Write the complete state of the sampler into a checkpoint
         virtual void                            writeMonitorHeaders(void) = 0;                      //!< Write the headers of the monitors
 
         // public methods
         size_t                                  getCurrentGeneration(void) const;                   //!< Get the current generations number
         void                                    setCurrentGeneration(size_t g);
+        
+        // helper functions for reading and writing checkpoints
+        static std::string                      readCheckpointString(std::istream &in);             //!< Read a string written by writeCheckpointString
+        static void                             readCheckpointToken(std::istream &in, const std::string &t);    //!< Read the next token and check that it is the expected one
+        static void                             writeCheckpointString(std::ostream &out, const std::string &s); //!< Write a string that may contain white spaces or newlines
         //        void                                    initializeMonitors(void);                         //!< Assign model and mcmc ptrs to monitors
 //        void                                    redrawChainState(void);
         
@@ -0,0 +1,800 @@
+#include "CompactTreeTrace.h"
+#include "RbException.h"
+#include "TopologyNode.h"
+
+#include <algorithm>
+
+
+using namespace RevBayesCore;
+
+namespace {
+
+    inline bool isBitSet(const boost::uint64_t *w, size_t i)
+    {
+        return ( w[i / 64] >> (i % 64) ) & 1;
+    }
+
+    inline void setBit(boost::uint64_t *w, size_t i)
+    {
+        w[i / 64] |= boost::uint64_t(1) << (i % 64);
+    }
+
+    // the flags of a node
+    const unsigned char FOSSIL           = 1;
+    const unsigned char SAMPLED_ANCESTOR = 2;
+
+    // split a parameter comment of the form name=value, as in TreeUtilities::constructTimeTreeRecursively
+    inline void splitParameter(const std::string &comment, std::string &name, std::string &value)
+    {
+        size_t begin = ( comment.empty() == false && comment[0] == '&' ? 1 : 0 );
+        size_t pos = comment.find( '=', begin );
+
+        name  = comment.substr( begin, pos == std::string::npos ? std::string::npos : pos - begin );
+        value = ( pos == std::string::npos ? "" : comment.substr( pos + 1 ) );
+    }
+
+}
+
+
+const size_t CompactTreeTrace::NOT_FOUND = size_t(-1);
+
+
+CompactTreeTrace::CompactTreeTrace( bool c, bool p ) :
+    clock( c ),
+    rooted( true ),
+    node_parameters( p ),
+    num_words( 0 )
+{
+
+    clear();
+}
+
+
+/**
+ * Encode a tree as splits and add it as the next sample.
+ * Unless the trace was initialized before, the first tree determines the taxon table, the outgroup and whether the trees are rooted.
+ */
+void CompactTreeTrace::addTree(const Tree &t)
+{
+
+    if ( taxa.empty() == true )
+    {
+        initialize( t );
+    }
+
+    // unrooted trees are rerooted on the outgroup, and we keep the nodes of the rerooted tree
+    // rerooting renumbers the nodes, so we remember the index each node was sampled with
+    Tree rerooted;
+    const Tree *tree = &t;
+    std::vector<size_t> sampled_indices;
+    if ( rooted == false )
+    {
+        rerooted = t;
+
+        std::vector<TopologyNode*> sampled_nodes = rerooted.getNodes();
+        std::vector<size_t> indices( sampled_nodes.size() );
+        for (size_t k = 0; k < sampled_nodes.size(); ++k)
+        {
+            indices[k] = sampled_nodes[k]->getIndex();
+        }
+
+        rerooted.reroot( outgroup, true );
+        tree = &rerooted;
+
+        sampled_indices.resize( sampled_nodes.size() );
+        for (size_t k = 0; k < sampled_nodes.size(); ++k)
+        {
+            sampled_indices[ sampled_nodes[k]->getIndex() ] = indices[k];
+        }
+    }
+
+    std::vector<boost::uint64_t> words;
+    std::vector<boost::uint32_t> parents;
+    std::vector<double> ages;
+    std::vector<boost::uint32_t> sa;
+    std::vector<const TopologyNode*> visited;
+    encodeNode( tree->getRoot(), NOT_FOUND, words, parents, ages, sa, &visited );
+
+    size_t num_nodes = parents.size();
+    std::vector<boost::uint32_t> topology( num_nodes );
+    HashedBitSet key = createSplitKey();
+
+    for (size_t k = 0; k < num_nodes; ++k)
+    {
+        const boost::uint64_t *w = &words[2 * num_words * k];
+
+        // hash-cons the split, the taxa and mrca are stored as sampled first
+        getSplitKey( w, key );
+        std::pair<size_t, bool> it = split_table.insert( key );
+        if ( it.second == true )
+        {
+            split_words.insert( split_words.end(), w, w + 2 * num_words );
+
+            size_t size = 0;
+            for (size_t j = 0; j < num_words; ++j)
+            {
+                size += HashedBitSet::countBits( w[j] );
+            }
+            split_sizes.push_back( size );
+        }
+
+        node_splits.push_back( boost::uint32_t( it.first ) );
+        topology[k] = boost::uint32_t( it.first );
+    }
+
+    node_ages.insert( node_ages.end(), ages.begin(), ages.end() );
+    node_parents.insert( node_parents.end(), parents.begin(), parents.end() );
+    sample_offsets.push_back( node_splits.size() );
+
+    // what else we need to decode the tree
+    for (size_t k = 0; k < num_nodes; ++k)
+    {
+        const TopologyNode &n = *visited[k];
+
+        node_indices.push_back( boost::uint32_t( rooted == true ? n.getIndex() : sampled_indices[ n.getIndex() ] ) );
+        node_flags.push_back( (n.isFossil() == true ? FOSSIL : 0) | (n.isSampledAncestor() == true ? SAMPLED_ANCESTOR : 0) );
+
+        bool has_name = ( n.isTip() == false && n.getName() != "" );
+        if ( node_parameters == true && ( has_name == true || n.getNodeParameters().empty() == false || n.getBranchParameters().empty() == false ) )
+        {
+            NodeAnnotation annotation;
+            annotation.node              = boost::uint32_t( k );
+            annotation.name              = ( has_name == true ? n.getName() : "" );
+            annotation.node_parameters   = n.getNodeParameters();
+            annotation.branch_parameters = n.getBranchParameters();
+            node_annotations.push_back( annotation );
+        }
+    }
+    annotation_offsets.push_back( node_annotations.size() );
+
+    sampled_ancestors.insert( sampled_ancestors.end(), sa.begin(), sa.end() );
+    sampled_ancestor_offsets.push_back( sampled_ancestors.size() );
+
+    // hash-cons the topology on its set of splits
+    std::sort( topology.begin(), topology.end() );
+    topology.erase( std::unique( topology.begin(), topology.end() ), topology.end() );
+
+    std::pair<std::map<std::vector<boost::uint32_t>, size_t>::iterator, bool> it = topology_indices.insert( std::make_pair( topology, topology_samples.size() ) );
+    if ( it.second == true )
+    {
+        topology_splits.insert( topology_splits.end(), topology.begin(), topology.end() );
+        topology_offsets.push_back( topology_splits.size() );
+        topology_samples.push_back( getNumberOfSamples() - 1 );
+    }
+
+    sample_topologies.push_back( boost::uint32_t( it.first->second ) );
+
+}
+
+
+/** Remove all samples, splits, topologies and taxa */
+void CompactTreeTrace::clear( void )
+{
+
+    outgroup = "";
+    taxa.clear();
+    tip_taxa.clear();
+    taxon_indices.clear();
+    num_words = 0;
+
+    split_table.clear( 0 );
+    split_words.clear();
+    split_sizes.clear();
+
+    topology_indices.clear();
+    topology_splits.clear();
+    topology_offsets.assign( 1, 0 );
+    topology_samples.clear();
+
+    node_splits.clear();
+    node_ages.clear();
+    node_parents.clear();
+    node_indices.clear();
+    node_flags.clear();
+    node_annotations.clear();
+    annotation_offsets.assign( 1, 0 );
+    sample_offsets.assign( 1, 0 );
+    sample_topologies.clear();
+    sampled_ancestors.clear();
+    sampled_ancestor_offsets.assign( 1, 0 );
+
+}
+
+
+/**
+ * Recursively encode the subtree of node n in preorder.
+ * For each node we append the position of its parent p (as distance), its age or branch length
+ * and the words of its taxa and mrca, which are the union of the words of its children.
+ * The sampled ancestor tips are collected in sa and the visited nodes in v (if not NULL).
+ */
+void CompactTreeTrace::encodeNode(const TopologyNode &n, size_t p, std::vector<boost::uint64_t> &w, std::vector<boost::uint32_t> &par, std::vector<double> &a, std::vector<boost::uint32_t> &sa, std::vector<const TopologyNode*> *v) const
+{
+
+    size_t k = par.size();
+
+    par.push_back( p == NOT_FOUND ? 0 : boost::uint32_t( k - p ) );
+    a.push_back( clock == true ? n.getAge() : n.getBranchLength() );
+    w.resize( w.size() + 2 * num_words, 0 );
+    if ( v != NULL )
+    {
+        v->push_back( &n );
+    }
+
+    if ( n.isTip() == true )
+    {
+        size_t i = getTaxonIndex( n.getTaxon().getName() );
+        if ( i == NOT_FOUND )
+        {
+            throw RbException( "Taxon '" + n.getTaxon().getName() + "' is not contained in the first tree of the tree trace." );
+        }
+
+        setBit( &w[2 * num_words * k], i );
+
+        if ( n.isSampledAncestor() == true )
+        {
+            sa.push_back( boost::uint32_t( i ) );
+        }
+    }
+    else
+    {
+        for (size_t c = 0; c < n.getNumberOfChildren(); ++c)
+        {
+            size_t child = par.size();
+            const TopologyNode &child_node = n.getChild( c );
+
+            encodeNode( child_node, k, w, par, a, sa, v );
+
+            // the taxa of the child, and for sampled ancestors the mrca
+            boost::uint64_t *node_words = &w[2 * num_words * k];
+            const boost::uint64_t *child_words = &w[2 * num_words * child];
+            for (size_t j = 0; j < num_words; ++j)
+            {
+                node_words[j] |= child_words[j];
+            }
+            if ( child_node.isSampledAncestor() == true )
+            {
+                for (size_t j = 0; j < num_words; ++j)
+                {
+                    node_words[num_words + j] |= child_words[j];
+                }
+            }
+        }
+    }
+
+}
+
+
+/** Encode all nodes of a tree, which is first rerooted on the outgroup if the trees are unrooted */
+void CompactTreeTrace::encodeTree(const Tree &t, std::vector<boost::uint64_t> &w, std::vector<boost::uint32_t> &par, std::vector<double> &a, std::vector<boost::uint32_t> &sa) const
+{
+
+    if ( rooted == false )
+    {
+        Tree tree = t;
+        tree.reroot( outgroup, true );
+
+        encodeNode( tree.getRoot(), NOT_FOUND, w, par, a, sa, NULL );
+    }
+    else
+    {
+        encodeNode( t.getRoot(), NOT_FOUND, w, par, a, sa, NULL );
+    }
+
+}
+
+
+/** Get the index of the split of a clade or NOT_FOUND if the clade was never sampled */
+size_t CompactTreeTrace::findSplit(const Clade &c) const
+{
+
+    std::vector<boost::uint64_t> w( 2 * num_words, 0 );
+
+    for (size_t i = 0; i < c.size(); ++i)
+    {
+        size_t index = getTaxonIndex( c.getTaxonName( i ) );
+        if ( index == NOT_FOUND )
+        {
+            return NOT_FOUND;
+        }
+        setBit( &w[0], index );
+    }
+
+    const std::vector<Taxon> &mrca = c.getMrca();
+    for (size_t i = 0; i < mrca.size(); ++i)
+    {
+        size_t index = getTaxonIndex( mrca[i].getName() );
+        if ( index == NOT_FOUND )
+        {
+            return NOT_FOUND;
+        }
+        setBit( &w[num_words], index );
+    }
+
+    return num_words == 0 ? NOT_FOUND : findSplit( &w[0] );
+}
+
+
+size_t CompactTreeTrace::findSplit(const boost::uint64_t *w) const
+{
+
+    HashedBitSet key = createSplitKey();
+    getSplitKey( w, key );
+
+    return split_table.find( key );
+}
+
+
+/**
+ * Get the index of the split of each node of a tree.
+ * In contrast to the samples, the tree is not rerooted, so s[i] is the split of the node with index i.
+ */
+void CompactTreeTrace::findSplits(const Tree &t, std::vector<size_t> &s) const
+{
+
+    const std::vector<TopologyNode*> &nodes = t.getNodes();
+    s.assign( nodes.size(), NOT_FOUND );
+
+    std::map<const TopologyNode*, size_t> node_indices;
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        node_indices[ nodes[i] ] = i;
+    }
+
+    std::vector<boost::uint64_t> words;
+    std::vector<boost::uint32_t> parents;
+    std::vector<double> ages;
+    std::vector<boost::uint32_t> sa;
+    std::vector<const TopologyNode*> visited;
+    encodeNode( t.getRoot(), NOT_FOUND, words, parents, ages, sa, &visited );
+
+    for (size_t k = 0; k < visited.size(); ++k)
+    {
+        s[ node_indices[ visited[k] ] ] = findSplit( &words[2 * num_words * k] );
+    }
+
+}
+
+
+/** Get the index of the topology of a tree or NOT_FOUND if the topology was never sampled */
+size_t CompactTreeTrace::findTopology(const Tree &t) const
+{
+
+    if ( getNumberOfSamples() == 0 )
+    {
+        return NOT_FOUND;
+    }
+
+    std::vector<boost::uint64_t> words;
+    std::vector<boost::uint32_t> parents;
+    std::vector<double> ages;
+    std::vector<boost::uint32_t> sa;
+    try
+    {
+        encodeTree( t, words, parents, ages, sa );
+    }
+    catch (RbException &e)
+    {
+        // the tree has other taxa
+        return NOT_FOUND;
+    }
+
+    std::vector<boost::uint32_t> topology( parents.size() );
+    for (size_t k = 0; k < parents.size(); ++k)
+    {
+        size_t s = findSplit( &words[2 * num_words * k] );
+        if ( s == NOT_FOUND )
+        {
+            return NOT_FOUND;
+        }
+        topology[k] = boost::uint32_t( s );
+    }
+
+    std::sort( topology.begin(), topology.end() );
+    topology.erase( std::unique( topology.begin(), topology.end() ), topology.end() );
+
+    std::map<std::vector<boost::uint32_t>, size_t>::const_iterator it = topology_indices.find( topology );
+
+    return it == topology_indices.end() ? NOT_FOUND : it->second;
+}
+
+
+/** Get the clade of a split, with its taxa and mrca as sampled first */
+Clade CompactTreeTrace::getClade(size_t s) const
+{
+
+    const boost::uint64_t *w = &split_words[2 * num_words * s];
+
+    std::vector<Taxon> clade_taxa;
+    std::vector<Taxon> mrca;
+    RbBitSet bitset( taxa.size() );
+
+    for (size_t i = 0; i < taxa.size(); ++i)
+    {
+        if ( isBitSet( w, i ) == true )
+        {
+            clade_taxa.push_back( taxa[i] );
+            bitset.set( i );
+        }
+        if ( isBitSet( w + num_words, i ) == true )
+        {
+            mrca.push_back( taxa[i] );
+        }
+    }
+
+    Clade c = Clade( clade_taxa, bitset );
+    if ( mrca.empty() == false )
+    {
+        c.setMrca( mrca );
+    }
+
+    return c;
+}
+
+
+/**
+ * Get the unique newick string of a topology.
+ * We rebuild the string from the first sample of the topology exactly as TreeUtilities::uniqueNewickTopology does for the tree,
+ * i.e., with sorted children and the first sampled ancestor child appended as the name of its parent.
+ */
+std::string CompactTreeTrace::getNewickTopology(size_t t) const
+{
+
+    size_t sample = topology_samples[t];
+    size_t begin = getNodesBegin( sample );
+    size_t num_nodes = getNodesEnd( sample ) - begin;
+
+    // the children of each node and the names of the tips
+    std::vector<std::vector<size_t> > children( num_nodes );
+    for (size_t k = 1; k < num_nodes; ++k)
+    {
+        children[ getNodeParent( begin + k ) - begin ].push_back( k );
+    }
+
+    std::vector<std::string> names( num_nodes );
+    std::vector<bool> is_sampled_ancestor( num_nodes, false );
+    for (size_t k = 0; k < num_nodes; ++k)
+    {
+        if ( children[k].empty() == true )
+        {
+            const boost::uint64_t *w = &split_words[2 * num_words * getNodeSplit( begin + k )];
+
+            size_t i = 0;
+            while ( isBitSet( w, i ) == false )
+            {
+                ++i;
+            }
+            names[k] = taxa[i].getName();
+
+            for (size_t j = getSampledAncestorsBegin( sample ); j < getSampledAncestorsEnd( sample ); ++j)
+            {
+                is_sampled_ancestor[k] = is_sampled_ancestor[k] || getSampledAncestor( j ) == i;
+            }
+        }
+    }
+
+    // now compose the string bottom-up, i.e., in reverse preorder
+    std::vector<std::string> newick( num_nodes );
+    for (size_t k = num_nodes; k-- > 0; )
+    {
+        if ( children[k].empty() == true )
+        {
+            newick[k] = names[k];
+            continue;
+        }
+
+        std::string fossil = "";
+        std::vector<std::string> child_newick;
+        for (size_t i = 0; i < children[k].size(); ++i)
+        {
+            size_t c = children[k][i];
+            if ( is_sampled_ancestor[c] == true && (names[c] < fossil || fossil == "") )
+            {
+                fossil = names[c];
+            }
+            else
+            {
+                child_newick.push_back( newick[c] );
+            }
+        }
+        std::sort( child_newick.begin(), child_newick.end() );
+
+        std::string s = "(";
+        for (size_t i = 0; i < child_newick.size(); ++i)
+        {
+            if ( i > 0 )
+            {
+                s += ",";
+            }
+            s += child_newick[i];
+        }
+        s += ")";
+        s += fossil;
+
+        newick[k] = s;
+    }
+
+    return newick[0];
+}
+
+
+/** Get the index of a taxon in the taxon table or NOT_FOUND */
+size_t CompactTreeTrace::getTaxonIndex(const std::string &n) const
+{
+
+    std::map<std::string, size_t>::const_iterator it = taxon_indices.find( n );
+
+    return it == taxon_indices.end() ? NOT_FOUND : it->second;
+}
+
+
+/**
+ * Decode the tree of sample i.
+ * The nodes keep the index they were sampled with, their flags, ages (or branch lengths) and, if we keep them, their parameters.
+ * Unrooted trees are returned as they were encoded, i.e., rerooted on the outgroup, but their nodes are not renumbered.
+ */
+Tree* CompactTreeTrace::getTree(size_t i) const
+{
+
+    size_t begin = getNodesBegin( i );
+    size_t num_nodes = getNodesEnd( i ) - begin;
+
+    // the tips are the nodes without children
+    std::vector<bool> is_tip( num_nodes, true );
+    for (size_t k = 1; k < num_nodes; ++k)
+    {
+        is_tip[ getNodeParent( begin + k ) - begin ] = false;
+    }
+
+    // the nodes are stored in preorder, so the parent of a node always exists before the node
+    std::vector<TopologyNode*> nodes( num_nodes, NULL );
+    for (size_t k = 0; k < num_nodes; ++k)
+    {
+        size_t index = node_indices[begin + k];
+
+        if ( is_tip[k] == true )
+        {
+            // the split of an unrooted tip may have been stored as its complement
+            size_t s = getNodeSplit( begin + k );
+            const boost::uint64_t *w = &split_words[2 * num_words * s];
+            bool complement = ( getSplitSize( s ) > 1 );
+
+            size_t taxon = 0;
+            while ( isBitSet( w, taxon ) == complement )
+            {
+                ++taxon;
+            }
+            nodes[k] = new TopologyNode( taxa[taxon], index );
+        }
+        else
+        {
+            nodes[k] = new TopologyNode( index );
+        }
+
+        nodes[k]->setFossil( (node_flags[begin + k] & FOSSIL) != 0 );
+        nodes[k]->setSampledAncestor( (node_flags[begin + k] & SAMPLED_ANCESTOR) != 0 );
+
+        if ( k > 0 )
+        {
+            TopologyNode *parent = nodes[ getNodeParent( begin + k ) - begin ];
+            parent->addChild( nodes[k] );
+            nodes[k]->setParent( parent );
+        }
+    }
+
+    for (size_t j = annotation_offsets[i]; j < annotation_offsets[i+1]; ++j)
+    {
+        const NodeAnnotation &annotation = node_annotations[j];
+        TopologyNode *node = nodes[ annotation.node ];
+
+        if ( annotation.name != "" )
+        {
+            node->setName( annotation.name );
+        }
+
+        std::string name, value;
+        for (size_t k = 0; k < annotation.node_parameters.size(); ++k)
+        {
+            splitParameter( annotation.node_parameters[k], name, value );
+            node->addNodeParameter( name, value );
+        }
+        for (size_t k = 0; k < annotation.branch_parameters.size(); ++k)
+        {
+            splitParameter( annotation.branch_parameters[k], name, value );
+            node->addBranchParameter( name, value );
+        }
+    }
+
+    Tree *t = new Tree();
+    t->setRoot( nodes[0], false );
+    t->setRooted( rooted );
+
+    // the branch lengths of time trees follow from the ages, which we set once all nodes are in the tree (as in TreeUtilities::convertTree)
+    for (size_t k = 0; k < num_nodes; ++k)
+    {
+        if ( clock == true )
+        {
+            nodes[k]->setAge( node_ages[begin + k] );
+        }
+        else
+        {
+            nodes[k]->setBranchLength( node_ages[begin + k] );
+        }
+    }
+
+    return t;
+}
+
+
+/** Create an empty key of the size of the split keys */
+HashedBitSet CompactTreeTrace::createSplitKey( void ) const
+{
+
+    return HashedBitSet( rooted == true ? 2 * 64 * num_words : taxa.size() );
+}
+
+
+/**
+ * Get the key under which a split is hash-consed.
+ * For rooted trees these are the taxa and the mrca. For unrooted trees we ignore the mrca
+ * and use the side of the split that does not contain the first taxon.
+ */
+void CompactTreeTrace::getSplitKey(const boost::uint64_t *w, HashedBitSet &key) const
+{
+
+    key.assign( w );
+
+    if ( rooted == false && (w[0] & 1) == 1 )
+    {
+        key.flip();
+    }
+
+}
+
+
+/** Initialize the taxon table, ordered by name, from the first tree */
+void CompactTreeTrace::initialize(const Tree &t)
+{
+
+    clear();
+
+    rooted   = t.isRooted();
+    outgroup = t.getTipNames()[0];
+    tip_taxa = t.getTaxa();
+
+    std::map<std::string, Taxon> tip_taxa;
+    for (size_t i = 0; i < t.getNumberOfTips(); ++i)
+    {
+        const Taxon &taxon = t.getTipNode( i ).getTaxon();
+        tip_taxa.insert( std::make_pair( taxon.getName(), taxon ) );
+    }
+
+    for (std::map<std::string, Taxon>::iterator it = tip_taxa.begin(); it != tip_taxa.end(); ++it)
+    {
+        taxon_indices[ it->first ] = taxa.size();
+        taxa.push_back( it->second );
+    }
+
+    num_words = (taxa.size() + 63) / 64;
+
+    split_table.clear( createSplitKey().size() );
+
+}
+
+
+/** Remove all samples and use the same taxon table, outgroup and rooting as another trace, so that the two traces can be merged */
+void CompactTreeTrace::initialize(const CompactTreeTrace &t)
+{
+
+    clear();
+
+    rooted        = t.rooted;
+    outgroup      = t.outgroup;
+    taxa          = t.taxa;
+    tip_taxa      = t.tip_taxa;
+    taxon_indices = t.taxon_indices;
+    num_words     = t.num_words;
+
+    split_table.clear( createSplitKey().size() );
+
+}
+
+
+/**
+ * Append the samples of another trace, which needs to have the same taxon table, outgroup and rooting.
+ * The splits and topologies of t are mapped onto the ones of this trace, and new ones are appended in the order in which t sampled them first.
+ * Hence, merging traces of consecutive blocks of trees gives exactly the trace of adding all trees in order.
+ */
+void CompactTreeTrace::merge(const CompactTreeTrace &t)
+{
+
+    if ( t.taxa.empty() == true )
+    {
+        return;
+    }
+
+    if ( taxa.empty() == true )
+    {
+        initialize( t );
+        node_parameters = t.node_parameters;
+    }
+    else if ( rooted != t.rooted || outgroup != t.outgroup || taxon_indices != t.taxon_indices )
+    {
+        throw RbException( "Cannot merge tree traces with different taxa or rooting." );
+    }
+
+    // we only keep the parameters if both traces have them
+    if ( node_parameters == true && t.node_parameters == false )
+    {
+        node_parameters = false;
+        node_annotations.clear();
+        annotation_offsets.assign( getNumberOfSamples() + 1, 0 );
+    }
+
+    // map the splits
+    std::vector<boost::uint32_t> split_map( t.getNumberOfSplits() );
+    HashedBitSet key = createSplitKey();
+    for (size_t s = 0; s < t.getNumberOfSplits(); ++s)
+    {
+        const boost::uint64_t *w = &t.split_words[2 * num_words * s];
+
+        getSplitKey( w, key );
+        std::pair<size_t, bool> it = split_table.insert( key );
+        if ( it.second == true )
+        {
+            split_words.insert( split_words.end(), w, w + 2 * num_words );
+            split_sizes.push_back( t.split_sizes[s] );
+        }
+        split_map[s] = boost::uint32_t( it.first );
+    }
+
+    // map the topologies
+    size_t sample_offset = getNumberOfSamples();
+    std::vector<boost::uint32_t> topology_map( t.getNumberOfTopologies() );
+    for (size_t i = 0; i < t.getNumberOfTopologies(); ++i)
+    {
+        std::vector<boost::uint32_t> topology( t.getTopologySplits( i ), t.getTopologySplits( i ) + t.getTopologySize( i ) );
+        for (size_t j = 0; j < topology.size(); ++j)
+        {
+            topology[j] = split_map[ topology[j] ];
+        }
+        std::sort( topology.begin(), topology.end() );
+
+        std::pair<std::map<std::vector<boost::uint32_t>, size_t>::iterator, bool> it = topology_indices.insert( std::make_pair( topology, topology_samples.size() ) );
+        if ( it.second == true )
+        {
+            topology_splits.insert( topology_splits.end(), topology.begin(), topology.end() );
+            topology_offsets.push_back( topology_splits.size() );
+            topology_samples.push_back( sample_offset + t.topology_samples[i] );
+        }
+        topology_map[i] = boost::uint32_t( it.first->second );
+    }
+
+    // append the samples
+    size_t node_offset = node_splits.size();
+    for (size_t k = 0; k < t.node_splits.size(); ++k)
+    {
+        node_splits.push_back( split_map[ t.node_splits[k] ] );
+    }
+    node_ages.insert( node_ages.end(), t.node_ages.begin(), t.node_ages.end() );
+    node_parents.insert( node_parents.end(), t.node_parents.begin(), t.node_parents.end() );
+    node_indices.insert( node_indices.end(), t.node_indices.begin(), t.node_indices.end() );
+    node_flags.insert( node_flags.end(), t.node_flags.begin(), t.node_flags.end() );
+
+    size_t annotation_offset = node_annotations.size();
+    if ( node_parameters == true )
+    {
+        node_annotations.insert( node_annotations.end(), t.node_annotations.begin(), t.node_annotations.end() );
+    }
+
+    size_t sampled_ancestor_offset = sampled_ancestors.size();
+    sampled_ancestors.insert( sampled_ancestors.end(), t.sampled_ancestors.begin(), t.sampled_ancestors.end() );
+
+    for (size_t i = 0; i < t.getNumberOfSamples(); ++i)
+    {
+        sample_offsets.push_back( node_offset + t.sample_offsets[i+1] );
+        sampled_ancestor_offsets.push_back( sampled_ancestor_offset + t.sampled_ancestor_offsets[i+1] );
+        annotation_offsets.push_back( annotation_offset + ( node_parameters == true ? t.annotation_offsets[i+1] : 0 ) );
+        sample_topologies.push_back( topology_map[ t.sample_topologies[i] ] );
+    }
+
+}
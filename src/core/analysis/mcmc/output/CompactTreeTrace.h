@@ -0,0 +1,155 @@
+/**
+ * @file
+ * This file contains the declaration of CompactTreeTrace which
+ * holds a sample of trees encoded as bipartitions.
+ *
+ * @brief Declaration of CompactTreeTrace
+ *
+ * (c) Copyright 2014- under GPL version 3
+ * @author The RevBayes Development Core Team
+ * @license GPL version 3
+ * @version 1.0
+ *
+ */
+
+#ifndef CompactTreeTrace_H
+#define CompactTreeTrace_H
+
+#include "Clade.h"
+#include "HashedBitSet.h"
+#include "HashedBitSetTable.h"
+#include "Taxon.h"
+#include "Tree.h"
+
+#include <boost/cstdint.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace RevBayesCore {
+
+    /**
+     * A compact representation of a sample of trees.
+     *
+     * Every node of a sampled tree is stored as a split, i.e., the set of taxa below the node
+     * packed into 64-bit words (one bit per taxon of the shared taxon table, which are ordered by name
+     * as in Tree::getTaxonBitSetMap) plus the set of its sampled ancestor children (the mrca of the clade).
+     * Identical splits are stored only once (hash-consing in a HashedBitSetTable), so a sample only keeps the split index,
+     * the age (or branch length for non-clock trees) and the position of the parent of each node in flat arrays,
+     * which are a few bytes per node and sample.
+     * The topologies are hash-consed on the set of their splits in the same way.
+     *
+     * Together with the index and the fossil flags of each node, this is enough to decode the trees again (see getTree).
+     * The node and branch parameters and the names of the internal nodes are only stored for the nodes that have any,
+     * and are dropped completely if they are not needed.
+     *
+     * Splits of rooted trees are equal if their taxa and mrcas are equal.
+     * Unrooted trees are rerooted on the outgroup (the first tip of the first tree) as in the TreeSummary,
+     * and their splits are equal if their taxa are equal or complementary.
+     *
+     * Traces that share the taxa (see initialize) can be filled independently, e.g., by different threads,
+     * and merged afterwards, which gives the same trace as adding all trees in order to a single trace.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2016-10-16, version 1.0
+     */
+    class CompactTreeTrace {
+
+    public:
+
+        static const size_t                             NOT_FOUND;                                                                      //!< Index returned if a split or topology is not contained in the trace
+
+        CompactTreeTrace(bool c = true, bool p = true);
+
+        void                                            addTree(const Tree &t);                                                         //!< Encode a tree and add it to the samples
+        void                                            clear(void);                                                                    //!< Remove all samples, splits and taxa
+        size_t                                          findSplit(const Clade &c) const;                                                //!< Get the index of the split of a clade or NOT_FOUND
+        void                                            findSplits(const Tree &t, std::vector<size_t> &s) const;                        //!< Get the index of the split of each node of a tree (by node index) or NOT_FOUND
+        size_t                                          findTopology(const Tree &t) const;                                              //!< Get the index of the topology of a tree or NOT_FOUND
+        Clade                                           getClade(size_t s) const;                                                       //!< Get the clade of a split
+        std::string                                     getNewickTopology(size_t t) const;                                              //!< Get the unique newick string of a topology (see TreeUtilities::uniqueNewickTopology)
+        size_t                                          getNumberOfSamples(void) const                  { return sample_offsets.size() - 1; }
+        size_t                                          getNumberOfSplits(void) const                   { return split_sizes.size(); }
+        size_t                                          getNumberOfTaxa(void) const                     { return taxa.size(); }
+        size_t                                          getNumberOfTopologies(void) const               { return topology_samples.size(); }
+        const std::string&                              getOutgroup(void) const                         { return outgroup; }
+        size_t                                          getSplitSize(size_t s) const                    { return split_sizes[s]; }
+        const std::vector<Taxon>&                       getTaxa(void) const                             { return taxa; }
+        size_t                                          getTaxonIndex(const std::string &n) const;                                      //!< Get the index of a taxon or NOT_FOUND
+        const std::vector<Taxon>&                       getTipTaxa(void) const                          { return tip_taxa; }                //!< The taxa in the order of the tips of the first tree
+        size_t                                          getTopologySize(size_t t) const                 { return topology_offsets[t+1] - topology_offsets[t]; }
+        Tree*                                           getTree(size_t i) const;                                                        //!< Decode the tree of sample i (the caller owns the tree)
+        bool                                            hasNodeParameters(void) const                   { return node_parameters; }       //!< Do we keep the node and branch parameters of the trees?
+        const boost::uint32_t*                          getTopologySplits(size_t t) const               { return &topology_splits[ topology_offsets[t] ]; }
+        void                                            initialize(const Tree &t);                                                      //!< Remove all samples and take the taxa, outgroup and rooting from a tree
+        void                                            initialize(const CompactTreeTrace &t);                                          //!< Remove all samples and take the taxa, outgroup and rooting from another trace
+        bool                                            isClock(void) const                             { return clock; }
+        bool                                            isRooted(void) const                            { return rooted; }
+        void                                            merge(const CompactTreeTrace &t);                                               //!< Append the samples of another trace with the same taxa
+
+        // the nodes of sample i are stored at the positions getNodesBegin(i) to getNodesEnd(i)-1 in preorder
+        size_t                                          getNodesBegin(size_t i) const                   { return sample_offsets[i]; }
+        size_t                                          getNodesEnd(size_t i) const                     { return sample_offsets[i+1]; }
+        double                                          getNodeAge(size_t k) const                      { return node_ages[k]; }
+        size_t                                          getNodeParent(size_t k) const                   { return node_parents[k] == 0 ? NOT_FOUND : k - node_parents[k]; }  //!< The position of the parent node or NOT_FOUND for the root
+        size_t                                          getNodeSplit(size_t k) const                    { return node_splits[k]; }
+        size_t                                          getSampledAncestorsBegin(size_t i) const        { return sampled_ancestor_offsets[i]; }
+        size_t                                          getSampledAncestorsEnd(size_t i) const          { return sampled_ancestor_offsets[i+1]; }
+        size_t                                          getSampledAncestor(size_t k) const              { return sampled_ancestors[k]; }    //!< The taxon index of a sampled ancestor
+        size_t                                          getTopology(size_t i) const                     { return sample_topologies[i]; }
+
+    private:
+
+        // the name and parameters of an annotated node
+        struct NodeAnnotation {
+            boost::uint32_t                             node;                                                                           //!< The position of the node within its sample
+            std::string                                 name;                                                                           //!< The name of an internal node
+            std::vector<std::string>                    node_parameters;
+            std::vector<std::string>                    branch_parameters;
+        };
+
+        void                                            encodeNode(const TopologyNode &n, size_t p, std::vector<boost::uint64_t> &w, std::vector<boost::uint32_t> &par, std::vector<double> &a, std::vector<boost::uint32_t> &sa, std::vector<const TopologyNode*> *v) const;
+        void                                            encodeTree(const Tree &t, std::vector<boost::uint64_t> &w, std::vector<boost::uint32_t> &par, std::vector<double> &a, std::vector<boost::uint32_t> &sa) const;
+        size_t                                          findSplit(const boost::uint64_t *w) const;
+        HashedBitSet                                    createSplitKey(void) const;
+        void                                            getSplitKey(const boost::uint64_t *w, HashedBitSet &key) const;
+
+        bool                                            clock;                                                                          //!< Do we store ages (or branch lengths)?
+        bool                                            rooted;                                                                         //!< Are the trees rooted?
+        bool                                            node_parameters;                                                                //!< Do we keep the node and branch parameters?
+        std::string                                     outgroup;                                                                       //!< The outgroup for rerooting unrooted trees
+        std::vector<Taxon>                              taxa;                                                                           //!< The shared taxon table
+        std::vector<Taxon>                              tip_taxa;                                                                       //!< The taxa in the order of the tips of the first tree
+        std::map<std::string, size_t>                   taxon_indices;                                                                  //!< The index of each taxon name
+        size_t                                          num_words;                                                                      //!< The number of 64-bit words per taxon set
+
+        // the hash-consed splits
+        HashedBitSetTable                               split_table;                                                                    //!< The index of each (normalized) split
+        std::vector<boost::uint64_t>                    split_words;                                                                    //!< The taxa and the mrca of each split (2*num_words each) as first sampled
+        std::vector<size_t>                             split_sizes;                                                                    //!< The number of taxa of each split
+
+        // the hash-consed topologies
+        std::map<std::vector<boost::uint32_t>, size_t>  topology_indices;                                                               //!< The index of each topology (sorted unique splits)
+        std::vector<boost::uint32_t>                    topology_splits;                                                                //!< The sorted unique splits of each topology
+        std::vector<size_t>                             topology_offsets;                                                               //!< The start of each topology in topology_splits
+        std::vector<size_t>                             topology_samples;                                                               //!< The first sample of each topology
+
+        // the samples
+        std::vector<boost::uint32_t>                    node_splits;                                                                    //!< The split of each node in each sample
+        std::vector<double>                             node_ages;                                                                      //!< The age or branch length of each node in each sample
+        std::vector<boost::uint32_t>                    node_parents;                                                                   //!< The distance to the parent of each node in each sample (0 for the root)
+        std::vector<boost::uint32_t>                    node_indices;                                                                   //!< The index of each node in the sampled tree
+        std::vector<unsigned char>                      node_flags;                                                                     //!< Whether each node is a fossil and/or a sampled ancestor
+        std::vector<NodeAnnotation>                     node_annotations;                                                               //!< The annotated nodes of each sample
+        std::vector<size_t>                             annotation_offsets;                                                             //!< The start of each sample in node_annotations
+        std::vector<size_t>                             sample_offsets;                                                                 //!< The start of each sample in the node arrays
+        std::vector<boost::uint32_t>                    sample_topologies;                                                              //!< The topology of each sample
+        std::vector<boost::uint32_t>                    sampled_ancestors;                                                              //!< The sampled ancestor taxa of each sample
+        std::vector<size_t>                             sampled_ancestor_offsets;                                                       //!< The start of each sample in sampled_ancestors
+
+    };
+
+}
+
+#endif
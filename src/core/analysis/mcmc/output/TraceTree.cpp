@@ -1,3 +1,4 @@
+#include "RbException.h"
 #include "RbUtil.h"
 #include "Tree.h"
 #include "TraceTree.h"
@@ -11,11 +12,11 @@
 using namespace RevBayesCore;
 
 
-TraceTree::TraceTree( bool c ) :
+TraceTree::TraceTree( bool c, bool p ) :
+    compact_trace( c, p ),
     clock( c )
 {
     outgroup = "";
-    values.clear();
     invalidate();
 }
 
@@ -23,7 +24,6 @@ TraceTree::TraceTree( bool c ) :
 TraceTree::~TraceTree()
 {
 
-    values.clear();
 }
 
 
@@ -35,7 +35,8 @@ void TraceTree::addObject(Tree *t)
     //        t->reroot( outgroup );
     
     
-    values.push_back(*t);
+    // we only store the encoded tree
+    compact_trace.addTree( *t );
     
     delete t;
     
@@ -44,6 +45,20 @@ void TraceTree::addObject(Tree *t)
 }
 
 
+/**
+ * Append trees that are already encoded, e.g., from a streaming reader.
+ * The node parameters are only kept if both traces keep them.
+ */
+void TraceTree::addCompactTrace(const CompactTreeTrace &t)
+{
+    
+    compact_trace.merge( t );
+    
+    // invalidate for recalculation of meta data
+    invalidate();
+}
+
+
 void TraceTree::addValueFromString(const std::string &s)
 {
     
@@ -84,6 +99,39 @@ void TraceTree::invalidate()
 }
 
 
+std::vector<Tree> TraceTree::getValues( void ) const
+{
+    
+    std::vector<Tree> values;
+    for (size_t i = 0; i < size(); ++i)
+    {
+        values.push_back( objectAt( i ) );
+    }
+    
+    return values;
+}
+
+
+/**
+ * Get the tree of a sample.
+ * The trees are only stored encoded, so every call decodes the tree again.
+ */
+Tree TraceTree::objectAt(size_t index) const
+{
+    
+    if ( index >= size() )
+    {
+        throw RbException("Index out of bounds of the tree trace.");
+    }
+    
+    Tree *t = compact_trace.getTree( index );
+    Tree tree = *t;
+    delete t;
+    
+    return tree;
+}
+
+
 bool TraceTree::isCoveredInInterval(const std::string &v, double i, bool verbose) const
 {
     
@@ -105,8 +153,15 @@ void TraceTree::printValue(std::ostream &o) const
 }
 
 
+/**
+ * Remove a tree from the trace.
+ * The splits and topologies are shared by all samples, so we encode the remaining trees again.
+ */
 void TraceTree::removeObjectAtIndex (int index)
 {
+    
+    std::vector<Tree> values = getValues();
+    
     // create a iterator for the vector
     std::vector<Tree>::iterator it = values.begin();
     
@@ -115,6 +170,7 @@ void TraceTree::removeObjectAtIndex (int index)
     
     // remove the element
     values.erase(it);
+    setValues( values );
     
     // invalidate for recalculation of meta data
     invalidate();
@@ -123,9 +179,18 @@ void TraceTree::removeObjectAtIndex (int index)
 
 void TraceTree::removeLastObject()
 {
-    // remove object from list
-    values.pop_back();
     
-    // invalidate for recalculation of meta data
-    invalidate();
+    removeObjectAtIndex( int(size()) - 1 );
+}
+
+
+void TraceTree::setValues(const std::vector<Tree> &v)
+{
+    
+    compact_trace.clear();
+    for (size_t i = 0; i < v.size(); ++i)
+    {
+        compact_trace.addTree( v[i] );
+    }
+    
 }
@@ -1,6 +1,7 @@
 #ifndef TraceTree_H
 #define TraceTree_H
 
+#include "CompactTreeTrace.h"
 #include "Tree.h"
 #include "Trace.h"
 
@@ -17,7 +18,7 @@ namespace RevBayesCore {
     
     public:
     
-        TraceTree( bool c );
+        TraceTree( bool c, bool p = true );
         virtual                    ~TraceTree();
     
         // overloaded functions from RbObject
@@ -25,21 +26,24 @@ namespace RevBayesCore {
         void                        printValue(std::ostream& o) const;                                          //!< Print value for user
 		
         void                        addObject(Tree *d);
+        void                        addCompactTrace(const CompactTreeTrace &t);                                 //!< Append trees that are already encoded
         void                        addValueFromString(const std::string &s);
+        bool                        hasNodeParameters(void) const                   { return compact_trace.hasNodeParameters(); }   //!< Do the trees keep their node and branch parameters?
         bool                        isCoveredInInterval(const std::string &v, double i, bool verbose) const;
-        const Tree&                 objectAt(size_t index) const                   { return values.at(index); }
+        Tree                        objectAt(size_t index) const;                                               //!< Decode the tree of a sample
         void                        removeLastObject();
         void                        removeObjectAtIndex(int index);
-        size_t                      size() const { return values.size(); }
+        size_t                      size() const                                    { return compact_trace.getNumberOfSamples(); }
     
         // getters and setters
         int                         getBurnin() const                               { return burnin; }
+        const CompactTreeTrace&     getCompactTrace() const                         { return compact_trace; }     //!< Get the trees encoded as splits
         double                      getEss() const                                  { return ess; }
         std::string                 getFileName() const                             { return fileName; }
         std::string                 getParameterName() const                        { return parmName; }
-        int                         getSamples() const                              { return (int)values.size(); }
+        int                         getSamples() const                              { return (int)size(); }
         int                         getStepSize() const                             { return stepSize; }
-        std::vector<Tree>           getValues() const                               { return values; }
+        std::vector<Tree>           getValues() const;
         int                         hasConverged() const                            { return converged; }
         int                         hasPassedEssThreshold() const                   { return passedEssThreshold; }
         int                         hasPassedGelmanRubinTest() const                { return passedGelmanRubinTest; }
@@ -54,7 +58,7 @@ namespace RevBayesCore {
         void                        setFileName(std::string fn)                     { fileName = fn; }
         void                        setParameterName(std::string pm)                { parmName = pm; }
         void                        setStepSize( int s)                             { stepSize = s; }
-        void                        setValues(const std::vector<Tree> &v)           { values = v; }
+        void                        setValues(const std::vector<Tree> &v);
         void                        setConverged(bool c)                            { converged = c; }
         void                        setPassedEssThreshold(int p)                    { passedEssThreshold = p; }
         void                        setPassedGelmanRubinTest(int p)                 { passedGelmanRubinTest = p; }
@@ -70,7 +74,7 @@ namespace RevBayesCore {
     
     private:
     
-        std::vector<Tree>           values;                                     //!< the values of this TraceTree
+        CompactTreeTrace            compact_trace;                              //!< the values of this TraceTree, which are decoded when needed
     
         bool                        clock;
         
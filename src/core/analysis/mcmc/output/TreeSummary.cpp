@@ -12,6 +12,7 @@
 
 #include <boost/lexical_cast.hpp>
 #include <iomanip>
+#include <numeric>
 #include <vector>
 #include <limits>
 #include <cmath>
@@ -31,12 +32,10 @@ TreeSummary::TreeSummary( void ) :
 
 TreeSummary::TreeSummary( const TraceTree &t ) :
     clock( t.isClock() ),
-    rooted( t.objectAt(0).isRooted() ),
+    rooted( t.getCompactTrace().isRooted() ),
     summarized( false ),
     trace( t ),
-    use_tree_trace( true ),
-    cladeAges( CladeComparator(rooted) ),
-    conditionalCladeAges( CladeComparator(rooted) )
+    use_tree_trace( true )
 {
     setBurnin( t.getBurnin() );
 }
@@ -110,31 +109,39 @@ Tree* TreeSummary::ancestralStateTree(const Tree &input_summary_tree, std::vecto
     double weight = 1.0 / ( num_sampled_states - burnin );
     
     bool process_active = true;
-    ProgressBar progress = ProgressBar( summary_nodes.size() * num_sampled_states, 0 );
+    ProgressBar progress = ProgressBar( num_sampled_states, burnin );
     if ( verbose == true && process_active == true )
     {
         progress.start();
     }
-        
-    // loop through all nodes in the summary tree
-    for (size_t i = 0; i < summary_nodes.size(); ++i)
+    
+    // the ancestral state trace of each node in the summary tree
+    std::vector<bool> trace_found( summary_nodes.size(), false );
+    std::vector<AncestralStateTrace*> node_traces( summary_nodes.size(), NULL );
+    
+    // loop through all the ancestral state samples
+    // the samples are the outer loop so that every sampled tree is decoded only once
+    for (size_t j = burnin; j < num_sampled_states; ++j)
     {
-        size_t sample_clade_index;
-        bool trace_found = false;
-        AncestralStateTrace ancestralstate_trace;
         
-        // loop through all the ancestral state samples
-        for (size_t j = burnin; j < num_sampled_states; ++j)
+        if ( verbose == true && process_active == true )
         {
-            
-            if ( verbose == true && process_active == true )
-            {
-                progress.update( i * num_sampled_states + num_sampled_states * (j - burnin) / (num_sampled_states - burnin) );
-            }
-            
-            // if necessary, get the sampled tree from the tree trace
-            const Tree &sample_tree = (use_tree_trace) ? trace.objectAt( j ) : *final_summary_tree;
-            const TopologyNode& sample_root = sample_tree.getRoot();
+            progress.update( j );
+        }
+        
+        // if necessary, get the sampled tree from the tree trace
+        Tree sampled_tree;
+        if ( use_tree_trace == true )
+        {
+            sampled_tree = trace.objectAt( j );
+        }
+        const Tree &sample_tree = (use_tree_trace) ? sampled_tree : *final_summary_tree;
+        const TopologyNode& sample_root = sample_tree.getRoot();
+        
+        // loop through all nodes in the summary tree
+        for (size_t i = 0; i < summary_nodes.size(); ++i)
+        {
+            size_t sample_clade_index;
             
             if ( use_tree_trace == true )
             {
@@ -142,7 +149,7 @@ Tree* TreeSummary::ancestralStateTree(const Tree &input_summary_tree, std::vecto
                 sample_clade_index = sample_root.getCladeIndex( summary_nodes[i] );
                 
                 // and we must also find the trace for this node index
-                trace_found = false;
+                trace_found[i] = false;
             }
             else
             {
@@ -153,30 +160,35 @@ Tree* TreeSummary::ancestralStateTree(const Tree &input_summary_tree, std::vecto
             {
                 
                 // if necessary find the AncestralStateTrace for the sampled node
-                if ( trace_found == false )
+                if ( trace_found[i] == false )
                 {
                     for (size_t k = 0; k < ancestralstate_traces.size(); ++k)
                     {
                         // if we have an ancestral state trace from an anagenetic-only process
                         if (ancestralstate_traces[k].getParameterName() == StringUtilities::toString(sample_clade_index + 1))
                         {
-                            ancestralstate_trace = ancestralstate_traces[k];
-                            trace_found = true;
+                            node_traces[i] = &ancestralstate_traces[k];
+                            trace_found[i] = true;
                             break;
                         }
                         // if we have an ancestral state trace from a cladogenetic process
                         // if you need to annotate start states too, use cladoAncestralStateTree
                         if (ancestralstate_traces[k].getParameterName() == "end_" + StringUtilities::toString(sample_clade_index + 1))
                         {
-                            ancestralstate_trace = ancestralstate_traces[k];
-                            trace_found = true;
+                            node_traces[i] = &ancestralstate_traces[k];
+                            trace_found[i] = true;
                             break;
                         }
                     }
                 }
                 
+                if ( node_traces[i] == NULL )
+                {
+                    throw RbException("Could not find the ancestral state trace of node " + StringUtilities::toString(sample_clade_index + 1) + ".");
+                }
+                
                 // get the sampled ancestral state for this iteration
-                const std::vector<std::string>& ancestralstate_vector = ancestralstate_trace.getValues();
+                const std::vector<std::string>& ancestralstate_vector = node_traces[i]->getValues();
                 std::string ancestralstate = getSiteState( ancestralstate_vector[j], site );
                 
                 bool state_found = false;
@@ -449,45 +461,53 @@ Tree* TreeSummary::cladoAncestralStateTree(const Tree &input_summary_tree, std::
     double weight = 1.0 / ( num_sampled_states - burnin );
     
     bool process_active = true;
-    ProgressBar progress = ProgressBar( summary_nodes.size() * num_sampled_states, 0 );
+    ProgressBar progress = ProgressBar( num_sampled_states, burnin );
     if ( verbose == true && process_active == true )
     {
         progress.start();
     }
     
-    // loop through all nodes in the summary tree
-    for (size_t i = 0; i < summary_nodes.size(); ++i)
+    // the ancestral state traces of each node in the summary tree
+    std::vector<bool> found_end_state( summary_nodes.size(), false );
+    std::vector<bool> found_start_1( summary_nodes.size(), false );
+    std::vector<bool> found_start_2( summary_nodes.size(), false );
+    std::vector<AncestralStateTrace*> ancestralstate_traces_end( summary_nodes.size(), NULL );
+    std::vector<AncestralStateTrace*> ancestralstate_traces_start_1( summary_nodes.size(), NULL );
+    std::vector<AncestralStateTrace*> ancestralstate_traces_start_2( summary_nodes.size(), NULL );
+    
+    // loop through all the ancestral state samples
+    // the samples are the outer loop so that every sampled tree is decoded only once
+    for (size_t j = burnin; j < num_sampled_states; ++j)
     {
-        size_t sample_clade_index;
-        bool found_end_state = false;
-        bool found_start_1 = false;
-        bool found_start_2 = false;
-        AncestralStateTrace ancestralstate_trace_end;
-        AncestralStateTrace ancestralstate_trace_start_1;
-        AncestralStateTrace ancestralstate_trace_start_2;
         
-        // loop through all the ancestral state samples
-        for (size_t j = burnin; j < num_sampled_states; ++j)
+        if ( verbose == true && process_active == true )
         {
-            
-            if ( verbose == true && process_active == true )
-            {
-                progress.update( i * num_sampled_states + num_sampled_states * (j - burnin) / (num_sampled_states - burnin) );
-            }
-            
-            // if necessary, get the sampled tree from the tree trace
-            const Tree &sample_tree = (use_tree_trace) ? trace.objectAt( j ) : *final_summary_tree;
-            const TopologyNode& sample_root = sample_tree.getRoot();
+            progress.update( j );
+        }
+        
+        // if necessary, get the sampled tree from the tree trace
+        Tree sampled_tree;
+        if ( use_tree_trace == true )
+        {
+            sampled_tree = trace.objectAt( j );
+        }
+        const Tree &sample_tree = (use_tree_trace) ? sampled_tree : *final_summary_tree;
+        const TopologyNode& sample_root = sample_tree.getRoot();
+        
+        // loop through all nodes in the summary tree
+        for (size_t i = 0; i < summary_nodes.size(); ++i)
+        {
+            size_t sample_clade_index;
             
             if ( use_tree_trace == true )
             {
                 // check if the clade in the summary tree is also in the sampled tree
                 sample_clade_index = sample_root.getCladeIndex( summary_nodes[i] );
                 
-                // and we must also find the trace sfor this node index
-                found_end_state = false;
-                found_start_1 = false;
-                found_start_2 = false;
+                // and we must also find the traces for this node index
+                found_end_state[i] = false;
+                found_start_1[i] = false;
+                found_start_2[i] = false;
             }
             else
             {
@@ -508,53 +528,58 @@ Tree* TreeSummary::cladoAncestralStateTree(const Tree &input_summary_tree, std::
                 
                 
                 // if necessary find the AncestralStateTraces for the sampled node
-                if ( found_end_state == false )
+                if ( found_end_state[i] == false )
                 {
                     for (size_t k = 0; k < ancestralstate_traces.size(); k++)
                     {
                         if (ancestralstate_traces[k].getParameterName() == "end_" + StringUtilities::toString(sample_clade_index + 1))
                         {
-                            ancestralstate_trace_end = ancestralstate_traces[k];
-                            found_end_state = true;
+                            ancestralstate_traces_end[i] = &ancestralstate_traces[k];
+                            found_end_state[i] = true;
                         }
                         
                         if ( !summary_nodes[i]->isTip() )
                         {
                             if (ancestralstate_traces[k].getParameterName() == "start_" + StringUtilities::toString(sample_clade_index_child_1 + 1))
                             {
-                                ancestralstate_trace_start_1 = ancestralstate_traces[k];
-                                found_start_1 = true;
+                                ancestralstate_traces_start_1[i] = &ancestralstate_traces[k];
+                                found_start_1[i] = true;
                             }
                             
                             if (ancestralstate_traces[k].getParameterName() == "start_" + StringUtilities::toString(sample_clade_index_child_2 + 1))
                             {
-                                ancestralstate_trace_start_2 = ancestralstate_traces[k];
-                                found_start_2 = true;
+                                ancestralstate_traces_start_2[i] = &ancestralstate_traces[k];
+                                found_start_2[i] = true;
                             }
                         }
                         else
                         {
-                            found_start_1 = true;
-                            found_start_2 = true;
+                            found_start_1[i] = true;
+                            found_start_2[i] = true;
                         }
                         
-                        if (found_end_state && found_start_1 && found_start_2)
+                        if (found_end_state[i] && found_start_1[i] && found_start_2[i])
                         {
                             break;
                         }
                     }
                 }
                 
+                if ( ancestralstate_traces_end[i] == NULL || ( !summary_nodes[i]->isTip() && ( ancestralstate_traces_start_1[i] == NULL || ancestralstate_traces_start_2[i] == NULL ) ) )
+                {
+                    throw RbException("Could not find the ancestral state traces of node " + StringUtilities::toString(sample_clade_index + 1) + ".");
+                }
+                
                 // get the sampled ancestral states for this iteration
-                std::vector<std::string> ancestralstate_trace_end_vector = ancestralstate_trace_end.getValues();
+                const std::vector<std::string> &ancestralstate_trace_end_vector = ancestralstate_traces_end[i]->getValues();
                 std::string ancestralstate_end = getSiteState( ancestralstate_trace_end_vector[j], site );
                 
                 if ( !summary_nodes[i]->isTip() )
                 {
-                    std::vector<std::string> ancestralstate_trace_start_1_vector = ancestralstate_trace_start_1.getValues();
+                    const std::vector<std::string> &ancestralstate_trace_start_1_vector = ancestralstate_traces_start_1[i]->getValues();
                     std::string ancestralstate_start_1 = getSiteState( ancestralstate_trace_start_1_vector[j], site );
                     
-                    std::vector<std::string> ancestralstate_trace_start_2_vector = ancestralstate_trace_start_2.getValues();
+                    const std::vector<std::string> &ancestralstate_trace_start_2_vector = ancestralstate_traces_start_2[i]->getValues();
                     std::string ancestralstate_start_2 = getSiteState( ancestralstate_trace_start_2_vector[j], site );
                     
                     size_t child1 = summary_nodes[i]->getChild(0).getIndex();
@@ -1462,61 +1487,112 @@ void TreeSummary::annotateTree( Tree &tree, AnnotationReport report, bool verbos
 
     RBOUT("Annotating tree ...");
 
-    std::string newick;
+    const CompactTreeTrace &compact = trace.getCompactTrace();
+
+    size_t topology = CompactTreeTrace::NOT_FOUND;
     
     if( report.tree_ages )
     {
-        Tree* tmp_tree = NULL;
-        if ( clock == true )
+        if( tree.isRooted() != rooted )
         {
-            tmp_tree = TreeUtilities::convertTree( tree );
+            throw(RbException("Rooting of input tree differs from the tree sample"));
         }
-        else
+
+        topology = compact.findTopology( tree );
+
+        if( topology == CompactTreeTrace::NOT_FOUND || treeFrequencies[topology] == 0 )
         {
-            tmp_tree = tree.clone();
+            throw(RbException("Could not find input tree in tree sample"));
         }
+    }
+
+    const std::vector<TopologyNode*> &nodes = tree.getNodes();
+    
+    double sampleSize = trace.size() - burnin;
 
-        if( tmp_tree->isRooted() == false && rooted == false )
+    // get the splits of the nodes and their parents
+    std::vector<size_t> node_splits;
+    compact.findSplits( tree, node_splits );
+
+    std::map<const TopologyNode*, size_t> node_positions;
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        node_positions[ nodes[i] ] = i;
+    }
+
+    std::vector<size_t> parent_splits( nodes.size(), CompactTreeTrace::NOT_FOUND );
+    std::vector<std::vector<size_t> > split_nodes( compact.getNumberOfSplits() );
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        if ( nodes[i]->isRoot() == false )
         {
-            tmp_tree->reroot( trace.objectAt(0).getTipNames()[0], true );
+            parent_splits[i] = node_splits[ node_positions[ &nodes[i]->getParent() ] ];
         }
-        else if( tmp_tree->isRooted() != rooted )
+        if ( node_splits[i] != CompactTreeTrace::NOT_FOUND )
         {
-            throw(RbException("Rooting of input tree differs from the tree sample"));
+            split_nodes[ node_splits[i] ].push_back( i );
         }
+    }
 
-        newick = TreeUtilities::uniqueNewickTopology( *tmp_tree );
+    // collect the ages of the clades of the tree in a single pass over the samples,
+    // conditional on the parent clade and on the topology of the tree
+    std::vector<std::vector<double> > clade_ages( nodes.size() );
+    std::vector<std::vector<double> > conditional_clade_ages( nodes.size() );
+    std::vector<std::vector<double> > tree_clade_ages( nodes.size() );
+    std::vector<size_t> last_sample( nodes.size(), CompactTreeTrace::NOT_FOUND );
+    std::vector<size_t> last_conditional_sample( nodes.size(), CompactTreeTrace::NOT_FOUND );
 
-        delete tmp_tree;
+    for (size_t j = burnin; j < compact.getNumberOfSamples(); ++j)
+    {
+        bool same_topology = ( compact.getTopology( j ) == topology );
 
-        if( treeCladeAges.find(newick) == treeCladeAges.end() )
+        for (size_t k = compact.getNodesBegin( j ); k < compact.getNodesEnd( j ); ++k)
         {
-            throw(RbException("Could not find input tree in tree sample"));
+            const std::vector<size_t> &clade_nodes = split_nodes[ compact.getNodeSplit( k ) ];
+
+            for (size_t l = 0; l < clade_nodes.size(); ++l)
+            {
+                size_t i = clade_nodes[l];
+                double age = compact.getNodeAge( k );
+
+                // each clade is counted once per sample
+                if ( last_sample[i] != j )
+                {
+                    last_sample[i] = j;
+                    clade_ages[i].push_back( age );
+                    if ( same_topology == true )
+                    {
+                        tree_clade_ages[i].push_back( age );
+                    }
+                }
+
+                size_t parent = compact.getNodeParent( k );
+                if ( parent != CompactTreeTrace::NOT_FOUND && compact.getNodeSplit( parent ) == parent_splits[i] && last_conditional_sample[i] != j )
+                {
+                    last_conditional_sample[i] = j;
+                    conditional_clade_ages[i].push_back( age );
+                }
+            }
         }
     }
 
-    const std::vector<TopologyNode*> &nodes = tree.getNodes();
-    
-    double sampleSize = trace.size() - burnin;
-    
     for (size_t i = 0; i < nodes.size(); ++i)
     {
         TopologyNode* n = nodes[i];
 
-        Clade c = n->getClade();
-
         // annotate clade posterior prob
-        if ( ( !n->isTip() || ( n->isRoot() && !c.getMrca().empty() ) ) && report.posterior )
+        if ( ( !n->isTip() || ( n->isRoot() && !n->getClade().getMrca().empty() ) ) && report.posterior )
         {
-            double cladeFreq = findCladeSample( c ).getFrequency();
+            double cladeFreq = findCladeFrequency( node_splits[i], *n );
             double pp = cladeFreq / sampleSize;
             n->addNodeParameter("posterior",pp);
         }
 
         // are we using sampled ancestors?
-        if( sampledAncestorSamples.empty() == false )
+        if( sampledAncestorFrequencies.empty() == false )
         {
-            double saFreq = sampledAncestorSamples[n->getTaxon()].getFrequency();
+            size_t taxon = n->isTip() ? compact.getTaxonIndex( n->getTaxon().getName() ) : CompactTreeTrace::NOT_FOUND;
+            double saFreq = ( taxon == CompactTreeTrace::NOT_FOUND ? 0.0 : sampledAncestorFrequencies[taxon] );
 
             // annotate sampled ancestor prob
             if( ((n->isTip() && n->isFossil()) || saFreq > 0) && report.sa )
@@ -1530,26 +1606,24 @@ void TreeSummary::annotateTree( Tree &tree, AnnotationReport report, bool verbos
 
         if ( !n->isRoot() )
         {
-            Clade parent = n->getParent().getClade();
-            std::map<Clade, std::vector<double>, CladeComparator >& condCladeAges = conditionalCladeAges[parent];
-            nodeAges = report.cc_ages ? condCladeAges[c] : cladeAges[c];
+            nodeAges = report.cc_ages ? conditional_clade_ages[i] : clade_ages[i];
 
             // annotate CCPs
             if( !n->isTip() && report.ccp )
             {
-                double parentCladeFreq = findCladeSample( parent ).getFrequency();
-                double ccp = condCladeAges[c].size() / parentCladeFreq;
+                double parentCladeFreq = findCladeFrequency( parent_splits[i], n->getParent() );
+                double ccp = conditional_clade_ages[i].size() / parentCladeFreq;
                 n->addNodeParameter("ccp",ccp);
             }
         }
         else
         {
-            nodeAges = cladeAges[c];
+            nodeAges = clade_ages[i];
         }
 
         if ( report.tree_ages )
         {
-            nodeAges = treeCladeAges[newick][ c ];
+            nodeAges = tree_clade_ages[i];
         }
             
         // set the node ages/branch lengths
@@ -1596,7 +1670,7 @@ void TreeSummary::annotateTree( Tree &tree, AnnotationReport report, bool verbos
         // annotate the HPD node age intervals
         if( report.hpd )
         {
-            nodeAges = cladeAges[c];
+            nodeAges = clade_ages[i];
 
             std::sort(nodeAges.begin(), nodeAges.end());
 
@@ -1647,7 +1721,8 @@ void TreeSummary::annotateTree( Tree &tree, AnnotationReport report, bool verbos
         enforceNonnegativeBranchLengths( tree.getRoot() );
     }*/
 
-    if( report.map_parameters )
+    // the parameters of the nodes are only available if the trace keeps them
+    if( report.map_parameters && trace.hasNodeParameters() )
     {
         mapParameters( tree );
     }
@@ -1660,7 +1735,14 @@ double TreeSummary::cladeProbability(const RevBayesCore::Clade &c, bool verbose
 {
     summarize(verbose);
 
-    return findCladeSample(c).getFrequency();
+    size_t s = trace.getCompactTrace().findSplit( c );
+
+    if ( s == CompactTreeTrace::NOT_FOUND || cladeFrequencies[s] == 0 )
+    {
+        throw RbException("Couldn't find a clade with name '" + c.toString() + "'.");
+    }
+
+    return cladeFrequencies[s];
 }
 
 
@@ -1679,40 +1761,15 @@ void TreeSummary::enforceNonnegativeBranchLengths(TopologyNode& node) const
 }
 
 
-//filling in clades and clade ages - including tip nodes in clade sample - to get age for serially sampled tips in time trees
-Clade TreeSummary::fillConditionalClades(const TopologyNode &n, std::map<Clade, std::set<Clade, CladeComparator>, CladeComparator> &condClades)
+size_t TreeSummary::findCladeFrequency(size_t s, const TopologyNode &n) const
 {
     
-    Clade parent = n.getClade();
-    parent.setAge( (clock == true ? n.getAge() : n.getBranchLength() ) );
-    
-    std::set<Clade, CladeComparator> children( (CladeComparator(rooted)) );
-
-    for (size_t i = 0; i < n.getNumberOfChildren(); i++)
+    if ( s == CompactTreeTrace::NOT_FOUND || cladeFrequencies[s] == 0 )
     {
-        const TopologyNode &childNode = n.getChild(i);
-
-        Clade ChildClade = fillConditionalClades(childNode, condClades);
-        children.insert(ChildClade);
+        throw RbException("Couldn't find a clade with name '" + n.getClade().toString() + "'.");
     }
-    
-    condClades[parent] = children;
-
-    return parent;
-}
-
-
-const Sample<Clade>& TreeSummary::findCladeSample(const Clade &n) const
-{
-    
-    std::vector<Sample<Clade> >::const_iterator it = find_if(cladeSamples.begin(), cladeSamples.end(), CladeComparator(rooted, n) );
 
-    if(it != cladeSamples.end())
-    {
-        return *it;
-    }
-    
-    throw RbException("Couldn't find a clade with name '" + n.toString() + "'.");
+    return cladeFrequencies[s];
 }
 
 
@@ -1828,35 +1885,9 @@ int TreeSummary::getTopologyFrequency(const RevBayesCore::Tree &tree, bool verbo
 {
     summarize( verbose );
     
-    std::string outgroup = trace.objectAt(0).getTipNames()[0];
-
-    Tree t = tree;
-
-    if( t.isRooted() == false && rooted == false )
-    {
-        t.reroot( outgroup, true );
-    }
-
-    std::string newick = TreeUtilities::uniqueNewickTopology( t );
-    
-    //double total_samples = trace.size();
-    double freq = 0;
-    
-    for (std::vector<Sample<std::string> >::const_reverse_iterator it = treeSamples.rbegin(); it != treeSamples.rend(); ++it)
-    {
-        
-        if ( newick == it->getValue() )
-        {
-            freq =it->getFrequency();
-//            p = freq/(total_samples-burnin);
-            
-            // now we found it
-            break;
-        }
-        
-    }
+    size_t topology = trace.getCompactTrace().findTopology( tree );
     
-    return freq;
+    return topology == CompactTreeTrace::NOT_FOUND ? 0 : int(treeFrequencies[topology]);
 }
 
 
@@ -1868,13 +1899,13 @@ std::vector<Tree> TreeSummary::getUniqueTrees( double credible_interval_size, bo
     NewickConverter converter;
     double total_prob = 0;
     double total_samples = trace.size();
-    for (std::vector<Sample<std::string> >::const_reverse_iterator it = treeSamples.rbegin(); it != treeSamples.rend(); ++it)
+    for (std::vector<Sample<size_t> >::const_reverse_iterator it = treeSamples.rbegin(); it != treeSamples.rend(); ++it)
     {
         double freq =it->getFrequency();
         double p =freq/(total_samples-burnin);
         total_prob += p;
         
-        Tree* current_tree = converter.convertFromNewick( it->getValue() );
+        Tree* current_tree = converter.convertFromNewick( trace.getCompactTrace().getNewickTopology( it->getValue() ) );
         unique_trees.push_back( *current_tree );
         delete current_tree;
         if ( total_prob >= credible_interval_size )
@@ -1896,20 +1927,11 @@ bool TreeSummary::isTreeContainedInCredibleInterval(const RevBayesCore::Tree &t,
     
     RandomNumberGenerator *rng = GLOBAL_RNG;
 
-    std::string outgroup = trace.objectAt(0).getTipNames()[0];
-
-    Tree tree = t;
-
-    if( tree.isRooted() == false && rooted == false )
-    {
-        tree.reroot( outgroup, true );
-    }
-
-    std::string newick = TreeUtilities::uniqueNewickTopology(tree);
+    size_t topology = trace.getCompactTrace().findTopology( t );
    
     double totalSamples = trace.size();
     double totalProb = 0.0;
-    for (std::vector<Sample<std::string> >::reverse_iterator it = treeSamples.rbegin(); it != treeSamples.rend(); ++it)
+    for (std::vector<Sample<size_t> >::reverse_iterator it = treeSamples.rbegin(); it != treeSamples.rend(); ++it)
     {
         
         double p =it->getFrequency()/(totalSamples-burnin);
@@ -1918,8 +1940,7 @@ bool TreeSummary::isTreeContainedInCredibleInterval(const RevBayesCore::Tree &t,
         
         if ( include_prob > rng->uniform01() )
         {
-            const std::string &current_sample = it->getValue();
-            if ( newick == current_sample )
+            if ( topology == it->getValue() )
             {
                 return true;
             }
@@ -1949,7 +1970,7 @@ Tree* TreeSummary::mapTree( AnnotationReport report, bool verbose )
     summarize( verbose );
     
     // get the tree with the highest posterior probability
-    std::string bestNewick = treeSamples.rbegin()->getValue();
+    std::string bestNewick = trace.getCompactTrace().getNewickTopology( treeSamples.rbegin()->getValue() );
     NewickConverter converter;
     Tree* tmp_best_tree = converter.convertFromNewick( bestNewick );
     
@@ -1966,7 +1987,7 @@ Tree* TreeSummary::mapTree( AnnotationReport report, bool verbose )
 
     delete tmp_best_tree;
 
-    TaxonMap tm = TaxonMap( trace.objectAt(0) );
+    TaxonMap tm = TaxonMap( trace.getCompactTrace().getTipTaxa() );
     tmp_tree->setTaxonIndices( tm );
 
     report.ages            = true;
@@ -1989,19 +2010,21 @@ Tree* TreeSummary::mccTree( AnnotationReport report, bool verbose )
     double max_cc = 0;
 
     // find the clade credibility score for each tree
+    const CompactTreeTrace &compact = trace.getCompactTrace();
+
     for(size_t t = 0; t < treeSamples.size(); t++)
     {
-        std::string newick = treeSamples[t].getValue();
+        size_t topology = treeSamples[t].getValue();
 
-        // now we summarize the clades for the best tree
-        std::map<Clade, std::vector<double>, CladeComparator> cladeAges = treeCladeAges[newick];
+        // the clades of this tree
+        const boost::uint32_t *splits = compact.getTopologySplits( topology );
 
         double cc = 0;
 
         // find the product of the clade frequencies
-        for(std::map<Clade, std::vector<double>, CladeComparator>::iterator clade = cladeAges.begin(); clade != cladeAges.end(); clade++)
+        for(size_t i = 0; i < compact.getTopologySize( topology ); i++)
         {
-            cc += log( findCladeSample( clade->first ).getFrequency() );
+            cc += log( cladeFrequencies[ splits[i] ] );
         }
 
         if(cc > max_cc)
@@ -2011,7 +2034,7 @@ Tree* TreeSummary::mccTree( AnnotationReport report, bool verbose )
             delete best_tree;
 
             NewickConverter converter;
-            Tree* tmp_tree = converter.convertFromNewick( newick );
+            Tree* tmp_tree = converter.convertFromNewick( compact.getNewickTopology( topology ) );
             if ( clock == true )
             {
                 best_tree = TreeUtilities::convertTree( *tmp_tree );
@@ -2021,7 +2044,7 @@ Tree* TreeSummary::mccTree( AnnotationReport report, bool verbose )
                 best_tree = tmp_tree->clone();
             }
 
-            TaxonMap tm = TaxonMap( trace.objectAt(0) );
+            TaxonMap tm = TaxonMap( trace.getCompactTrace().getTipTaxa() );
             best_tree->setTaxonIndices( tm );
 
             delete tmp_tree;
@@ -2044,10 +2067,15 @@ Tree* TreeSummary::mrTree(AnnotationReport report, double cutoff, bool verbose)
     RBOUT(ss.str());
 
     //fill in clades, use all above 50% to resolve the bush with the consensus partitions
-    summarize( verbose );        //fills std::vector<Sample<std::string> > cladeSamples, sorts them by descending freq
+    summarize( verbose );        //fills std::vector<Sample<size_t> > cladeSamples, sorts them by ascending freq
 
     //set up variables for consensus tree assembly
-    std::vector<std::string> tipNames = trace.objectAt(0).getTipNames();
+    const std::vector<Taxon> &tipTaxa = trace.getCompactTrace().getTipTaxa();
+    std::vector<std::string> tipNames;
+    for (size_t i = 0; i < tipTaxa.size(); i++)
+    {
+        tipNames.push_back( tipTaxa[i].getName() );
+    }
 
     //first create a bush
     TopologyNode* root = new TopologyNode(tipNames.size()); //construct root node with index = nb Tips
@@ -2075,7 +2103,7 @@ Tree* TreeSummary::mrTree(AnnotationReport report, double cutoff, bool verbose)
         float cladeFreq = cladeSamples[rIndex].getFrequency() / (float)(trace.size() - burnin);
         if (cladeFreq < cutoff)  break;
 
-        Clade clade = cladeSamples[rIndex].getValue();
+        Clade clade = trace.getCompactTrace().getClade( cladeSamples[rIndex].getValue() );
 
         //make sure we have an internal node
         if (clade.size() == 1 || clade.size() == tipNames.size())  continue;
@@ -2204,9 +2232,11 @@ void TreeSummary::printCladeSummary(std::ostream &o, double minCladeProbability,
     
     double totalSamples = trace.size();
     
-    for (std::vector<Sample<Clade> >::reverse_iterator it = cladeSamples.rbegin(); it != cladeSamples.rend(); ++it)
+    const CompactTreeTrace &compact = trace.getCompactTrace();
+
+    for (std::vector<Sample<size_t> >::reverse_iterator it = cladeSamples.rbegin(); it != cladeSamples.rend(); ++it)
     {
-        size_t num_taxa = it->getValue().size();
+        size_t num_taxa = compact.getSplitSize( it->getValue() );
 
         if( num_taxa == 1 ) continue;
 
@@ -2245,7 +2275,7 @@ void TreeSummary::printCladeSummary(std::ostream &o, double minCladeProbability,
         StringUtilities::fillWithSpaces(s, 16, true);
         o << s;*/
         
-        o << it->getValue();
+        o << compact.getClade( it->getValue() );
         o << std::endl;
         
     }
@@ -2291,7 +2321,7 @@ void TreeSummary::printTreeSummary(std::ostream &o, double credibleIntervalSize,
     o << "----------------------------------------------------------------" << std::endl;
     double totalSamples = trace.size();
     double totalProb = 0.0;
-    for (std::vector<Sample<std::string> >::reverse_iterator it = treeSamples.rbegin(); it != treeSamples.rend(); ++it)
+    for (std::vector<Sample<size_t> >::reverse_iterator it = treeSamples.rbegin(); it != treeSamples.rend(); ++it)
     {
         double freq =it->getFrequency();
         double p =it->getFrequency()/(totalSamples-burnin);
@@ -2321,7 +2351,7 @@ void TreeSummary::printTreeSummary(std::ostream &o, double credibleIntervalSize,
         StringUtilities::fillWithSpaces(s, 16, true);
         o << s;*/
         
-        o << it->getValue();
+        o << trace.getCompactTrace().getNewickTopology( it->getValue() );
         o << std::endl;
         
         if ( totalProb >= credibleIntervalSize )
@@ -2370,18 +2400,16 @@ int TreeSummary::size( bool post ) const
 }
 
 
+/*
+ * Count the clades, topologies and sampled ancestors after the burnin.
+ * The trees are taken from the compact trace, where each split and topology has an index,
+ * so we simply count the topologies and sum up their frequencies over their clades.
+ * The clade ages are only collected for the clades of an annotated tree (see annotateTree).
+ */
 void TreeSummary::summarize( bool verbose )
 {
     if( summarized ) return;
 
-    cladeAges.clear();
-    conditionalCladeAges.clear();
-    sampledAncestorSamples.clear();
-    treeCladeAges.clear();
-    
-    std::map<Clade, Sample<Clade>, CladeComparator > cladeSampleMap( (CladeComparator(rooted)) );
-    std::map<std::string, Sample<std::string> >      treeSampleMap;
-
     ProgressBar progress = ProgressBar(trace.size(), burnin);
     if ( verbose )
     {
@@ -2389,9 +2417,15 @@ void TreeSummary::summarize( bool verbose )
         progress.start();
     }
     
-    std::string outgroup = trace.objectAt(0).getTipNames()[0];
+    const CompactTreeTrace &compact = trace.getCompactTrace();
+
+    treeFrequencies.assign( compact.getNumberOfTopologies(), 0 );
+    cladeFrequencies.assign( compact.getNumberOfSplits(), 0 );
+    sampledAncestorFrequencies.assign( compact.getNumberOfTaxa(), 0 );
 
-    for (size_t i = burnin; i < trace.size(); ++i)
+    bool using_sampled_ancestors = false;
+
+    for (size_t i = burnin; i < compact.getNumberOfSamples(); ++i)
     {
         
         if ( verbose )
@@ -2399,91 +2433,13 @@ void TreeSummary::summarize( bool verbose )
             progress.update(i);
         }
         
-        Tree tree = trace.objectAt(i);
-
-        if( rooted == false )
-        {
-            tree.reroot( outgroup, true );
-        }
-
-        std::string newick = TreeUtilities::uniqueNewickTopology( tree );
-
-        Sample<std::string> treeSample(newick, 0);
-        treeSample.setTrace(std::vector<double>(i - burnin, 0.0));
-        treeSampleMap.insert(std::pair<std::string, Sample<std::string> >(newick, treeSample));
-        treeCladeAges.insert(std::pair<std::string, std::map<Clade, std::vector<double>, CladeComparator > >( newick, std::map<Clade, std::vector<double>, CladeComparator >( (CladeComparator(rooted)) ) ) );
-
-        // add empty observations for all non-matching trees
-        for (std::map<std::string, Sample<std::string> >::iterator it = treeSampleMap.begin(); it != treeSampleMap.end(); ++it)
-        {
-            if (it->first == newick)
-            {
-                it->second.addObservation(true);
-            }
-            else
-            {
-                it->second.addObservation(false);
-            }
-
-        }
-        
-        // get the clades for this tree
-        std::map<Clade, std::set<Clade, CladeComparator>, CladeComparator> condClades;
-        fillConditionalClades(tree.getRoot(), condClades);
-        
-        // collect clade ages and increment the clade frequency counter
-        for (std::map<Clade, std::set<Clade, CladeComparator>, CladeComparator >::iterator it=condClades.begin(); it!=condClades.end(); ++it )
-        {
-            const Clade& c  = it->first;
-
-            // insert a new sample
-            Sample<Clade> cladeSample = Sample<Clade>(c, 0);
-            cladeSample.setTrace(std::vector<double>(i - burnin, 0.0));
-            // insert silently fails if clade has already been seen
-            cladeSampleMap.insert(std::pair<Clade, Sample<Clade> >(c, cladeSample));
-
-            // store the age for this clade
-            // or create a new entry for the age of the clade
-            cladeAges[c].push_back( c.getAge() );
-            treeCladeAges[newick][c].push_back( c.getAge() );
-
-            // this is an empty set if c is a tip node
-            const std::set<Clade, CladeComparator>& children = it->second;
-
-            // add conditional clade ages
-            for (std::set<Clade, CladeComparator>::const_iterator child=children.begin(); child!=children.end(); ++child )
-            {
-                // inserts new entries if doesn't already exist
-                conditionalCladeAges[c][*child].push_back( child->getAge() );
-            }
-        }
-
-        for (std::map<Clade, Sample<Clade>, CladeComparator >::iterator it=cladeSampleMap.begin(); it!=cladeSampleMap.end(); ++it )
-        {
-            if ( condClades.find( it->first ) != condClades.end() )
-            {
-                it->second.addObservation( true );
-            }
-            else
-            {
-                it->second.addObservation( false );
-            }
-
-        }
+        ++treeFrequencies[ compact.getTopology(i) ];
 
         // collect sampled ancestor probs
-        for (size_t j = 0; j < tree.getNumberOfTips(); j++)
+        for (size_t j = compact.getSampledAncestorsBegin(i); j < compact.getSampledAncestorsEnd(i); ++j)
         {
-            const TopologyNode& tip = tree.getTipNode(j);
-
-            Taxon taxon = tip.getTaxon();
-
-            Sample<Taxon> taxonSample(taxon, 0);
-            taxonSample.setTrace(std::vector<double>(i - burnin, 0.0));
-
-            sampledAncestorSamples.insert( std::pair<Taxon, Sample<Taxon> >(taxon, taxonSample) );
-
-            sampledAncestorSamples[taxon].addObservation( tip.isSampledAncestor() );
+            ++sampledAncestorFrequencies[ compact.getSampledAncestor(j) ];
+            using_sampled_ancestors = true;
         }
     }
     
@@ -2494,145 +2450,43 @@ void TreeSummary::summarize( bool verbose )
         RBOUT("Collecting samples ...\n");
     }
 
-    // collect the samples
-    cladeSamples.clear();
-    for (std::map<Clade, Sample<Clade>, CladeComparator >::iterator it = cladeSampleMap.begin(); it != cladeSampleMap.end(); ++it)
-    {
-        it->second.computeStatistics();
-        cladeSamples.push_back(it->second);
-    }
-    
-    // sort the samples by frequency
-    VectorUtilities::sort( cladeSamples );
-    
-
     // collect the samples
     treeSamples.clear();
-    for (std::map<std::string, Sample<std::string> >::iterator it = treeSampleMap.begin(); it != treeSampleMap.end(); ++it)
-    {
-        it->second.computeStatistics();
-        treeSamples.push_back(it->second);
-    }
-
-    // sort the samples by frequency
-    VectorUtilities::sort( treeSamples );
-
-
-    // collect the samples
-    bool using_sampled_ancestors = false;
-
-    for (std::map<Taxon, Sample<Taxon> >::iterator it = sampledAncestorSamples.begin(); it != sampledAncestorSamples.end(); ++it)
-    {
-        it->second.computeStatistics();
-
-        using_sampled_ancestors = using_sampled_ancestors || it->second.getFrequency() > 0;
-    }
-
-    if( using_sampled_ancestors == false ) sampledAncestorSamples.clear();
-
-    summarized = true;
-}
-
-/*
- * Sort rooted clades as normal, or by mrcas
- * Sort unrooted clades (splits) by min(bitset,~bitset)
- */
-bool CladeComparator::operator()(const Clade& a, const Clade& b) const
-{
-    const RbBitSet& ab = a.getBitRepresentation();
-    const RbBitSet& bb = b.getBitRepresentation();
-
-    // If clades are rooted or clades are from different sized trees,
-    // do taxon-wise comparison, taking mrcas into account.
-    if( rooted || ab.size() != bb.size() )
+    for (size_t t = 0; t < treeFrequencies.size(); ++t)
     {
-        if( ab.size() != bb.size() || a.getMrca() == b.getMrca() )
+        if ( treeFrequencies[t] > 0 )
         {
-            return a < b;
-        }
-        else
-        {
-            return a.getMrca() < b.getMrca();
-        }
-    }
+            treeSamples.push_back( Sample<size_t>(t, (unsigned int)treeFrequencies[t]) );
 
-    if( ab.empty() || bb.empty() )
-    {
-        throw(RbException("Cannot compare unrooted clades (splits) with empty bitsets"));
+            // each clade occurs once in each tree of this topology
+            const boost::uint32_t *splits = compact.getTopologySplits(t);
+            for (size_t j = 0; j < compact.getTopologySize(t); ++j)
+            {
+                cladeFrequencies[ splits[j] ] += treeFrequencies[t];
+            }
+        }
     }
 
-    // do bitwise comparison
-
-    // if the first bit is 1, negate the bitset
-    bool neg_ab = ab[0];
-    bool neg_bb = bb[0];
+    // sort the samples by frequency
+    std::stable_sort( treeSamples.begin(), treeSamples.end() );
+    
 
-    for(size_t i = 0; i < ab.size(); i++)
+    // collect the samples
+    cladeSamples.clear();
+    for (size_t s = 0; s < cladeFrequencies.size(); ++s)
     {
-        bool vab = ab[i];
-        bool vbb = bb[i];
-
-        // get bit from min bitset for each clade
-        bool mab = neg_ab ? !vab : vab;
-        bool mbb = neg_bb ? !vbb : vbb;
-
-        // return result from first mismatch
-        if(mab != mbb)
+        if ( cladeFrequencies[s] > 0 )
         {
-            return mab < mbb;
+            cladeSamples.push_back( Sample<size_t>(s, (unsigned int)cladeFrequencies[s]) );
         }
     }
+    
+    // sort the samples by frequency
+    std::stable_sort( cladeSamples.begin(), cladeSamples.end() );
 
-    // ignore mrca in unrooted comparison
-    return false;
-}
-
-/*
- * Rooted clades are equal iff their taxa and mrcas are equal
- * Unrooted splits are equal iff their taxa are equal or the intersection of their bitsets is empty
- */
-bool CladeComparator::operator()(const Sample<Clade>& s) const
-{
-    const Clade& a = s.getValue();
-
-    const RbBitSet& ab = a.getBitRepresentation();
-    const RbBitSet& bb = clade.getBitRepresentation();
-
-    // If clades are rooted or clades are from different sized trees,
-    // do taxon-wise comparison, taking mrcas into account.
-    if( rooted || ab.size() != bb.size() )
-    {
-        return a == clade && a.getMrca() == clade.getMrca();
-    }
-
-    if( ab.empty() || bb.empty() )
-    {
-        throw(RbException("Cannot compare unrooted clades (splits) with empty bitsets"));
-    }
-
-    // do bitwise comparison
-
-    // if the first bit is 1, negate the bitset
-    bool neg_ab = ab[0];
-    bool neg_bb = bb[0];
-
-    for(size_t i = 0; i < ab.size(); i++)
-    {
-        bool vab = ab[i];
-        bool vbb = bb[i];
-
-        // get bit from min bitset for each clade
-        bool mab = neg_ab ? !vab : vab;
-        bool mbb = neg_bb ? !vbb : vbb;
 
-        // return result from first mismatch
-        if(mab != mbb)
-        {
-            return false;
-        }
-    }
+    if( using_sampled_ancestors == false ) sampledAncestorFrequencies.clear();
 
-    // ignore mrca in unrooted comparison
-    return true;
+    summarized = true;
 }
 
@@ -3,6 +3,7 @@
 
 #include "AncestralStateTrace.h"
 #include "Clade.h"
+#include "CompactTreeTrace.h"
 #include "ConditionalClade.h"
 #include "NewickConverter.h"
 #include "RlUserInterface.h"
@@ -17,21 +18,6 @@
 
 namespace RevBayesCore {
 
-    /*
-     * This functor is used as a comparator to identify equivalence classes
-     * of unrooted splits, and rooted clades with or without sampled mrcas
-     */
-    struct CladeComparator
-    {
-        CladeComparator(bool r = true, const Clade& c = Clade() ) : clade(c), rooted(r) {};
-
-        bool operator()(const Clade& a, const Clade& b) const;
-        bool operator()(const Sample<Clade>& s) const;
-
-        Clade clade;
-        bool rooted;
-    };
-    
     struct AnnotationReport
     {
         
@@ -86,8 +72,7 @@ namespace RevBayesCore {
     private:
 
         void                                                                    enforceNonnegativeBranchLengths(TopologyNode& tree) const;
-        Clade                                                                   fillConditionalClades(const TopologyNode &n, std::map<Clade, std::set<Clade, CladeComparator>, CladeComparator> &cc);
-        const Sample<Clade>&                                                    findCladeSample(const Clade &n) const;
+        size_t                                                                  findCladeFrequency(size_t s, const TopologyNode &n) const;
         TopologyNode*                                                           findParentNode(TopologyNode&, const Clade &, std::vector<TopologyNode*>&, RbBitSet& ) const;
         std::string                                                             getSiteState( const std::string &site_sample, size_t site );
         void                                                                    mapContinuous(Tree &inputTree, const std::string &n, size_t paramIndex, double hpd = 0.95, bool np=true ) const;
@@ -102,13 +87,12 @@ namespace RevBayesCore {
         TraceTree                                                               trace;
         bool                                                                    use_tree_trace;
 
-        std::vector<Sample<Clade> >                                             cladeSamples;
-        std::map<Taxon, Sample<Taxon> >                                         sampledAncestorSamples;
-        std::vector<Sample<std::string> >                                       treeSamples;
-
-        std::map<Clade, std::vector<double>, CladeComparator >                                    cladeAges;
-        std::map<Clade, std::map<Clade, std::vector<double>, CladeComparator >, CladeComparator > conditionalCladeAges;
-        std::map<std::string, std::map<Clade, std::vector<double>, CladeComparator > >            treeCladeAges;
+        // the summaries refer to the splits and topologies of the compact trace
+        std::vector<Sample<size_t> >                                            cladeSamples;                       //!< The sampled splits sorted by frequency
+        std::vector<size_t>                                                     cladeFrequencies;                   //!< The frequency of each split
+        std::vector<size_t>                                                     sampledAncestorFrequencies;         //!< The sampled ancestor frequency of each taxon (empty without sampled ancestors)
+        std::vector<Sample<size_t> >                                            treeSamples;                        //!< The sampled topologies sorted by frequency
+        std::vector<size_t>                                                     treeFrequencies;                    //!< The frequency of each topology
     };
     
 
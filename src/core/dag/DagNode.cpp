@@ -932,3 +932,15 @@ void DagNode::touchAffected(bool touchAll)
     }
     
 }
+
+
+/**
+ * Make sure that the value of this node is up to date.
+ * Deterministic nodes compute their value lazily when it is requested, which is not thread safe.
+ * Hence, we need to call this function for the parents of nodes that are evaluated concurrently.
+ * Here we provide only a dummy implementation because a generic DAG node has no value.
+ */
+void DagNode::updateValue( void ) const
+{
+    // dummy implementation
+}
@@ -91,6 +91,7 @@ namespace RevBayesCore {
         virtual void                                                swapParent(const DagNode *oldP, const DagNode *newP);                                       //!< Exchange the parent node which includes setting myself as a child of the new parent and removing myself from my old parents children list
         void                                                        touch(bool touchAll=false);
         virtual void                                                touchAffected(bool touchAll=false);                                                         //!< Touch affected nodes (flag for recalculation)
+        virtual void                                                updateValue(void) const;                                                                    //!< Make sure that the (lazily computed) value is up to date
 
     protected:
                                                                     DagNode(const std::string &n);                                                              //!< Constructor
@@ -10,6 +10,7 @@
 #include "TraceTree.h"
 #include "TraceVectorNumeric.h"
 
+#include <limits>
 #include <ostream>
 #include <string>
 
@@ -32,6 +33,7 @@ namespace RevBayesCore {
         virtual bool                                        isSimpleNumeric(void) const;                                                                                //!< Is this variable a simple numeric variable? Currently only integer and real number are.
         virtual void                                        printName(std::ostream &o, const std::string &sep, int l=-1, bool left=true, bool fv=true) const;           //!< Monitor/Print this variable
         virtual void                                        printValue(std::ostream &o, const std::string &sep, int l=-1, bool left=true, bool user=true, bool simple=true) const;  //!< Monitor/Print this variable
+        virtual void                                        updateValue(void) const;                                                                                    //!< Make sure that the (lazily computed) value is up to date
         virtual void                                        writeToFile(const std::string &dir) const;                                              //!< Write the value of this node to a file within the given directory.
 
         // getters and setters
@@ -84,6 +86,11 @@ namespace RevBayesCore {
     {
         
         std::stringstream ss;
+        if ( user == false && simple == false )
+        {
+            // complex storing is meant for reading the value back in, so we need all digits
+            ss.precision( std::numeric_limits<double>::digits10 + 2 );
+        }
         ss << getValue();
         std::string s = ss.str();
         if ( l > 0 )
@@ -295,6 +302,19 @@ void RevBayesCore::TypedDagNode<valueType>::printValue(std::ostream &o, const st
 }
 
 
+/**
+ * Make sure that the value is up to date.
+ * Requesting the value triggers the update of lazily computed values, e.g., of deterministic nodes.
+ */
+template<class valueType>
+void RevBayesCore::TypedDagNode<valueType>::updateValue( void ) const
+{
+    
+    this->getValue();
+    
+}
+
+
 template<class valueType>
 void RevBayesCore::TypedDagNode<valueType>::writeToFile(const std::string &dir) const
 {
@@ -0,0 +1,194 @@
+#include "HashedBitSet.h"
+#include "RbException.h"
+
+using namespace RevBayesCore;
+
+
+HashedBitSet::HashedBitSet(void) :
+    num_bits( 0 ),
+    hash( 0 ),
+    hash_is_dirty( true )
+{
+
+}
+
+
+HashedBitSet::HashedBitSet(size_t n) :
+    words( (n + 63) / 64, 0 ),
+    num_bits( n ),
+    hash( 0 ),
+    hash_is_dirty( true )
+{
+
+}
+
+
+HashedBitSet::HashedBitSet(size_t n, const boost::uint64_t *w) :
+    words( w, w + (n + 63) / 64 ),
+    num_bits( n ),
+    hash( 0 ),
+    hash_is_dirty( true )
+{
+
+}
+
+
+/** Equals comparison, which compares the hashes first */
+bool HashedBitSet::operator==(const HashedBitSet& x) const
+{
+
+    return num_bits == x.num_bits && getHash() == x.getHash() && words == x.words;
+}
+
+
+/** Not-Equals comparison */
+bool HashedBitSet::operator!=(const HashedBitSet& x) const
+{
+
+    return operator==(x) == false;
+}
+
+
+/** Bitwise or */
+HashedBitSet& HashedBitSet::operator|=(const HashedBitSet& x)
+{
+    if ( x.num_bits != num_bits )
+    {
+        throw(RbException("Cannot or HashedBitSets of unequal sizes"));
+    }
+
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        words[i] |= x.words[i];
+    }
+    hash_is_dirty = true;
+
+    return *this;
+}
+
+
+/** Copy the words of another bit set of the same size */
+void HashedBitSet::assign(const boost::uint64_t *w)
+{
+
+    words.assign( w, w + words.size() );
+    hash_is_dirty = true;
+}
+
+
+void HashedBitSet::clear(void)
+{
+
+    words.assign( words.size(), 0 );
+    hash_is_dirty = true;
+}
+
+
+/**
+ * Hash the words with the finalizer of SplitMix64, which mixes every bit of a word into the whole hash.
+ */
+boost::uint64_t HashedBitSet::computeHash(const boost::uint64_t *w, size_t n)
+{
+
+    boost::uint64_t h = 0x9E3779B97F4A7C15ULL * (n + 1);
+    for (size_t i = 0; i < n; ++i)
+    {
+        boost::uint64_t z = h ^ w[i];
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        h = z ^ (z >> 31);
+    }
+
+    return h;
+}
+
+
+size_t HashedBitSet::countBits(boost::uint64_t x)
+{
+
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+
+    return size_t( (x * 0x0101010101010101ULL) >> 56 );
+}
+
+
+/** Flip all bits, keeping the bits beyond the size unset */
+void HashedBitSet::flip(void)
+{
+
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        words[i] = ~words[i];
+    }
+
+    if ( num_bits % 64 != 0 )
+    {
+        words.back() &= ( boost::uint64_t(1) << (num_bits % 64) ) - 1;
+    }
+    hash_is_dirty = true;
+}
+
+
+boost::uint64_t HashedBitSet::getHash(void) const
+{
+
+    if ( hash_is_dirty == true )
+    {
+        hash = computeHash( getWords(), words.size() );
+        hash_is_dirty = false;
+    }
+
+    return hash;
+}
+
+
+size_t HashedBitSet::getNumberSetBits(void) const
+{
+
+    size_t n = 0;
+    for (size_t i = 0; i < words.size(); ++i)
+    {
+        n += countBits( words[i] );
+    }
+
+    return n;
+}
+
+
+void HashedBitSet::resize(size_t n)
+{
+
+    num_bits = n;
+    words.assign( (n + 63) / 64, 0 );
+    hash_is_dirty = true;
+}
+
+
+void HashedBitSet::set(size_t i)
+{
+
+    words[i / 64] |= boost::uint64_t(1) << (i % 64);
+    hash_is_dirty = true;
+}
+
+
+void HashedBitSet::unset(size_t i)
+{
+
+    words[i / 64] &= ~( boost::uint64_t(1) << (i % 64) );
+    hash_is_dirty = true;
+}
+
+
+std::ostream& RevBayesCore::operator<<(std::ostream& o, const HashedBitSet& x)
+{
+
+    for (size_t i = 0; i < x.size(); ++i)
+    {
+        o << ( x.isSet(i) ? "1" : "0" );
+    }
+
+    return o;
+}
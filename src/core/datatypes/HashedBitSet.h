@@ -0,0 +1,63 @@
+#ifndef HashedBitSet_H
+#define HashedBitSet_H
+
+#include <boost/cstdint.hpp>
+#include <ostream>
+#include <vector>
+
+namespace RevBayesCore {
+
+    /**
+     * Word-packed bit set with a cached 64-bit hash.
+     *
+     * In contrast to the RbBitSet, the bits are packed into 64-bit words, so that unions and comparisons
+     * work on whole words. The hash is computed once when it is first needed after a modification,
+     * which makes the bit set a cheap key for hash tables (see HashedBitSetTable).
+     * Bits beyond the size of the set are always zero.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2016-10-16, version 1.0
+     */
+    class HashedBitSet {
+
+    public:
+        HashedBitSet(void);                                                                                     //!< Empty bit set
+        HashedBitSet(size_t n);                                                                                 //!< Bit set of size n with all bits unset
+        HashedBitSet(size_t n, const boost::uint64_t *w);                                                       //!< Bit set of size n with the given words
+
+        bool                            operator==(const HashedBitSet &bs) const;
+        bool                            operator!=(const HashedBitSet &bs) const;
+        HashedBitSet&                   operator|=(const HashedBitSet &bs);
+
+        void                            assign(const boost::uint64_t *w);                                       //!< Copy the words from w
+        void                            clear(void);                                                            //!< Unset all bits
+        void                            flip(void);                                                             //!< Flip all bits
+        boost::uint64_t                 getHash(void) const;                                                    //!< Get the hash of the bits
+        size_t                          getNumberOfWords(void) const                { return words.size(); }
+        size_t                          getNumberSetBits(void) const;                                           //!< Get the number of bits set
+        const boost::uint64_t*          getWords(void) const                        { return words.empty() ? NULL : &words[0]; }
+        bool                            isSet(size_t i) const                       { return ( words[i / 64] >> (i % 64) ) & 1; }
+        void                            resize(size_t n);                                                       //!< Resize and unset all bits
+        void                            set(size_t i);
+        size_t                          size(void) const                            { return num_bits; }
+        void                            unset(size_t i);
+
+        static boost::uint64_t          computeHash(const boost::uint64_t *w, size_t n);                        //!< Hash n words
+        static size_t                   countBits(boost::uint64_t w);                                           //!< The number of bits set in a word
+
+    private:
+
+        std::vector<boost::uint64_t>    words;
+        size_t                          num_bits;
+        mutable boost::uint64_t         hash;
+        mutable bool                    hash_is_dirty;
+
+    };
+
+    // Global functions using the class
+    std::ostream&                       operator<<(std::ostream& o, const HashedBitSet& x);                     //!< Overloaded output operator
+
+}
+
+#endif
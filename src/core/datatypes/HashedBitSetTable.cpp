@@ -0,0 +1,109 @@
+#include "HashedBitSetTable.h"
+#include "RbException.h"
+
+#include <algorithm>
+
+using namespace RevBayesCore;
+
+
+const size_t HashedBitSetTable::NOT_FOUND = size_t(-1);
+
+
+HashedBitSetTable::HashedBitSetTable(size_t n)
+{
+
+    clear( n );
+}
+
+
+void HashedBitSetTable::clear(size_t n)
+{
+
+    num_bits  = n;
+    num_words = (n + 63) / 64;
+    keys.clear();
+    hashes.clear();
+    slots.assign( 16, 0 );
+}
+
+
+size_t HashedBitSetTable::find(const HashedBitSet &b) const
+{
+
+    boost::uint32_t s = slots[ findSlot( b ) ];
+
+    return s == 0 ? NOT_FOUND : s - 1;
+}
+
+
+size_t HashedBitSetTable::findSlot(const HashedBitSet &b) const
+{
+
+    if ( b.size() != num_bits )
+    {
+        throw RbException("Cannot look up a bit set of different size in the bit set table.");
+    }
+
+    boost::uint64_t h = b.getHash();
+    size_t mask = slots.size() - 1;
+
+    for (size_t slot = size_t(h) & mask; ; slot = (slot + 1) & mask)
+    {
+        boost::uint32_t s = slots[slot];
+        if ( s == 0 )
+        {
+            return slot;
+        }
+
+        size_t i = s - 1;
+        if ( hashes[i] == h && std::equal( keys.begin() + i * num_words, keys.begin() + (i + 1) * num_words, b.getWords() ) )
+        {
+            return slot;
+        }
+    }
+
+}
+
+
+std::pair<size_t, bool> HashedBitSetTable::insert(const HashedBitSet &b)
+{
+
+    size_t slot = findSlot( b );
+    if ( slots[slot] != 0 )
+    {
+        return std::make_pair( size_t( slots[slot] - 1 ), false );
+    }
+
+    size_t i = hashes.size();
+    keys.insert( keys.end(), b.getWords(), b.getWords() + num_words );
+    hashes.push_back( b.getHash() );
+    slots[slot] = boost::uint32_t( i + 1 );
+
+    // keep the table at most half full
+    if ( 2 * hashes.size() > slots.size() )
+    {
+        rehash( 2 * slots.size() );
+    }
+
+    return std::make_pair( i, true );
+}
+
+
+/** Rebuild the slots with the stored hashes, so that no bit set is hashed again */
+void HashedBitSetTable::rehash(size_t num_slots)
+{
+
+    slots.assign( num_slots, 0 );
+    size_t mask = num_slots - 1;
+
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        size_t slot = size_t( hashes[i] ) & mask;
+        while ( slots[slot] != 0 )
+        {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = boost::uint32_t( i + 1 );
+    }
+
+}
@@ -0,0 +1,52 @@
+#ifndef HashedBitSetTable_H
+#define HashedBitSetTable_H
+
+#include "HashedBitSet.h"
+
+#include <boost/cstdint.hpp>
+#include <utility>
+#include <vector>
+
+namespace RevBayesCore {
+
+    /**
+     * Flat open-addressing hash table of bit sets of equal size.
+     *
+     * The table assigns consecutive indices to the inserted bit sets and stores their words and hashes in flat arrays.
+     * Lookups use linear probing on a power-of-two array of slots, which is kept at most half full,
+     * and only compare the words of a bit set if the stored hash matches.
+     * Hence, neither lookups nor insertions allocate memory per bit set (except for growing the arrays).
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2016-10-16, version 1.0
+     */
+    class HashedBitSetTable {
+
+    public:
+        static const size_t                     NOT_FOUND;                                                                  //!< Index returned if a bit set is not contained in the table
+
+        HashedBitSetTable(size_t n = 0);                                                                                    //!< Empty table for bit sets of size n
+
+        void                                    clear(size_t n);                                                            //!< Remove all bit sets and set the size of the bit sets to n
+        size_t                                  find(const HashedBitSet &b) const;                                          //!< Get the index of a bit set or NOT_FOUND
+        std::pair<size_t, bool>                 insert(const HashedBitSet &b);                                              //!< Get the index of a bit set, which is inserted if new
+        const boost::uint64_t*                  getWords(size_t i) const                    { return &keys[i * num_words]; }
+        size_t                                  size(void) const                            { return hashes.size(); }
+
+    private:
+
+        size_t                                  findSlot(const HashedBitSet &b) const;                                      //!< The slot of a bit set or the empty slot where it belongs
+        void                                    rehash(size_t num_slots);
+
+        size_t                                  num_bits;
+        size_t                                  num_words;
+        std::vector<boost::uint64_t>            keys;                                                                       //!< The words of all bit sets
+        std::vector<boost::uint64_t>            hashes;                                                                     //!< The hash of each bit set
+        std::vector<boost::uint32_t>            slots;                                                                      //!< The index plus one of the bit set in each slot (0 if empty)
+
+    };
+
+}
+
+#endif
@@ -15,6 +15,7 @@
 #ifndef Printer_H
 #define Printer_H
 
+#include <limits>
 #include <string>
 
 #include "StringUtilities.h"
@@ -56,7 +57,9 @@ namespace RevBayesCore {
         
         static void                     printForComplexStoring( const objType &a, std::ostream &o, const std::string &sep, int l, bool left )
         {
+            // complex storing is meant for reading the value back in (e.g., checkpoints), so we need all digits
             std::stringstream ss;
+            ss.precision( std::numeric_limits<double>::digits10 + 2 );
             ss << a;
             std::string s = ss.str();
             if ( l > 0 )
@@ -8,6 +8,7 @@
 #include "Printer.h"
 #include "RbConstIterator.h"
 #include "RbContainer.h"
+#include "RbException.h"
 #include "RbIterator.h"
 #include "Serializable.h"
 #include "Serializer.h"
@@ -46,11 +47,50 @@ namespace RevBayesCore {
         virtual void                                        initFromString( const std::string &s )
         {
             this->clear();
-            std::string sub = s.substr( 2, s.size()-4);
+            
+            // strip the enclosing brackets, e.g., "[ 1, 2 ]" or "[ 1, 2]"
+            size_t first = s.find('[');
+            size_t last  = s.rfind(']');
+            if ( first == std::string::npos || last == std::string::npos || last < first )
+            {
+                throw RbException("Could not resurrect vector from string value:\n" + s);
+            }
+            
+            // split only at the top level so that nested vectors (or newick strings) stay intact
             std::vector<std::string> elements;
-            StringUtilities::stringSplit(sub,", ", elements);
+            std::string element = "";
+            int depth = 0;
+            for (size_t i=first+1; i<last; ++i)
+            {
+                char c = s[i];
+                if ( c == '[' || c == '(' )
+                {
+                    ++depth;
+                }
+                else if ( c == ']' || c == ')' )
+                {
+                    --depth;
+                }
+                
+                if ( c == ',' && depth == 0 )
+                {
+                    elements.push_back( element );
+                    element = "";
+                }
+                else if ( c != ' ' || element != "" )
+                {
+                    element += c;
+                }
+            }
+            if ( element != "" || elements.size() > 0 )
+            {
+                elements.push_back( element );
+            }
+            
             for (size_t i=0; i<elements.size(); ++i)
             {
+                // remove trailing white spaces
+                elements[i].erase( elements[i].find_last_not_of(' ') + 1 );
                 valueType value;
                 RevBayesCore::Serializer<valueType, IsDerivedFrom<valueType, Serializable>::Is >::ressurectFromString( &value, elements[i] );
                 this->push_back( value );
@@ -6,6 +6,7 @@
 //  Copyright 2012 __MyCompanyName__. All rights reserved.
 //
 
+#include "CholeskyDecomposition.h"
 #include "EigenSystem.h"
 #include "MatrixReal.h"
 #include "RbException.h"
@@ -23,7 +24,9 @@ MatrixReal::MatrixReal( void ) : elements( RbVector<RbVector<double> >() ),
     nRows( 0 ),
     nCols( 0 ),
     eigensystem( NULL ),
-    eigenNeedsUpdate( true )
+    eigenNeedsUpdate( true ),
+    cholesky( NULL ),
+    choleskyNeedsUpdate( true )
 {
 
 }
@@ -33,7 +36,9 @@ MatrixReal::MatrixReal( size_t n ) : elements( RbVector<RbVector<double> >(n, Rb
     nRows( n ),
     nCols( n ),
     eigensystem( NULL ),
-    eigenNeedsUpdate( true )
+    eigenNeedsUpdate( true ),
+    cholesky( NULL ),
+    choleskyNeedsUpdate( true )
 {
     
 }
@@ -43,7 +48,9 @@ MatrixReal::MatrixReal( size_t n, size_t k) : elements( RbVector<RbVector<double
     nRows( n ),
     nCols( k ),
     eigensystem( NULL ),
-    eigenNeedsUpdate( true )
+    eigenNeedsUpdate( true ),
+    cholesky( NULL ),
+    choleskyNeedsUpdate( true )
 {
     
 }
@@ -54,7 +61,9 @@ MatrixReal::MatrixReal( size_t n, size_t k, double v) :
     nRows( n ),
     nCols( k ),
     eigensystem( NULL ),
-    eigenNeedsUpdate( true )
+    eigenNeedsUpdate( true ),
+    cholesky( NULL ),
+    choleskyNeedsUpdate( true )
 {
 
 }
@@ -64,7 +73,9 @@ MatrixReal::MatrixReal( const MatrixReal &m ) :
     nRows( m.nRows ),
     nCols( m.nCols ),
     eigensystem( NULL ),
-    eigenNeedsUpdate( true )
+    eigenNeedsUpdate( true ),
+    cholesky( NULL ),
+    choleskyNeedsUpdate( true )
 {
     
 }
@@ -73,6 +84,7 @@ MatrixReal::MatrixReal( const MatrixReal &m ) :
 MatrixReal::~MatrixReal( void )
 {
     delete eigensystem;
+    delete cholesky;
 }
 
 
@@ -86,6 +98,7 @@ MatrixReal& MatrixReal::operator=(const MatrixReal &m)
         elements = m.elements;
         
         eigenNeedsUpdate = true;
+        choleskyNeedsUpdate = true;
     }
     
     return *this;
@@ -96,6 +109,7 @@ RbVector<double>& MatrixReal::operator[]( size_t index )
 {
     // to be safe
     eigenNeedsUpdate = true;
+    choleskyNeedsUpdate = true;
     
     return elements[index];
 }
@@ -148,14 +162,35 @@ void MatrixReal::clear( void )
 {
     // to be safe
     eigenNeedsUpdate = true;
+    choleskyNeedsUpdate = true;
     
     elements.clear();
 }
 
 
+/**
+ * Compute the inverse of the matrix.
+ * Covariance and precision matrices are symmetric positive definite, which we invert with the Cholesky decomposition.
+ * All other matrices are inverted with the eigen decomposition.
+ */
 MatrixReal MatrixReal::computeInverse( void ) const
 {
- 
+    
+    if ( isSymmetric() == true )
+    {
+        // update the Cholesky decomposition if necessary
+        updateCholesky();
+        
+        if ( cholesky->isPositiveDefinite() == true )
+        {
+            MatrixReal inverse;
+            cholesky->computeInverse( inverse );
+            
+            return inverse;
+        }
+        
+    }
+    
     // update the eigensystem if necessary
     update();
     
@@ -219,6 +254,21 @@ RbVector<double> MatrixReal::getColumn( size_t columnIndex ) const
 }
 
 
+const CholeskyDecomposition& MatrixReal::getCholeskyDecomposition( void ) const
+{
+    
+    if ( isSymmetric() == false )
+    {
+        throw RbException("The Cholesky decomposition is only defined for symmetric matrices.");
+    }
+    
+    // update the Cholesky decomposition if necessary
+    updateCholesky();
+    
+    return *cholesky;
+}
+
+
 size_t MatrixReal::getDim( void ) const
 {
     // we assume that this is a square matrix
@@ -255,14 +305,7 @@ double MatrixReal::getDet() const {
         }
     else
         {
-        // update the eigensystem if necessary
-        update();
-        const std::vector<double>& eigenval = eigensystem->getRealEigenvalues();
-
-        for (size_t i=0; i<nRows; i++)
-            {
-            logDet += log(eigenval[i]);
-            }
+        logDet = getLogDet();
         }
     
     if (logDet < -300.0)
@@ -286,6 +329,19 @@ double MatrixReal::getLogDet() const
     }
     else
     {
+        
+        if ( isSymmetric() == true )
+        {
+            // update the Cholesky decomposition if necessary
+            updateCholesky();
+            
+            if ( cholesky->isPositiveDefinite() == true )
+            {
+                return cholesky->getLogDeterminant();
+            }
+            
+        }
+        
         // update the eigensystem if necessary
         update();
 
@@ -460,6 +516,14 @@ bool MatrixReal::isDiagonal(void) const
 
 bool MatrixReal::isPositive( void )  const
 {
+    
+    // a symmetric matrix is positive definite if and only if it has a Cholesky decomposition
+    if ( isSymmetric() == true )
+    {
+        updateCholesky();
+        
+        return cholesky->isPositiveDefinite();
+    }
 
     update();
 
@@ -481,6 +545,28 @@ bool MatrixReal::isSquareMatrix( void ) const
 }
 
 
+bool MatrixReal::isSymmetric( void ) const
+{
+    if ( !isSquareMatrix() )
+    {
+        return false;
+    }
+    
+    for (size_t i = 0; i < nRows; ++i)
+    {
+        for (size_t j = i + 1; j < nCols; ++j)
+        {
+            if ( elements[i][j] != elements[j][i] )
+            {
+                return false;
+            }
+        }
+    }
+    
+    return true;
+}
+
+
 void MatrixReal::resize(size_t r, size_t c)
 {
     
@@ -490,6 +576,7 @@ void MatrixReal::resize(size_t r, size_t c)
     nCols = c;
     
     eigenNeedsUpdate = true;
+    choleskyNeedsUpdate = true;
 }
 
 
@@ -528,6 +615,24 @@ void MatrixReal::update( void ) const
 }
 
 
+void MatrixReal::updateCholesky( void ) const
+{
+    
+    if ( cholesky == NULL )
+    {
+        cholesky = new CholeskyDecomposition();
+    }
+    
+    if ( choleskyNeedsUpdate == true )
+    {
+        cholesky->decompose( *this );
+        
+        choleskyNeedsUpdate = false;
+    }
+    
+}
+
+
 
 #include "RbMathMatrix.h"
 #include "RbException.h"
@@ -854,6 +959,9 @@ MatrixReal& MatrixReal::operator+=(double b)
         }
     }
     
+    eigenNeedsUpdate = true;
+    choleskyNeedsUpdate = true;
+    
 	return *this;
 }
 
@@ -878,6 +986,9 @@ MatrixReal& MatrixReal::operator-=(double b)
         }
     }
     
+    eigenNeedsUpdate = true;
+    choleskyNeedsUpdate = true;
+    
 	return *this;
 }
 
@@ -902,6 +1013,9 @@ MatrixReal& MatrixReal::operator*=(double b)
         }
     }
     
+    eigenNeedsUpdate = true;
+    choleskyNeedsUpdate = true;
+    
 	return *this;
 }
 
@@ -1013,6 +1127,9 @@ MatrixReal&  MatrixReal::operator+=(const MatrixReal& B)
 				elements[i][j] += B[i][j];
             }
         }
+        
+        eigenNeedsUpdate = true;
+        choleskyNeedsUpdate = true;
     }
     else
     {
@@ -1045,6 +1162,9 @@ MatrixReal& MatrixReal::operator-=(const MatrixReal& B)
 				elements[i][j] -= B[i][j];
             }
         }
+        
+        eigenNeedsUpdate = true;
+        choleskyNeedsUpdate = true;
     }
     else
     {
@@ -1072,21 +1192,29 @@ MatrixReal& MatrixReal::operator*=(const MatrixReal& B)
     size_t bCols = B.getNumberOfColumns();
 	if ( nCols == bRows ) 
     {
+        // we loop in the order i-k-j, so that the innermost loop runs over contiguous rows of B and C
 		MatrixReal C(nRows, bCols, 0.0 );
-		for (size_t i=0; i<nRows; i++) 
+		for (size_t i=0; i<nRows && nCols > 0 && bCols > 0; i++) 
         {
-			for (size_t j=0; j<bCols; j++) 
+            const double *a = &elements[i][0];
+            double *c = &C.elements[i][0];
+			for (size_t k=0; k<nCols; k++) 
             {
-				double sum = 0.0;
-				for (size_t k=0; k<nCols; k++)
-					sum += elements[i][k] * B[k][j];
-				C[i][j] = sum;
+                const double a_ik = a[k];
+                const double *b = &B.elements[k][0];
+				for (size_t j=0; j<bCols; j++)
+                {
+					c[j] += a_ik * b[j];
+                }
             }
         }
         
         nCols = C.nCols;
         nRows = C.nRows;
         elements = C.elements;
+        
+        eigenNeedsUpdate = true;
+        choleskyNeedsUpdate = true;
     }
     else
     {
@@ -28,6 +28,7 @@
 
 namespace RevBayesCore {
     
+    class CholeskyDecomposition;
     class EigenSystem;
     
     class MatrixReal : public Cloneable, public MemberObject<RbVector<double> > {
@@ -79,6 +80,7 @@ namespace RevBayesCore {
         MatrixReal                              computeInverse(void) const;
         void                                    executeMethod(const std::string &n, const std::vector<const DagNode*> &args, RbVector<double> &rv) const;       //!< Map the member methods to internal function calls
         RbVector<double>                        getColumn(size_t i) const;                                                                                      //!< Get the i-th column
+        const CholeskyDecomposition&            getCholeskyDecomposition(void) const;                                                                           //!< Get the Cholesky decomposition (only for symmetric matrices)
         size_t                                  getDim() const;
         EigenSystem&                            getEigenSystem(void);
         const EigenSystem&                      getEigenSystem(void) const ;
@@ -98,6 +100,7 @@ namespace RevBayesCore {
     protected:
         // helper methods
         void                                    update(void) const;
+        void                                    updateCholesky(void) const;
         
         // members
         RbVector<RbVector<double> >             elements;
@@ -105,6 +108,8 @@ namespace RevBayesCore {
         size_t                                  nCols;
         mutable EigenSystem*                    eigensystem;
         mutable bool                            eigenNeedsUpdate;
+        mutable CholeskyDecomposition*          cholesky;                                                                                                       //!< The Cholesky decomposition, which we use for symmetric positive definite matrices
+        mutable bool                            choleskyNeedsUpdate;
         
     };
     
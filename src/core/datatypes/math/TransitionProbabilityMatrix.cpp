@@ -67,11 +67,16 @@ TransitionProbabilityMatrix& TransitionProbabilityMatrix::operator=( const Trans
     
     if ( this != &tpm ) 
     {
+        // we only need new memory if the dimensions differ
+        if ( nElements != tpm.nElements )
+        {
+            delete [] theMatrix;
+            theMatrix = new double[ tpm.nElements ];
+        }
+        
         nElements = tpm.nElements;
         num_states = tpm.num_states;
         
-        delete [] theMatrix;
-        theMatrix = new double[ nElements ];
         for ( size_t i = 0; i < nElements; ++i) 
         {
             theMatrix[i] = tpm.theMatrix[i];
@@ -29,6 +29,21 @@ TaxonMap::TaxonMap( const Tree &t ) :
 }
 
 
+/**
+ * Constructor from a vector of taxa.
+ */
+TaxonMap::TaxonMap( const std::vector<Taxon> &t ) :
+    taxa()
+{
+    
+    for (size_t i=0; i<t.size(); ++i)
+    {
+        addTaxon( t[i] );
+    }
+    
+}
+
+
 /**
  * Get the i-th taxon.
  *
@@ -28,6 +28,7 @@ namespace RevBayesCore {
         
         TaxonMap(void);                                //!< Default constructor
         TaxonMap(const Tree &t);                                                            //!< Constructor from tree object
+        TaxonMap(const std::vector<Taxon> &t);                                              //!< Constructor from taxa
         virtual                             ~TaxonMap() {}
         
 //        bool                                operator==(const TaxonMap &t) const;           //!< Equals operators
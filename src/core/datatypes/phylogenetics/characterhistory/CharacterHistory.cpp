@@ -4,6 +4,8 @@
 #include "RbException.h"
 #include "Tree.h"
 
+#include <cmath>
+
 using namespace RevBayesCore;
 
 
@@ -53,6 +53,24 @@ void RateGenerator::calculateTransitionProbabilities(double t, TransitionProbabi
     calculateTransitionProbabilities(t, 0.0, 1.0, P);
 }
 
+
+/**
+ * Calculate the transition probabilities for a batch of (start age, end age, rate) triplets, e.g. for all branches and rate categories of a tree.
+ * P is resized to the size of the batch. By default we compute every matrix on its own;
+ * derived classes may overwrite this method to share work between the matrices.
+ */
+void RateGenerator::calculateTransitionProbabilities(const std::vector<double> &startAges, const std::vector<double> &endAges, const std::vector<double> &rates, std::vector<TransitionProbabilityMatrix>& P) const
+{
+    
+    P.resize( rates.size(), TransitionProbabilityMatrix(num_states) );
+    
+    for (size_t i = 0; i < rates.size(); ++i)
+    {
+        calculateTransitionProbabilities(startAges[i], endAges[i], rates[i], P[i]);
+    }
+    
+}
+
 size_t RateGenerator::getNumberOfStates( void ) const
 {
     return num_states;
@@ -31,6 +31,7 @@ namespace RevBayesCore {
         virtual void                        initFromString( const std::string &s ) { throw RbException("Sebastians (29/6/2016): Missing derived implementations!!!"); }                                                 //!< Serialize (resurrect) the object from a string value
 
         // virtual methods that may need to overwritten
+        virtual void                        calculateTransitionProbabilities(const std::vector<double> &startAges, const std::vector<double> &endAges, const std::vector<double> &rates, std::vector<TransitionProbabilityMatrix>& P) const;   //!< Calculate a batch of transition matrices
         virtual void                        update(void) {};
         
         // public methods
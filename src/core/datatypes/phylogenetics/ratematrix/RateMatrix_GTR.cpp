@@ -7,6 +7,7 @@
 #include "TransitionProbabilityMatrix.h"
 #include "RbMathLogic.h"
 
+#include <algorithm>
 #include <cmath>
 #include <string>
 #include <iomanip>
@@ -138,6 +139,33 @@ void RateMatrix_GTR::calculateTransitionProbabilities(double startAge, double en
 }
 
 
+/**
+ * Calculate the transition probabilities for a batch of (start age, end age, rate) triplets.
+ * All matrices share the same eigen system, so we compute them together (see tiProbsEigens).
+ */
+void RateMatrix_GTR::calculateTransitionProbabilities(const std::vector<double> &startAges, const std::vector<double> &endAges, const std::vector<double> &rates, std::vector<TransitionProbabilityMatrix>& P) const
+{
+    
+    std::vector<double> t( rates.size() );
+    for (size_t b = 0; b < rates.size(); ++b)
+    {
+        t[b] = rates[b] * (startAges[b] - endAges[b]);
+    }
+    
+    P.resize( rates.size(), TransitionProbabilityMatrix(num_states) );
+    
+    if ( theEigenSystem->isComplex() == false )
+    {
+        tiProbsEigens(t, P);
+    }
+    else
+    {
+        tiProbsComplexEigens(t, P);
+    }
+    
+}
+
+
 RateMatrix_GTR* RateMatrix_GTR::clone( void ) const
 {
     return new RateMatrix_GTR( *this );
@@ -180,6 +208,66 @@ void RateMatrix_GTR::tiProbsEigens(double t, TransitionProbabilityMatrix& P) con
 }
 
 
+/**
+ * Calculate a batch of transition probabilities for the real case.
+ * This is the matrix product P[ij][b] = sum_s c_ijk[ij][s] * exp(lambda_s * t_b) of the precomputed
+ * eigenvector products (num_states^2 x num_states) with the eigenvalue exponentials (num_states x batch).
+ * We compute it in blocks of matrices so that the exponentials of a block stay in the cache and
+ * the innermost loop runs over the matrices of the block, which the compiler can vectorize.
+ * The sums are accumulated in the same order as in the single matrix version, so the results are identical.
+ */
+void RateMatrix_GTR::tiProbsEigens(const std::vector<double> &t, std::vector<TransitionProbabilityMatrix>& P) const
+{
+    
+    // get a reference to the eigenvalues
+    const std::vector<double>& eigenValue = theEigenSystem->getRealEigenvalues();
+    
+    const size_t num_matrices   = t.size();
+    const size_t num_elements   = num_states * num_states;
+    const size_t block_size     = 32;
+    
+    std::vector<double> eigValExp(num_states * block_size);
+    std::vector<double> sum(block_size);
+    
+    for (size_t first = 0; first < num_matrices; first += block_size)
+    {
+        const size_t n = std::min(block_size, num_matrices - first);
+        
+        // precalculate the products of the eigenvalues and the branch lengths, eigenvalue-major
+        for (size_t s=0; s<num_states; s++)
+        {
+            double* e = &eigValExp[s*n];
+            for (size_t b=0; b<n; b++)
+            {
+                e[b] = exp(eigenValue[s] * t[first+b]);
+            }
+        }
+        
+        // calculate the transition probabilities of this block
+        const double* ptr = &c_ijk[0];
+        for (size_t ij=0; ij<num_elements; ij++, ptr += num_states)
+        {
+            std::fill(sum.begin(), sum.begin() + n, 0.0);
+            for (size_t s=0; s<num_states; s++)
+            {
+                const double  c = ptr[s];
+                const double* e = &eigValExp[s*n];
+                for (size_t b=0; b<n; b++)
+                {
+                    sum[b] += c * e[b];
+                }
+            }
+            
+            for (size_t b=0; b<n; b++)
+            {
+                P[first+b].theMatrix[ij] = (sum[b] < 0.0) ? 0.0 : sum[b];
+            }
+        }
+    }
+    
+}
+
+
 void RateMatrix_GTR::initFromString(const std::string &s)
 {
 
@@ -259,6 +347,64 @@ void RateMatrix_GTR::tiProbsComplexEigens(double t, TransitionProbabilityMatrix&
 }
 
 
+/**
+ * Calculate a batch of transition probabilities for the complex case.
+ * See the real case for the blocking scheme.
+ */
+void RateMatrix_GTR::tiProbsComplexEigens(const std::vector<double> &t, std::vector<TransitionProbabilityMatrix>& P) const
+{
+    
+    // get a reference to the eigenvalues
+    const std::vector<double>& eigenValueReal = theEigenSystem->getRealEigenvalues();
+    const std::vector<double>& eigenValueComp = theEigenSystem->getImagEigenvalues();
+    
+    const size_t num_matrices   = t.size();
+    const size_t num_elements   = num_states * num_states;
+    const size_t block_size     = 32;
+    
+    std::vector<std::complex<double> > ceigValExp(num_states * block_size);
+    std::vector<std::complex<double> > sum(block_size);
+    
+    for (size_t first = 0; first < num_matrices; first += block_size)
+    {
+        const size_t n = std::min(block_size, num_matrices - first);
+        
+        // precalculate the products of the eigenvalues and the branch lengths, eigenvalue-major
+        for (size_t s=0; s<num_states; s++)
+        {
+            std::complex<double> ev = std::complex<double>(eigenValueReal[s], eigenValueComp[s]);
+            std::complex<double>* e = &ceigValExp[s*n];
+            for (size_t b=0; b<n; b++)
+            {
+                e[b] = exp(ev * t[first+b]);
+            }
+        }
+        
+        // calculate the transition probabilities of this block
+        const std::complex<double>* ptr = &cc_ijk[0];
+        for (size_t ij=0; ij<num_elements; ij++, ptr += num_states)
+        {
+            std::fill(sum.begin(), sum.begin() + n, std::complex<double>(0.0, 0.0));
+            for (size_t s=0; s<num_states; s++)
+            {
+                const std::complex<double>  c = ptr[s];
+                const std::complex<double>* e = &ceigValExp[s*n];
+                for (size_t b=0; b<n; b++)
+                {
+                    sum[b] += c * e[b];
+                }
+            }
+            
+            for (size_t b=0; b<n; b++)
+            {
+                P[first+b].theMatrix[ij] = (sum[b].real() < 0.0) ? 0.0 : sum[b].real();
+            }
+        }
+    }
+    
+}
+
+
 /** Update the eigen system */
 void RateMatrix_GTR::updateEigenSystem(void)
 {
@@ -45,6 +45,7 @@ namespace RevBayesCore {
         // RateMatrix functions
         virtual RateMatrix_GTR&             assign(const Assignable &m);                                                                                            //!< Assign operation that can be called on a base class instance.
         void                                calculateTransitionProbabilities(double startAge, double endAge, double rate, TransitionProbabilityMatrix& P) const;    //!< Calculate the transition matrix
+        void                                calculateTransitionProbabilities(const std::vector<double> &startAges, const std::vector<double> &endAges, const std::vector<double> &rates, std::vector<TransitionProbabilityMatrix>& P) const;   //!< Calculate a batch of transition matrices
         RateMatrix_GTR*                     clone(void) const;
         void                                update(void);
         virtual void                        initFromString( const std::string &s );                                             //!< Serialize (resurrect) the object from a string value
@@ -53,6 +54,8 @@ namespace RevBayesCore {
         void                                calculateCijk(void);                                                                //!< Do precalculations on eigenvectors and their inverse
         void                                tiProbsEigens(double t, TransitionProbabilityMatrix& P) const;                      //!< Calculate transition probabilities for real case
         void                                tiProbsComplexEigens(double t, TransitionProbabilityMatrix& P) const;               //!< Calculate transition probabilities for complex case
+        void                                tiProbsEigens(const std::vector<double> &t, std::vector<TransitionProbabilityMatrix>& P) const;         //!< Calculate a batch of transition probabilities for real case
+        void                                tiProbsComplexEigens(const std::vector<double> &t, std::vector<TransitionProbabilityMatrix>& P) const;  //!< Calculate a batch of transition probabilities for complex case
         void                                updateEigenSystem(void);                                                            //!< Update the system of eigenvalues and eigenvectors
         
         EigenSystem*                        theEigenSystem;                                                                     //!< Holds the eigen system
@@ -848,6 +848,36 @@ void Tree::makeInternalNodesBifurcating(bool reindex)
 
 // method to order nodes by their existing index
 // used when reading in tree with existing node indexes we need to keep
+/**
+ * Order the nodes vector so that the i-th node is the node with index indices[i].
+ * This restores the exact layout of a tree whose nodes are not ordered by their index.
+ */
+void Tree::orderNodes( const std::vector<size_t> &indices )
+{
+    
+    orderNodesByIndex();
+    
+    if ( indices.size() != nodes.size() )
+    {
+        throw RbException("Problem while working with tree: Wrong number of node indices.");
+    }
+    
+    std::vector<TopologyNode*> nodes_copy = std::vector<TopologyNode*>(nodes.size(), NULL);
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        if ( indices[i] >= nodes.size() || nodes[indices[i]] == NULL )
+        {
+            throw RbException("Problem while working with tree: Node had bad index.");
+        }
+        nodes_copy[i] = nodes[indices[i]];
+        nodes[indices[i]] = NULL;
+    }
+    
+    nodes = nodes_copy;
+    
+}
+
+
 void Tree::orderNodesByIndex( void )
 {
 
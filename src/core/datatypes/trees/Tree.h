@@ -100,6 +100,7 @@ namespace RevBayesCore {
         bool                                                isRooted(void) const;                                                                               //!< Is the Tree rooted
         bool                                                isUltrametric(void) const;                                                                          //!< Is this tree ultrametric?
         void                                                makeInternalNodesBifurcating(bool reindex);                                                                 //!< Make all the internal nodes bifurcating.
+        void                                                orderNodes(const std::vector<size_t> &indices);                                                     //!< Order the nodes so that the i-th node has the i-th of the given indices
         void                                                orderNodesByIndex();
         void                                                reroot(const std::string &outgroup, bool reset);                                                                //!< Re-root the tree with the given outgroup
         void                                                reroot(TopologyNode &n, bool reset);
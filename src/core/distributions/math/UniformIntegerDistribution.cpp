@@ -3,6 +3,8 @@
 #include "RandomNumberGenerator.h"
 #include "RbConstants.h"
 
+#include <cmath>
+
 using namespace RevBayesCore;
 
 UniformIntegerDistribution::UniformIntegerDistribution(const TypedDagNode<int> *mi, const TypedDagNode<int> *ma) : TypedDistribution<int>( new int( 0 ) ),
@@ -51,6 +51,10 @@ void AbstractPhyloBrownianProcess::simulateRecursively( const TopologyNode &node
         // get the branch specific rate
         double branch_sigma = sqrt( computeBranchTime( child.getIndex(), branch_length ) );
         
+        // draw the standard normal deviates of all sites at once
+        std::vector<double> z = std::vector<double>( num_sites, 0.0 );
+        RbStatistics::Normal::rv( 0.0, 1.0, *rng, z );
+        
         ContinuousTaxonData &taxon = taxa[ child.getIndex() ];
         for ( size_t i = 0; i < num_sites; ++i )
         {
@@ -61,7 +65,7 @@ void AbstractPhyloBrownianProcess::simulateRecursively( const TopologyNode &node
             double standDev = branch_sigma * computeSiteRate( i );
             
             // create the character
-            double c = RbStatistics::Normal::rv( parent_state, standDev, *rng);
+            double c = parent_state + standDev * z[i];
             
             // add the character to the sequence
             taxon.addCharacter( c );
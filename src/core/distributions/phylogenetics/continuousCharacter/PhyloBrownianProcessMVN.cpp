@@ -1,8 +1,8 @@
 #include "ConstantNode.h"
 #include "PhyloBrownianProcessMVN.h"
-#include "DistributionMultivariateNormal.h"
 #include "RandomNumberFactory.h"
 #include "RandomNumberGenerator.h"
+#include "RbConstants.h"
 #include "RbException.h"
 #include "StochasticNode.h"
 #include "TopologyNode.h"
@@ -16,9 +16,14 @@ PhyloBrownianProcessMVN::PhyloBrownianProcessMVN(const TypedDagNode<Tree> *t, si
     AbstractPhyloBrownianProcess( t, ns ),
     numTips( t->getValue().getNumberOfTips() ),
     obs( std::vector<std::vector<double> >(this->num_sites, std::vector<double>(numTips, 0.0) ) ),
-    phylogeneticCovarianceMatrix( new MatrixReal(numTips, numTips) ),
-    storedPhylogeneticCovarianceMatrix( new MatrixReal(numTips, numTips) ),
-    inversePhylogeneticCovarianceMatrix( numTips, numTips ),
+    covarianceFactor(),
+    storedCovarianceFactor(),
+    branchVariances(),
+    storedBranchVariances(),
+    parentIndices(),
+    storedParentIndices(),
+    numFactorUpdates( 0 ),
+    storedNumFactorUpdates( 0 ),
     changedCovariance(false),
     needsCovarianceRecomputation( true ),
     needsScaleRecomputation( true )
@@ -57,19 +62,10 @@ PhyloBrownianProcessMVN* PhyloBrownianProcessMVN::clone( void ) const
 double PhyloBrownianProcessMVN::computeLnProbability( void )
 {
     
-    // compute the ln probability by recursively calling the probability calculation for each node
-    const TopologyNode &root = this->tau->getValue().getRoot();
-    
-    // we start with the root and then traverse down the tree
-    size_t rootIndex = root.getIndex();
-    
     if ( needsCovarianceRecomputation == true )
     {
-        // perhaps there is a more efficient way to reset the matrix to 0.
-        phylogeneticCovarianceMatrix = new MatrixReal(numTips, numTips);
-        recursiveComputeCovarianceMatrix(*phylogeneticCovarianceMatrix, root, rootIndex);
+        updateCovarianceFactor();
         needsCovarianceRecomputation = false;
-        inversePhylogeneticCovarianceMatrix = phylogeneticCovarianceMatrix->computeInverse();
     }
     
     // sum the partials up
@@ -79,6 +75,21 @@ double PhyloBrownianProcessMVN::computeLnProbability( void )
 }
 
 
+/**
+ * The variance of a branch in the factored covariance matrix, i.e., the branch time without the homogeneous clock rate.
+ */
+double PhyloBrownianProcessMVN::computeBranchVariance(size_t node_index, double brlen) const
+{
+    
+    if ( this->heterogeneous_clock_rates != NULL )
+    {
+        return this->heterogeneous_clock_rates->getValue()[node_index] * brlen;
+    }
+    
+    return brlen;
+}
+
+
 double PhyloBrownianProcessMVN::computeRootState(size_t siteIdx)
 {
     
@@ -99,6 +110,27 @@ double PhyloBrownianProcessMVN::computeRootState(size_t siteIdx)
 
 
 
+/**
+ * Set the entries of all tips below the node to 1.
+ */
+void PhyloBrownianProcessMVN::flagTipsBelow(const TopologyNode &node, std::vector<double> &x) const
+{
+    
+    if ( node.isTip() )
+    {
+        x[node.getIndex()] = 1.0;
+    }
+    else
+    {
+        for (size_t i = 0; i < node.getNumberOfChildren(); ++i)
+        {
+            flagTipsBelow( node.getChild(i), x );
+        }
+    }
+    
+}
+
+
 void PhyloBrownianProcessMVN::keepSpecialization( DagNode* affecter )
 {
     
@@ -174,8 +206,8 @@ std::set<size_t> PhyloBrownianProcessMVN::recursiveComputeCovarianceMatrix(Matri
     
     if ( node.isRoot() == false )
     {
-        // get my scaled branch length
-        double v = this->computeBranchTime(node_index, node.getBranchLength() );
+        // get the variance of my branch
+        double v = branchVariances[node_index];
         
         if ( node.isTip() )
         {
@@ -227,16 +259,18 @@ std::set<size_t> PhyloBrownianProcessMVN::recursiveComputeCovarianceMatrix(Matri
 void PhyloBrownianProcessMVN::restoreSpecialization( DagNode* affecter )
 {
     
-    // reset the flags
+    // restore the factor of the covariance matrix
     if ( changedCovariance == true )
     {
         changedCovariance = false;
-        needsCovarianceRecomputation = false;
         
-        MatrixReal *tmp = phylogeneticCovarianceMatrix;
-        phylogeneticCovarianceMatrix = storedPhylogeneticCovarianceMatrix;
-        storedPhylogeneticCovarianceMatrix = tmp;
+        covarianceFactor        = storedCovarianceFactor;
+        branchVariances         = storedBranchVariances;
+        parentIndices           = storedParentIndices;
+        numFactorUpdates        = storedNumFactorUpdates;
         
+        // the restored factor belongs to the restored branch lengths, so we only need to check that nothing else changed
+        needsCovarianceRecomputation = true;
     }
     
 }
@@ -308,15 +342,31 @@ std::vector<double> PhyloBrownianProcessMVN::simulateRootCharacters(size_t n)
 double PhyloBrownianProcessMVN::sumRootLikelihood( void )
 {
     
+    if ( covarianceFactor.isPositiveDefinite() == false )
+    {
+        return RbConstants::Double::neginf;
+    }
+    
+    // the homogeneous clock rate only scales the covariance matrix
+    double clockRate = ( this->heterogeneous_clock_rates == NULL ? this->homogeneous_clock_rate->getValue() : 1.0 );
+    double logNormalize = -0.5 * log( RbConstants::TwoPI );
+    double logDet = covarianceFactor.getLogDeterminant();
+    
     // sum the log-likelihoods for all sites together
     double sumPartialProbs = 0.0;
+    std::vector<double> diff = std::vector<double>(numTips, 0.0);
     for (size_t site = 0; site < this->num_sites; ++site)
     {
-        std::vector<double> m = std::vector<double>(numTips, computeRootState(site) );
+        double rootState = computeRootState(site);
+        for (size_t i = 0; i < numTips; ++i)
+        {
+            diff[i] = obs[site][i] - rootState;
+        }
         
         double sigma = this->computeSiteRate(site);
-        //        sumPartialProbs += RbStatistics::MultivariateNormal::lnPdfCovariance(m, *phylogeneticCovarianceMatrix, obs[site], sigma*sigma);
-        sumPartialProbs += RbStatistics::MultivariateNormal::lnPdfPrecision(m, inversePhylogeneticCovarianceMatrix, obs[site], sigma*sigma);
+        double scale = clockRate * sigma * sigma;
+        double s2 = covarianceFactor.computeQuadraticForm( diff );
+        sumPartialProbs += numTips * logNormalize - 0.5 * (logDet + numTips * log(scale) + s2 / scale);
     }
     
     return sumPartialProbs;
@@ -339,32 +389,18 @@ void PhyloBrownianProcessMVN::touchSpecialization( DagNode* affecter, bool touch
     }
     else if ( affecter == this->homogeneous_clock_rate )
     {
-        needsCovarianceRecomputation = true;
-        if ( changedCovariance == false )
-        {
-            MatrixReal *tmp = phylogeneticCovarianceMatrix;
-            phylogeneticCovarianceMatrix = storedPhylogeneticCovarianceMatrix;
-            storedPhylogeneticCovarianceMatrix = tmp;
-        }
-        changedCovariance = true;
-        
-    }
-    else if ( affecter == this->heterogeneous_clock_rates )
-    {
-        needsCovarianceRecomputation = true;
-        if ( changedCovariance == false )
-        {
-            storedPhylogeneticCovarianceMatrix = phylogeneticCovarianceMatrix;
-        }
-        changedCovariance = true;
+        // the clock rate only scales the covariance matrix, so the factor does not change
         
     }
-    else if ( affecter == this->tau )
+    else if ( affecter == this->heterogeneous_clock_rates || affecter == this->tau )
     {
         needsCovarianceRecomputation = true;
         if ( changedCovariance == false )
         {
-            storedPhylogeneticCovarianceMatrix = phylogeneticCovarianceMatrix;
+            storedCovarianceFactor  = covarianceFactor;
+            storedBranchVariances   = branchVariances;
+            storedParentIndices     = parentIndices;
+            storedNumFactorUpdates  = numFactorUpdates;
         }
         changedCovariance = true;
         
@@ -397,3 +433,78 @@ void PhyloBrownianProcessMVN::swapParameterInternal(const DagNode *oldP, const D
 }
 
 
+
+
+/**
+ * Bring the factor of the covariance matrix up to date with the tree and the branch rates.
+ * A change of the variance of a branch is a rank-one change of the covariance matrix for the tips below the branch,
+ * which we apply to the factor. If the topology changed, or so many branches changed that the updates would be more expensive,
+ * then we compute the covariance matrix and factor it again. We also factor the matrix again after numTips updates
+ * so that the rounding errors of the updates do not accumulate.
+ */
+void PhyloBrownianProcessMVN::updateCovarianceFactor( void )
+{
+    
+    const std::vector<TopologyNode*> &nodes = this->tau->getValue().getNodes();
+    size_t numNodes = nodes.size();
+    
+    // get the current variance and parent of each branch
+    std::vector<double> variances = std::vector<double>(numNodes, 0.0);
+    std::vector<size_t> parents = std::vector<size_t>(numNodes, numNodes);
+    for (size_t i = 0; i < numNodes; ++i)
+    {
+        const TopologyNode &node = *nodes[i];
+        if ( node.isRoot() == false )
+        {
+            size_t index = node.getIndex();
+            variances[index] = computeBranchVariance( index, node.getBranchLength() );
+            parents[index] = node.getParent().getIndex();
+        }
+    }
+    
+    bool refactor = ( covarianceFactor.isPositiveDefinite() == false || covarianceFactor.getDim() != numTips || parents != parentIndices || numFactorUpdates >= numTips );
+    
+    if ( refactor == false )
+    {
+        std::vector<size_t> changedNodes;
+        for (size_t i = 0; i < numNodes; ++i)
+        {
+            if ( variances[i] != branchVariances[i] )
+            {
+                changedNodes.push_back( i );
+            }
+        }
+        
+        // an update costs O(n^2) and factoring the matrix O(n^3/3)
+        refactor = ( 4 * changedNodes.size() > numTips );
+        
+        std::vector<double> tips = std::vector<double>(numTips, 0.0);
+        for (size_t i = 0; i < changedNodes.size() && refactor == false; ++i)
+        {
+            size_t index = changedNodes[i];
+            
+            tips.assign( numTips, 0.0 );
+            flagTipsBelow( *nodes[index], tips );
+            
+            // a downdate can fail because of rounding errors, in which case we just factor the matrix again
+            refactor = ( covarianceFactor.update( tips, variances[index] - branchVariances[index] ) == false );
+            ++numFactorUpdates;
+        }
+        
+    }
+    
+    branchVariances = variances;
+    parentIndices   = parents;
+    
+    if ( refactor == true )
+    {
+        const TopologyNode &root = this->tau->getValue().getRoot();
+        
+        MatrixReal covariance = MatrixReal(numTips, numTips);
+        recursiveComputeCovarianceMatrix( covariance, root, root.getIndex() );
+        covarianceFactor.decompose( covariance );
+        
+        numFactorUpdates = 0;
+    }
+    
+}
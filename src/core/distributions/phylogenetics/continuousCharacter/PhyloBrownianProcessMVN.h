@@ -2,6 +2,7 @@
 #define PhyloBrownianProcessMVN_H
 
 #include "AbstractPhyloBrownianProcess.h"
+#include "CholeskyDecomposition.h"
 #include "MatrixReal.h"
 
 #include <vector>
@@ -11,7 +12,12 @@ namespace RevBayesCore {
     /**
      * @brief Homogeneous distribution of character state evolution along a tree class (PhyloCTMC).
      *
-     *
+     * The characters at the tips follow a multivariate normal distribution with the phylogenetic covariance matrix.
+     * We keep the Cholesky factor of the covariance matrix (without the homogeneous clock rate, which only scales the matrix),
+     * so that the log-determinant and the quadratic forms come directly from the factor.
+     * The branch of a node adds its variance to all pairs of tips below the node, i.e., a change of a branch length or a branch rate
+     * is a rank-one change of the covariance matrix, which we apply to the factor in O(n^2).
+     * We only factor the matrix again if the topology changed or many branches changed at once.
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna)
@@ -47,17 +53,25 @@ namespace RevBayesCore {
         virtual void                                                        swapParameterInternal(const DagNode *oldP, const DagNode *newP);                         //!< Swap a parameter
         
     private:
+        double                                                              computeBranchVariance(size_t node_index, double brlen) const;
         double                                                              computeRootState(size_t siteIdx);
+        void                                                                flagTipsBelow(const TopologyNode &node, std::vector<double> &x) const;
         std::set<size_t>                                                    recursiveComputeCovarianceMatrix( MatrixReal &m, const TopologyNode &node, size_t node_index );
+        void                                                                updateCovarianceFactor(void);
         
         const TypedDagNode< double >*                                       homogeneous_root_state;
         const TypedDagNode< RbVector< double > >*                           heterogeneous_root_state;
         
         size_t                                                              numTips;
         std::vector<std::vector<double> >                                   obs;
-        MatrixReal*                                                         phylogeneticCovarianceMatrix;
-        MatrixReal*                                                         storedPhylogeneticCovarianceMatrix;
-        MatrixReal                                                          inversePhylogeneticCovarianceMatrix;
+        CholeskyDecomposition                                               covarianceFactor;                                               //!< The Cholesky factor of the covariance matrix without the homogeneous clock rate
+        CholeskyDecomposition                                               storedCovarianceFactor;
+        std::vector<double>                                                 branchVariances;                                                //!< The variance of the branch of each node in the factored covariance matrix
+        std::vector<double>                                                 storedBranchVariances;
+        std::vector<size_t>                                                 parentIndices;                                                  //!< The parent of each node in the factored covariance matrix
+        std::vector<size_t>                                                 storedParentIndices;
+        size_t                                                              numFactorUpdates;                                               //!< The number of rank-one updates since we factored the covariance matrix
+        size_t                                                              storedNumFactorUpdates;
         bool                                                                changedCovariance;
         bool                                                                needsCovarianceRecomputation;
         bool                                                                needsScaleRecomputation;
@@ -2,9 +2,12 @@
 #include "PhyloBrownianProcessREML.h"
 #include "RandomNumberFactory.h"
 #include "RandomNumberGenerator.h"
+#include "RbConstants.h"
 #include "RbException.h"
+#include "RbSettings.h"
 #include "TopologyNode.h"
 
+#include <algorithm>
 #include <cmath>
 
 
@@ -12,9 +15,9 @@ using namespace RevBayesCore;
 
 PhyloBrownianProcessREML::PhyloBrownianProcessREML(const TypedDagNode<Tree> *t, size_t ns) :
     AbstractPhyloBrownianProcess( t, ns ),
-    partial_likelihoods( std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) ) ),
-    contrasts( std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) ) ),
-    contrast_uncertainty( std::vector<std::vector<double> >(2, std::vector<double>(this->num_nodes, 0) ) ),
+    partial_likelihoods( std::vector<double>(2*this->num_nodes*this->num_sites, 0) ),
+    contrasts( std::vector<double>(2*this->num_nodes*this->num_sites, 0) ),
+    contrast_uncertainty( std::vector<double>(2*this->num_nodes, 0) ),
     active_likelihood( std::vector<size_t>(this->num_nodes, 0) ),
     changed_nodes( std::vector<bool>(this->num_nodes, false) ),
     dirty_nodes( std::vector<bool>(this->num_nodes, true) )
@@ -59,6 +62,51 @@ PhyloBrownianProcessREML* PhyloBrownianProcessREML::clone( void ) const
 }
 
 
+/**
+ * Compute the contrasts and partial likelihoods of a node for the sites [site_begin,site_end).
+ * This is a single loop over contiguous arrays without any function calls, so that the compiler can vectorize it.
+ * We read the contrasts of both children before we write the contrast of the node,
+ * because for multifurcations the left child is the node itself.
+ */
+void PhyloBrownianProcessREML::computeContrasts( const ContrastOperation &op, const std::vector<double> &log_site_rates, const std::vector<double> &inverse_site_variances, size_t site_begin, size_t site_end )
+{
+    
+    double *p_node         = &this->partial_likelihoods[op.node_offset];
+    double *mu_node        = &this->contrasts[op.node_offset];
+    const double *p_left   = &this->partial_likelihoods[op.left_offset];
+    const double *p_right  = &this->partial_likelihoods[op.right_offset];
+    const double *mu_left  = &this->contrasts[op.left_offset];
+    const double *mu_right = &this->contrasts[op.right_offset];
+    const double *log_sr   = &log_site_rates[0];
+    const double *inv_sr2  = &inverse_site_variances[0];
+    
+    const double t = op.t_left + op.t_right;
+    const double inverse_t = 1.0 / t;
+    const double weight_left = op.t_right * inverse_t;
+    const double weight_right = op.t_left * inverse_t;
+    const double log_stdev = 0.5 * log(t);
+    
+    for (size_t i = site_begin; i < site_end; ++i)
+    {
+        double m_left  = mu_left[i];
+        double m_right = mu_right[i];
+        
+        // compute the contrasts for this site and node
+        double contrast = m_left - m_right;
+        
+        // the log-density of the contrast with standard deviation siteRate * sqrt(t)
+        double lnl_node = - RbConstants::LN_SQRT_2PI - log_sr[i] - log_stdev - 0.5 * contrast * contrast * inv_sr2[i] * inverse_t;
+        
+        mu_node[i] = m_left * weight_left + m_right * weight_right;
+        
+        // sum up the probabilities of the contrasts
+        p_node[i] = lnl_node + p_left[i] + p_right[i];
+        
+    } // end for-loop over all sites
+    
+}
+
+
 double PhyloBrownianProcessREML::computeLnProbability( void )
 {
     
@@ -80,9 +128,36 @@ double PhyloBrownianProcessREML::computeLnProbability( void )
     if ( this->dirty_nodes[rootIndex] )
     {
         
-        
+        // collect the contrasts of all dirty nodes in postorder
+        contrast_operations.clear();
         recursiveComputeLnProbability( root, rootIndex );
         
+        // the site specific rates are the same for all nodes
+        std::vector<double> log_site_rates = std::vector<double>(this->num_sites, 0.0);
+        std::vector<double> inverse_site_variances = std::vector<double>(this->num_sites, 0.0);
+        for (size_t i = 0; i < this->num_sites; ++i)
+        {
+            double site_rate = this->computeSiteRate(i);
+            log_site_rates[i] = log(site_rate);
+            inverse_site_variances[i] = 1.0 / (site_rate*site_rate);
+        }
+        
+        // the sites are independent, so we compute all operations for blocks of sites in parallel
+        const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+        const size_t block_size = 256;
+        const int num_blocks = int( (this->num_sites + block_size - 1) / block_size );
+        const size_t num_operations = contrast_operations.size();
+#       pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads > 1 && num_blocks > 1)
+        for (int b = 0; b < num_blocks; ++b)
+        {
+            size_t site_begin = b * block_size;
+            size_t site_end   = std::min( site_begin + block_size, this->num_sites );
+            for (size_t k = 0; k < num_operations; ++k)
+            {
+                computeContrasts( contrast_operations[k], log_site_rates, inverse_site_variances, site_begin, site_end );
+            }
+        }
+        
         // start by filling the likelihood vector for the children of the root
         if ( root.getNumberOfChildren() == 2 ) // rooted trees have two children for the root
         {
@@ -155,9 +230,7 @@ void PhyloBrownianProcessREML::recursiveComputeLnProbability( const TopologyNode
         // mark as computed
         dirty_nodes[node_index] = false;
 
-        std::vector<double> &p_node  = this->partial_likelihoods[this->active_likelihood[node_index]][node_index];
-        std::vector<double> &mu_node  = this->contrasts[this->active_likelihood[node_index]][node_index];
-
+        size_t node_buffer = this->active_likelihood[node_index]*this->num_nodes + node_index;
         
         // get the number of children
         size_t num_children = node.getNumberOfChildren();
@@ -178,16 +251,12 @@ void PhyloBrownianProcessREML::recursiveComputeLnProbability( const TopologyNode
             size_t right_index = right.getIndex();
             recursiveComputeLnProbability( right, right_index );
 
-            const std::vector<double> &p_left  = this->partial_likelihoods[this->active_likelihood[left_index]][left_index];
-            const std::vector<double> &p_right = this->partial_likelihoods[this->active_likelihood[right_index]][right_index];
-
-            // get the per node and site contrasts
-            const std::vector<double> &mu_left  = this->contrasts[this->active_likelihood[left_index]][left_index];
-            const std::vector<double> &mu_right = this->contrasts[this->active_likelihood[right_index]][right_index];
+            size_t left_buffer  = this->active_likelihood[left_index]*this->num_nodes + left_index;
+            size_t right_buffer = this->active_likelihood[right_index]*this->num_nodes + right_index;
 
             // get the propagated uncertainties
-            double delta_left  = this->contrast_uncertainty[this->active_likelihood[left_index]][left_index];
-            double delta_right = this->contrast_uncertainty[this->active_likelihood[right_index]][right_index];
+            double delta_left  = this->contrast_uncertainty[left_buffer];
+            double delta_right = this->contrast_uncertainty[right_buffer];
 
             // get the scaled branch lengths
             double v_left  = 0;
@@ -202,27 +271,16 @@ void PhyloBrownianProcessREML::recursiveComputeLnProbability( const TopologyNode
             double t_right = v_right + delta_right;
 
             // set delta_node = (t_l*t_r)/(t_l+t_r);
-            this->contrast_uncertainty[this->active_likelihood[node_index]][node_index] = (t_left*t_right) / (t_left+t_right);
-
-            double stdev = sqrt(t_left+t_right);
-            for (int i=0; i<this->num_sites; i++)
-            {
-
-                mu_node[i] = (mu_left[i]*t_right + mu_right[i]*t_left) / (t_left+t_right);
-
-                // get the site specific rate of evolution
-                double standDev = this->computeSiteRate(i) * stdev;
-
-                // compute the contrasts for this site and node
-                double contrast = mu_left[i] - mu_right[i];
-
-                // compute the probability for the contrasts at this node
-                double lnl_node = RbStatistics::Normal::lnPdf(0, standDev, contrast);
-
-                // sum up the probabilities of the contrasts
-                p_node[i] = lnl_node + p_left[i] + p_right[i];
+            this->contrast_uncertainty[node_buffer] = (t_left*t_right) / (t_left+t_right);
 
-            } // end for-loop over all sites
+            // the contrasts for all sites are computed later
+            ContrastOperation op;
+            op.node_offset  = node_buffer  * this->num_sites;
+            op.left_offset  = left_buffer  * this->num_sites;
+            op.right_offset = right_buffer * this->num_sites;
+            op.t_left       = t_left;
+            op.t_right      = t_right;
+            contrast_operations.push_back( op );
 
         } // end for-loop over all children
         
@@ -332,9 +390,9 @@ void PhyloBrownianProcessREML::resetValue( void )
 {
     
     // check if the vectors need to be resized
-    partial_likelihoods = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) );
-    contrasts = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes, std::vector<double>(this->num_sites, 0) ) );
-    contrast_uncertainty = std::vector<std::vector<double> >(2, std::vector<double>(this->num_nodes, 0) );
+    partial_likelihoods = std::vector<double>(2*this->num_nodes*this->num_sites, 0);
+    contrasts = std::vector<double>(2*this->num_nodes*this->num_sites, 0);
+    contrast_uncertainty = std::vector<double>(2*this->num_nodes, 0);
     
     // create a vector with the correct site indices
     // some of the sites may have been excluded
@@ -362,12 +420,13 @@ void PhyloBrownianProcessREML::resetValue( void )
         {
             if ( (*it)->isTip() )
             {
+                size_t index = (*it)->getIndex();
                 ContinuousTaxonData& taxon = this->value->getTaxonData( (*it)->getName() );
                 double &c = taxon.getCharacter(site_indices[site]);
-                contrasts[0][(*it)->getIndex()][site] = c;
-                contrasts[1][(*it)->getIndex()][site] = c;
-                contrast_uncertainty[0][(*it)->getIndex()] = 0;
-                contrast_uncertainty[1][(*it)->getIndex()] = 0;
+                contrasts[index*this->num_sites + site] = c;
+                contrasts[(this->num_nodes + index)*this->num_sites + site] = c;
+                contrast_uncertainty[index] = 0;
+                contrast_uncertainty[this->num_nodes + index] = 0;
             }
         }
     }
@@ -437,7 +496,7 @@ double PhyloBrownianProcessREML::sumRootLikelihood( void )
     size_t node_index = root.getIndex();
     
     // get the pointers to the partial likelihoods of the left and right subtree
-    std::vector<double> &p_node = this->partial_likelihoods[this->active_likelihood[node_index]][node_index];
+    const double *p_node = &this->partial_likelihoods[(this->active_likelihood[node_index]*this->num_nodes + node_index)*this->num_sites];
     
     // sum the log-likelihoods for all sites together
     double sum_partial_probs = 0.0;
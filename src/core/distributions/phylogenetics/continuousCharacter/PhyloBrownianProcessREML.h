@@ -9,7 +9,11 @@ namespace RevBayesCore {
     /**
      * @brief Homogeneous distribution of character state evolution along a tree class (PhyloCTMC).
      *
-     *
+     * The likelihood is computed from the independent contrasts (REML).
+     * The partial likelihoods and contrasts of a node are stored as one contiguous array over the sites,
+     * so that the computation of a node is a single loop over the sites, which the compiler can vectorize.
+     * We first collect the dirty nodes in postorder together with their branch times, and then compute
+     * the contrasts of all collected nodes for blocks of sites, which are independent and therefore computed in parallel.
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna)
@@ -45,10 +49,10 @@ namespace RevBayesCore {
         // Parameter management functions.
         virtual void                                                        swapParameterInternal(const DagNode *oldP, const DagNode *newP);                         //!< Swap a parameter
 
-        // the likelihoods
-        std::vector<std::vector<std::vector<double> > >                     partial_likelihoods;
-        std::vector<std::vector<std::vector<double> > >                     contrasts;
-        std::vector<std::vector<double> >                                   contrast_uncertainty;
+        // the likelihoods, with the sites of each buffer and node at [(buffer*num_nodes + node)*num_sites]
+        std::vector<double>                                                 partial_likelihoods;
+        std::vector<double>                                                 contrasts;
+        std::vector<double>                                                 contrast_uncertainty;                                           //!< The propagated uncertainty of each buffer and node at [buffer*num_nodes + node]
         std::vector<size_t>                                                 active_likelihood;
         
         // convenience variables available for derived classes too
@@ -56,7 +60,20 @@ namespace RevBayesCore {
         std::vector<bool>                                                   dirty_nodes;
 
     private:
-                
+        
+        // the computation of the contrasts of a node for a pair of children
+        struct ContrastOperation {
+            size_t                                                          node_offset;                                                    //!< The offset of the sites of the node
+            size_t                                                          left_offset;                                                    //!< The offset of the sites of the left child
+            size_t                                                          right_offset;                                                   //!< The offset of the sites of the right child
+            double                                                          t_left;                                                         //!< The branch time plus the propagated uncertainty of the left child
+            double                                                          t_right;                                                        //!< The branch time plus the propagated uncertainty of the right child
+        };
+        
+        void                                                                computeContrasts(const ContrastOperation &op, const std::vector<double> &log_site_rates, const std::vector<double> &inverse_site_variances, size_t site_begin, size_t site_end);
+        
+        std::vector<ContrastOperation>                                      contrast_operations;                                            //!< The contrasts to compute in postorder
+        
     };
     
 }
@@ -1,9 +1,9 @@
 #include "PhyloOrnsteinUhlenbeckProcessMVN.h"
 #include "ConstantNode.h"
 #include "DistributionNormal.h"
-#include "DistributionMultivariateNormal.h"
 #include "RandomNumberFactory.h"
 #include "RandomNumberGenerator.h"
+#include "RbConstants.h"
 #include "RbException.h"
 #include "StochasticNode.h"
 #include "TopologyNode.h"
@@ -19,9 +19,8 @@ PhyloOrnsteinUhlenbeckProcessMVN::PhyloOrnsteinUhlenbeckProcessMVN(const TypedDa
     obs( std::vector<std::vector<double> >(this->num_sites, std::vector<double>(num_tips, 0.0) ) ),
     means( new std::vector<std::vector<double> >(this->num_sites, std::vector<double>(num_tips, 0.0) ) ),
     stored_means( new std::vector<std::vector<double> >(this->num_sites, std::vector<double>(num_tips, 0.0) ) ),
-    phylogenetic_covariance_matrix( new MatrixReal(num_tips, num_tips) ),
-    stored_phylogenetic_covariance_matrix( new MatrixReal(num_tips, num_tips) ),
-    inverse_phylogenetic_covariance_matrix( num_tips, num_tips ),
+    covariance_factor(),
+    stored_covariance_factor(),
     changed_covariance(false),
     needs_covariance_recomputation( true ),
     needs_scale_recomputation( true )
@@ -57,8 +56,6 @@ PhyloOrnsteinUhlenbeckProcessMVN::PhyloOrnsteinUhlenbeckProcessMVN(const TypedDa
 PhyloOrnsteinUhlenbeckProcessMVN::~PhyloOrnsteinUhlenbeckProcessMVN( void )
 {
 
-//    delete phylogenetic_covariance_matrix;
-//    delete stored_phylogenetic_covariance_matrix;
 }
 
 
@@ -79,10 +76,14 @@ double PhyloOrnsteinUhlenbeckProcessMVN::computeLnProbability( void )
     // we start with the root and then traverse down the tree
     size_t root_index = root.getIndex();
     
+    std::vector<double> distances = std::vector<double>(num_tips,0.0);
+    recursiveComputeRootToTipDistance(distances, 0.0, root, root_index);
+    
+    double sel   = computeBranchAlpha(0);
+    double opt   = computeBranchTheta(0);
+    
     if ( needs_covariance_recomputation == true )
     {
-        std::vector<double> distances = std::vector<double>(num_tips,0.0);
-        recursiveComputeRootToTipDistance(distances, 0.0, root, root_index);
         MatrixReal c_matrix = MatrixReal(num_tips,num_tips);
         for (size_t i=0; i<num_tips; ++i)
         {
@@ -97,33 +98,30 @@ double PhyloOrnsteinUhlenbeckProcessMVN::computeLnProbability( void )
         MatrixReal shared_distances_matrix = MatrixReal(num_tips, num_tips);
         recursiveComputeDistanceMatrix(shared_distances_matrix, root, root_index);
         
-        double sel   = computeBranchAlpha(0);
-        double drift = computeBranchSigma(0);
-        double opt   = computeBranchTheta(0);
-        double var = (drift*drift)/sel * 0.5;
-        
-        MatrixReal &m = *phylogenetic_covariance_matrix;
+        // the stationary variance only scales the matrix, so we leave it out of the factor
+        MatrixReal m = MatrixReal(num_tips, num_tips);
         for (size_t i=0; i<num_tips; ++i)
         {
             for (size_t j=0; j<num_tips; ++j)
             {
-                m[i][j] = var * exp(-sel*c_matrix[i][j]) * (exp(2*sel*shared_distances_matrix[i][j])-1.0);
-            }
-        }
-        inverse_phylogenetic_covariance_matrix = phylogenetic_covariance_matrix->computeInverse();
-
-        // now compute the means
-        for (size_t i=0; i<num_sites; ++i)
-        {
-            for (size_t j=0; j<num_tips; ++j)
-            {
-                (*means)[i][j] = opt * (1.0-exp(-sel*distances[j])) + computeRootState(i)*exp(-sel*distances[j]);
+                m[i][j] = exp(-sel*c_matrix[i][j]) * (exp(2*sel*shared_distances_matrix[i][j])-1.0);
             }
         }
+        covariance_factor.decompose( m );
         
         needs_covariance_recomputation = false;
     }
     
+    // now compute the means, which also change with the root state and theta
+    for (size_t i=0; i<num_sites; ++i)
+    {
+        double root_state = computeRootState(i);
+        for (size_t j=0; j<num_tips; ++j)
+        {
+            (*means)[i][j] = opt * (1.0-exp(-sel*distances[j])) + root_state*exp(-sel*distances[j]);
+        }
+    }
+    
     // sum the partials up
     this->lnProb = sumRootLikelihood();
     
@@ -375,9 +373,7 @@ void PhyloOrnsteinUhlenbeckProcessMVN::restoreSpecialization( DagNode* affecter
         changed_covariance = false;
         needs_covariance_recomputation = false;
         
-        MatrixReal *tmp = phylogenetic_covariance_matrix;
-        phylogenetic_covariance_matrix = stored_phylogenetic_covariance_matrix;
-        stored_phylogenetic_covariance_matrix = tmp;
+        covariance_factor = stored_covariance_factor;
         
     }
     
@@ -615,6 +611,10 @@ void PhyloOrnsteinUhlenbeckProcessMVN::simulateRecursively( const TopologyNode &
         // get the branch specific optimum (theta)
         double branch_alpha = computeBranchAlpha( child.getIndex() );
         
+        // draw the standard normal deviates of all sites at once
+        std::vector<double> z = std::vector<double>( num_sites, 0.0 );
+        RbStatistics::Normal::rv( 0.0, 1.0, *rng, z );
+        
         ContinuousTaxonData &taxon = taxa[ child.getIndex() ];
         for ( size_t i = 0; i < num_sites; ++i )
         {
@@ -630,7 +630,7 @@ void PhyloOrnsteinUhlenbeckProcessMVN::simulateRecursively( const TopologyNode &
             double standDev = branch_sigma * sqrt((1 - e2) / 2 / branch_alpha);
             
             // create the character
-            double c = RbStatistics::Normal::rv( m, standDev, *rng);
+            double c = m + standDev * z[i];
             
             // add the character to the sequence
             taxon.addCharacter( c );
@@ -667,13 +667,34 @@ std::vector<double> PhyloOrnsteinUhlenbeckProcessMVN::simulateRootCharacters(siz
 double PhyloOrnsteinUhlenbeckProcessMVN::sumRootLikelihood( void )
 {
     
+    if ( covariance_factor.isPositiveDefinite() == false )
+    {
+        return RbConstants::Double::neginf;
+    }
+    
+    // the stationary variance scales the factored covariance matrix
+    double sel   = computeBranchAlpha(0);
+    double drift = computeBranchSigma(0);
+    double var = (drift*drift)/sel * 0.5;
+    
+    double log_normalize = -0.5 * log( RbConstants::TwoPI );
+    double log_det = covariance_factor.getLogDeterminant();
+    
     // sum the log-likelihoods for all sites together
     double sumPartialProbs = 0.0;
+    std::vector<double> diff = std::vector<double>(num_tips, 0.0);
     for (size_t site = 0; site < this->num_sites; ++site)
     {
+        const std::vector<double> &m = (*means)[site];
+        for (size_t i = 0; i < num_tips; ++i)
+        {
+            diff[i] = obs[site][i] - m[i];
+        }
+        
         double sigma = this->computeSiteRate(site);
-        //        sumPartialProbs += RbStatistics::MultivariateNormal::lnPdfCovariance(m, *phylogeneticCovarianceMatrix, obs[site], sigma*sigma);
-        sumPartialProbs += RbStatistics::MultivariateNormal::lnPdfPrecision( (*means)[site], inverse_phylogenetic_covariance_matrix, obs[site], sigma*sigma);
+        double scale = var * sigma * sigma;
+        double s2 = covariance_factor.computeQuadraticForm( diff );
+        sumPartialProbs += num_tips * log_normalize - 0.5 * (log_det + num_tips * log(scale) + s2 / scale);
     }
     
     return sumPartialProbs;
@@ -738,15 +759,18 @@ void PhyloOrnsteinUhlenbeckProcessMVN::touchSpecialization( DagNode* affecter, b
     {
         
         
+    }
+    else if ( affecter == homogeneous_theta || affecter == heterogeneous_theta || affecter == homogeneous_sigma || affecter == heterogeneous_sigma )
+    {
+        // theta only changes the means and sigma only scales the covariance matrix, so the factor does not change
+        
     }
     else
     {
         needs_covariance_recomputation = true;
         if ( changed_covariance == false )
         {
-            MatrixReal *tmp = phylogenetic_covariance_matrix;
-            phylogenetic_covariance_matrix = stored_phylogenetic_covariance_matrix;
-            stored_phylogenetic_covariance_matrix = tmp;
+            stored_covariance_factor = covariance_factor;
         }
         changed_covariance = true;
         
@@ -2,6 +2,7 @@
 #define PhyloOrnsteinUhlenbeckProcessMVN_H
 
 #include "AbstractPhyloContinuousCharacterProcess.h"
+#include "CholeskyDecomposition.h"
 #include "MatrixReal.h"
 
 #include <vector>
@@ -11,7 +12,10 @@ namespace RevBayesCore {
     /**
      * @brief Homogeneous distribution of character state evolution along a tree class (PhyloCTMC).
      *
-     *
+     * We keep the Cholesky factor of the phylogenetic covariance matrix without the stationary variance sigma^2/(2 alpha),
+     * which only scales the matrix. Hence, only changes of the tree, the branch rates or alpha require factoring the matrix again,
+     * whereas changes of sigma, theta or the root state only cost O(n^2) per site for the quadratic form.
+     * Note that a change of a single branch length changes the covariance matrix multiplicatively for all tips, so there are no low-rank updates as for Brownian motion.
      *
      * @copyright Copyright 2009-
      * @author The RevBayes Development Core Team (Sebastian Hoehna)
@@ -75,9 +79,8 @@ namespace RevBayesCore {
         std::vector<std::vector<double> >                                   obs;
         std::vector<std::vector<double> >*                                  means;
         std::vector<std::vector<double> >*                                  stored_means;
-        MatrixReal*                                                         phylogenetic_covariance_matrix;
-        MatrixReal*                                                         stored_phylogenetic_covariance_matrix;
-        MatrixReal                                                          inverse_phylogenetic_covariance_matrix;
+        CholeskyDecomposition                                               covariance_factor;                                              //!< The Cholesky factor of the covariance matrix without the stationary variance
+        CholeskyDecomposition                                               stored_covariance_factor;
         bool                                                                changed_covariance;
         bool                                                                needs_covariance_recomputation;
         bool                                                                needs_scale_recomputation;
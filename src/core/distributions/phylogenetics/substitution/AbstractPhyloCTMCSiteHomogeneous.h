@@ -6,6 +6,7 @@
 #include "DiscreteTaxonData.h"
 #include "DnaState.h"
 #include "MemberObject.h"
+#include "PhyloCTMCKernels.h"
 #include "RbMathLogic.h"
 #include "RbSettings.h"
 #include "RbVector.h"
@@ -54,6 +55,9 @@ namespace RevBayesCore {
      * nodeOffset                  =  num_site_mixtures*pattern_block_size*num_chars;
      * mixtureOffset               =  pattern_block_size*num_chars;
      * siteOffset                  =  num_chars;
+     *
+     * Derived classes using the vectorized kernels (see PhyloCTMCKernels) set pad_states so that siteOffset is num_chars
+     * rounded up to a multiple of the SIMD vector width. The padded entries are always 0.0 and are never part of a sum.
      * This gives the more convenient access via
      * partialLikelihoods[active*activeLikelihoodOffset + node_index*nodeOffset + siteRateIndex*mixtureOffset + siteIndex*siteOffset + charIndex]
      *
@@ -61,6 +65,16 @@ namespace RevBayesCore {
      * We also use twice as much memory because we store the partial likelihood along each branch and not only for each internal node.
      * This gives us a speed improvement during MCMC proposal in the order of a factor 2.
      *
+     * The transition probability matrices of each branch are cached together with the branch length, the clock rate and
+     * a version number that is renewed whenever the rate matrices or site rates of the branch change. Like the partial likelihoods,
+     * the cache is double buffered: a touched branch writes into its second buffer, keepSpecialization() accepts the new buffer and
+     * restoreSpecialization() switches back to the old one. Hence, branches that did not change (e.g. the ancestors of a changed branch)
+     * and rejected proposals never exponentiate a rate matrix again.
+     *
+     * The site patterns are independent of each other. Hence, the pattern block of this process (see compress())
+     * is additionally split among threads when compiled with OpenMP and the 'numThreads' option is larger than 1.
+     * Every pattern is always computed by exactly the same operations, so the likelihood does not depend on the number of threads.
+     *
      *
      *
      * @copyright Copyright 2009-
@@ -109,7 +123,12 @@ namespace RevBayesCore {
     protected:
 
         // helper method for this and derived classes
+        void                                                                getBranchAgesAndRate(size_t node_idx, double &start_age, double &end_age, double &rate) const;         //!< Get the start and end age and the clock rate of a branch
+        void                                                                invalidateTransitionProbabilities(void);                                                    //!< Renew the versions of the cached transition probabilities of all branches
+        void                                                                invalidateTransitionProbabilities(size_t node_idx);                                         //!< Renew the version of the cached transition probabilities of this branch
         void                                                                recursivelyFlagNodeDirty(const TopologyNode& n);
+        void                                                                resetTransitionProbabilityCache(void);                                                      //!< Discard all cached transition probabilities
+        void                                                                updateTransitionProbabilityCache(void);                                                     //!< Compute the transition probabilities of all dirty branches in batches
         virtual void                                                        resizeLikelihoodVectors(void);
         virtual void                                                        setActivePIDSpecialized(size_t i, size_t n);                                                          //!< Set the number of processes for this distribution.
 
@@ -143,6 +162,9 @@ namespace RevBayesCore {
         virtual void                                                        computeRootLikelihoods( std::vector< double > &rv ) const;
         virtual double                                                      sumRootLikelihood( void );
         virtual std::vector<size_t>                                         getIncludedSiteIndices();
+        virtual void                                                        scale(size_t i);
+        virtual void                                                        scale(size_t i, size_t l, size_t r);
+        virtual void                                                        scale(size_t i, size_t l, size_t r, size_t m);
 
 
         // members
@@ -157,6 +179,26 @@ namespace RevBayesCore {
         const TypedDagNode<Tree>*                                           tau;
         std::vector<TransitionProbabilityMatrix>                            transition_prob_matrices;
 
+        // the cache of the transition probabilities per branch
+        struct TransitionProbabilityCacheEntry {
+            size_t                                                          version;                                        //!< The version of the rate matrices and site rates
+            double                                                          start_age;                                      //!< The age of the start of the branch
+            double                                                          end_age;                                        //!< The age of the end of the branch
+            double                                                          rate;                                           //!< The clock rate of the branch
+            std::vector<TransitionProbabilityMatrix>                        matrices;                                       //!< The matrices per mixture category (empty if never computed)
+        };
+        TransitionProbabilityCacheEntry&                                    getNewTransitionProbabilityCacheEntry(size_t node_idx);                                                   //!< Get the (invalid) entry for new transition probabilities of a branch
+        bool                                                                isTransitionProbabilityCacheValid(size_t node_idx, double start_age, double end_age, double rate) const;  //!< Can we reuse the cached transition probabilities of a branch?
+        void                                                                validateTransitionProbabilityCacheEntry(size_t node_idx, double start_age, double end_age, double rate);  //!< Set the key of the new entry of a branch once its matrices are stored
+
+        std::vector<std::vector<TransitionProbabilityCacheEntry> >          transition_prob_cache;                          //!< The cache entries [active][node_index]
+        std::vector<size_t>                                                 active_transition_prob_cache;                   //!< The active cache entry per node
+        std::vector<bool>                                                   changed_transition_prob_cache;                  //!< Did we switch the active cache entry since the last keep/restore?
+        std::vector<size_t>                                                 transition_prob_versions;                       //!< The current version per node
+        std::vector<size_t>                                                 stored_transition_prob_versions;                //!< The versions at the last keep
+        size_t                                                              transition_prob_version_counter;                //!< The last version handed out (versions are never reused)
+        bool                                                                batch_transition_probabilities;                 //!< Do we compute the transition probabilities of all dirty branches together (see updateTransitionProbabilityCache)?
+
         // the likelihoods
         double*                                                             partialLikelihoods;
         std::vector<size_t>                                                 activeLikelihood;
@@ -197,6 +239,7 @@ namespace RevBayesCore {
 
         bool                                                                useMarginalLikelihoods;
         bool                                                                inMcmcMode;
+        bool                                                                pad_states;
 
         // members
         const TypedDagNode< double >*                                       homogeneous_clock_rate;
@@ -226,9 +269,6 @@ namespace RevBayesCore {
         // private methods
         void                                                                fillLikelihoodVector(const TopologyNode &n, size_t nIdx);
         void                                                                recursiveMarginalLikelihoodComputation(size_t nIdx);
-        virtual void                                                        scale(size_t i);
-        virtual void                                                        scale(size_t i, size_t l, size_t r);
-        virtual void                                                        scale(size_t i, size_t l, size_t r, size_t m);
         void                                                                simulate(const TopologyNode& node, std::vector< DiscreteTaxonData< charType > > &t, const std::vector<bool> &inv, const std::vector<size_t> &perSiteRates);
 
 
@@ -267,6 +307,13 @@ RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::AbstractPhyloCTMCSiteH
     num_matrices( 1 ),
     tau( t ),
     transition_prob_matrices( std::vector<TransitionProbabilityMatrix>(num_site_mixtures, TransitionProbabilityMatrix(num_chars) ) ),
+    transition_prob_cache(),
+    active_transition_prob_cache(),
+    changed_transition_prob_cache(),
+    transition_prob_versions(),
+    stored_transition_prob_versions(),
+    transition_prob_version_counter( 0 ),
+    batch_transition_probabilities( true ),
 //    partialLikelihoods( new double[2*num_nodes*num_site_mixtures*num_sites*num_chars] ),
     partialLikelihoods( NULL ),
     activeLikelihood( std::vector<size_t>(num_nodes, 0) ),
@@ -291,6 +338,7 @@ RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::AbstractPhyloCTMCSiteH
     using_weighted_characters( wd ),
     useMarginalLikelihoods( false ),
     inMcmcMode( false ),
+    pad_states( false ),
     pattern_block_start( 0 ),
     pattern_block_end( num_patterns ),
     pattern_block_size( num_patterns ),
@@ -320,6 +368,8 @@ RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::AbstractPhyloCTMCSiteH
     mixtureOffset               =  pattern_block_size*num_chars;
     siteOffset                  =  num_chars;
 
+    resetTransitionProbabilityCache();
+
 
     // add the parameters to our set (in the base class)
     // in that way other class can easily access the set of our parameters
@@ -353,6 +403,13 @@ RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::AbstractPhyloCTMCSiteH
     num_matrices( n.num_matrices ),
     tau( n.tau ),
     transition_prob_matrices( n.transition_prob_matrices ),
+    transition_prob_cache( n.transition_prob_cache ),
+    active_transition_prob_cache( n.active_transition_prob_cache ),
+    changed_transition_prob_cache( n.changed_transition_prob_cache ),
+    transition_prob_versions( n.transition_prob_versions ),
+    stored_transition_prob_versions( n.stored_transition_prob_versions ),
+    transition_prob_version_counter( n.transition_prob_version_counter ),
+    batch_transition_probabilities( n.batch_transition_probabilities ),
 //    partialLikelihoods( new double[2*num_nodes*num_site_mixtures*num_sites*num_chars] ),
     partialLikelihoods( NULL ),
     activeLikelihood( n.activeLikelihood ),
@@ -377,6 +434,7 @@ RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::AbstractPhyloCTMCSiteH
     using_weighted_characters( n.using_weighted_characters ),
     useMarginalLikelihoods( n.useMarginalLikelihoods ),
     inMcmcMode( n.inMcmcMode ),
+    pad_states( n.pad_states ),
     pattern_block_start( n.pattern_block_start ),
     pattern_block_end( n.pattern_block_end ),
     pattern_block_size( n.pattern_block_size ),
@@ -770,6 +828,9 @@ double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeLnProbab
     if ( dirty_nodes[root_index] == true )
     {
 
+        // compute the missing transition probabilities of all branches together
+        updateTransitionProbabilityCache();
+
         // start by filling the likelihood vector for the children of the root
         if ( root.getNumberOfChildren() == 2 ) // rooted trees have two children for the root
         {
@@ -1509,6 +1570,16 @@ double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getPInv( void )
 }
 
 
+template<class charType>
+bool RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::isTransitionProbabilityCacheValid( size_t node_idx, double start_age, double end_age, double rate ) const
+{
+
+    const TransitionProbabilityCacheEntry &cached = transition_prob_cache[ active_transition_prob_cache[node_idx] ][node_idx];
+
+    return cached.version == transition_prob_versions[node_idx] && cached.start_age == start_age && cached.end_age == end_age && cached.rate == rate && cached.matrices.size() == this->num_site_mixtures;
+}
+
+
 template<class charType>
 void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::keepSpecialization( DagNode* affecter )
 {
@@ -1530,6 +1601,118 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::keepSpecializatio
         (*it) = false;
     }
 
+    // accept the new transition probabilities
+    for (std::vector<bool>::iterator it = this->changed_transition_prob_cache.begin(); it != this->changed_transition_prob_cache.end(); ++it)
+    {
+        (*it) = false;
+    }
+    stored_transition_prob_versions = transition_prob_versions;
+
+}
+
+
+/**
+ * Get the start age, the end age and the clock rate of the branch leading to a node.
+ * If the tree is not a time tree, then the branch ends at age 0.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getBranchAgesAndRate( size_t node_idx, double &start_age, double &end_age, double &rate ) const
+{
+
+    const TopologyNode* node = tau->getValue().getNodes()[node_idx];
+
+    // get the clock rate for the branch
+    rate = 1.0;
+    if ( this->branch_heterogeneous_clock_rates == true )
+    {
+        rate = this->heterogeneous_clock_rates->getValue()[node_idx];
+    }
+    else if(homogeneous_clock_rate != NULL)
+    {
+        rate = this->homogeneous_clock_rate->getValue();
+    }
+
+    end_age = node->getAge();
+
+    // if the tree is not a time tree, then the age will be not a number
+    if ( RbMath::isFinite(end_age) == false )
+    {
+        // we assume by default that the end is at time 0
+        end_age = 0.0;
+    }
+    start_age = end_age + node->getBranchLength();
+
+}
+
+
+/**
+ * Get the cache entry for new transition probabilities of a branch.
+ * The first new entry of a branch since the last keep/restore goes into the other buffer so that restoreSpecialization() can switch back.
+ * The entry stays invalid until the caller has filled in the matrices and called validateTransitionProbabilityCacheEntry(),
+ * so that an exception while computing the matrices never leaves a valid entry with wrong matrices behind.
+ */
+template<class charType>
+typename RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::TransitionProbabilityCacheEntry& RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::getNewTransitionProbabilityCacheEntry( size_t node_idx )
+{
+
+    if ( changed_transition_prob_cache[node_idx] == false )
+    {
+        active_transition_prob_cache[node_idx] = (active_transition_prob_cache[node_idx] == 0 ? 1 : 0);
+        changed_transition_prob_cache[node_idx] = true;
+    }
+
+    // version 0 is never handed out and hence never matches
+    TransitionProbabilityCacheEntry &entry = transition_prob_cache[ active_transition_prob_cache[node_idx] ][node_idx];
+    entry.version   = 0;
+
+    return entry;
+}
+
+
+/**
+ * Set the key of the active cache entry of a branch.
+ * This must only be called after the matrices of the entry have been stored.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::validateTransitionProbabilityCacheEntry( size_t node_idx, double start_age, double end_age, double rate )
+{
+
+    TransitionProbabilityCacheEntry &entry = transition_prob_cache[ active_transition_prob_cache[node_idx] ][node_idx];
+    entry.version   = transition_prob_versions[node_idx];
+    entry.start_age = start_age;
+    entry.end_age   = end_age;
+    entry.rate      = rate;
+
+}
+
+
+/**
+ * Renew the versions of the cached transition probabilities of all branches,
+ * e.g. because the rate matrices or the site rates have changed.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::invalidateTransitionProbabilities( void )
+{
+
+    ++transition_prob_version_counter;
+    for (std::vector<size_t>::iterator it = transition_prob_versions.begin(); it != transition_prob_versions.end(); ++it)
+    {
+        (*it) = transition_prob_version_counter;
+    }
+
+}
+
+
+/**
+ * Renew the version of the cached transition probabilities of a single branch,
+ * e.g. because the rate matrix of this branch has changed.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::invalidateTransitionProbabilities( size_t node_idx )
+{
+
+    transition_prob_versions[node_idx] = ++transition_prob_version_counter;
+
 }
 
 
@@ -1637,10 +1820,13 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::redrawValue( void
     std::vector<size_t> perSiteMixtures = std::vector<size_t>(num_sites,0);
     std::vector<bool> inv = std::vector<bool>(num_sites,false);
     double prob_invariant = getPInv();
+    // we draw two uniforms per site at once, one for the invariance and one for the mixture category
+    std::vector<double> u_sites = std::vector<double>(2*num_sites,0.0);
+    rng->uniform01( u_sites );
     for ( size_t i = 0; i < num_sites; ++i )
     {
         // draw if this site is invariant
-        double u = rng->uniform01();
+        double u = u_sites[2*i];
         if ( u < prob_invariant )
         {
             // this site is invariant
@@ -1650,7 +1836,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::redrawValue( void
         else if ( num_site_mixtures  > 1 )
         {
             // draw the rate for this site
-            u = rng->uniform01();
+            u = u_sites[2*i+1];
             size_t mixtureIndex = size_t(u*num_site_mixtures);
             perSiteMixtures[i] = mixtureIndex;
 
@@ -1667,6 +1853,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::redrawValue( void
     std::vector<std::vector<double> > freqs;    getRootFrequencies(freqs);
     // simulate the root sequence
     DiscreteTaxonData< charType > &root = taxa[ tau->getValue().getRoot().getIndex() ];
+    rng->uniform01( &u_sites[0], num_sites );
     for ( size_t i = 0; i < num_sites; ++i )
     {
         const std::vector< double > &stationary_freqs = freqs[perSiteMixtures[i] % freqs.size()];
@@ -1675,7 +1862,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::redrawValue( void
         charType c = charType( num_chars );
         c.setToFirstState();
         // draw the state
-        double u = rng->uniform01();
+        double u = u_sites[i];
         std::vector< double >::const_iterator freq = stationary_freqs.begin();
         while ( true )
         {
@@ -1777,7 +1964,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::resizeLikelihoodV
     }
 
     // set the offsets for easier iteration through the likelihood vector
-    siteOffset                  =  num_chars;
+    siteOffset                  =  ( pad_states == true ? PhyloCTMCKernels::getPaddedNumberOfStates(num_chars) : num_chars );
     mixtureOffset               =  pattern_block_size*siteOffset;
     nodeOffset                  =  num_site_mixtures*mixtureOffset;
     activeLikelihoodOffset      =  num_nodes*nodeOffset;
@@ -1818,6 +2005,33 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::resizeLikelihoodV
 
     transition_prob_matrices = std::vector<TransitionProbabilityMatrix>(num_site_mixtures, TransitionProbabilityMatrix(num_chars) );
 
+    // the number of mixture categories may have changed
+    resetTransitionProbabilityCache();
+
+}
+
+
+/**
+ * Discard all cached transition probabilities, e.g. because the number of nodes or mixture categories has changed.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::resetTransitionProbabilityCache( void )
+{
+
+    TransitionProbabilityCacheEntry empty_entry;
+    empty_entry.version     = 0;
+    empty_entry.start_age   = 0.0;
+    empty_entry.end_age     = 0.0;
+    empty_entry.rate        = 0.0;
+
+    transition_prob_cache           = std::vector<std::vector<TransitionProbabilityCacheEntry> >(2, std::vector<TransitionProbabilityCacheEntry>(num_nodes, empty_entry) );
+    active_transition_prob_cache    = std::vector<size_t>(num_nodes, 0);
+    changed_transition_prob_cache   = std::vector<bool>(num_nodes, false);
+
+    // the new versions make sure that we never match an entry of an earlier cache
+    transition_prob_versions        = std::vector<size_t>(num_nodes, ++transition_prob_version_counter);
+    stored_transition_prob_versions = transition_prob_versions;
+
 }
 
 
@@ -1851,6 +2065,18 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::restoreSpecializa
         changed_nodes[index] = false;
     }
 
+    // restore the transition probabilities and their versions
+    for (size_t index = 0; index < changed_transition_prob_cache.size(); ++index)
+    {
+        if ( changed_transition_prob_cache[index] == true )
+        {
+            active_transition_prob_cache[index] = (active_transition_prob_cache[index] == 0 ? 1 : 0);
+        }
+
+        changed_transition_prob_cache[index] = false;
+    }
+    transition_prob_versions = stored_transition_prob_versions;
+
 }
 
 template<class charType>
@@ -1861,7 +2087,10 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t nod
 
     if ( RbSettings::userSettings().getUseScaling() == true && node_index % RbSettings::userSettings().getScalingDensity() == 0 )
     {
-        // iterate over all mixture categories
+        const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+
+        // iterate over all sites; the sites are independent and can be split among threads
+#       pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads > 1)
         for (size_t site = 0; site < this->pattern_block_size ; ++site)
         {
 
@@ -1926,7 +2155,10 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t nod
 
     if ( RbSettings::userSettings().getUseScaling() == true && node_index % RbSettings::userSettings().getScalingDensity() == 0 )
     {
-        // iterate over all mixture categories
+        const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+
+        // iterate over all sites; the sites are independent and can be split among threads
+#       pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads > 1)
         for (size_t site = 0; site < this->pattern_block_size ; ++site)
         {
 
@@ -1991,7 +2223,10 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::scale( size_t nod
 
     if ( RbSettings::userSettings().getUseScaling() == true && node_index % RbSettings::userSettings().getScalingDensity() == 0 )
     {
-        // iterate over all mixture categories
+        const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+
+        // iterate over all sites; the sites are independent and can be split among threads
+#       pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads > 1)
         for (size_t site = 0; site < this->pattern_block_size ; ++site)
         {
 
@@ -2103,6 +2338,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::simulate( const T
 
     // simulate the sequence for each child
     RandomNumberGenerator* rng = GLOBAL_RNG;
+    std::vector<double> u_sites = std::vector<double>(num_sites,0.0);
     for (std::vector< TopologyNode* >::const_iterator it = children.begin(); it != children.end(); ++it)
     {
         const TopologyNode &child = *(*it);
@@ -2110,6 +2346,9 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::simulate( const T
         // update the transition probability matrix
         updateTransitionProbabilities( child.getIndex(), child.getBranchLength() );
 
+        // draw the uniforms for all sites of this branch at once
+        rng->uniform01( u_sites );
+
         DiscreteTaxonData< charType > &taxon = taxa[ child.getIndex() ];
         for ( size_t i = 0; i < num_sites; ++i )
         {
@@ -2131,7 +2370,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::simulate( const T
                 charType c = charType( num_chars );
                 c.setToFirstState();
                 // draw the state
-                double u = rng->uniform01();
+                double u = u_sites[i];
                 size_t stateIndex = 0;
                 while ( true )
                 {
@@ -2527,22 +2766,24 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     // we need this vector to sum over the different mixture likelihoods
     std::vector<double> per_mixture_Likelihoods = std::vector<double>(pattern_block_size,0.0);
 
+    // the sites are independent and can be split among threads
+    // every site is always summed in the same order, so the result does not depend on the number of threads
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+
     // get pointer the likelihood
     double*   p_mixture     = p_node;
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
 
-        // get pointers to the likelihood for this mixture category
-        double*   p_site_mixture     = p_mixture;
         // iterate over all sites
-
+#       pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads > 1)
         for (size_t site = 0; site < pattern_block_size; ++site)
         {
             // temporary variable storing the likelihood
             double tmp = 0.0;
             // get the pointers to the likelihoods for this site and mixture category
-            double* p_site_j   = p_site_mixture;
+            double* p_site_j   = p_mixture + site*this->siteOffset;
             // iterate over all starting states
             for (size_t i=0; i<num_chars; ++i)
             {
@@ -2555,9 +2796,6 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
             // add the likelihood for this mixture category
             per_mixture_Likelihoods[site] += tmp;
 
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset;
-
         } // end-for over all sites (=patterns)
 
         // increment the pointers to the next mixture category
@@ -2567,7 +2805,8 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
 
     double prob_invariant = getPInv();
     double oneMinusPInv = 1.0 - prob_invariant;
-    std::vector< size_t >::const_iterator patterns = this->pattern_counts.begin();
+    bool use_scaling = RbSettings::userSettings().getUseScaling();
+    const std::vector<double> &log_scaling_factors = this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index];
     if ( prob_invariant > 0.0 )
     {
         // get the mean root frequency vector
@@ -2600,21 +2839,23 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
             }
         }
 
-        for (size_t site = 0; site < pattern_block_size; ++site, ++patterns)
+#       pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads > 1)
+        for (size_t site = 0; site < pattern_block_size; ++site)
         {
+            double patterns = double( this->pattern_counts[site] );
 
-            if ( RbSettings::userSettings().getUseScaling() == true )
+            if ( use_scaling == true )
             {
 
                 if ( this->site_invariant[site] == true )
                 {
-                    rv[site] = log( prob_invariant * f[ this->invariant_site_index[site] ] * exp(this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site]) + oneMinusPInv * per_mixture_Likelihoods[site] / this->num_site_mixtures ) * *patterns;
+                    rv[site] = log( prob_invariant * f[ this->invariant_site_index[site] ] * exp(log_scaling_factors[site]) + oneMinusPInv * per_mixture_Likelihoods[site] / this->num_site_mixtures ) * patterns;
                 }
                 else
                 {
-                    rv[site] = log( oneMinusPInv * per_mixture_Likelihoods[site] / this->num_site_mixtures ) * *patterns;
+                    rv[site] = log( oneMinusPInv * per_mixture_Likelihoods[site] / this->num_site_mixtures ) * patterns;
                 }
-                rv[site] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
+                rv[site] -= log_scaling_factors[site] * patterns;
 
             }
             else // no scaling
@@ -2622,11 +2863,11 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
 
                 if ( this->site_invariant[site] == true )
                 {
-                    rv[site] = log( prob_invariant * f[ this->invariant_site_index[site] ]  + oneMinusPInv * per_mixture_Likelihoods[site] / this->num_site_mixtures ) * *patterns;
+                    rv[site] = log( prob_invariant * f[ this->invariant_site_index[site] ]  + oneMinusPInv * per_mixture_Likelihoods[site] / this->num_site_mixtures ) * patterns;
                 }
                 else
                 {
-                    rv[site] = log( oneMinusPInv * per_mixture_Likelihoods[site] / this->num_site_mixtures ) * *patterns;
+                    rv[site] = log( oneMinusPInv * per_mixture_Likelihoods[site] / this->num_site_mixtures ) * patterns;
                 }
 
             }
@@ -2637,13 +2878,16 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::computeRootLikeli
     else
     {
 
-        for (size_t site = 0; site < pattern_block_size; ++site, ++patterns)
+#       pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads > 1)
+        for (size_t site = 0; site < pattern_block_size; ++site)
         {
-            rv[site] = log( per_mixture_Likelihoods[site] / this->num_site_mixtures ) * *patterns;
+            double patterns = double( this->pattern_counts[site] );
+
+            rv[site] = log( per_mixture_Likelihoods[site] / this->num_site_mixtures ) * patterns;
 
-            if ( RbSettings::userSettings().getUseScaling() == true )
+            if ( use_scaling == true )
             {
-                rv[site] -= this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index][site] * *patterns;
+                rv[site] -= log_scaling_factors[site] * patterns;
             }
 
         }
@@ -2662,6 +2906,7 @@ double RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::sumRootLikeliho
     std::vector<double> site_likelihoods = std::vector<double>(pattern_block_size,0.0);
     computeRootLikelihoods( site_likelihoods );
 
+    // sum the site likelihoods sequentially so that the result is identical for any number of threads
     double sum_partial_probs = 0.0;
 
     for (size_t site = 0; site < pattern_block_size; ++site)
@@ -2763,6 +3008,9 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::swapParameterInte
         num_nodes = tau->getValue().getNumberOfNodes();
     }
 
+    // the new parameter may have a different value
+    resetTransitionProbabilityCache();
+
 }
 
 template<class charType>
@@ -2806,6 +3054,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::touchSpecializati
         {
             // just flag everyting for recomputation
             touchAll = true;
+            invalidateTransitionProbabilities();
         }
         else
         {
@@ -2814,6 +3063,7 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::touchSpecializati
             for (std::set<size_t>::iterator it = indices.begin(); it != indices.end(); ++it)
             {
                 this->recursivelyFlagNodeDirty( *nodes[*it] );
+                invalidateTransitionProbabilities( *it );
             }
         }
     }
@@ -2826,6 +3076,12 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::touchSpecializati
     else if ( affecter != tau ) // if the topology wasn't the culprit for the touch, then we just flag everything as dirty
     {
         touchAll = true;
+
+        // the clock rate is part of the cache key, and the other two parameters do not enter the transition probabilities
+        if ( affecter != homogeneous_clock_rate && affecter != p_inv && affecter != site_rates_probs )
+        {
+            invalidateTransitionProbabilities();
+        }
     }
 
     if ( touchAll )
@@ -2874,31 +3130,37 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionP
 
     if (node->isRoot()) throw RbException("dnPhyloCTMC called updateTransitionProbabilities for the root node\n");
 
-    // second, get the clock rate for the branch
-    double rate = 1.0;
-    if ( this->branch_heterogeneous_clock_rates == true )
-    {
-        rate = this->heterogeneous_clock_rates->getValue()[node_idx];
-    }
-    else if(homogeneous_clock_rate != NULL)
+    double start_age = 0.0, end_age = 0.0, rate = 1.0;
+    getBranchAgesAndRate( node_idx, start_age, end_age, rate );
+
+    // we can reuse the transition probabilities if neither the branch nor its rate matrices and site rates have changed
+    const TransitionProbabilityCacheEntry &cached = transition_prob_cache[ active_transition_prob_cache[node_idx] ][node_idx];
+    if ( isTransitionProbabilityCacheValid( node_idx, start_age, end_age, rate ) == true )
     {
-        rate = this->homogeneous_clock_rate->getValue();
+        for (size_t i = 0; i < this->transition_prob_matrices.size(); ++i)
+        {
+            this->transition_prob_matrices[i] = cached.matrices[i];
+        }
+        return;
     }
 
-    double end_age = node->getAge();
-
-    // if the tree is not a time tree, then the age will be not a number
-    if ( RbMath::isFinite(end_age) == false )
+    // the branch ages and rates of all site rate categories
+    std::vector<double> start_ages( this->num_site_rates, start_age );
+    std::vector<double> end_ages( this->num_site_rates, end_age );
+    std::vector<double> rates( this->num_site_rates, rate );
+    if ( this->rate_variation_across_sites == true )
     {
-        // we assume by default that the end is at time 0
-        end_age = 0.0;
+        for (size_t j = 0; j < this->num_site_rates; ++j)
+        {
+            rates[j] *= this->site_rates->getValue()[j];
+        }
     }
-    double start_age = end_age + node->getBranchLength();
 
     // first, get the rate matrix for this branch
     RateMatrix_JC jc(this->num_chars);
     const RateGenerator *rm = &jc;
 
+    std::vector<TransitionProbabilityMatrix> tp;
     if (this->branch_heterogeneous_substitution_matrices == false )
     {
         for (size_t matrix = 0; matrix < this->num_matrices; ++matrix)
@@ -2912,6 +3174,79 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionP
                 rm = &this->homogeneous_rate_matrix->getValue();
             }
 
+            // compute all site rate categories together
+            rm->calculateTransitionProbabilities( start_ages, end_ages, rates, tp );
+            for (size_t j = 0; j < this->num_site_rates; ++j)
+            {
+                this->transition_prob_matrices[j*this->num_matrices + matrix] = tp[j];
+            }
+        }
+    }
+    else
+    {
+        if ( this->heterogeneous_rate_matrices != NULL )
+        {
+            rm = &this->heterogeneous_rate_matrices->getValue()[node_idx];
+        }
+        else if( this->homogeneous_rate_matrix != NULL )
+        {
+            rm = &this->homogeneous_rate_matrix->getValue();
+        }
+
+        rm->calculateTransitionProbabilities( start_ages, end_ages, rates, tp );
+        for (size_t j = 0; j < this->num_site_rates; ++j)
+        {
+            this->transition_prob_matrices[j] = tp[j];
+        }
+    }
+
+    // store the new transition probabilities so that we can reuse them
+    getNewTransitionProbabilityCacheEntry( node_idx ).matrices = this->transition_prob_matrices;
+    validateTransitionProbabilityCacheEntry( node_idx, start_age, end_age, rate );
+
+}
+
+
+/**
+ * Compute the transition probabilities of all dirty branches that are not in the cache.
+ * If all branches share the same rate matrices, then we compute all branches and site rate categories
+ * of a rate matrix in one batch, which is considerably faster than one matrix at a time (e.g. after a change of the rate matrix).
+ * The later calls to updateTransitionProbabilities() of these branches simply copy the cached matrices.
+ */
+template<class charType>
+void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionProbabilityCache( void )
+{
+
+    // branch specific rate matrices cannot be shared
+    if ( batch_transition_probabilities == false || this->branch_heterogeneous_substitution_matrices == true )
+    {
+        return;
+    }
+
+    // collect the branches that need new transition probabilities
+    const std::vector<TopologyNode*> &nodes = tau->getValue().getNodes();
+    std::vector<TransitionProbabilityCacheEntry*> entries;
+    std::vector<size_t> entry_nodes;
+    std::vector<double> entry_rates;
+    std::vector<double> start_ages, end_ages, rates;
+    for (size_t node_idx = 0; node_idx < nodes.size(); ++node_idx)
+    {
+        if ( dirty_nodes[node_idx] == false || nodes[node_idx]->isRoot() == true )
+        {
+            continue;
+        }
+
+        double start_age = 0.0, end_age = 0.0, rate = 1.0;
+        getBranchAgesAndRate( node_idx, start_age, end_age, rate );
+
+        if ( isTransitionProbabilityCacheValid( node_idx, start_age, end_age, rate ) == false )
+        {
+            TransitionProbabilityCacheEntry &entry = getNewTransitionProbabilityCacheEntry( node_idx );
+            entry.matrices.resize( this->num_site_mixtures, TransitionProbabilityMatrix(this->num_chars) );
+            entries.push_back( &entry );
+            entry_nodes.push_back( node_idx );
+            entry_rates.push_back( rate );
+
             for (size_t j = 0; j < this->num_site_rates; ++j)
             {
                 double r = 1.0;
@@ -2920,32 +3255,52 @@ void RevBayesCore::AbstractPhyloCTMCSiteHomogeneous<charType>::updateTransitionP
                     r = this->site_rates->getValue()[j];
                 }
 
-                rm->calculateTransitionProbabilities( start_age, end_age,  rate * r, this->transition_prob_matrices[j*this->num_matrices + matrix] );
+                start_ages.push_back( start_age );
+                end_ages.push_back( end_age );
+                rates.push_back( rate * r );
             }
         }
     }
-    else
+
+    if ( entries.empty() == true )
+    {
+        return;
+    }
+
+    // compute the transition probabilities of all branches for one rate matrix at a time
+    RateMatrix_JC jc(this->num_chars);
+    const RateGenerator *rm = &jc;
+
+    std::vector<TransitionProbabilityMatrix> tp;
+    for (size_t matrix = 0; matrix < this->num_matrices; ++matrix)
     {
         if ( this->heterogeneous_rate_matrices != NULL )
         {
-            rm = &this->heterogeneous_rate_matrices->getValue()[node_idx];
+            rm = &this->heterogeneous_rate_matrices->getValue()[matrix];
         }
         else if( this->homogeneous_rate_matrix != NULL )
         {
             rm = &this->homogeneous_rate_matrix->getValue();
         }
 
-        for (size_t j = 0; j < this->num_site_rates; ++j)
+        rm->calculateTransitionProbabilities( start_ages, end_ages, rates, tp );
+
+        for (size_t i = 0; i < entries.size(); ++i)
         {
-            double r = 1.0;
-            if( this->rate_variation_across_sites == true )
+            for (size_t j = 0; j < this->num_site_rates; ++j)
             {
-                r = this->site_rates->getValue()[j];
+                entries[i]->matrices[j*this->num_matrices + matrix] = tp[i*this->num_site_rates + j];
             }
-
-            rm->calculateTransitionProbabilities( start_age, end_age,  rate * r, this->transition_prob_matrices[j] );
         }
     }
+
+    // only now are all matrices of the new entries complete
+    for (size_t i = 0; i < entries.size(); ++i)
+    {
+        size_t first = i*this->num_site_rates;
+        validateTransitionProbabilityCacheEntry( entry_nodes[i], start_ages[first], end_ages[first], entry_rates[i] );
+    }
+
 }
 
 #endif
@@ -136,6 +136,9 @@ RevBayesCore::PhyloCTMCClado<charType>::PhyloCTMCClado(const TypedDagNode<Tree>
                                                 );
     heterogeneousCladogenesisMatrices        = NULL;
     cladogenesisTimes                        = NULL;
+    
+    // the cladogenetic model computes its own transition probabilities (see updateTransitionProbabilities)
+    this->batch_transition_probabilities     = false;
  
     
     cladoActiveLikelihoodOffset      =  this->num_nodes*this->num_site_rates*this->num_patterns*this->num_chars*this->num_chars;
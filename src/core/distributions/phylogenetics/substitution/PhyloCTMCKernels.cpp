@@ -0,0 +1,600 @@
+#include "PhyloCTMCKernels.h"
+
+#include <cstring>
+
+/* The SIMD kernels are compiled for their instruction set by function attributes
+   so that the rest of RevBayes can still be compiled for a generic CPU. */
+#if ( defined (__x86_64__) || defined (__i386__) ) && ( defined (__clang__) || ( defined (__GNUC__) && __GNUC__ >= 5 ) )
+#define RB_CTMC_KERNELS_AVX2
+#include <immintrin.h>
+#endif
+
+#if defined (RB_CTMC_KERNELS_AVX2) && ( defined (__clang__) || __GNUC__ >= 7 )
+#define RB_CTMC_KERNELS_AVX512
+#endif
+
+/* The largest padded state space for which the SIMD kernels keep their scratch buffer on the stack (enough for codon models). */
+#define RB_CTMC_KERNELS_STACK_STATES 64
+
+using namespace RevBayesCore;
+
+
+typedef void (*InternalNodeKernel)(const double*, const double*, const size_t*, const double*, const size_t*, double*, size_t, size_t, size_t, size_t);
+typedef void (*InternalNodeKernel3)(const double*, const double*, const size_t*, const double*, const size_t*, const double*, const size_t*, double*, size_t, size_t, size_t, size_t);
+
+
+/**
+ * The set of kernels chosen for this CPU.
+ * The vector width is the number of doubles processed at once and determines the padding of the state dimension.
+ */
+struct PhyloCTMCKernelTable {
+    InternalNodeKernel      internal_node;
+    InternalNodeKernel3     internal_node_3;
+    size_t                  vector_width;
+    std::string             name;
+};
+
+
+/*
+ * The row of the descendant likelihoods used for a site.
+ * Without a row index the descendant likelihoods are stored per site, otherwise they are a lookup table (e.g., the tip state tables).
+ */
+static inline size_t getRow(const size_t *rows, size_t site)
+{
+    return ( rows == NULL ? site : rows[site] );
+}
+
+
+/*
+ * Scalar kernels.
+ * These are used if the CPU has no supported SIMD extension or if the state space is smaller than the vector width.
+ */
+static void computeInternalNodeLikelihoodScalar(const double *tp, const double *p_left, const size_t *left_rows, const double *p_right, const size_t *right_rows, double *p_node, size_t num_states, size_t site_offset, size_t site_begin, size_t site_end)
+{
+
+    for (size_t site = site_begin; site < site_end; ++site)
+    {
+        const double*   p_site_left     = p_left  + getRow(left_rows, site)*site_offset;
+        const double*   p_site_right    = p_right + getRow(right_rows, site)*site_offset;
+        double*         p_site          = p_node  + site*site_offset;
+
+        // iterate over the possible starting states
+        const double* tp_a = tp;
+        for (size_t c1 = 0; c1 < num_states; ++c1)
+        {
+            // temporary variable
+            double sum = 0.0;
+
+            // iterate over all possible terminal states
+            for (size_t c2 = 0; c2 < num_states; ++c2 )
+            {
+                sum += p_site_left[c2] * p_site_right[c2] * tp_a[c2];
+            }
+
+            // store the likelihood for this starting state
+            p_site[c1] = sum;
+
+            // increment the pointers to the next starting state
+            tp_a += site_offset;
+        }
+
+        // the padded states are never possible
+        for (size_t c1 = num_states; c1 < site_offset; ++c1)
+        {
+            p_site[c1] = 0.0;
+        }
+
+    }
+
+}
+
+
+static void computeInternalNodeLikelihoodScalar(const double *tp, const double *p_left, const size_t *left_rows, const double *p_middle, const size_t *middle_rows, const double *p_right, const size_t *right_rows, double *p_node, size_t num_states, size_t site_offset, size_t site_begin, size_t site_end)
+{
+
+    for (size_t site = site_begin; site < site_end; ++site)
+    {
+        const double*   p_site_left     = p_left   + getRow(left_rows, site)*site_offset;
+        const double*   p_site_middle   = p_middle + getRow(middle_rows, site)*site_offset;
+        const double*   p_site_right    = p_right  + getRow(right_rows, site)*site_offset;
+        double*         p_site          = p_node   + site*site_offset;
+
+        // iterate over the possible starting states
+        const double* tp_a = tp;
+        for (size_t c1 = 0; c1 < num_states; ++c1)
+        {
+            // temporary variable
+            double sum = 0.0;
+
+            // iterate over all possible terminal states
+            for (size_t c2 = 0; c2 < num_states; ++c2 )
+            {
+                sum += p_site_left[c2] * p_site_middle[c2] * p_site_right[c2] * tp_a[c2];
+            }
+
+            // store the likelihood for this starting state
+            p_site[c1] = sum;
+
+            // increment the pointers to the next starting state
+            tp_a += site_offset;
+        }
+
+        // the padded states are never possible
+        for (size_t c1 = num_states; c1 < site_offset; ++c1)
+        {
+            p_site[c1] = 0.0;
+        }
+
+    }
+
+}
+
+
+#if defined (RB_CTMC_KERNELS_AVX2)
+
+/*
+ * AVX2 kernels.
+ * The product of the descendant partial likelihoods is computed once per site and then multiplied
+ * into four rows of the transition probability matrix at a time using fused multiply-add.
+ */
+__attribute__((target("avx2,fma")))
+static inline double horizontalSumAVX2(__m256d v)
+{
+    __m128d lo = _mm256_castpd256_pd128( v );
+    __m128d hi = _mm256_extractf128_pd( v, 1 );
+    lo = _mm_add_pd( lo, hi );
+    lo = _mm_add_sd( lo, _mm_unpackhi_pd( lo, lo ) );
+
+    return _mm_cvtsd_f64( lo );
+}
+
+
+__attribute__((target("avx2,fma")))
+static void multiplyRowsAVX2(const double *tp, const double *p_product, double *p_site, size_t num_states, size_t site_offset)
+{
+
+    size_t c1 = 0;
+    // four starting states at once
+    for (; c1+4 <= num_states; c1 += 4)
+    {
+        const double* tp_0 = tp + c1*site_offset;
+        const double* tp_1 = tp_0 + site_offset;
+        const double* tp_2 = tp_1 + site_offset;
+        const double* tp_3 = tp_2 + site_offset;
+
+        __m256d acc_0 = _mm256_setzero_pd();
+        __m256d acc_1 = _mm256_setzero_pd();
+        __m256d acc_2 = _mm256_setzero_pd();
+        __m256d acc_3 = _mm256_setzero_pd();
+        for (size_t c2 = 0; c2 < site_offset; c2 += 4)
+        {
+            __m256d p = _mm256_loadu_pd( p_product + c2 );
+            acc_0 = _mm256_fmadd_pd( p, _mm256_loadu_pd( tp_0 + c2 ), acc_0 );
+            acc_1 = _mm256_fmadd_pd( p, _mm256_loadu_pd( tp_1 + c2 ), acc_1 );
+            acc_2 = _mm256_fmadd_pd( p, _mm256_loadu_pd( tp_2 + c2 ), acc_2 );
+            acc_3 = _mm256_fmadd_pd( p, _mm256_loadu_pd( tp_3 + c2 ), acc_3 );
+        }
+
+        // reduce the four accumulators into the four likelihoods
+        __m256d acc_01 = _mm256_hadd_pd( acc_0, acc_1 );
+        __m256d acc_23 = _mm256_hadd_pd( acc_2, acc_3 );
+        __m256d lo = _mm256_permute2f128_pd( acc_01, acc_23, 0x20 );
+        __m256d hi = _mm256_permute2f128_pd( acc_01, acc_23, 0x31 );
+        _mm256_storeu_pd( p_site + c1, _mm256_add_pd( lo, hi ) );
+    }
+
+    // the remaining starting states
+    for (; c1 < num_states; ++c1)
+    {
+        const double* tp_a = tp + c1*site_offset;
+        __m256d acc = _mm256_setzero_pd();
+        for (size_t c2 = 0; c2 < site_offset; c2 += 4)
+        {
+            acc = _mm256_fmadd_pd( _mm256_loadu_pd( p_product + c2 ), _mm256_loadu_pd( tp_a + c2 ), acc );
+        }
+        p_site[c1] = horizontalSumAVX2( acc );
+    }
+
+    // the padded states are never possible
+    for (; c1 < site_offset; ++c1)
+    {
+        p_site[c1] = 0.0;
+    }
+
+}
+
+
+__attribute__((target("avx2,fma")))
+static void computeInternalNodeLikelihoodAVX2(const double *tp, const double *p_left, const size_t *left_rows, const double *p_right, const size_t *right_rows, double *p_node, size_t num_states, size_t site_offset, size_t site_begin, size_t site_end)
+{
+
+    // the product of the descendant likelihoods lives on the stack unless the state space is very large
+    double product_stack[RB_CTMC_KERNELS_STACK_STATES];
+    std::vector<double> product_heap;
+    double* p_product = product_stack;
+    if ( site_offset > RB_CTMC_KERNELS_STACK_STATES )
+    {
+        product_heap.resize( site_offset );
+        p_product = &product_heap[0];
+    }
+
+    for (size_t site = site_begin; site < site_end; ++site)
+    {
+        const double*   p_site_left     = p_left  + getRow(left_rows, site)*site_offset;
+        const double*   p_site_right    = p_right + getRow(right_rows, site)*site_offset;
+
+        for (size_t c2 = 0; c2 < site_offset; c2 += 4)
+        {
+            _mm256_storeu_pd( p_product + c2, _mm256_mul_pd( _mm256_loadu_pd( p_site_left + c2 ), _mm256_loadu_pd( p_site_right + c2 ) ) );
+        }
+
+        multiplyRowsAVX2( tp, p_product, p_node + site*site_offset, num_states, site_offset );
+    }
+
+}
+
+
+__attribute__((target("avx2,fma")))
+static void computeInternalNodeLikelihoodAVX2(const double *tp, const double *p_left, const size_t *left_rows, const double *p_middle, const size_t *middle_rows, const double *p_right, const size_t *right_rows, double *p_node, size_t num_states, size_t site_offset, size_t site_begin, size_t site_end)
+{
+
+    // the product of the descendant likelihoods lives on the stack unless the state space is very large
+    double product_stack[RB_CTMC_KERNELS_STACK_STATES];
+    std::vector<double> product_heap;
+    double* p_product = product_stack;
+    if ( site_offset > RB_CTMC_KERNELS_STACK_STATES )
+    {
+        product_heap.resize( site_offset );
+        p_product = &product_heap[0];
+    }
+
+    for (size_t site = site_begin; site < site_end; ++site)
+    {
+        const double*   p_site_left     = p_left   + getRow(left_rows, site)*site_offset;
+        const double*   p_site_middle   = p_middle + getRow(middle_rows, site)*site_offset;
+        const double*   p_site_right    = p_right  + getRow(right_rows, site)*site_offset;
+
+        for (size_t c2 = 0; c2 < site_offset; c2 += 4)
+        {
+            __m256d lm = _mm256_mul_pd( _mm256_loadu_pd( p_site_left + c2 ), _mm256_loadu_pd( p_site_middle + c2 ) );
+            _mm256_storeu_pd( p_product + c2, _mm256_mul_pd( lm, _mm256_loadu_pd( p_site_right + c2 ) ) );
+        }
+
+        multiplyRowsAVX2( tp, p_product, p_node + site*site_offset, num_states, site_offset );
+    }
+
+}
+
+#endif
+
+
+#if defined (RB_CTMC_KERNELS_AVX512)
+
+/*
+ * AVX-512 kernels.
+ * Same structure as the AVX2 kernels but with eight doubles per vector.
+ */
+__attribute__((target("avx512f")))
+static void multiplyRowsAVX512(const double *tp, const double *p_product, double *p_site, size_t num_states, size_t site_offset)
+{
+
+    size_t c1 = 0;
+    // four starting states at once
+    for (; c1+4 <= num_states; c1 += 4)
+    {
+        const double* tp_0 = tp + c1*site_offset;
+        const double* tp_1 = tp_0 + site_offset;
+        const double* tp_2 = tp_1 + site_offset;
+        const double* tp_3 = tp_2 + site_offset;
+
+        __m512d acc_0 = _mm512_setzero_pd();
+        __m512d acc_1 = _mm512_setzero_pd();
+        __m512d acc_2 = _mm512_setzero_pd();
+        __m512d acc_3 = _mm512_setzero_pd();
+        for (size_t c2 = 0; c2 < site_offset; c2 += 8)
+        {
+            __m512d p = _mm512_loadu_pd( p_product + c2 );
+            acc_0 = _mm512_fmadd_pd( p, _mm512_loadu_pd( tp_0 + c2 ), acc_0 );
+            acc_1 = _mm512_fmadd_pd( p, _mm512_loadu_pd( tp_1 + c2 ), acc_1 );
+            acc_2 = _mm512_fmadd_pd( p, _mm512_loadu_pd( tp_2 + c2 ), acc_2 );
+            acc_3 = _mm512_fmadd_pd( p, _mm512_loadu_pd( tp_3 + c2 ), acc_3 );
+        }
+
+        p_site[c1]   = _mm512_reduce_add_pd( acc_0 );
+        p_site[c1+1] = _mm512_reduce_add_pd( acc_1 );
+        p_site[c1+2] = _mm512_reduce_add_pd( acc_2 );
+        p_site[c1+3] = _mm512_reduce_add_pd( acc_3 );
+    }
+
+    // the remaining starting states
+    for (; c1 < num_states; ++c1)
+    {
+        const double* tp_a = tp + c1*site_offset;
+        __m512d acc = _mm512_setzero_pd();
+        for (size_t c2 = 0; c2 < site_offset; c2 += 8)
+        {
+            acc = _mm512_fmadd_pd( _mm512_loadu_pd( p_product + c2 ), _mm512_loadu_pd( tp_a + c2 ), acc );
+        }
+        p_site[c1] = _mm512_reduce_add_pd( acc );
+    }
+
+    // the padded states are never possible
+    for (; c1 < site_offset; ++c1)
+    {
+        p_site[c1] = 0.0;
+    }
+
+}
+
+
+__attribute__((target("avx512f")))
+static void computeInternalNodeLikelihoodAVX512(const double *tp, const double *p_left, const size_t *left_rows, const double *p_right, const size_t *right_rows, double *p_node, size_t num_states, size_t site_offset, size_t site_begin, size_t site_end)
+{
+
+    // the product of the descendant likelihoods lives on the stack unless the state space is very large
+    double product_stack[RB_CTMC_KERNELS_STACK_STATES];
+    std::vector<double> product_heap;
+    double* p_product = product_stack;
+    if ( site_offset > RB_CTMC_KERNELS_STACK_STATES )
+    {
+        product_heap.resize( site_offset );
+        p_product = &product_heap[0];
+    }
+
+    for (size_t site = site_begin; site < site_end; ++site)
+    {
+        const double*   p_site_left     = p_left  + getRow(left_rows, site)*site_offset;
+        const double*   p_site_right    = p_right + getRow(right_rows, site)*site_offset;
+
+        for (size_t c2 = 0; c2 < site_offset; c2 += 8)
+        {
+            _mm512_storeu_pd( p_product + c2, _mm512_mul_pd( _mm512_loadu_pd( p_site_left + c2 ), _mm512_loadu_pd( p_site_right + c2 ) ) );
+        }
+
+        multiplyRowsAVX512( tp, p_product, p_node + site*site_offset, num_states, site_offset );
+    }
+
+}
+
+
+__attribute__((target("avx512f")))
+static void computeInternalNodeLikelihoodAVX512(const double *tp, const double *p_left, const size_t *left_rows, const double *p_middle, const size_t *middle_rows, const double *p_right, const size_t *right_rows, double *p_node, size_t num_states, size_t site_offset, size_t site_begin, size_t site_end)
+{
+
+    // the product of the descendant likelihoods lives on the stack unless the state space is very large
+    double product_stack[RB_CTMC_KERNELS_STACK_STATES];
+    std::vector<double> product_heap;
+    double* p_product = product_stack;
+    if ( site_offset > RB_CTMC_KERNELS_STACK_STATES )
+    {
+        product_heap.resize( site_offset );
+        p_product = &product_heap[0];
+    }
+
+    for (size_t site = site_begin; site < site_end; ++site)
+    {
+        const double*   p_site_left     = p_left   + getRow(left_rows, site)*site_offset;
+        const double*   p_site_middle   = p_middle + getRow(middle_rows, site)*site_offset;
+        const double*   p_site_right    = p_right  + getRow(right_rows, site)*site_offset;
+
+        for (size_t c2 = 0; c2 < site_offset; c2 += 8)
+        {
+            __m512d lm = _mm512_mul_pd( _mm512_loadu_pd( p_site_left + c2 ), _mm512_loadu_pd( p_site_middle + c2 ) );
+            _mm512_storeu_pd( p_product + c2, _mm512_mul_pd( lm, _mm512_loadu_pd( p_site_right + c2 ) ) );
+        }
+
+        multiplyRowsAVX512( tp, p_product, p_node + site*site_offset, num_states, site_offset );
+    }
+
+}
+
+#endif
+
+
+/**
+ * Choose the kernels for the instruction set supported by this CPU.
+ */
+static PhyloCTMCKernelTable selectKernels( void )
+{
+
+    PhyloCTMCKernelTable table;
+    table.internal_node     = &computeInternalNodeLikelihoodScalar;
+    table.internal_node_3   = &computeInternalNodeLikelihoodScalar;
+    table.vector_width      = 1;
+    table.name              = "scalar";
+
+#if defined (RB_CTMC_KERNELS_AVX2)
+    __builtin_cpu_init();
+
+#   if defined (RB_CTMC_KERNELS_AVX512)
+    if ( __builtin_cpu_supports("avx512f") )
+    {
+        table.internal_node     = &computeInternalNodeLikelihoodAVX512;
+        table.internal_node_3   = &computeInternalNodeLikelihoodAVX512;
+        table.vector_width      = 8;
+        table.name              = "AVX-512";
+
+        return table;
+    }
+#   endif
+
+    if ( __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") )
+    {
+        table.internal_node     = &computeInternalNodeLikelihoodAVX2;
+        table.internal_node_3   = &computeInternalNodeLikelihoodAVX2;
+        table.vector_width      = 4;
+        table.name              = "AVX2";
+    }
+#endif
+
+    return table;
+}
+
+
+/**
+ * Get the kernels for this CPU. They are chosen once when first needed.
+ */
+static const PhyloCTMCKernelTable& getKernels( void )
+{
+
+    static const PhyloCTMCKernelTable table = selectKernels();
+
+    return table;
+}
+
+
+/**
+ * Compute the partial likelihoods of an internal node with two descendants.
+ * We fall back to the scalar kernel if the state dimension is not padded to the vector width.
+ */
+void RevBayesCore::PhyloCTMCKernels::computeInternalNodeLikelihood(const double *tp, const double *p_left, const size_t *left_rows, const double *p_right, const size_t *right_rows, double *p_node, size_t num_states, size_t site_offset, size_t site_begin, size_t site_end)
+{
+
+    const PhyloCTMCKernelTable &kernels = getKernels();
+
+    if ( num_states >= kernels.vector_width && site_offset % kernels.vector_width == 0 )
+    {
+        kernels.internal_node( tp, p_left, left_rows, p_right, right_rows, p_node, num_states, site_offset, site_begin, site_end );
+    }
+    else
+    {
+        computeInternalNodeLikelihoodScalar( tp, p_left, left_rows, p_right, right_rows, p_node, num_states, site_offset, site_begin, site_end );
+    }
+
+}
+
+
+/**
+ * Compute the partial likelihoods of an internal node with three descendants (the root of an unrooted tree).
+ * We fall back to the scalar kernel if the state dimension is not padded to the vector width.
+ */
+void RevBayesCore::PhyloCTMCKernels::computeInternalNodeLikelihood(const double *tp, const double *p_left, const size_t *left_rows, const double *p_middle, const size_t *middle_rows, const double *p_right, const size_t *right_rows, double *p_node, size_t num_states, size_t site_offset, size_t site_begin, size_t site_end)
+{
+
+    const PhyloCTMCKernelTable &kernels = getKernels();
+
+    if ( num_states >= kernels.vector_width && site_offset % kernels.vector_width == 0 )
+    {
+        kernels.internal_node_3( tp, p_left, left_rows, p_middle, middle_rows, p_right, right_rows, p_node, num_states, site_offset, site_begin, site_end );
+    }
+    else
+    {
+        computeInternalNodeLikelihoodScalar( tp, p_left, left_rows, p_middle, middle_rows, p_right, right_rows, p_node, num_states, site_offset, site_begin, site_end );
+    }
+
+}
+
+
+/**
+ * Compute the partial likelihoods at the root with two descendants.
+ * The frequencies are padded with zeros, so the padded states are set to 0.0 as well.
+ * This element-wise product is vectorized by the compiler.
+ */
+void RevBayesCore::PhyloCTMCKernels::computeRootLikelihood(const double *f, const double *p_left, const size_t *left_rows, const double *p_right, const size_t *right_rows, double *p_node, size_t num_states, size_t site_offset, size_t site_begin, size_t site_end)
+{
+
+    for (size_t site = site_begin; site < site_end; ++site)
+    {
+        const double*   p_site_left     = p_left  + getRow(left_rows, site)*site_offset;
+        const double*   p_site_right    = p_right + getRow(right_rows, site)*site_offset;
+        double*         p_site          = p_node  + site*site_offset;
+
+        for (size_t c = 0; c < site_offset; ++c)
+        {
+            p_site[c] = p_site_left[c] * p_site_right[c] * f[c];
+        }
+
+    }
+
+}
+
+
+/**
+ * Compute the partial likelihoods at the root with three descendants.
+ * The frequencies are padded with zeros, so the padded states are set to 0.0 as well.
+ * This element-wise product is vectorized by the compiler.
+ */
+void RevBayesCore::PhyloCTMCKernels::computeRootLikelihood(const double *f, const double *p_left, const size_t *left_rows, const double *p_middle, const size_t *middle_rows, const double *p_right, const size_t *right_rows, double *p_node, size_t num_states, size_t site_offset, size_t site_begin, size_t site_end)
+{
+
+    for (size_t site = site_begin; site < site_end; ++site)
+    {
+        const double*   p_site_left     = p_left   + getRow(left_rows, site)*site_offset;
+        const double*   p_site_middle   = p_middle + getRow(middle_rows, site)*site_offset;
+        const double*   p_site_right    = p_right  + getRow(right_rows, site)*site_offset;
+        double*         p_site          = p_node   + site*site_offset;
+
+        for (size_t c = 0; c < site_offset; ++c)
+        {
+            p_site[c] = p_site_left[c] * p_site_right[c] * p_site_middle[c] * f[c];
+        }
+
+    }
+
+}
+
+
+std::string RevBayesCore::PhyloCTMCKernels::getInstructionSet( void )
+{
+
+    return getKernels().name;
+}
+
+
+/**
+ * Get the size of the state dimension padded to a multiple of the vector width.
+ * State spaces smaller than the vector width are not padded because they would waste more memory than they gain.
+ */
+size_t RevBayesCore::PhyloCTMCKernels::getPaddedNumberOfStates(size_t num_states)
+{
+
+    size_t width = getKernels().vector_width;
+
+    if ( num_states < width )
+    {
+        return num_states;
+    }
+
+    return ((num_states + width - 1) / width) * width;
+}
+
+
+/**
+ * Copy a transition probability matrix into a padded matrix with rows of length site_offset.
+ * If transpose is true, then row i of the padded matrix holds the probabilities of ending in state i,
+ * which is the layout needed for tip likelihoods.
+ */
+void RevBayesCore::PhyloCTMCKernels::padTransitionProbabilities(const double *tp, size_t num_states, size_t site_offset, bool transpose, std::vector<double> &tp_padded)
+{
+
+    tp_padded.assign( num_states*site_offset, 0.0 );
+
+    for (size_t i = 0; i < num_states; ++i)
+    {
+        for (size_t j = 0; j < num_states; ++j)
+        {
+            if ( transpose == true )
+            {
+                tp_padded[j*site_offset+i] = tp[i*num_states+j];
+            }
+            else
+            {
+                tp_padded[i*site_offset+j] = tp[i*num_states+j];
+            }
+        }
+    }
+
+}
+
+
+void RevBayesCore::PhyloCTMCKernels::padVector(const std::vector<double> &v, size_t site_offset, std::vector<double> &v_padded)
+{
+
+    v_padded.assign( site_offset, 0.0 );
+
+    for (size_t i = 0; i < v.size() && i < site_offset; ++i)
+    {
+        v_padded[i] = v[i];
+    }
+
+}
@@ -0,0 +1,49 @@
+/**
+ * @file
+ * This file contains the vectorized kernels of the pruning algorithm used by the PhyloCTMC classes.
+ *
+ * @brief Namespace containing SIMD kernels for partial likelihood computations
+ *
+ * (c) Copyright 2009- under GPL version 3
+ * @date Last modified: $Date$
+ * @author The RevBayes Development Core Team
+ * @license GPL version 3
+ *
+ * $Id$
+ */
+
+#ifndef PhyloCTMCKernels_H
+#define PhyloCTMCKernels_H
+
+#include <string>
+#include <vector>
+
+namespace RevBayesCore {
+
+    /**
+     * The kernels compute the partial likelihoods for a range of sites [site_begin,site_end) of a single mixture category.
+     * All pointers point to the first site of the mixture category and consecutive sites are site_offset doubles apart.
+     * The state dimension may be padded, i.e., site_offset >= num_states, and the padded entries are always set to 0.0.
+     * Transition probabilities and root frequencies have to be padded in the same way (see padTransitionProbabilities).
+     * The descendant likelihoods may also be a table of rows, e.g., one row per observed state of a tip, in which case the
+     * row index array (left_rows, middle_rows, right_rows) gives the row used for each site. A NULL row index means one row per site.
+     *
+     * The instruction set (AVX-512, AVX2 with FMA, or plain scalar code) is chosen once at runtime from the capabilities of the CPU.
+     * For any given machine the same instruction set is used for every site, hence the results are identical for any number of threads.
+     */
+    namespace PhyloCTMCKernels {
+
+        void                computeInternalNodeLikelihood(const double *tp, const double *p_left, const size_t *left_rows, const double *p_right, const size_t *right_rows, double *p_node, size_t num_states, size_t site_offset, size_t site_begin, size_t site_end);                          //!< p_node[c1] = sum_c2 tp[c1][c2]*p_left[c2]*p_right[c2]
+        void                computeInternalNodeLikelihood(const double *tp, const double *p_left, const size_t *left_rows, const double *p_middle, const size_t *middle_rows, const double *p_right, const size_t *right_rows, double *p_node, size_t num_states, size_t site_offset, size_t site_begin, size_t site_end);  //!< p_node[c1] = sum_c2 tp[c1][c2]*p_left[c2]*p_middle[c2]*p_right[c2]
+        void                computeRootLikelihood(const double *f, const double *p_left, const size_t *left_rows, const double *p_right, const size_t *right_rows, double *p_node, size_t num_states, size_t site_offset, size_t site_begin, size_t site_end);                                  //!< p_node[c] = f[c]*p_left[c]*p_right[c]
+        void                computeRootLikelihood(const double *f, const double *p_left, const size_t *left_rows, const double *p_middle, const size_t *middle_rows, const double *p_right, const size_t *right_rows, double *p_node, size_t num_states, size_t site_offset, size_t site_begin, size_t site_end);          //!< p_node[c] = f[c]*p_left[c]*p_middle[c]*p_right[c]
+        std::string         getInstructionSet(void);                                                                                                                                                                                    //!< The name of the instruction set chosen for this CPU
+        size_t              getPaddedNumberOfStates(size_t num_states);                                                                                                                                                                 //!< The padded size of the state dimension for the chosen instruction set
+        void                padTransitionProbabilities(const double *tp, size_t num_states, size_t site_offset, bool transpose, std::vector<double> &tp_padded);                                                                       //!< Copy a transition probability matrix into rows of length site_offset
+        void                padVector(const std::vector<double> &v, size_t site_offset, std::vector<double> &v_padded);                                                                                                                //!< Copy a vector into a zero padded vector of length site_offset
+
+    }
+
+}
+
+#endif
@@ -3,6 +3,7 @@
 
 #include "AbstractPhyloCTMCSiteHomogeneous.h"
 #include "DnaState.h"
+#include "PhyloCTMCKernels.h"
 #include "RateMatrix.h"
 #include "RbVector.h"
 #include "TopologyNode.h"
@@ -20,20 +21,33 @@ namespace RevBayesCore {
 
         // public member functions
         PhyloCTMCSiteHomogeneous*                           clone(void) const;                                                                          //!< Create an independent clone
+        virtual void                                        drawJointConditionalAncestralStates(std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates);
 
 
     protected:
 
+        virtual void                                        compress(void);
         virtual void                                        computeRootLikelihood(size_t root, size_t l, size_t r);
         virtual void                                        computeRootLikelihood(size_t root, size_t l, size_t r, size_t m);
         virtual void                                        computeInternalNodeLikelihood(const TopologyNode &n, size_t nIdx, size_t l, size_t r);
         virtual void                                        computeInternalNodeLikelihood(const TopologyNode &n, size_t nIdx, size_t l, size_t r, size_t m);
         virtual void                                        computeTipLikelihood(const TopologyNode &node, size_t nIdx);
+        virtual void                                        scale(size_t i);
+
+        // members
+        bool                                                use_tip_state_tables;                                                                       //!< Should tips be stored as tables indexed by the observed state?
 
 
     private:
 
+        void                                                computeTipStateTable(size_t nIdx);
+        void                                                fillTipLikelihoodFromStateTable(size_t nIdx);
+        void                                                getDescendantLikelihoods(size_t nIdx, const double* &p, const size_t* &rows, size_t &mixture_offset) const;
+        bool                                                usesTipStateTables(void) const;
 
+        std::vector<std::vector<size_t> >                   tip_state_codes;                                                                            //!< The row of the tip state table used by each tip and site
+        std::vector<std::vector<RbBitSet> >                 tip_ambiguous_states;                                                                       //!< The distinct ambiguous states observed at each tip
+        std::vector<std::vector<std::vector<double> > >     tip_state_tables;                                                                           //!< The tip state tables for both likelihood buffers and each node
 
     };
 
@@ -47,13 +61,20 @@ namespace RevBayesCore {
 #include "TopologyNode.h"
 #include "TransitionProbabilityMatrix.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
+#include <map>
 
 template<class charType>
-RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::PhyloCTMCSiteHomogeneous(const TypedDagNode<Tree> *t, size_t nChars, bool c, size_t nSites, bool amb) : AbstractPhyloCTMCSiteHomogeneous<charType>(  t, nChars, 1, c, nSites, amb )
+RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::PhyloCTMCSiteHomogeneous(const TypedDagNode<Tree> *t, size_t nChars, bool c, size_t nSites, bool amb) : AbstractPhyloCTMCSiteHomogeneous<charType>(  t, nChars, 1, c, nSites, amb ),
+    use_tip_state_tables( true )
 {
 
+    // we use the vectorized kernels and therefore pad the state dimension to the SIMD vector width
+    this->pad_states = true;
+    this->resizeLikelihoodVectors();
+
 }
 
 
@@ -73,67 +94,261 @@ RevBayesCore::PhyloCTMCSiteHomogeneous<charType>* RevBayesCore::PhyloCTMCSiteHom
 }
 
 
+/**
+ * Compress the data and compute for each tip and site the row of the tip state table.
+ * Rows 0 to num_chars-1 are the unambiguous states, row num_chars is a gap,
+ * and the remaining rows are the distinct ambiguous states observed at this tip.
+ */
+template<class charType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::compress( void )
+{
+
+    // compress the data in the base class
+    AbstractPhyloCTMCSiteHomogeneous<charType>::compress();
+
+    tip_state_codes         = std::vector<std::vector<size_t> >(this->num_nodes);
+    tip_ambiguous_states    = std::vector<std::vector<RbBitSet> >(this->num_nodes);
+    tip_state_tables        = std::vector<std::vector<std::vector<double> > >(2, std::vector<std::vector<double> >(this->num_nodes) );
+
+    std::vector<TopologyNode*> nodes = this->tau->getValue().getNodes();
+    for (std::vector<TopologyNode*>::iterator it = nodes.begin(); it != nodes.end(); ++it)
+    {
+        if ( (*it)->isTip() == false )
+        {
+            continue;
+        }
+
+        size_t node_index = (*it)->getIndex();
+        const std::vector<bool>             &gap_node       = this->gap_matrix[node_index];
+        const std::vector<unsigned long>    &char_node      = this->char_matrix[node_index];
+        const std::vector<RbBitSet>         &amb_char_node  = this->ambiguous_char_matrix[node_index];
+
+        std::vector<size_t>     &codes      = tip_state_codes[node_index];
+        std::vector<RbBitSet>   &ambiguous  = tip_ambiguous_states[node_index];
+        std::map<RbBitSet, size_t> ambiguous_codes;
+
+        codes.resize( this->pattern_block_size );
+        for (size_t site = 0; site < this->pattern_block_size; ++site)
+        {
+            if ( gap_node[site] == true )
+            {
+                codes[site] = this->num_chars;
+            }
+            else if ( this->using_ambiguous_characters == true )
+            {
+                const RbBitSet &val = amb_char_node[site];
+
+                if ( val.getNumberSetBits() == 1 )
+                {
+                    // this is actually an unambiguous state
+                    size_t state = 0;
+                    while ( val.isSet(state) == false )
+                    {
+                        ++state;
+                    }
+                    codes[site] = state;
+                }
+                else
+                {
+                    std::map<RbBitSet, size_t>::const_iterator code = ambiguous_codes.find( val );
+                    if ( code == ambiguous_codes.end() )
+                    {
+                        code = ambiguous_codes.insert( std::make_pair( val, this->num_chars + 1 + ambiguous.size() ) ).first;
+                        ambiguous.push_back( val );
+                    }
+                    codes[site] = code->second;
+                }
+
+            }
+            else
+            {
+                codes[site] = char_node[site];
+            }
+
+        }
+
+    }
+
+}
+
 
+/**
+ * Compute the tip state table of a tip for all mixture categories.
+ * Each row holds the probabilities of all starting states given the observed state of the row,
+ * that is, the partial likelihood vector of any site with this observation.
+ */
 template<class charType>
-void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihood( size_t root, size_t left, size_t right)
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeTipStateTable(size_t node_index)
 {
 
-    // get the pointers to the partial likelihoods of the left and right subtree
-          double* p        = this->partialLikelihoods + this->activeLikelihood[root]  * this->activeLikelihoodOffset + root  * this->nodeOffset;
-    const double* p_left   = this->partialLikelihoods + this->activeLikelihood[left]  * this->activeLikelihoodOffset + left  * this->nodeOffset;
-    const double* p_right  = this->partialLikelihoods + this->activeLikelihood[right] * this->activeLikelihoodOffset + right * this->nodeOffset;
+    const std::vector<RbBitSet> &ambiguous = tip_ambiguous_states[node_index];
+    size_t num_codes    = this->num_chars + 1 + ambiguous.size();
+    size_t table_offset = num_codes*this->siteOffset;
+
+    std::vector<double> &table = tip_state_tables[this->activeLikelihood[node_index]][node_index];
+    table.resize( this->num_site_mixtures*table_offset );
+
+    // the transposed transition probabilities, i.e., row i holds the probabilities of all starting states to end in state i
+    std::vector<double> tp_padded;
+
+    // iterate over all mixture categories
+    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    {
+        PhyloCTMCKernels::padTransitionProbabilities( this->transition_prob_matrices[mixture].theMatrix, this->num_chars, this->siteOffset, true, tp_padded );
+
+        // the unambiguous states are the rows of the transposed matrix
+        double* p_table = &table[mixture*table_offset];
+        memcpy(p_table, &tp_padded[0], this->num_chars*this->siteOffset*sizeof(double));
+
+        // since this is a gap we need to assume that the actual state could have been any state
+        double* p_gap = p_table + this->num_chars*this->siteOffset;
+        std::fill(p_gap, p_gap + this->num_chars, 1.0);
+        std::fill(p_gap + this->num_chars, p_gap + this->siteOffset, 0.0);
+
+        // the ambiguous states are the sums of the rows of all observed states
+        double* p_row = p_gap + this->siteOffset;
+        for (size_t k = 0; k < ambiguous.size(); ++k)
+        {
+            const RbBitSet &val = ambiguous[k];
+
+            std::fill(p_row, p_row + this->siteOffset, 0.0);
+            for ( size_t i=0; i<val.size(); ++i )
+            {
+                // check whether we observed this state
+                if ( val.isSet(i) == true )
+                {
+                    const double* d = &tp_padded[i*this->siteOffset];
+                    for (size_t c1 = 0; c1 < this->siteOffset; ++c1)
+                    {
+                        p_row[c1] += d[c1];
+                    }
+                }
+            }
+
+            p_row += this->siteOffset;
+        }
+
+    } // end-for over all mixture categories
+
+}
+
+
+/**
+ * Draw ancestral states. This needs the partial likelihoods of the tips, which we fill from the tip state tables first.
+ */
+template<class charType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::drawJointConditionalAncestralStates(std::vector<std::vector<charType> >& startStates, std::vector<std::vector<charType> >& endStates)
+{
+
+    if ( usesTipStateTables() == true )
+    {
+        size_t num_tips = this->tau->getValue().getNumberOfTips();
+        for (size_t i = 0; i < num_tips; ++i)
+        {
+            fillTipLikelihoodFromStateTable( this->tau->getValue().getNode(i).getIndex() );
+        }
+    }
+
+    AbstractPhyloCTMCSiteHomogeneous<charType>::drawJointConditionalAncestralStates(startStates, endStates);
+
+}
+
+
+/**
+ * Copy the rows of the tip state table into the partial likelihood vector of this tip.
+ */
+template<class charType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::fillTipLikelihoodFromStateTable(size_t node_index)
+{
+
+    double* p_node = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+
+    const double*   p_table         = NULL;
+    const size_t*   rows            = NULL;
+    size_t          table_offset    = 0;
+    getDescendantLikelihoods( node_index, p_table, rows, table_offset );
+
+    for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
+    {
+        for (size_t site = 0; site < this->pattern_block_size; ++site)
+        {
+            memcpy(p_node + mixture*this->mixtureOffset + site*this->siteOffset, p_table + mixture*table_offset + rows[site]*this->siteOffset, this->siteOffset*sizeof(double));
+        }
+    }
+
+}
+
+
+/**
+ * Get the likelihoods of a descendant node for the kernels.
+ * For a tip with a tip state table these are the rows of the table together with the row index of each site,
+ * otherwise the partial likelihoods with one row per site.
+ */
+template<class charType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::getDescendantLikelihoods(size_t node_index, const double* &p, const size_t* &rows, size_t &mixture_offset) const
+{
+
+    if ( usesTipStateTables() == true && this->tau->getValue().getNode(node_index).isTip() == true )
+    {
+        const std::vector<double> &table = tip_state_tables[this->activeLikelihood[node_index]][node_index];
+
+        p               = &table[0];
+        rows            = ( this->pattern_block_size > 0 ? &tip_state_codes[node_index][0] : NULL );
+        mixture_offset  = table.size() / this->num_site_mixtures;
+    }
+    else
+    {
+        p               = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+        rows            = NULL;
+        mixture_offset  = this->mixtureOffset;
+    }
+
+}
+
 
-    // create a vector for the per mixture likelihoods
-    // we need this vector to sum over the different mixture likelihoods
-    std::vector<double> per_mixture_Likelihoods = std::vector<double>(this->num_patterns,0.0);
+template<class charType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihood( size_t root, size_t left, size_t right)
+{
 
-    // get pointers the likelihood for both subtrees
-          double*   p_mixture          = p;
-    const double*   p_mixture_left     = p_left;
-    const double*   p_mixture_right    = p_right;
+    // get the pointers to the partial likelihoods of the left and right subtree
+    double* p = this->partialLikelihoods + this->activeLikelihood[root]  * this->activeLikelihoodOffset + root  * this->nodeOffset;
+    const double *p_left = NULL, *p_right = NULL;
+    const size_t *left_rows = NULL, *right_rows = NULL;
+    size_t left_offset = 0, right_offset = 0;
+    getDescendantLikelihoods( left,  p_left,  left_rows,  left_offset );
+    getDescendantLikelihoods( right, p_right, right_rows, right_offset );
 
     // get the root frequencies
     std::vector<std::vector<double> >   ff;
     this->getRootFrequencies(ff);
 
+    // the number of threads among which we split the sites
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+
+    // the root frequencies padded to the size of the state dimension
+    std::vector<double> f_padded;
+
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
         // get the root frequencies
-        const std::vector<double> &f                    = ff[mixture % ff.size()];
-        std::vector<double>::const_iterator f_end       = f.end();
-        std::vector<double>::const_iterator f_begin     = f.begin();
-
-        // get pointers to the likelihood for this mixture category
-              double*   p_site_mixture          = p_mixture;
-        const double*   p_site_mixture_left     = p_mixture_left;
-        const double*   p_site_mixture_right    = p_mixture_right;
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size; ++site)
-        {
-            // get the pointer to the stationary frequencies
-            std::vector<double>::const_iterator f_j             = f_begin;
-            // get the pointers to the likelihoods for this site and mixture category
-                  double* p_site_j        = p_site_mixture;
-            const double* p_site_left_j   = p_site_mixture_left;
-            const double* p_site_right_j  = p_site_mixture_right;
-            // iterate over all starting states
-            for (; f_j != f_end; ++f_j)
-            {
-                // add the probability of starting from this state
-                *p_site_j = *p_site_left_j * *p_site_right_j * *f_j;
+        PhyloCTMCKernels::padVector( ff[mixture % ff.size()], this->siteOffset, f_padded );
 
-                // increment pointers
-                ++p_site_j; ++p_site_left_j; ++p_site_right_j;
-            }
+        // get the pointers to the likelihood for this mixture category
+        double*         p_mixture           = p       + mixture*this->mixtureOffset;
+        const double*   p_mixture_left      = p_left  + mixture*left_offset;
+        const double*   p_mixture_right     = p_right + mixture*right_offset;
 
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset;
+        // each thread computes a contiguous range of sites
+#       pragma omp parallel for schedule(static,1) num_threads(num_threads) if(num_threads > 1)
+        for (int thread = 0; thread < num_threads; ++thread)
+        {
+            size_t site_begin = (this->pattern_block_size * thread) / num_threads;
+            size_t site_end   = (this->pattern_block_size * (thread+1)) / num_threads;
 
-        } // end-for over all sites (=patterns)
+            PhyloCTMCKernels::computeRootLikelihood( &f_padded[0], p_mixture_left, left_rows, p_mixture_right, right_rows, p_mixture, this->num_chars, this->siteOffset, site_begin, site_end );
 
-        // increment the pointers to the next mixture category
-        p_mixture+=this->mixtureOffset; p_mixture_left+=this->mixtureOffset; p_mixture_right+=this->mixtureOffset;
+        } // end-for over all threads
 
     } // end-for over all mixtures (=rate categories)
 
@@ -145,63 +360,47 @@ template<class charType>
 void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeRootLikelihood( size_t root, size_t left, size_t right, size_t middle)
 {
 
-    // get the pointers to the partial likelihoods of the left and right subtree
-          double* p        = this->partialLikelihoods + this->activeLikelihood[root]   * this->activeLikelihoodOffset + root   * this->nodeOffset;
-    const double* p_left   = this->partialLikelihoods + this->activeLikelihood[left]   * this->activeLikelihoodOffset + left   * this->nodeOffset;
-    const double* p_right  = this->partialLikelihoods + this->activeLikelihood[right]  * this->activeLikelihoodOffset + right  * this->nodeOffset;
-    const double* p_middle = this->partialLikelihoods + this->activeLikelihood[middle] * this->activeLikelihoodOffset + middle * this->nodeOffset;
-
-    // get pointers the likelihood for both subtrees
-          double*   p_mixture          = p;
-    const double*   p_mixture_left     = p_left;
-    const double*   p_mixture_right    = p_right;
-    const double*   p_mixture_middle   = p_middle;
+    // get the pointers to the partial likelihoods of the left, middle and right subtree
+    double* p = this->partialLikelihoods + this->activeLikelihood[root]   * this->activeLikelihoodOffset + root   * this->nodeOffset;
+    const double *p_left = NULL, *p_middle = NULL, *p_right = NULL;
+    const size_t *left_rows = NULL, *middle_rows = NULL, *right_rows = NULL;
+    size_t left_offset = 0, middle_offset = 0, right_offset = 0;
+    getDescendantLikelihoods( left,   p_left,   left_rows,   left_offset );
+    getDescendantLikelihoods( middle, p_middle, middle_rows, middle_offset );
+    getDescendantLikelihoods( right,  p_right,  right_rows,  right_offset );
 
     // get the root frequencies
     std::vector<std::vector<double> >   ff;
     this->getRootFrequencies(ff);
 
+    // the number of threads among which we split the sites
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+
+    // the root frequencies padded to the size of the state dimension
+    std::vector<double> f_padded;
+
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
         // get the root frequencies
-        const std::vector<double> &f                    = ff[mixture % ff.size()];
-        std::vector<double>::const_iterator f_end       = f.end();
-        std::vector<double>::const_iterator f_begin     = f.begin();
-
-        // get pointers to the likelihood for this mixture category
-              double*   p_site_mixture          = p_mixture;
-        const double*   p_site_mixture_left     = p_mixture_left;
-        const double*   p_site_mixture_right    = p_mixture_right;
-        const double*   p_site_mixture_middle   = p_mixture_middle;
-        // iterate over all sites
-        for (size_t site = 0; site < this->pattern_block_size; ++site)
-        {
-
-            // get the pointer to the stationary frequencies
-            std::vector<double>::const_iterator f_j = f_begin;
-            // get the pointers to the likelihoods for this site and mixture category
-                  double* p_site_j        = p_site_mixture;
-            const double* p_site_left_j   = p_site_mixture_left;
-            const double* p_site_right_j  = p_site_mixture_right;
-            const double* p_site_middle_j = p_site_mixture_middle;
-            // iterate over all starting states
-            for (; f_j != f_end; ++f_j)
-            {
-                // add the probability of starting from this state
-                *p_site_j = *p_site_left_j * *p_site_right_j * *p_site_middle_j * *f_j;
-
-                // increment pointers
-                ++p_site_j; ++p_site_left_j; ++p_site_right_j; ++p_site_middle_j;
-            }
+        PhyloCTMCKernels::padVector( ff[mixture % ff.size()], this->siteOffset, f_padded );
 
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture_middle+=this->siteOffset;
+        // get the pointers to the likelihood for this mixture category
+        double*         p_mixture           = p        + mixture*this->mixtureOffset;
+        const double*   p_mixture_left      = p_left   + mixture*left_offset;
+        const double*   p_mixture_middle    = p_middle + mixture*middle_offset;
+        const double*   p_mixture_right     = p_right  + mixture*right_offset;
+
+        // each thread computes a contiguous range of sites
+#       pragma omp parallel for schedule(static,1) num_threads(num_threads) if(num_threads > 1)
+        for (int thread = 0; thread < num_threads; ++thread)
+        {
+            size_t site_begin = (this->pattern_block_size * thread) / num_threads;
+            size_t site_end   = (this->pattern_block_size * (thread+1)) / num_threads;
 
-        } // end-for over all sites (=patterns)
+            PhyloCTMCKernels::computeRootLikelihood( &f_padded[0], p_mixture_left, left_rows, p_mixture_middle, middle_rows, p_mixture_right, right_rows, p_mixture, this->num_chars, this->siteOffset, site_begin, site_end );
 
-        // increment the pointers to the next mixture category
-        p_mixture+=this->mixtureOffset; p_mixture_left+=this->mixtureOffset; p_mixture_right+=this->mixtureOffset; p_mixture_middle+=this->mixtureOffset;
+        } // end-for over all threads
 
     } // end-for over all mixtures (=rate categories)
 
@@ -216,52 +415,40 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikeli
     this->updateTransitionProbabilities( node_index, node.getBranchLength() );
 
     // get the pointers to the partial likelihoods for this node and the two descendant subtrees
-    const double*   p_left  = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
-    const double*   p_right = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
-    double*         p_node  = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    double* p_node = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    const double *p_left = NULL, *p_right = NULL;
+    const size_t *left_rows = NULL, *right_rows = NULL;
+    size_t left_offset = 0, right_offset = 0;
+    getDescendantLikelihoods( left,  p_left,  left_rows,  left_offset );
+    getDescendantLikelihoods( right, p_right, right_rows, right_offset );
+
+    // the number of threads among which we split the sites
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+
+    // the transition probabilities with rows padded to the size of the state dimension
+    std::vector<double> tp_padded;
 
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
         // the transition probability matrix for this mixture category
-        const double*    tp_begin                = this->transition_prob_matrices[mixture].theMatrix;
+        PhyloCTMCKernels::padTransitionProbabilities( this->transition_prob_matrices[mixture].theMatrix, this->num_chars, this->siteOffset, false, tp_padded );
 
         // get the pointers to the likelihood for this mixture category
-        size_t offset = mixture*this->mixtureOffset;
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
-        // compute the per site probabilities
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
-        {
+        double*         p_mixture           = p_node  + mixture*this->mixtureOffset;
+        const double*   p_mixture_left      = p_left  + mixture*left_offset;
+        const double*   p_mixture_right     = p_right + mixture*right_offset;
 
-            // get the pointers for this mixture category and this site
-            const double*       tp_a    = tp_begin;
-            // iterate over the possible starting states
-            for (size_t c1 = 0; c1 < this->num_chars; ++c1)
-            {
-                // temporary variable
-                double sum = 0.0;
-
-                // iterate over all possible terminal states
-                for (size_t c2 = 0; c2 < this->num_chars; ++c2 )
-                {
-                    sum += p_site_mixture_left[c2] * p_site_mixture_right[c2] * tp_a[c2];
-
-                } // end-for over all distination character
-
-                // store the likelihood for this starting state
-                p_site_mixture[c1] = sum;
-
-                // increment the pointers to the next starting state
-                tp_a+=this->num_chars;
-
-            } // end-for over all initial characters
+        // each thread computes a contiguous range of sites
+#       pragma omp parallel for schedule(static,1) num_threads(num_threads) if(num_threads > 1)
+        for (int thread = 0; thread < num_threads; ++thread)
+        {
+            size_t site_begin = (this->pattern_block_size * thread) / num_threads;
+            size_t site_end   = (this->pattern_block_size * (thread+1)) / num_threads;
 
-            // increment the pointers to the next site
-            p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
+            PhyloCTMCKernels::computeInternalNodeLikelihood( &tp_padded[0], p_mixture_left, left_rows, p_mixture_right, right_rows, p_mixture, this->num_chars, this->siteOffset, site_begin, site_end );
 
-        } // end-for over all sites (=patterns)
+        } // end-for over all threads
 
     } // end-for over all mixtures (=rate-categories)
 
@@ -275,55 +462,43 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeInternalNodeLikeli
     // compute the transition probability matrix
     this->updateTransitionProbabilities( node_index, node.getBranchLength() );
 
-    // get the pointers to the partial likelihoods for this node and the two descendant subtrees
-    const double*   p_left      = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
-    const double*   p_middle    = this->partialLikelihoods + this->activeLikelihood[middle]*this->activeLikelihoodOffset + middle*this->nodeOffset;
-    const double*   p_right     = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
-    double*         p_node      = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    // get the pointers to the partial likelihoods for this node and the three descendant subtrees
+    double* p_node = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
+    const double *p_left = NULL, *p_middle = NULL, *p_right = NULL;
+    const size_t *left_rows = NULL, *middle_rows = NULL, *right_rows = NULL;
+    size_t left_offset = 0, middle_offset = 0, right_offset = 0;
+    getDescendantLikelihoods( left,   p_left,   left_rows,   left_offset );
+    getDescendantLikelihoods( middle, p_middle, middle_rows, middle_offset );
+    getDescendantLikelihoods( right,  p_right,  right_rows,  right_offset );
+
+    // the number of threads among which we split the sites
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+
+    // the transition probabilities with rows padded to the size of the state dimension
+    std::vector<double> tp_padded;
 
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
         // the transition probability matrix for this mixture category
-        const double*    tp_begin                = this->transition_prob_matrices[mixture].theMatrix;
+        PhyloCTMCKernels::padTransitionProbabilities( this->transition_prob_matrices[mixture].theMatrix, this->num_chars, this->siteOffset, false, tp_padded );
 
         // get the pointers to the likelihood for this mixture category
-        size_t offset = mixture*this->mixtureOffset;
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_middle   = p_middle + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
-        // compute the per site probabilities
-        for (size_t site = 0; site < this->pattern_block_size ; ++site)
+        double*         p_mixture           = p_node   + mixture*this->mixtureOffset;
+        const double*   p_mixture_left      = p_left   + mixture*left_offset;
+        const double*   p_mixture_middle    = p_middle + mixture*middle_offset;
+        const double*   p_mixture_right     = p_right  + mixture*right_offset;
+
+        // each thread computes a contiguous range of sites
+#       pragma omp parallel for schedule(static,1) num_threads(num_threads) if(num_threads > 1)
+        for (int thread = 0; thread < num_threads; ++thread)
         {
+            size_t site_begin = (this->pattern_block_size * thread) / num_threads;
+            size_t site_end   = (this->pattern_block_size * (thread+1)) / num_threads;
 
-            // get the pointers for this mixture category and this site
-            const double*       tp_a    = tp_begin;
-            // iterate over the possible starting states
-            for (size_t c1 = 0; c1 < this->num_chars; ++c1)
-            {
-                // temporary variable
-                double sum = 0.0;
-
-                // iterate over all possible terminal states
-                for (size_t c2 = 0; c2 < this->num_chars; ++c2 )
-                {
-                    sum += p_site_mixture_left[c2] * p_site_mixture_middle[c2] * p_site_mixture_right[c2] * tp_a[c2];
-
-                } // end-for over all distination character
-
-                // store the likelihood for this starting state
-                p_site_mixture[c1] = sum;
-
-                // increment the pointers to the next starting state
-                tp_a+=this->num_chars;
-
-            } // end-for over all initial characters
-
-            // increment the pointers to the next site
-            p_site_mixture_left+=this->siteOffset; p_site_mixture_middle+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
+            PhyloCTMCKernels::computeInternalNodeLikelihood( &tp_padded[0], p_mixture_left, left_rows, p_mixture_middle, middle_rows, p_mixture_right, right_rows, p_mixture, this->num_chars, this->siteOffset, site_begin, site_end );
 
-        } // end-for over all sites (=patterns)
+        } // end-for over all threads
 
     } // end-for over all mixtures (=rate-categories)
 
@@ -336,14 +511,26 @@ template<class charType>
 void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeTipLikelihood(const TopologyNode &node, size_t node_index)
 {
 
+    // compute the transition probabilities
+    this->updateTransitionProbabilities( node_index, node.getBranchLength() );
+
+    // with tip state tables we only need one row per observed state instead of one per site
+    if ( usesTipStateTables() == true )
+    {
+        computeTipStateTable( node_index );
+        return;
+    }
+
     double* p_node = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
 
     const std::vector<bool> &gap_node = this->gap_matrix[node_index];
-    const std::vector<unsigned long> &char_node = this->char_matrix[node_index];
     const std::vector<RbBitSet> &amb_char_node = this->ambiguous_char_matrix[node_index];
 
-    // compute the transition probabilities
-    this->updateTransitionProbabilities( node_index, node.getBranchLength() );
+    // the number of threads among which we split the sites
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+
+    // the transposed transition probabilities, i.e., row i holds the probabilities of all starting states to end in state i
+    std::vector<double> tp_padded;
 
     double*   p_mixture      = p_node;
 
@@ -351,115 +538,94 @@ void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::computeTipLikelihood(cons
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
         // the transition probability matrix for this mixture category
-        const double*                       tp_begin    = this->transition_prob_matrices[mixture].theMatrix;
-
-        // get the pointer to the likelihoods for this site and mixture category
-        double*     p_site_mixture      = p_mixture;
+        PhyloCTMCKernels::padTransitionProbabilities( this->transition_prob_matrices[mixture].theMatrix, this->num_chars, this->siteOffset, true, tp_padded );
+        const double*                       tp_begin    = &tp_padded[0];
 
         // iterate over all sites
-        for (size_t site = 0; site != this->pattern_block_size; ++site)
+#       pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads > 1)
+        for (size_t site = 0; site < this->pattern_block_size; ++site)
         {
+            // get the pointer to the likelihoods for this site and mixture category
+            double*     p_site_mixture      = p_mixture + site*this->siteOffset;
 
             // is this site a gap?
             if ( gap_node[site] )
             {
                 // since this is a gap we need to assume that the actual state could have been any state
+                std::fill(p_site_mixture, p_site_mixture + this->num_chars, 1.0);
 
-                // iterate over all initial states for the transitions
-                for (size_t c1 = 0; c1 < this->num_chars; ++c1)
-                {
-
-                    // store the likelihood
-                    p_site_mixture[c1] = 1.0;
+                // the padded states are never possible
+                std::fill(p_site_mixture + this->num_chars, p_site_mixture + this->siteOffset, 0.0);
 
-                }
             }
-            else // we have observed a character
+            else
             {
+                // compute the likelihood that we had a transition from each state to the observed state
+                // note, the observed state could be ambiguous!
+                const RbBitSet &val = amb_char_node[site];
+                std::vector< double > weights = this->value->getCharacter(node_index, site).getWeights();
 
-                // iterate over all possible initial states
-                for (size_t c1 = 0; c1 < this->num_chars; ++c1)
+                std::fill(p_site_mixture, p_site_mixture + this->siteOffset, 0.0);
+                for ( size_t i=0; i<val.size(); ++i )
                 {
-
-                    if ( this->using_ambiguous_characters == true && this->using_weighted_characters == false)
+                    // check whether we observed this state
+                    if ( val.isSet(i) == true )
                     {
-                        // compute the likelihood that we had a transition from state c1 to the observed state org_val
-                        // note, the observed state could be ambiguous!
-                        const RbBitSet &val = amb_char_node[site];
-
-                        // get the pointer to the transition probabilities for the terminal states
-                        const double* d  = tp_begin+(this->num_chars*c1);
+                        // get the pointer to the transition probabilities to end in this state
+                        const double* d  = tp_begin + i*this->siteOffset;
+                        double        w  = weights[i];
 
-                        double tmp = 0.0;
-
-                        for( size_t i=0; i<val.size(); ++i )
+                        // add the probability
+                        for (size_t c1 = 0; c1 < this->siteOffset; ++c1)
                         {
-                            // check whether we observed this state
-                            if ( val.isSet(i) == true )
-                            {
-                                // add the probability
-                                tmp += *d;
-                            }
+                            p_site_mixture[c1] += d[c1] * w;
+                        }
+                    }
 
-                            // increment the pointer to the next transition probability
-                            ++d;
-                        } // end-while over all observed states for this character
+                } // end-for over all observed states for this character
 
-                        // store the likelihood
-                        p_site_mixture[c1] = tmp;
+            } // end-if a gap state
 
-                    }
-                    else if ( this->using_weighted_characters == true )
-                    {
-                      // compute the likelihood that we had a transition from state c1 to the observed state org_val
-                      // note, the observed state could be ambiguous!
-                      const RbBitSet &val = amb_char_node[site];
-
-                      // get the pointer to the transition probabilities for the terminal states
-                      const double* d  = tp_begin+(this->num_chars*c1);
-
-                      double tmp = 0.0;
-                      std::vector< double > weights = this->value->getCharacter(node_index, site).getWeights();
-                      for( size_t i=0; i<val.size(); ++i )
-                      {
-                          // check whether we observed this state
-                          if ( val.isSet(i) == true )
-                          {
-                              // add the probability
-                              tmp += *d * weights[i] ;
-                          }
-
-                          // increment the pointer to the next transition probability
-                          ++d;
-                      } // end-while over all observed states for this character
-
-                      // store the likelihood
-                      p_site_mixture[c1] = tmp;
+        } // end-for over all sites/patterns in the sequence
 
-                    }
-                    else // no ambiguous characters in use
-                    {
-                        unsigned long org_val = char_node[site];
+        // increment the pointers to next mixture category
+        p_mixture+=this->mixtureOffset;
 
-                        // store the likelihood
-                        p_site_mixture[c1] = tp_begin[c1*this->num_chars+org_val];
+    } // end-for over all mixture categories
 
-                    }
+}
 
-                } // end-for over all possible initial character for the branch
 
-            } // end-if a gap state
+/**
+ * Rescale the likelihoods of a tip.
+ * The tip state tables hold transition probabilities, which cannot underflow, so we do not rescale them.
+ */
+template<class charType>
+void RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::scale( size_t node_index )
+{
 
-            // increment the pointers to next site
-            p_site_mixture+=this->siteOffset;
+    if ( usesTipStateTables() == false )
+    {
+        AbstractPhyloCTMCSiteHomogeneous<charType>::scale( node_index );
+    }
+    else if ( RbSettings::userSettings().getUseScaling() == true )
+    {
+        std::vector<double> &log_scaling_factors = this->perNodeSiteLogScalingFactors[this->activeLikelihood[node_index]][node_index];
+        std::fill(log_scaling_factors.begin(), log_scaling_factors.end(), 0.0);
+    }
 
-        } // end-for over all sites/patterns in the sequence
+}
 
-        // increment the pointers to next mixture category
-        p_mixture+=this->mixtureOffset;
 
-    } // end-for over all mixture categories
+/**
+ * Do we compute the tips as tip state tables?
+ * Weighted characters have a different observation at each site and are stored per site.
+ */
+template<class charType>
+bool RevBayesCore::PhyloCTMCSiteHomogeneous<charType>::usesTipStateTables( void ) const
+{
 
+    return use_tip_state_tables == true && this->using_weighted_characters == false;
 }
 
 
@@ -4,6 +4,12 @@
 RevBayesCore::PhyloCTMCSiteHomogeneousDollo::PhyloCTMCSiteHomogeneousDollo(const TypedDagNode<Tree> *t, size_t nc, bool c, size_t nSites, bool amb, DolloAscertainmentBias::Coding ty, bool norm) :
     PhyloCTMCSiteHomogeneousConditional<StandardState>(  t, nc, c, nSites, amb, AscertainmentBias::Coding(ty)), dim(nc), integrationFactors(0), normalize(norm)
 {
+    // the Dollo model stores additional entries per site and computes all tip likelihoods itself
+    use_tip_state_tables = false;
+
+    // the Dollo model computes its own transition probabilities (see updateTransitionProbabilities)
+    batch_transition_probabilities = false;
+
     massNodeOffset = this->num_site_mixtures*numCorrectionMasks;
     activeMassOffset = this->num_nodes*massNodeOffset;
     perMaskMixtureCorrections = std::vector<double>(2*activeMassOffset, 0.0);
@@ -101,28 +101,30 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeRootLike
           double*   p_mixture          = p;
     const double*   p_mixture_left     = p_left;
     const double*   p_mixture_right    = p_right;
+    
+    // the number of threads among which we split the sites
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+    
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
         // get the root frequencies
         const std::vector<double> &f = ff[mixture % ff.size()];
 
-        // get pointers to the likelihood for this mixture category
-              double*   p_site_mixture          = p_mixture;
-        const double*   p_site_mixture_left     = p_mixture_left;
-        const double*   p_site_mixture_right    = p_mixture_right;
         // iterate over all sites
+#       pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads > 1)
         for (size_t site = 0; site < this->pattern_block_size; ++site)
         {
+            // get pointers to the likelihood for this mixture category and site
+                  double*   p_site_mixture          = p_mixture       + site*this->siteOffset;
+            const double*   p_site_mixture_left     = p_mixture_left  + site*this->siteOffset;
+            const double*   p_site_mixture_right    = p_mixture_right + site*this->siteOffset;
             
             p_site_mixture[0] = p_site_mixture_left[0] * p_site_mixture_right[0] * f[0];
             p_site_mixture[1] = p_site_mixture_left[1] * p_site_mixture_right[1] * f[1];
             p_site_mixture[2] = p_site_mixture_left[2] * p_site_mixture_right[2] * f[2];
             p_site_mixture[3] = p_site_mixture_left[3] * p_site_mixture_right[3] * f[3];
             
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset;
-            
         } // end-for over all sites (=patterns)
         
         // increment the pointers to the next mixture category
@@ -154,28 +156,30 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeRootLike
     const double*   p_mixture_left     = p_left;
     const double*   p_mixture_right    = p_right;
     const double*   p_mixture_middle   = p_middle;
+    
+    // the number of threads among which we split the sites
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+    
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
         // get the root frequencies
         const std::vector<double> &f = ff[mixture % ff.size()];
 
-        // get pointers to the likelihood for this mixture category
-              double*   p_site_mixture          = p_mixture;
-        const double*   p_site_mixture_left     = p_mixture_left;
-        const double*   p_site_mixture_right    = p_mixture_right;
-        const double*   p_site_mixture_middle   = p_mixture_middle;
         // iterate over all sites
+#       pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads > 1)
         for (size_t site = 0; site < this->pattern_block_size; ++site)
-        {   
+        {
+            // get pointers to the likelihood for this mixture category and site
+                  double*   p_site_mixture          = p_mixture        + site*this->siteOffset;
+            const double*   p_site_mixture_left     = p_mixture_left   + site*this->siteOffset;
+            const double*   p_site_mixture_right    = p_mixture_right  + site*this->siteOffset;
+            const double*   p_site_mixture_middle   = p_mixture_middle + site*this->siteOffset;
             p_site_mixture[0] = p_site_mixture_left[0] * p_site_mixture_right[0] * p_site_mixture_middle[0] * f[0];
             p_site_mixture[1] = p_site_mixture_left[1] * p_site_mixture_right[1] * p_site_mixture_middle[1] * f[1];
             p_site_mixture[2] = p_site_mixture_left[2] * p_site_mixture_right[2] * p_site_mixture_middle[2] * f[2];
             p_site_mixture[3] = p_site_mixture_left[3] * p_site_mixture_right[3] * p_site_mixture_middle[3] * f[3];
             
-            // increment the pointers to the next site
-            p_site_mixture+=this->siteOffset; p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture_middle+=this->siteOffset;
-            
         } // end-for over all sites (=patterns)
         
         // increment the pointers to the next mixture category
@@ -207,12 +211,6 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeInternal
     double* p_left   = this->partialLikelihoods + this->activeLikelihood[left]*this->activeLikelihoodOffset + left*this->nodeOffset;
     double* p_right  = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
     double* p_node   = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
-
-    double* tmp_ac = new double[4];
-    double* tmp_gt = new double[4];
-//    double tmp_ac[4];
-//    double tmp_gt[4];
-    
     
 #   else
 
@@ -223,6 +221,9 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeInternal
 
 #   endif
     
+    // the number of threads among which we split the sites
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+    
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
@@ -234,9 +235,9 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeInternal
         
 #       if defined ( SSE_ENABLED )
         
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
+        double*          p_mixture               = p_node + offset;
+        const double*    p_mixture_left          = p_left + offset;
+        const double*    p_mixture_right         = p_right + offset;
         
         __m128d tp_a_ac = _mm_load_pd(tp_begin);
         __m128d tp_a_gt = _mm_load_pd(tp_begin+2);
@@ -249,9 +250,9 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeInternal
         
 #       elif defined ( AVX_ENABLED )
         
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
+        double*          p_mixture               = p_node + offset;
+        const double*    p_mixture_left          = p_left + offset;
+        const double*    p_mixture_right         = p_right + offset;
         
         __m256d tp_a = _mm256_load_pd(tp_begin);
         __m256d tp_c = _mm256_load_pd(tp_begin+4);
@@ -260,15 +261,20 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeInternal
         
 #       else
 
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
+        double*          p_mixture               = p_node + offset;
+        const double*    p_mixture_left          = p_left + offset;
+        const double*    p_mixture_right         = p_right + offset;
 
 #       endif
 
         // compute the per site probabilities
+#       pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads > 1)
         for (size_t site = 0; site < this->pattern_block_size ; ++site)
         {
+            // get the pointers to the likelihoods for this site
+            double*          p_site_mixture          = p_mixture       + site*this->siteOffset;
+            const double*    p_site_mixture_left     = p_mixture_left  + site*this->siteOffset;
+            const double*    p_site_mixture_right    = p_mixture_right + site*this->siteOffset;
             
 #           if defined ( SSE_ENABLED )
             
@@ -319,8 +325,11 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeInternal
             __m256d gt   = _mm256_hadd_pd(g_acgt,t_acgt);
             
             
-            _mm256_store_pd(tmp_ac,ac);
-            _mm256_store_pd(tmp_gt,gt);
+            // temporary per site storage, so that threads do not share it
+            double tmp_ac[4];
+            double tmp_gt[4];
+            _mm256_storeu_pd(tmp_ac,ac);
+            _mm256_storeu_pd(tmp_gt,gt);
             
             p_site_mixture[0] = tmp_ac[0] + tmp_ac[2];
             p_site_mixture[1] = tmp_ac[1] + tmp_ac[3];
@@ -363,19 +372,10 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeInternal
             p_site_mixture[3] = sum;
 
 #           endif
-            
-            // increment the pointers to the next site
-            p_site_mixture_left+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
-
                         
         } // end-for over all sites (=patterns)
         
     } // end-for over all mixtures (=rate-categories)
-
-# if defined ( AVX_ENABLED )
-    delete[] tmp_ac;
-    delete[] tmp_gt;
-# endif
     
 }
 
@@ -394,6 +394,9 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeInternal
     const double*   p_right     = this->partialLikelihoods + this->activeLikelihood[right]*this->activeLikelihoodOffset + right*this->nodeOffset;
     double*         p_node      = this->partialLikelihoods + this->activeLikelihood[node_index]*this->activeLikelihoodOffset + node_index*this->nodeOffset;
     
+    // the number of threads among which we split the sites
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+    
     // iterate over all mixture categories
     for (size_t mixture = 0; mixture < this->num_site_mixtures; ++mixture)
     {
@@ -405,10 +408,10 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeInternal
         
 #       if defined ( SSE_ENABLED )
         
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_middle   = p_middle + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
+        double*          p_mixture               = p_node + offset;
+        const double*    p_mixture_left          = p_left + offset;
+        const double*    p_mixture_middle        = p_middle + offset;
+        const double*    p_mixture_right         = p_right + offset;
         
         __m128d tp_a_ac = _mm_load_pd(tp_begin);
         __m128d tp_a_gt = _mm_load_pd(tp_begin+2);
@@ -421,9 +424,10 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeInternal
         
 #       elif defined ( AVX_ENABLED )
         
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
+        double*          p_mixture               = p_node + offset;
+        const double*    p_mixture_left          = p_left + offset;
+        const double*    p_mixture_middle        = p_middle + offset;
+        const double*    p_mixture_right         = p_right + offset;
         
         __m256d tp_a = _mm256_load_pd(tp_begin);
         __m256d tp_c = _mm256_load_pd(tp_begin+4);
@@ -432,16 +436,22 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeInternal
         
 #       else
         
-        double*          p_site_mixture          = p_node + offset;
-        const double*    p_site_mixture_left     = p_left + offset;
-        const double*    p_site_mixture_middle   = p_middle + offset;
-        const double*    p_site_mixture_right    = p_right + offset;
+        double*          p_mixture               = p_node + offset;
+        const double*    p_mixture_left          = p_left + offset;
+        const double*    p_mixture_middle        = p_middle + offset;
+        const double*    p_mixture_right         = p_right + offset;
         
 #       endif
         
         // compute the per site probabilities
+#       pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads > 1)
         for (size_t site = 0; site < this->pattern_block_size ; ++site)
         {
+            // get the pointers to the likelihoods for this site
+            double*          p_site_mixture          = p_mixture        + site*this->siteOffset;
+            const double*    p_site_mixture_left     = p_mixture_left   + site*this->siteOffset;
+            const double*    p_site_mixture_middle   = p_mixture_middle + site*this->siteOffset;
+            const double*    p_site_mixture_right    = p_mixture_right  + site*this->siteOffset;
             
 #           if defined ( SSE_ENABLED )
             
@@ -540,10 +550,6 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeInternal
             
 #           endif
             
-            // increment the pointers to the next site
-            p_site_mixture_left+=this->siteOffset; p_site_mixture_middle+=this->siteOffset; p_site_mixture_right+=this->siteOffset; p_site_mixture+=this->siteOffset;
-            
-            
         } // end-for over all sites (=patterns)
         
     } // end-for over all mixtures (=rate-categories)
@@ -564,6 +570,9 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeTipLikel
     // compute the transition probabilities
     this->updateTransitionProbabilities( node_index, node.getBranchLength() );
     
+    // the number of threads among which we split the sites
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+    
     double*   p_mixture      = p_node;
     
     // iterate over all mixture categories
@@ -572,12 +581,12 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeTipLikel
         // the transition probability matrix for this mixture category
         const double*       tp_begin    = this->transition_prob_matrices[mixture].theMatrix;
         
-        // get the pointer to the likelihoods for this site and mixture category
-        double*     p_site_mixture      = p_mixture;
-        
         // iterate over all sites
+#       pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads > 1)
         for (size_t site = 0; site < this->pattern_block_size; ++site)
         {
+            // get the pointer to the likelihoods for this site and mixture category
+            double*     p_site_mixture      = p_mixture + site*this->siteOffset;
             
             // is this site a gap?
             if ( gap_node[site] ) 
@@ -656,10 +665,6 @@ void RevBayesCore::PhyloCTMCSiteHomogeneousNucleotide<charType>::computeTipLikel
                 
             } // end-if a gap state
             
-            
-            // increment the pointers to next site
-            p_site_mixture+=this->siteOffset; 
-            
         } // end-for over all sites/patterns in the sequence
         
         // increment the pointers to next mixture category
@@ -5,6 +5,8 @@
 #include "Tree.h"
 #include "TraceTree.h"
 
+#include <cmath>
+
 using namespace RevBayesCore;
 
 
@@ -12,28 +14,29 @@ using namespace RevBayesCore;
 EmpiricalTreeDistribution::EmpiricalTreeDistribution(const TraceTree &t, int b) : TypedDistribution<Tree>( new Tree() ),
     probability( 0.0 ),
     burnin( b ),
-    trace( t )
+    trace( t ),
+    use_tree_file( false ),
+    num_trees( t.size() )
 {
-    // make sure burnin is proper
-    if (trace.size() <= burnin)
-    {
-        throw RbException("Burnin size is too large for the trace.");
-    }
-    
-    if (burnin == -1)
-    {
-        burnin = trace.size() / 4;
-    }
-    else
-    {
-        burnin = (size_t)(b);
-    }
     
-    // all the trees have the same probability
-    probability = 1 / (double)(trace.size() - burnin);
+    initialize( b );
+}
+
+
+/**
+ * Constructor from an indexed tree file.
+ * Only the index of the file is held in memory, and a tree is only read when it is drawn.
+ */
+EmpiricalTreeDistribution::EmpiricalTreeDistribution(const IndexedTreeFile &f, int b) : TypedDistribution<Tree>( new Tree() ),
+    probability( 0.0 ),
+    burnin( b ),
+    trace( f.isClock() ),
+    tree_file( f ),
+    use_tree_file( true ),
+    num_trees( f.size() )
+{
     
-    // draw the first value
-    redrawValue();
+    initialize( b );
 }
 
 
@@ -50,15 +53,51 @@ EmpiricalTreeDistribution* EmpiricalTreeDistribution::clone( void ) const
 }
 
 
+/**
+ * Get a copy of the i-th tree, which the caller owns.
+ * The trees of the trace are decoded directly into the copy.
+ */
+Tree* EmpiricalTreeDistribution::getTree( size_t i ) const
+{
+    
+    return use_tree_file == true ? new Tree( tree_file.getTree( i ) ) : trace.getCompactTrace().getTree( i );
+}
+
+
+void EmpiricalTreeDistribution::initialize( int b )
+{
+    
+    // make sure burnin is proper
+    if (b == -1)
+    {
+        burnin = num_trees / 4;
+    }
+    else if (b < 0 || num_trees <= size_t(b))
+    {
+        throw RbException("Burnin size is too large for the trace.");
+    }
+    else
+    {
+        burnin = (size_t)(b);
+    }
+    
+    // all the trees have the same probability
+    probability = 1 / (double)(num_trees - burnin);
+    
+    // draw the first value
+    redrawValue();
+}
+
+
 void EmpiricalTreeDistribution::redrawValue( void )
 {
     
     // draw a random tree
     RandomNumberGenerator* rng = GLOBAL_RNG;
-    size_t total_tree_samples = trace.size();
-    current_tree_index = (size_t)( rng->uniform01() * (total_tree_samples - burnin) + burnin - 1 );
+    size_t total_tree_samples = num_trees;
+    current_tree_index = burnin + (size_t)( rng->uniform01() * (total_tree_samples - burnin) );
     
-    Tree *psi = new Tree( trace.objectAt(current_tree_index) );
+    Tree *psi = getTree( current_tree_index );
     
     delete this->value;
     this->value = psi;
@@ -79,7 +118,7 @@ void EmpiricalTreeDistribution::setCurrentTree( size_t index )
     
     current_tree_index = index;
     
-    Tree *psi = new Tree( trace.objectAt(current_tree_index) );
+    Tree *psi = getTree( current_tree_index );
     
     delete this->value;
     this->value = psi;
@@ -2,7 +2,8 @@
  * @file
  * This file contains the declaration and implementation
  * of the EmpiricalTreeDistribution class. The distribution 
- * is constructed from an input tree trace.
+ * is constructed from an input tree trace, or from an indexed tree file
+ * of which only the drawn trees are read.
  * 
  *
  * @brief Declaration and implementation of the EmpiricalTreeDistribution class
@@ -18,6 +19,7 @@
 #define EmpiricalTreeDistribution_H
 
 
+#include "IndexedTreeFile.h"
 #include "Sample.h"
 #include "TypedDistribution.h"
 #include "Tree.h"
@@ -30,6 +32,7 @@ namespace RevBayesCore {
     public:
 		
 		EmpiricalTreeDistribution(const TraceTree &t, int b );
+		EmpiricalTreeDistribution(const IndexedTreeFile &f, int b );
 		
 		virtual                                             ~EmpiricalTreeDistribution(void); 
 
@@ -45,10 +48,16 @@ namespace RevBayesCore {
 		
 	private:
 		
+		Tree*                                               getTree(size_t i) const;                                    //!< Get a copy of the i-th tree of the trace or file
+		void                                                initialize(int b);
+		
 		double                                              probability;
 		size_t                                              burnin;
 		size_t                                              current_tree_index;
 		TraceTree                                           trace;
+		IndexedTreeFile                                     tree_file;
+		bool                                                use_tree_file;                                              //!< Do we read the trees from the file instead of the trace?
+		size_t                                              num_trees;
 		
 	};
 
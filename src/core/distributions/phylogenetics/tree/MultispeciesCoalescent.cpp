@@ -20,7 +20,14 @@ MultispeciesCoalescent::MultispeciesCoalescent(const TypedDagNode<Tree> *sp,
     Nes( NULL ),
     Ne( new ConstantNode<double>("Ne", new double(1.0) ) ),
     num_taxa( taxa.size() ),
-    log_tree_topology_prob (0.0)
+    log_tree_topology_prob (0.0),
+    tip_mapping_dirty( true ),
+    species_tips_touched( false ),
+    gene_tree_fits_species_tree( true ),
+    coalescent_intervals_dirty( true ),
+    coalescent_intervals_touched( false ),
+    stored_gene_tree_fits_species_tree( true ),
+    stored_coalescent_intervals_dirty( true )
 {
     // add the parameters to our set (in the base class)
     // in that way other class can easily access the set of our parameters
@@ -136,219 +143,266 @@ MultispeciesCoalescent* MultispeciesCoalescent::clone( void ) const
 }
 
 
+/**
+ * Compute the probability of the gene tree given the species tree.
+ * Every coalescent event in a species branch with j lineages contributes log(theta) - j(j-1)/2 * theta * t for the waiting time t,
+ * and the final interval of a non-root branch with k lineages contributes -k(k-1)/2 * theta * t.
+ * Hence, we only need the number of coalescent events and the sum of the weighted waiting times per species branch,
+ * which are recomputed only if the gene tree or the species tree has changed.
+ */
 double MultispeciesCoalescent::computeLnProbability( void )
 {
     
-    // variable declarations and initialization
+    if ( coalescent_intervals_dirty == true )
+    {
+        computeCoalescentIntervals();
+    }
+    
+    if ( gene_tree_fits_species_tree == false )
+    {
+        // some coalescent event happens between lineages of different species tree branches
+        return RbConstants::Double::neginf;
+    }
+    
     double lnProbCoal = 0;
+    for (size_t i = 0; i < num_coalescences.size(); ++i)
+    {
+        double theta = 1.0 / getNe( i );
+        lnProbCoal += num_coalescences[i] * log( theta ) - theta * coalescent_intervals[i];
+    }
     
-    const Tree &sp = species_tree->getValue();
+    return lnProbCoal; // + logTreeTopologyProb;
     
-    const std::vector< TopologyNode* > &speciesTreeNodes = sp.getNodes();
-    // first let's create a map from species names to the nodes of the species tree
-    std::map<std::string, TopologyNode * > speciesNames2speciesNodes;
-    for (std::vector< TopologyNode *>::const_iterator it = speciesTreeNodes.begin(); it != speciesTreeNodes.end(); ++it)
+}
+
+
+/**
+ * Compute the number of coalescent events and the sum of the waiting times weighted by the number of pairs of lineages for every species tree branch.
+ * First, we assign each coalescent event of the gene tree to the species branch in which it happens,
+ * and then we traverse the species tree from the tips to the root, so that we know the number of lineages entering each branch.
+ */
+void MultispeciesCoalescent::computeCoalescentIntervals( void )
+{
+    
+    // check if the tips of the species tree are still the same
+    if ( species_tips_touched == true && tip_mapping_dirty == false )
     {
-        if ( (*it)->isTip() )
+        const Tree &sp = species_tree->getValue();
+        size_t num_species = sp.getNumberOfTips();
+        tip_mapping_dirty = ( num_species != species_tip_names.size() );
+        for (size_t i = 0; i < num_species && tip_mapping_dirty == false; ++i)
         {
-            const std::string &name = (*it)->getName();
-            speciesNames2speciesNodes[name] = *it;
+            tip_mapping_dirty = ( sp.getTipNode( i ).getName() != species_tip_names[i] );
         }
     }
+    species_tips_touched = false;
     
+    if ( tip_mapping_dirty == true )
+    {
+        mapTipsToSpecies();
+    }
     
-    // create a map from individual name to the actual tip node for convenience
-    std::map< std::string, TopologyNode*> individualNames2geneTreeTips;
-    for ( size_t i = 0; i < num_taxa; ++i)
+    const Tree &sp = species_tree->getValue();
+    const std::vector<TopologyNode*> &species_tree_nodes = sp.getNodes();
+    size_t num_species_nodes = species_tree_nodes.size();
+    
+    species_parents.resize( num_species_nodes );
+    species_ages.resize( num_species_nodes );
+    for (std::vector<TopologyNode*>::const_iterator it = species_tree_nodes.begin(); it != species_tree_nodes.end(); ++it)
     {
-        TopologyNode *tip = &value->getTipNode( i );
-        individualNames2geneTreeTips[ tip->getName() ] = tip;
+        size_t index = (*it)->getIndex();
+        species_parents[index] = ( (*it)->isRoot() ? RbConstants::Size_t::inf : (*it)->getParent().getIndex() );
+        species_ages[index] = (*it)->getAge();
     }
     
+    num_tip_lineages.assign( num_species_nodes, 0 );
+    for (size_t i = 0; i < num_taxa; ++i)
+    {
+        ++num_tip_lineages[ tip_species[i] ];
+    }
     
-    std::map< const TopologyNode *, std::set< TopologyNode* > > individualsPerBranch;
+    // assign the coalescent events to the species branches
+    coalescent_events.clear();
+    gene_tree_fits_species_tree = ( recursivelyAssignSpeciesBranch( value->getRoot() ) != RbConstants::Size_t::inf );
+    coalescent_intervals_dirty = false;
     
-    for (std::vector< Taxon >::iterator it = taxa.begin(); it != taxa.end(); ++it)
+    num_coalescences.assign( num_species_nodes, 0 );
+    coalescent_intervals.assign( num_species_nodes, 0.0 );
+    if ( gene_tree_fits_species_tree == false )
+    {
+        return;
+    }
+    
+    // sort the events by species branch and age
+    std::sort( coalescent_events.begin(), coalescent_events.end() );
+    event_offsets.assign( num_species_nodes + 1, 0 );
+    for (size_t i = 0; i < coalescent_events.size(); ++i)
+    {
+        ++event_offsets[ coalescent_events[i].first + 1 ];
+    }
+    for (size_t i = 0; i < num_species_nodes; ++i)
+    {
+        event_offsets[i+1] += event_offsets[i];
+    }
+    
+    recursivelyComputeCoalescentIntervals( sp.getRoot() );
+    
+}
+
+
+double  MultispeciesCoalescent::getNe(size_t index) const
+{
+    
+    if (Ne != NULL)
+    {
+        return Ne->getValue();
+    }
+    else if (Nes != NULL)
     {
-        const std::string &tipName = it->getName();
-        TopologyNode *n = individualNames2geneTreeTips[tipName];
-        const std::string &speciesName = it->getSpeciesName();
-        TopologyNode *speciesNode = speciesNames2speciesNodes[speciesName];
-        std::set< TopologyNode * > &nodesAtNode = individualsPerBranch[ speciesNode ];
-        nodesAtNode.insert( n );
+        return Nes->getValue()[index];
     }
+    else
+    {
+        std::cerr << "Error: Null Pointers for Ne and Nes." << std::endl;
+        exit(-1);
+    }
+}
+
 
-    /*
-    for (std::map<std::string,std::string>::iterator it = gene2species.begin(); it != gene2species.end(); ++it)
+void MultispeciesCoalescent::keepSpecialization( DagNode *affecter )
+{
+    
+    coalescent_intervals_touched = false;
+    
+}
+
+
+/**
+ * Map the tips of the gene tree to the indices of the tips of the species tree.
+ * We only use the names here, so that the likelihood computation only needs the indices.
+ */
+void MultispeciesCoalescent::mapTipsToSpecies( void )
+{
+    
+    const Tree &sp = species_tree->getValue();
+    size_t num_species = sp.getNumberOfTips();
+    
+    std::map<std::string, size_t> species_names_2_indices;
+    species_tip_names.resize( num_species );
+    for (size_t i = 0; i < num_species; ++i)
     {
-        const std::string &tipName = it->first;
-        TopologyNode *n = individualNames2geneTreeTips[tipName];
-        const std::string &speciesName = it->second;
-        TopologyNode *speciesNode = speciesNames2speciesNodes[speciesName];
-        std::set< TopologyNode * > &nodesAtNode = individualsPerBranch[ speciesNode ];
-        nodesAtNode.insert( n );
+        const TopologyNode &tip = sp.getTipNode( i );
+        species_tip_names[i] = tip.getName();
+        species_names_2_indices[ tip.getName() ] = tip.getIndex();
     }
-    */
-    std::map<double, TopologyNode*> speciesAge2speciesNodes;
-    double i = -0.01;
-    for (std::vector<TopologyNode *>::const_iterator it = speciesTreeNodes.begin(); it != speciesTreeNodes.end(); ++it)
+    
+    std::map<std::string, size_t> individual_names_2_species;
+    for (std::vector<Taxon>::const_iterator it = taxa.begin(); it != taxa.end(); ++it)
     {
-        if ( (*it)->isTip() )
+        std::map<std::string, size_t>::const_iterator species = species_names_2_indices.find( it->getSpeciesName() );
+        if ( species == species_names_2_indices.end() )
         {
-            speciesAge2speciesNodes[ i ] = (*it);
-            i -= 0.01;
+            throw RbException("Cannot match the taxon '" + it->getName() + "' to a tip in the species tree. The taxon map is probably wrong.");
         }
-        else
+        individual_names_2_species[ it->getName() ] = species->second;
+    }
+    
+    tip_species.resize( num_taxa );
+    for (size_t i = 0; i < num_taxa; ++i)
+    {
+        const TopologyNode &tip = value->getTipNode( i );
+        std::map<std::string, size_t>::const_iterator species = individual_names_2_species.find( tip.getName() );
+        if ( species == individual_names_2_species.end() )
         {
-            speciesAge2speciesNodes[ (*it)->getAge() ] = (*it);
+            throw RbException("Cannot find the taxon '" + tip.getName() + "' of the gene tree in the taxon map.");
         }
+        tip_species[ tip.getIndex() ] = species->second;
     }
     
-    // we loop over the nodes of the species tree in phylogenetic traversal
-    for (std::map<double, TopologyNode *>::const_iterator it = speciesAge2speciesNodes.begin(); it != speciesAge2speciesNodes.end(); ++it)
-    {
-        TopologyNode *spNode = it->second;
-        const TopologyNode *spParentNode = NULL;
-        double speciesAge = spNode->getAge();
-        double parentSpeciesAge = RbConstants::Double::inf;
-//        double branchLength = RbConstants::Double::inf;
-        if ( !spNode->isRoot() )
+    tip_mapping_dirty = false;
+    
+}
+
+
+/**
+ * Get the species branch in which the coalescent event at this node happens and store the event.
+ * The lineages of the children start in the branches of the children and move to the parent species whenever the event is older than the speciation.
+ * If the lineages are not in the same species branch at the time of the event, then the gene tree does not fit the species tree and we return Size_t::inf.
+ */
+size_t MultispeciesCoalescent::recursivelyAssignSpeciesBranch( const TopologyNode &node )
+{
+    
+    if ( node.isTip() == true )
+    {
+        return tip_species[ node.getIndex() ];
+    }
+    
+    double age = node.getAge();
+    size_t branch = RbConstants::Size_t::inf;
+    for (size_t i = 0; i < node.getNumberOfChildren(); ++i)
+    {
+        size_t child_branch = recursivelyAssignSpeciesBranch( node.getChild( i ) );
+        if ( child_branch == RbConstants::Size_t::inf )
         {
-            spParentNode = &spNode->getParent();
-            parentSpeciesAge = spParentNode->getAge();
-//            branchLength = parentSpeciesAge - speciesAge;
+            return RbConstants::Size_t::inf;
         }
         
-        // create a local copy of the individuals per branch
-        std::set<TopologyNode*> remainingIndividuals = individualsPerBranch[spNode];
-        
-        // get all coalescent events among the individuals
-        std::set<double> coalTimes;
-        
-        
-        std::map<double, TopologyNode *> coalTimes2coalNodes;
-        for ( std::set<TopologyNode*>::iterator remNode = remainingIndividuals.begin(); remNode != remainingIndividuals.end(); ++remNode)
+        while ( species_parents[child_branch] != RbConstants::Size_t::inf && species_ages[ species_parents[child_branch] ] <= age )
         {
-            TopologyNode *rn = (*remNode);
-            if ( !rn->isRoot() )
-            {
-                TopologyNode &parent = rn->getParent();
-                double parentAge = parent.getAge();
-                coalTimes2coalNodes[ parentAge ] = &parent;
-            }
+            child_branch = species_parents[child_branch];
         }
         
-        double currentTime = speciesAge;
-        while ( currentTime < parentSpeciesAge && coalTimes2coalNodes.size() > 0 )
-        {
-            
-            TopologyNode *parent = coalTimes2coalNodes.begin()->second;
-            double parentAge = parent->getAge();
-			double branchNe = getNe(spNode->getIndex());
-			double theta = 1.0 / branchNe;
-            
-            if ( parentAge < parentSpeciesAge )
-            { //Coalescence in the species tree branch
-                
-                // get the left and right child of the parent
-                TopologyNode *left = &parent->getChild( 0 );
-                TopologyNode *right = &parent->getChild( 1 );
-                if ( remainingIndividuals.find( left ) == remainingIndividuals.end() || remainingIndividuals.find( right ) == remainingIndividuals.end() )
-                {
-                    // one of the children does not belong to this species tree branch
-                    return RbConstants::Double::neginf;
-                }
-                
-				//We remove the coalescent event and the coalesced lineages
-                coalTimes2coalNodes.erase( coalTimes2coalNodes.begin() );
-                remainingIndividuals.erase( remainingIndividuals.find( left ) );
-                remainingIndividuals.erase( remainingIndividuals.find( right ) );
-                
-				//We insert the parent in the vector of lineages in this branch
-                remainingIndividuals.insert( parent );
-                if ( !parent->isRoot() )
-                {
-                    TopologyNode *grandParent = &parent->getParent();
-                    coalTimes2coalNodes[ grandParent->getAge() ] = grandParent;
-                }
-                
-				//a is the time between the previous and the current coalescences
-                double a = parentAge - currentTime;
-                currentTime = parentAge;
-                
-                // now we do the computation
-                
-                // get the number j of individuals we had before the current coalescence
-                size_t j = remainingIndividuals.size() + 1;
-                // compute the number of pairs: pairs = C(j choose 2) = j * (j-1.0) / 2.0
-                double nPairs = j * (j-1.0) / 2.0;
-                double lambda = nPairs * theta;
-                
-                // add the density for this coalescent event
-                //lnProbCoal += log( lambda ) - lambda * a;
-				//Corrected version:
-                lnProbCoal += log( theta ) - lambda * a;
-				
-                
-                
-            } //End if coalescence in the species tree branch
-            else
-            { //No more coalescences in this species tree branch
-                
-                // compute the probability of no coalescent event in the final part of the branch
-                // only do this if the branch is not the root branch
-                if ( spParentNode != NULL )
-                {
-                    double finalInterval = parentSpeciesAge - currentTime;
-                    size_t k = remainingIndividuals.size();
-                    lnProbCoal -= k*(k-1.0)/2.0 * finalInterval * theta;
-                }
-                
-                // jump out of the while loop
-//                currentTime = speciesAge;
-                break;
-            }
-            
-            
-        } // end of while loop
-        
-        
-        // merge the two sets of individuals that go into the next species
-        if ( spParentNode != NULL )
+        if ( i > 0 && child_branch != branch )
         {
-            std::set<TopologyNode *> &incomingLineages = individualsPerBranch[spParentNode];
-            incomingLineages.insert( remainingIndividuals.begin(), remainingIndividuals.end());
+            // one of the children does not belong to this species tree branch
+            return RbConstants::Size_t::inf;
         }
-        
-        
-    } // end loop over all nodes in the species tree (in phylogenetic ordering)
-    
+        branch = child_branch;
+    }
     
-    return lnProbCoal; // + logTreeTopologyProb;
+    coalescent_events.push_back( std::pair<size_t, double>( branch, age ) );
     
+    return branch;
 }
 
 
-double  MultispeciesCoalescent::getNe(size_t index) const
+/**
+ * Compute the number of coalescent events and the weighted sum of the waiting times of the branch of this species tree node.
+ * The lineages entering the branch are the gene tree tips of the species or the lineages leaving the children's branches.
+ */
+size_t MultispeciesCoalescent::recursivelyComputeCoalescentIntervals( const TopologyNode &species_node )
 {
     
-    if (Ne != NULL)
+    size_t index = species_node.getIndex();
+    size_t k = num_tip_lineages[index];
+    for (size_t i = 0; i < species_node.getNumberOfChildren(); ++i)
     {
-        return Ne->getValue();
+        k += recursivelyComputeCoalescentIntervals( species_node.getChild( i ) );
     }
-    else if (Nes != NULL)
+    
+    double current_time = species_ages[index];
+    double weighted_time = 0.0;
+    for (size_t i = event_offsets[index]; i < event_offsets[index+1]; ++i)
     {
-        return Nes->getValue()[index];
+        double age = coalescent_events[i].second;
+        weighted_time += k * (k-1.0) / 2.0 * (age - current_time);
+        current_time = age;
+        --k;
     }
-    else
+    
+    // the probability of no coalescent event in the final part of the branch, only if the branch is not the root branch
+    if ( species_parents[index] != RbConstants::Size_t::inf )
     {
-        std::cerr << "Error: Null Pointers for Ne and Nes." << std::endl;
-        exit(-1);
+        weighted_time += k * (k-1.0) / 2.0 * (species_ages[ species_parents[index] ] - current_time);
     }
+    
+    num_coalescences[index] = event_offsets[index+1] - event_offsets[index];
+    coalescent_intervals[index] = weighted_time;
+    
+    return k;
 }
 
 
-
 void MultispeciesCoalescent::redrawValue( void )
 {
     
@@ -356,6 +410,29 @@ void MultispeciesCoalescent::redrawValue( void )
     
 }
 
+
+void MultispeciesCoalescent::restoreSpecialization( DagNode *restorer )
+{
+    
+    // restore the summaries of the coalescent intervals
+    if ( coalescent_intervals_touched == true )
+    {
+        num_coalescences.swap( stored_num_coalescences );
+        coalescent_intervals.swap( stored_coalescent_intervals );
+        gene_tree_fits_species_tree = stored_gene_tree_fits_species_tree;
+        coalescent_intervals_dirty = stored_coalescent_intervals_dirty;
+        
+        coalescent_intervals_touched = false;
+    }
+    
+    // the tips of the restored species tree might differ from those of the last mapping
+    if ( restorer == species_tree )
+    {
+        species_tips_touched = true;
+    }
+    
+}
+
 void MultispeciesCoalescent::setNes(TypedDagNode< RbVector<double> >* input_nes)
 {
 
@@ -383,6 +460,18 @@ void MultispeciesCoalescent::setNe(TypedDagNode<double>* input_ne)
 }
 
 
+void MultispeciesCoalescent::setValue(Tree *v, bool force)
+{
+    
+    // delegate to the parent class
+    TypedDistribution<Tree>::setValue(v, force);
+    
+    tip_mapping_dirty = true;
+    coalescent_intervals_dirty = true;
+    
+}
+
+
 
 
 void MultispeciesCoalescent::simulateTree( void )
@@ -526,6 +615,9 @@ void MultispeciesCoalescent::simulateTree( void )
     // finally store the new value
     value = psi;
     
+    tip_mapping_dirty = true;
+    coalescent_intervals_dirty = true;
+    
 }
 
 
@@ -549,3 +641,36 @@ void MultispeciesCoalescent::swapParameterInternal(const DagNode *oldP, const Da
     }
     
 }
+
+
+/**
+ * A parameter or the gene tree itself has changed.
+ * A new population size does not change the coalescent intervals, but any other change of the species tree or the gene tree does.
+ */
+void MultispeciesCoalescent::touchSpecialization( DagNode *toucher, bool touchAll )
+{
+    
+    if ( toucher != NULL && ( toucher == Ne || toucher == Nes ) )
+    {
+        return;
+    }
+    
+    if ( toucher == species_tree )
+    {
+        species_tips_touched = true;
+    }
+    
+    // store the current summaries once per move
+    if ( coalescent_intervals_touched == false )
+    {
+        stored_num_coalescences = num_coalescences;
+        stored_coalescent_intervals = coalescent_intervals;
+        stored_gene_tree_fits_species_tree = gene_tree_fits_species_tree;
+        stored_coalescent_intervals_dirty = coalescent_intervals_dirty;
+        
+        coalescent_intervals_touched = true;
+    }
+    
+    coalescent_intervals_dirty = true;
+    
+}
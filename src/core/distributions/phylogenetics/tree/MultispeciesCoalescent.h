@@ -10,6 +10,16 @@ namespace RevBayesCore {
     
     class Clade;
     
+    /**
+     * The multispecies coalescent process with constant population sizes per species tree branch.
+     *
+     * The probability of the gene tree only depends on the effective population size of a species branch
+     * through the number of coalescent events in the branch and the sum of the waiting times weighted by the number of pairs of lineages.
+     * We cache these summaries of the coalescent intervals for all species branches and only compute them again if the gene tree or the species tree has changed,
+     * so that a new population size only costs a sum over the species branches.
+     * The tips of the gene tree are mapped to the tips of the species tree by index once when the gene tree is set,
+     * and the mapping is only checked again when the tips of the species tree have changed.
+     */
     class MultispeciesCoalescent : public TypedDistribution<Tree> {
         
     public:
@@ -22,10 +32,14 @@ namespace RevBayesCore {
         void                                                redrawValue(void);
         void                                                setNes(TypedDagNode<RbVector<double> >* inputNes);
         void                                                setNe(TypedDagNode<double>* inputNe);
+        void                                                setValue(Tree *v, bool f=false);                                                    //!< Set the current value, e.g. attach an observation (clamp)
 
     protected:
         // Parameter management functions
+        void                                                keepSpecialization(DagNode* affecter);
+        void                                                restoreSpecialization(DagNode *restorer);
         void                                                swapParameterInternal(const DagNode *oldP, const DagNode *newP);            //!< Swap a parameter
+        void                                                touchSpecialization(DagNode *toucher, bool touchAll);
         
     private:
         
@@ -34,6 +48,10 @@ namespace RevBayesCore {
         // helper functions
         void                                                attachTimes(Tree *psi, std::vector<TopologyNode *> &tips, size_t index, const std::vector<double> &times);
         void                                                buildRandomBinaryTree(std::vector<TopologyNode *> &tips);
+        void                                                computeCoalescentIntervals(void);                                                   //!< Compute the summaries of the coalescent intervals of all species branches
+        void                                                mapTipsToSpecies(void);                                                             //!< Map the tips of the gene tree to the tips of the species tree
+        size_t                                              recursivelyAssignSpeciesBranch(const TopologyNode &node);                           //!< Find the species branch of the coalescent event at this node
+        size_t                                              recursivelyComputeCoalescentIntervals(const TopologyNode &species_node);            //!< Summarize the intervals of this species branch and return the number of lineages leaving it
         void                                                simulateTree(void);
         
         // members
@@ -44,6 +62,30 @@ namespace RevBayesCore {
         size_t                                              num_taxa;
         double                                              log_tree_topology_prob;
         
+        // the mapping of the tips of the gene tree to the species tree
+        std::vector<size_t>                                 tip_species;                                                                        //!< The index of the species tip of each tip of the gene tree
+        std::vector<std::string>                            species_tip_names;                                                                  //!< The names of the species tips when we built the mapping
+        bool                                                tip_mapping_dirty;                                                                  //!< Does the mapping need to be built again, e.g., for a new gene tree?
+        bool                                                species_tips_touched;                                                               //!< Has the species tree changed, so that we need to check its tips?
+        
+        // the summaries of the coalescent intervals per species branch (indexed by the species tree node)
+        std::vector<size_t>                                 num_coalescences;                                                                   //!< The number of coalescent events in the branch
+        std::vector<double>                                 coalescent_intervals;                                                               //!< The sum of the waiting times weighted by the number of pairs of lineages
+        bool                                                gene_tree_fits_species_tree;                                                        //!< Do all coalescent events happen between lineages of the same species branch?
+        bool                                                coalescent_intervals_dirty;                                                         //!< Do we need to compute the summaries again?
+        bool                                                coalescent_intervals_touched;                                                       //!< Have the summaries been stored in this move?
+        std::vector<size_t>                                 stored_num_coalescences;
+        std::vector<double>                                 stored_coalescent_intervals;
+        bool                                                stored_gene_tree_fits_species_tree;
+        bool                                                stored_coalescent_intervals_dirty;
+        
+        // work space for computing the summaries
+        std::vector<size_t>                                 species_parents;                                                                    //!< The parent of each species tree node (Size_t::inf for the root)
+        std::vector<double>                                 species_ages;
+        std::vector<size_t>                                 num_tip_lineages;                                                                   //!< The number of gene tree tips of each species tip
+        std::vector<std::pair<size_t, double> >             coalescent_events;                                                                  //!< The species branch and age of each coalescent event
+        std::vector<size_t>                                 event_offsets;                                                                      //!< The first event of each species branch in the sorted events
+        
     };
     
 }
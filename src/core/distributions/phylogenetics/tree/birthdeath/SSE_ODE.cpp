@@ -8,20 +8,48 @@ using namespace RevBayesCore;
 
 SSE_ODE::SSE_ODE( const std::vector<double> &m, const RateGenerator* q, double r, bool backward_time, bool extinction_only ) :
     mu( m ),
+    lambda( std::vector<double>(m.size(), 0.0) ),
     num_states( q->getNumberOfStates() ),
-    Q( q ),
-    rate( r ),
+    anagenetic_rates( std::vector<double>(q->getNumberOfStates()*q->getNumberOfStates(), 0.0) ),
+    no_event_rates( std::vector<double>(q->getNumberOfStates(), 0.0) ),
+    extinction_probabilities( NULL ),
+    extinction_derivatives( NULL ),
+    grid_dt( 0.0 ),
     extinction_only( extinction_only ),
+    use_speciation_from_event_map( false ),
     backward_time( backward_time )
 {
-    
+
+    // copy the anagenetic rates into a dense matrix
+    // backward in time we need the rates out of state i and forward in time the rates into state i
+    double age = 0.0;
+    for (size_t i = 0; i < num_states; ++i)
+    {
+        for (size_t j = 0; j < num_states; ++j)
+        {
+            if ( i != j )
+            {
+                if ( backward_time == true )
+                {
+                    anagenetic_rates[i*num_states+j] = q->getRate(i, j, age, r);
+                }
+                else
+                {
+                    anagenetic_rates[i*num_states+j] = q->getRate(j, i, age, r);
+                }
+            }
+        }
+    }
+
+    updateNoEventRates();
+
 }
 
 
-void SSE_ODE::operator()(const state_type &x, state_type &dxdt, const double t)
+void SSE_ODE::operator()(const state_type &x, state_type &dxdt, const double t) const
 {
     // ClaSSE equations A1 and A2 from Goldberg and Igic, 2012
-    
+
     // catch negative extinction probabilities that can result from
     // rounding errors in the ODE stepper
     state_type safe_x = x;
@@ -29,165 +57,239 @@ void SSE_ODE::operator()(const state_type &x, state_type &dxdt, const double t)
     {
         safe_x[i] = ( x[i] < 0.0 ? 0.0 : x[i] );
     }
-    
-    double age = 0.0;
-    for (size_t i = 0; i < num_states; ++i)
+
+    const double *r = &anagenetic_rates[0];
+    const double *e = &safe_x[0];
+    const double *d = &safe_x[num_states];
+
+    // the extinction probabilities are given by the grid
+    bool integrate_extinction = ( extinction_probabilities == NULL );
+    if ( integrate_extinction == false )
     {
-        
-        // calculate sum of speciation rates
-        // lambda_ijk for all possible values of j and k
-        double lambda_sum = 0.0;
-        
-        if ( use_speciation_from_event_map == true )
-        {
-            std::map<std::vector<unsigned>, double>::iterator it;
-            for (it = event_map.begin(); it != event_map.end(); it++)
-            {
-                const std::vector<unsigned>& states = it->first;
-                double curr_lambda = it->second;
-            
-                if (i == states[0])
-                {
-                    lambda_sum += curr_lambda;
-                }
-            }
-        }
-        else
-        {
-            lambda_sum = lambda[i];
-        }
-        
-        /**** Extinction ****/
-        /**** equation A2 ***/
-        
-        // extinction event
-        dxdt[i] = mu[i];
-        
-        // no event
-        double no_event_rate = mu[i] + lambda_sum;
-        for (size_t j = 0; j < num_states; ++j)
+        interpolateExtinctionProbabilities( t, &safe_x[0] );
+    }
+
+    /**** Extinction ****/
+    /**** equation A2 ***/
+
+    if ( integrate_extinction == true )
+    {
+        for (size_t i = 0; i < num_states; ++i)
         {
-            if ( i != j )
+            // extinction event and no event
+            double dx = mu[i] - no_event_rates[i] * e[i];
+
+            // anagenetic state change
+            const double *r_i = r + i*num_states;
+            for (size_t j = 0; j < num_states; ++j)
             {
-                if ( backward_time == true )
-                {
-                    no_event_rate += Q->getRate(i, j, age, rate);
-                }
-                else
-                {
-                    no_event_rate += Q->getRate(j, i, age, rate);
-                }
+                dx += r_i[j] * e[j];
             }
+            dxdt[i] = dx;
         }
-        
-        dxdt[i] -= no_event_rate * safe_x[i];
-        
+
         // speciation event
         if ( use_speciation_from_event_map == true )
         {
-            std::map<std::vector<unsigned>, double>::iterator it;
-            for (it = event_map.begin(); it != event_map.end(); it++)
+            for (size_t k = 0; k < event_rates.size(); ++k)
             {
-                const std::vector<unsigned>& states = it->first;
-                double curr_lambda = it->second;
-                if (i == states[0])
-                {
-                    dxdt[i] += curr_lambda * safe_x[states[1]] * safe_x[states[2]];
-                }
+                dxdt[event_ancestors[k]] += event_rates[k] * e[event_daughters_1[k]] * e[event_daughters_2[k]];
             }
         }
         else
         {
-            dxdt[i] += lambda[i] * safe_x[i] * safe_x[i];
-        }
-        
-        // anagenetic state change
-        for (size_t j = 0; j < num_states; ++j)
-        {
-            if ( i != j )
+            for (size_t i = 0; i < num_states; ++i)
             {
-                if ( backward_time == true )
-                {
-                    dxdt[i] += Q->getRate(i, j, age, rate) * safe_x[j];
-                }
-                else
-                {
-                    dxdt[i] += Q->getRate(j, i, age, rate) * safe_x[j];
-                }
+                dxdt[i] += lambda[i] * e[i] * e[i];
             }
         }
 
         if ( backward_time == false )
         {
-            dxdt[i] = -dxdt[i];
+            for (size_t i = 0; i < num_states; ++i)
+            {
+                dxdt[i] = -dxdt[i];
+            }
+        }
+    }
+    else
+    {
+        // the extinction probabilities are interpolated and not integrated
+        for (size_t i = 0; i < num_states; ++i)
+        {
+            dxdt[i] = 0.0;
         }
-        
-        if ( extinction_only == false )
+    }
+
+    if ( extinction_only == false )
+    {
+        /**** Observation ****/
+        /**** equation A1 ****/
+
+        for (size_t i = 0; i < num_states; ++i)
         {
-            /**** Observation ****/
-            /**** equation A1 ****/
-        
             // no event
-            dxdt[i + num_states] = -no_event_rate * safe_x[i + num_states];
-            
-            // speciation event
-            if ( use_speciation_from_event_map == true )
+            double dx = -no_event_rates[i] * d[i];
+
+            // anagenetic state change
+            const double *r_i = r + i*num_states;
+            for (size_t j = 0; j < num_states; ++j)
             {
-                std::map<std::vector<unsigned>, double>::iterator it;
-                for (it = event_map.begin(); it != event_map.end(); it++)
-                {
-                    const std::vector<unsigned>& states = it->first;
-                    double lambda = it->second;
-                    if (i == states[0])
-                    {
-                        double term1 = safe_x[states[1] + num_states] * safe_x[states[2]];
-                        double term2 = safe_x[states[2] + num_states] * safe_x[states[1]];
-                        dxdt[i + num_states] += lambda * (term1 + term2 );
-                    }
-                }
+                dx += r_i[j] * d[j];
             }
-            else
+            dxdt[i + num_states] = dx;
+        }
+
+        // speciation event
+        if ( use_speciation_from_event_map == true )
+        {
+            for (size_t k = 0; k < event_rates.size(); ++k)
             {
-                dxdt[i + num_states] += 2 * lambda[i] * safe_x[i] * safe_x[i + num_states];
+                size_t j = event_daughters_1[k];
+                size_t l = event_daughters_2[k];
+                dxdt[event_ancestors[k] + num_states] += event_rates[k] * ( d[j] * e[l] + d[l] * e[j] );
             }
-        
-            // anagenetic state change
-            for (size_t j = 0; j < num_states; ++j)
+        }
+        else
+        {
+            for (size_t i = 0; i < num_states; ++i)
             {
-                if ( i != j )
-                {
-                    if ( backward_time == true )
-                    {
-                        dxdt[i + num_states] += Q->getRate(i, j, age, rate) * safe_x[j + num_states];
-                    }
-                    else
-                    {
-                        dxdt[i + num_states] += Q->getRate(j, i, age, rate) * safe_x[j + num_states];
-                    }
-                }
-                
+                dxdt[i + num_states] += 2 * lambda[i] * e[i] * d[i];
             }
-            
-        } // end if extinction_only
-        
-    } // end for num_states
-    
+        }
+
+    } // end if extinction_only
+    else
+    {
+        for (size_t i = 0; i < num_states; ++i)
+        {
+            dxdt[i + num_states] = 0.0;
+        }
+    }
+
+}
+
+
+/**
+ * Interpolate the extinction probabilities at age t by a cubic Hermite spline through the grid points.
+ * Ages beyond the grid are extrapolated from the last interval.
+ */
+void SSE_ODE::interpolateExtinctionProbabilities( double t, double *e ) const
+{
+
+    const std::vector<double> &values      = *extinction_probabilities;
+    const std::vector<double> &derivatives = *extinction_derivatives;
+
+    size_t num_points = values.size() / num_states;
+    double s = ( t < 0.0 ? 0.0 : t / grid_dt );
+    size_t k = size_t( s );
+    if ( k + 1 >= num_points )
+    {
+        k = ( num_points > 1 ? num_points - 2 : 0 );
+    }
+    s -= k;
+
+    // the Hermite basis functions
+    double s2  = s * s;
+    double s3  = s2 * s;
+    double h00 = 2*s3 - 3*s2 + 1;
+    double h10 = (s3 - 2*s2 + s) * grid_dt;
+    double h01 = -2*s3 + 3*s2;
+    double h11 = (s3 - s2) * grid_dt;
+
+    const double *e0  = &values[k*num_states];
+    const double *e1  = e0 + num_states;
+    const double *de0 = &derivatives[k*num_states];
+    const double *de1 = de0 + num_states;
+    for (size_t i = 0; i < num_states; ++i)
+    {
+        double v = h00 * e0[i] + h10 * de0[i] + h01 * e1[i] + h11 * de1[i];
+        e[i] = ( v < 0.0 ? 0.0 : v );
+    }
+
 }
 
 
 void SSE_ODE::setEventMap( const std::map<std::vector<unsigned>, double> &e )
 {
-    
+
     use_speciation_from_event_map = true;
-    event_map = e;
+
+    event_ancestors.clear();
+    event_daughters_1.clear();
+    event_daughters_2.clear();
+    event_rates.clear();
+
+    std::map<std::vector<unsigned>, double>::const_iterator it;
+    for (it = e.begin(); it != e.end(); ++it)
+    {
+        const std::vector<unsigned>& states = it->first;
+        event_ancestors.push_back( states[0] );
+        event_daughters_1.push_back( states[1] );
+        event_daughters_2.push_back( states[2] );
+        event_rates.push_back( it->second );
+    }
+
+    updateNoEventRates();
+
+}
+
+
+/**
+ * Use the extinction probabilities e and their derivatives de at the ages k*dt instead of integrating them.
+ * The vectors are not copied and need to stay valid while the ODE is integrated.
+ */
+void SSE_ODE::setExtinctionProbabilities( const std::vector<double> &e, const std::vector<double> &de, double dt )
+{
+
+    extinction_probabilities = &e;
+    extinction_derivatives = &de;
+    grid_dt = dt;
+
 }
 
 
 void SSE_ODE::setSpeciationRate( const std::vector<double> &s )
 {
-    
+
     use_speciation_from_event_map = false;
     lambda = s;
-    
+
+    updateNoEventRates();
+
 }
 
+
+/**
+ * Compute the total rate of leaving each state, i.e., the extinction, speciation and anagenetic rates.
+ */
+void SSE_ODE::updateNoEventRates( void )
+{
+
+    for (size_t i = 0; i < num_states; ++i)
+    {
+        double no_event_rate = mu[i];
+
+        if ( use_speciation_from_event_map == false )
+        {
+            no_event_rate += lambda[i];
+        }
+
+        const double *r_i = &anagenetic_rates[i*num_states];
+        for (size_t j = 0; j < num_states; ++j)
+        {
+            no_event_rate += r_i[j];
+        }
+
+        no_event_rates[i] = no_event_rate;
+    }
+
+    if ( use_speciation_from_event_map == true )
+    {
+        for (size_t k = 0; k < event_rates.size(); ++k)
+        {
+            no_event_rates[event_ancestors[k]] += event_rates[k];
+        }
+    }
+
+}
@@ -19,6 +19,15 @@ namespace RevBayesCore {
      * cladogenetic multi-rate birth-death process (ClaSSE: Goldberg and Igic, 2012)
      * Will Freyman 6/22/16
      *
+     * All rates are copied into fixed-layout arrays when the ODE is set up, i.e., the anagenetic rates
+     * into a dense matrix and the cladogenetic events into flat arrays, so that the right-hand side
+     * only consists of loops over contiguous arrays and does not call the rate generator.
+     * The right-hand side does not modify the ODE, so the same ODE can be shared by several threads.
+     *
+     * The extinction probabilities E(t) do not depend on the tree. If they are given on a grid of ages,
+     * then only the observation probabilities D(t) are integrated and E(t) is interpolated from the grid
+     * (cubic Hermite interpolation using the derivatives at the grid points).
+     *
      */
     class SSE_ODE {
         
@@ -26,19 +35,31 @@ namespace RevBayesCore {
         
         SSE_ODE( const std::vector<double> &m, const RateGenerator* q, double r, bool backward_time, bool extinction_only);
         
-        void operator() ( const state_type &x , state_type &dxdt , const double t );
+        void operator() ( const state_type &x , state_type &dxdt , const double t ) const;
         
+        void            interpolateExtinctionProbabilities( double t, double *e ) const;                            //!< Interpolate the extinction probabilities at age t from the grid
         void            setEventMap( const std::map<std::vector<unsigned>, double> &e );
+        void            setExtinctionProbabilities( const std::vector<double> &e, const std::vector<double> &de, double dt );
         void            setSpeciationRate( const std::vector<double> &s );
         
     private:
         
+        void            updateNoEventRates( void );
+        
         std::vector<double>                         mu;                                 //!< vector of extinction rates, one rate for each character state
         std::vector<double>                         lambda;                             //!< vector of speciation rates, one rate for each character state
         size_t                                      num_states;                         //!< the number of character states = q->getNumberOfStates()
-        const RateGenerator*                        Q;                                  //!< anagenetic rate matrix
-        std::map<std::vector<unsigned>, double>     event_map;                          //!< cladogenetic event map, with the structure pair< [ancestor_state, daughter_1_state, daughter_2_state], speciation_rate >
-        double                                      rate;                               //!< clock rate for anagenetic change
+        std::vector<double>                         anagenetic_rates;                   //!< dense anagenetic rates (i*num_states+j) in the direction of time, with zero diagonal
+        std::vector<double>                         no_event_rates;                     //!< total rate of leaving each state
+        std::vector<size_t>                         event_ancestors;                    //!< ancestor state of each cladogenetic event
+        std::vector<size_t>                         event_daughters_1;                  //!< first daughter state of each cladogenetic event
+        std::vector<size_t>                         event_daughters_2;                  //!< second daughter state of each cladogenetic event
+        std::vector<double>                         event_rates;                        //!< speciation rate of each cladogenetic event
+        
+        // the extinction probabilities on a grid of ages (optional)
+        const std::vector<double>*                  extinction_probabilities;           //!< E at the grid points (k*num_states+i), or NULL if E is integrated
+        const std::vector<double>*                  extinction_derivatives;             //!< dE/dt at the grid points
+        double                                      grid_dt;                            //!< the distance between the grid points
         
         // flags to modify behabior
         bool                                        extinction_only;                    //!< calculate only extinction probabilities
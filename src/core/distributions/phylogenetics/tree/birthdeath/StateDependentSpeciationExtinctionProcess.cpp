@@ -9,12 +9,15 @@
 #include "RandomNumberGenerator.h"
 #include "RbConstants.h"
 #include "RbMathCombinatorialFunctions.h"
+#include "RbSettings.h"
 #include "StandardState.h"
 #include "StochasticNode.h"
+#include "StringUtilities.h"
 #include "TopologyNode.h"
 
 #include <algorithm>
 #include <cmath>
+#include <exception>
 #include <boost/assign/list_of.hpp>
 #include <boost/numeric/odeint.hpp>
 
@@ -41,7 +44,12 @@ StateDependentSpeciationExtinctionProcess::StateDependentSpeciationExtinctionPro
     changed_nodes( std::vector<bool>(2*tn.size()-1, false) ),
     dirty_nodes( std::vector<bool>(2*tn.size()-1, true) ),
     partial_likelihoods( std::vector<std::vector<std::vector<double> > >(2*tn.size()-1, std::vector<std::vector<double> >(2,std::vector<double>(2*ext->getValue().size(),0))) ),
-    extinction_probabilities( std::vector<std::vector<double> >( 500.0, std::vector<double>( ext->getValue().size(), 0) ) ),
+    extinction_probabilities(),
+    extinction_derivatives(),
+    extinction_probabilities_dirty( true ),
+    extinction_probabilities_touched( false ),
+    stored_extinction_probabilities(),
+    stored_extinction_derivatives(),
     num_states( ext->getValue().size() ),
     scaling_factors( std::vector<std::vector<double> >(2*tn.size()-1, std::vector<double>(2,0.0) ) ),
     total_scaling( 0.0 ),
@@ -49,6 +57,7 @@ StateDependentSpeciationExtinctionProcess::StateDependentSpeciationExtinctionPro
     cladogenesis_matrix( NULL ),
     root_age( ra ),
     mu( ext ),
+    lambda( NULL ),
     pi( p ),
     Q( q ),
     rate( r ),
@@ -77,6 +86,23 @@ StateDependentSpeciationExtinctionProcess::StateDependentSpeciationExtinctionPro
     
     log_tree_topology_prob = (num_taxa - 1) * RbConstants::LN2 - lnFact ;
     
+    // we want to know which branches of the tree change
+    value->getTreeChangeEventHandler().addListener( this );
+    
+}
+
+
+/**
+ * Destructor. We need to stop listening to the tree, which is deleted by our base class.
+ */
+StateDependentSpeciationExtinctionProcess::~StateDependentSpeciationExtinctionProcess( void )
+{
+    
+    if ( value != NULL )
+    {
+        value->getTreeChangeEventHandler().removeListener( this );
+    }
+    
 }
 
 
@@ -100,6 +126,14 @@ StateDependentSpeciationExtinctionProcess* StateDependentSpeciationExtinctionPro
 double StateDependentSpeciationExtinctionProcess::computeLnProbability( void )
 {
     
+    // we need to check here if we still are listining to this tree for change events
+    // the tree could have been replaced (e.g., in a copy of this distribution) without telling us
+    if ( value->getTreeChangeEventHandler().isListening( this ) == false )
+    {
+        value->getTreeChangeEventHandler().addListener( this );
+        dirty_nodes = std::vector<bool>(value->getNumberOfNodes(), true);
+    }
+    
     // check that the ages are in correct chronological order
     // i.e., no child is older than its parent
     const std::vector<TopologyNode*>& nodes = value->getNodes();
@@ -161,13 +195,8 @@ double StateDependentSpeciationExtinctionProcess::computeLnProbability( void )
         }
     }
     
-    // mark all nodes as dirty
-    for (std::vector<TopologyNode*>::const_iterator it = c.begin(); it != c.end(); ++it)
-    {
-        const TopologyNode &the_node = *(*it);
-        dirty_nodes[the_node.getIndex()] = true;
-    }
-    
+    // the extinction probabilities are the same for all branches
+    computeExtinctionProbabilities();
     
     // variable declarations and initialization
     double lnProbTimes = 0;
@@ -178,9 +207,6 @@ double StateDependentSpeciationExtinctionProcess::computeLnProbability( void )
         lnProbTimes = - 2*log( pSurvival(0, ra) );
     }
     
-    // reset the total scaling
-    total_scaling = 0.0;
-    
     // multiply the probability of a descendant of the initial species
     lnProbTimes += computeRootLikelihood();
     
@@ -188,127 +214,166 @@ double StateDependentSpeciationExtinctionProcess::computeLnProbability( void )
 }
 
 
-void StateDependentSpeciationExtinctionProcess::computeNodeProbability(const RevBayesCore::TopologyNode &node, size_t node_index) const
+/**
+ * Integrate the extinction probabilities from the present up to the root age and store them and their derivatives on the grid of ages k*dt.
+ * The extinction probabilities do not depend on the tree, so we only integrate them again if the rates have changed.
+ * If the grid is still valid but the root is older than the grid, then we only extend the grid.
+ */
+void StateDependentSpeciationExtinctionProcess::computeExtinctionProbabilities( void ) const
 {
     
-    // check for recomputation
-//    if ( dirty_nodes[node_index] == true )
-    if ( true )
+    double max_age = value->getRoot().getAge();
+    size_t num_points = size_t( ceil( max_age / dt ) ) + 1;
+    if ( num_points < 2 )
     {
-        // mark as computed
-        dirty_nodes[node_index] = false;
+        num_points = 2;
+    }
+    
+    size_t first_point = 0;
+    if ( extinction_probabilities_dirty == false )
+    {
+        first_point = extinction_probabilities.size() / num_states;
+        if ( first_point >= num_points )
+        {
+            return;
+        }
+    }
+    
+    extinction_probabilities.resize( num_points * num_states );
+    extinction_derivatives.resize( num_points * num_states );
+    
+    SSE_ODE ode = createODE( true, true );
+    
+    double sampling_probability = rho->getValue();
+    state_type x = std::vector<double>(2 * num_states, 0);
+    state_type dxdt = std::vector<double>(2 * num_states, 0);
+    for (size_t i = 0; i < num_states; ++i)
+    {
+        x[i] = ( first_point == 0 ? 1.0 - sampling_probability : extinction_probabilities[(first_point-1)*num_states+i] );
+    }
+    
+    for (size_t k = first_point; k < num_points; ++k)
+    {
+        if ( k > 0 )
+        {
+            integrateODE( ode, x, (k-1) * dt, k * dt );
+        }
         
-        std::vector<double> node_likelihood = std::vector<double>(2 * num_states, 0);
-        if ( node.isTip() == true )
+        ode( x, dxdt, k * dt );
+        for (size_t i = 0; i < num_states; ++i)
         {
-            
-            // this is a tip node
-            double samplingProbability = rho->getValue();
-            const DiscreteCharacterState &state = static_cast<TreeDiscreteCharacterData*>( this->value )->getCharacterData().getTaxonData( node.getTaxon().getName() )[0];
-            const RbBitSet &obs_state = state.getState();
-            
-            for (size_t j = 0; j < num_states; ++j)
-            {
-                
-                node_likelihood[j] = 1.0 - samplingProbability;
-                
-                if ( obs_state.isSet( j ) == true || state.isMissingState() == true || state.isGapState() == true )
-                {
-                    node_likelihood[num_states+j] = samplingProbability;
-                }
-                else
-                {
-                    node_likelihood[num_states+j] = 0.0;
-                }
-            }
-            
+            extinction_probabilities[k*num_states+i] = x[i];
+            extinction_derivatives[k*num_states+i] = dxdt[i];
         }
-        else
+    }
+    
+    extinction_probabilities_dirty = false;
+    
+}
+
+
+/**
+ * Compute the likelihoods at the beginning of the branch above the node.
+ * The likelihoods of the children need to be computed already.
+ */
+void StateDependentSpeciationExtinctionProcess::computeNodeProbability(const RevBayesCore::TopologyNode &node, size_t node_index, const SSE_ODE &ode, const std::map<std::vector<unsigned>, double> &event_map, const std::vector<double> &speciation_rates, double sampling_probability) const
+{
+    
+    std::vector<double> node_likelihood = std::vector<double>(2 * num_states, 0);
+    if ( node.isTip() == true )
+    {
+        
+        // this is a tip node
+        const DiscreteCharacterState &state = static_cast<TreeDiscreteCharacterData*>( this->value )->getCharacterData().getTaxonData( node.getTaxon().getName() )[0];
+        const RbBitSet &obs_state = state.getState();
+        
+        for (size_t j = 0; j < num_states; ++j)
         {
             
-            // this is an internal node
-            const TopologyNode          &left           = node.getChild(0);
-            size_t                      left_index      = left.getIndex();
-            computeNodeProbability( left, left_index );
-            const TopologyNode          &right          = node.getChild(1);
-            size_t                      right_index     = right.getIndex();
-            computeNodeProbability( right, right_index );
+            node_likelihood[j] = 1.0 - sampling_probability;
             
-            // get the likelihoods of descendant nodes
-            const std::vector<double> &left_likelihoods  = partial_likelihoods[left_index][active_likelihood[left_index]];
-            const std::vector<double> &right_likelihoods = partial_likelihoods[right_index][active_likelihood[right_index]];
-
-            std::map<std::vector<unsigned>, double> eventMap;
-            std::vector<double> speciation_rates;
-            if ( use_cladogenetic_events == true )
+            if ( obs_state.isSet( j ) == true || state.isMissingState() == true || state.isGapState() == true )
             {
-                // get cladogenesis event map (sparse speciation rate matrix)
-                const DeterministicNode<MatrixReal>* cpn = static_cast<const DeterministicNode<MatrixReal>* >( cladogenesis_matrix );
-                const TypedFunction<MatrixReal>& tf = cpn->getFunction();
-                const AbstractCladogenicStateFunction* csf = dynamic_cast<const AbstractCladogenicStateFunction*>( &tf );
-                
-                eventMap = csf->getEventMap();
+                node_likelihood[num_states+j] = sampling_probability;
             }
             else
             {
-                speciation_rates = lambda->getValue();
-            }
-            
-            // merge descendant likelihoods
-            for (size_t i=0; i<num_states; ++i)
-            {
-                node_likelihood[i] = left_likelihoods[i];
-
-                if ( use_cladogenetic_events == true )
-                {
-                    
-                    double like_sum = 0.0;
-                    std::map<std::vector<unsigned>, double>::iterator it;
-                    for (it = eventMap.begin(); it != eventMap.end(); it++)
-                    {
-                        const std::vector<unsigned>& states = it->first;
-                        double speciation_rate = it->second;
-                        if (i == states[0])
-                        {
-                            double likelihoods = left_likelihoods[num_states + states[1]] * right_likelihoods[num_states + states[2]];
-                            like_sum += speciation_rate * likelihoods;
-                        }
-                    }
-                    node_likelihood[num_states + i] = like_sum;
-                    
-                }
-                else
-                {
-                    node_likelihood[num_states + i] = left_likelihoods[num_states + i] * right_likelihoods[num_states + i] * speciation_rates[i];
-                }
+                node_likelihood[num_states+j] = 0.0;
             }
         }
         
-        // calculate likelihood for this branch
-        double begin_age = node.getAge();
-        double end_age = node.getParent().getAge();
-        numericallyIntegrateProcess(node_likelihood, begin_age, end_age, true, false);
+    }
+    else
+    {
         
-        // rescale the states
-        double max = 0.0;
+        // this is an internal node
+        size_t left_index  = node.getChild(0).getIndex();
+        size_t right_index = node.getChild(1).getIndex();
+        
+        // get the likelihoods of descendant nodes
+        const std::vector<double> &left_likelihoods  = partial_likelihoods[left_index][active_likelihood[left_index]];
+        const std::vector<double> &right_likelihoods = partial_likelihoods[right_index][active_likelihood[right_index]];
+        
+        // merge descendant likelihoods
         for (size_t i=0; i<num_states; ++i)
         {
-            if ( node_likelihood[num_states+i] > max )
+            node_likelihood[i] = left_likelihoods[i];
+        }
+        
+        if ( use_cladogenetic_events == true )
+        {
+            std::map<std::vector<unsigned>, double>::const_iterator it;
+            for (it = event_map.begin(); it != event_map.end(); it++)
             {
-                max = node_likelihood[num_states+i];
+                const std::vector<unsigned>& states = it->first;
+                double speciation_rate = it->second;
+                double likelihoods = left_likelihoods[num_states + states[1]] * right_likelihoods[num_states + states[2]];
+                node_likelihood[num_states + states[0]] += speciation_rate * likelihoods;
             }
         }
-        for (size_t i=0; i<num_states; ++i)
+        else
         {
-            node_likelihood[num_states+i] /= max;
+            for (size_t i=0; i<num_states; ++i)
+            {
+                node_likelihood[num_states + i] = left_likelihoods[num_states + i] * right_likelihoods[num_states + i] * speciation_rates[i];
+            }
+        }
+    }
+    
+    // the extinction probabilities start at the tip reached through the first children, which need not be at the present.
+    // the ODE does not depend on the age, so we shift the branch by the age of this tip and use the same grid for all branches.
+    const TopologyNode *tip = &node;
+    while ( tip->isTip() == false )
+    {
+        tip = &tip->getChild(0);
+    }
+    double shift = tip->getAge();
+    
+    // calculate likelihood for this branch
+    double begin_age = node.getAge() - shift;
+    double end_age = node.getParent().getAge() - shift;
+    integrateODE(ode, node_likelihood, begin_age, end_age);
+    
+    // the extinction probabilities at the end of the branch are given by the grid
+    ode.interpolateExtinctionProbabilities( end_age, &node_likelihood[0] );
+    
+    // rescale the states
+    double max = 0.0;
+    for (size_t i=0; i<num_states; ++i)
+    {
+        if ( node_likelihood[num_states+i] > max )
+        {
+            max = node_likelihood[num_states+i];
         }
-        scaling_factors[node_index][active_likelihood[node_index]] = log(max);
-        total_scaling += scaling_factors[node_index][active_likelihood[node_index]] - scaling_factors[node_index][active_likelihood[node_index]^1];
-        
-        // store the likelihoods
-        partial_likelihoods[node_index][active_likelihood[node_index]] = node_likelihood;
-
     }
+    for (size_t i=0; i<num_states; ++i)
+    {
+        node_likelihood[num_states+i] /= max;
+    }
+    scaling_factors[node_index][active_likelihood[node_index]] = log(max);
+    
+    // store the likelihoods
+    partial_likelihoods[node_index][active_likelihood[node_index]] = node_likelihood;
     
 }
 
@@ -316,6 +381,11 @@ void StateDependentSpeciationExtinctionProcess::computeNodeProbability(const Rev
 double StateDependentSpeciationExtinctionProcess::computeRootLikelihood( void ) const
 {
     
+    // the ODE for the observation probabilities, with the extinction probabilities from the grid
+    SSE_ODE ode = createODE( true, false );
+    ode.setExtinctionProbabilities( extinction_probabilities, extinction_derivatives, dt );
+    double sampling_probability = rho->getValue();
+    
     std::map<std::vector<unsigned>, double> eventMap;
     std::vector<double> speciation_rates;
     if ( use_cladogenetic_events == true )
@@ -337,10 +407,73 @@ double StateDependentSpeciationExtinctionProcess::computeRootLikelihood( void )
     size_t                  node_index      = root.getIndex();
     const TopologyNode     &left            = root.getChild(0);
     size_t                  left_index      = left.getIndex();
-    computeNodeProbability( left, left_index );
     const TopologyNode     &right           = root.getChild(1);
     size_t                  right_index     = right.getIndex();
-    computeNodeProbability( right, right_index );
+    
+    // group the dirty branches by their height, because all branches of the same height are independent
+    std::vector<std::vector<const TopologyNode*> > branches;
+    recursivelyCollectBranches( left, branches );
+    recursivelyCollectBranches( right, branches );
+    
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+    for (size_t h = 0; h < branches.size(); ++h)
+    {
+        const std::vector<const TopologyNode*> &level = branches[h];
+        const int num_branches = int( level.size() );
+        
+        std::vector<std::string> errors = std::vector<std::string>(num_branches, "");
+        std::vector<char> failed = std::vector<char>(num_branches, false);
+#       pragma omp parallel for schedule(dynamic) num_threads(num_threads) if(num_threads > 1 && num_branches > 1)
+        for (int i = 0; i < num_branches; ++i)
+        {
+            try
+            {
+                computeNodeProbability( *level[i], level[i]->getIndex(), ode, eventMap, speciation_rates, sampling_probability );
+            }
+            catch (RbException &e)
+            {
+                errors[i] = e.getMessage();
+                failed[i] = true;
+            }
+            catch (std::exception &e)
+            {
+                errors[i] = e.what();
+                failed[i] = true;
+            }
+            catch (...)
+            {
+                errors[i] = "Unknown error in branch " + StringUtilities::toString( level[i]->getIndex() + 1 ) + ".";
+                failed[i] = true;
+            }
+        }
+        
+        for (int i = 0; i < num_branches; ++i)
+        {
+            if ( failed[i] == true )
+            {
+                throw RbException( "Could not integrate the branch likelihoods: " + errors[i] );
+            }
+        }
+        
+        // mark as computed
+        for (int i = 0; i < num_branches; ++i)
+        {
+            dirty_nodes[ level[i]->getIndex() ] = false;
+        }
+    }
+    dirty_nodes[node_index] = false;
+    
+    // sum up the scaling factors of all branches
+    total_scaling = 0.0;
+    const std::vector<TopologyNode*> &nodes = value->getNodes();
+    for (std::vector<TopologyNode*>::const_iterator it = nodes.begin(); it != nodes.end(); ++it)
+    {
+        if ( (*it)->isRoot() == false )
+        {
+            size_t index = (*it)->getIndex();
+            total_scaling += scaling_factors[index][active_likelihood[index]];
+        }
+    }
 
     // merge descendant likelihoods
     const std::vector<double> &left_likelihoods  = partial_likelihoods[left_index][active_likelihood[left_index]];
@@ -385,6 +518,37 @@ double StateDependentSpeciationExtinctionProcess::computeRootLikelihood( void )
     return log(prob) + total_scaling;
 }
 
+
+/**
+ * Create the ODE for the current extinction, speciation and anagenetic rates.
+ */
+SSE_ODE StateDependentSpeciationExtinctionProcess::createODE( bool backward_time, bool extinction_only ) const
+{
+    
+    const std::vector<double> &extinction_rates = mu->getValue();
+    SSE_ODE ode = SSE_ODE(extinction_rates, &Q->getValue(), rate->getValue(), backward_time, extinction_only);
+    if ( use_cladogenetic_events == true )
+    {
+        cladogenesis_matrix->getValue(); // we must call getValue() to update the speciation and extinction rates in the event map
+        
+        // get cladogenesis event map (sparse speciation rate matrix)
+        const DeterministicNode<MatrixReal>* cpn = static_cast<const DeterministicNode<MatrixReal>* >( cladogenesis_matrix );
+        const TypedFunction<MatrixReal>& tf = cpn->getFunction();
+        const AbstractCladogenicStateFunction* csf = dynamic_cast<const AbstractCladogenicStateFunction*>( &tf );
+        std::map<std::vector<unsigned>, double> event_map = csf->getEventMap();
+        
+        ode.setEventMap( event_map );
+    }
+    else
+    {
+        const std::vector<double> &speciation_rates = lambda->getValue();
+        ode.setSpeciationRate( speciation_rates );
+    }
+    
+    return ode;
+}
+
+
 const AbstractHomologousDiscreteCharacterData& StateDependentSpeciationExtinctionProcess::getCharacterData() const
 {
     return static_cast<TreeDiscreteCharacterData*>(this->value)->getCharacterData();
@@ -728,12 +892,26 @@ void StateDependentSpeciationExtinctionProcess::executeProcedure(const std::stri
         const AbstractHomologousDiscreteCharacterData& v = static_cast<const TypedDagNode<AbstractHomologousDiscreteCharacterData > *>( args[0] )->getValue();
         
         static_cast<TreeDiscreteCharacterData*>(this->value)->setCharacterData( v.clone() );
+        
+        // the likelihoods of all branches depend on the data at the tips
+        touchSpecialization( NULL, true );
     }
     
     return TypedDistribution<Tree>::executeProcedure( name, args, found );
 }
 
 
+/**
+ * The tree has changed, so we need to integrate the branch of this node and of all its ancestors again.
+ */
+void StateDependentSpeciationExtinctionProcess::fireTreeChangeEvent( const TopologyNode &n, const unsigned& m )
+{
+    
+    recursivelyFlagNodeDirty( n );
+    
+}
+
+
 /**
  * Get the affected nodes by a change of this node.
  * If the root age has changed than we need to call get affected again.
@@ -751,7 +929,7 @@ void StateDependentSpeciationExtinctionProcess::getAffected(RbOrderedSet<DagNode
 
 
 /**
- * Keep the current value and reset some internal flags. Nothing to do here.
+ * Keep the current value and reset some internal flags.
  */
 void StateDependentSpeciationExtinctionProcess::keepSpecialization(DagNode *affecter)
 {
@@ -761,6 +939,19 @@ void StateDependentSpeciationExtinctionProcess::keepSpecialization(DagNode *affe
         dag_node->keepAffected();
     }
     
+    // reset all flags
+    for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
+    {
+        (*it) = false;
+    }
+    
+    for (std::vector<bool>::iterator it = changed_nodes.begin(); it != changed_nodes.end(); ++it)
+    {
+        (*it) = false;
+    }
+    
+    extinction_probabilities_touched = false;
+    
 }
 
 
@@ -768,15 +959,26 @@ void StateDependentSpeciationExtinctionProcess::keepSpecialization(DagNode *affe
 double StateDependentSpeciationExtinctionProcess::pSurvival(double start, double end) const
 {
     
-    double samplingProbability = rho->getValue();
     state_type initial_state = std::vector<double>(2*num_states,0);
-    for (size_t i=0; i<num_states; ++i)
+    if ( start == 0.0 )
     {
-        initial_state[i] = 1.0 - samplingProbability;
-        initial_state[num_states + i] = samplingProbability;
+        // the extinction probabilities since the present are given by the grid
+        computeExtinctionProbabilities();
+        SSE_ODE ode = createODE( true, true );
+        ode.setExtinctionProbabilities( extinction_probabilities, extinction_derivatives, dt );
+        ode.interpolateExtinctionProbabilities( end, &initial_state[0] );
+    }
+    else
+    {
+        double samplingProbability = rho->getValue();
+        for (size_t i=0; i<num_states; ++i)
+        {
+            initial_state[i] = 1.0 - samplingProbability;
+            initial_state[num_states + i] = samplingProbability;
+        }
+        
+        numericallyIntegrateProcess(initial_state, start, end, true, false);
     }
-    
-    numericallyIntegrateProcess(initial_state, start, end, true, false);
     
     double prob = 0.0;
     const RbVector<double> &freqs = pi->getValue();
@@ -817,6 +1019,35 @@ void StateDependentSpeciationExtinctionProcess::restoreSpecialization(DagNode *a
         dag_node->restoreAffected();
     }
     
+    // reset the flags
+    for (std::vector<bool>::iterator it = dirty_nodes.begin(); it != dirty_nodes.end(); ++it)
+    {
+        (*it) = false;
+    }
+    
+    // restore the active likelihoods vector
+    for (size_t index = 0; index < changed_nodes.size(); ++index)
+    {
+        // we have to restore, that means if we have changed the active likelihood vector
+        // then we need to revert this change
+        if ( changed_nodes[index] == true )
+        {
+            active_likelihood[index] = (active_likelihood[index] == 0 ? 1 : 0);
+        }
+        
+        // set all flags to false
+        changed_nodes[index] = false;
+    }
+    
+    // restore the extinction probabilities
+    if ( extinction_probabilities_touched == true )
+    {
+        extinction_probabilities.swap( stored_extinction_probabilities );
+        extinction_derivatives.swap( stored_extinction_derivatives );
+        extinction_probabilities_dirty = extinction_probabilities.empty();
+        extinction_probabilities_touched = false;
+    }
+    
 }
 
 
@@ -873,6 +1104,9 @@ void StateDependentSpeciationExtinctionProcess::setNumberOfTimeSlices( double n
     NUM_TIME_SLICES = n;
     dt = root_age->getValue() / NUM_TIME_SLICES;
     
+    // the extinction probabilities are stored on the grid of the old time slices
+    extinction_probabilities_dirty = true;
+    
 }
 
 
@@ -887,6 +1121,9 @@ void StateDependentSpeciationExtinctionProcess::setValue(Tree *v, bool f )
     static_cast<TreeDiscreteCharacterData *>(this->value)->setTree( *v );
     delete v;
     
+    // we need to compute the likelihoods of all branches for the new tree
+    touchSpecialization( NULL, true );
+    
     
     if ( root_age != NULL )
     {
@@ -969,13 +1206,22 @@ void StateDependentSpeciationExtinctionProcess::swapParameterInternal(const DagN
 void StateDependentSpeciationExtinctionProcess::touchSpecialization(DagNode *affecter, bool touchAll)
 {
     
-    touchAll = true;
-    
     if ( affecter == root_age )
     {
+        // setting the age of the root flags the branches of its children
         value->getRoot().setAge( root_age->getValue() );
         dag_node->touchAffected();
     }
+    else if ( affecter == NULL || affecter == dag_node || affecter == pi )
+    {
+        // a change of the tree itself is signaled by the tree change events and the root frequencies only affect the root
+    }
+    else
+    {
+        // the rates and the sampling probability affect the extinction probabilities and all branches
+        touchExtinctionProbabilities();
+        touchAll = true;
+    }
     
     if ( touchAll )
     {
@@ -1000,37 +1246,119 @@ void StateDependentSpeciationExtinctionProcess::touchSpecialization(DagNode *aff
 
 
 /**
- * Wrapper function for the ODE time stepper function.
+ * The rates have changed, so we need to integrate the extinction probabilities again.
+ * We keep the current extinction probabilities in case the move is rejected.
  */
-void StateDependentSpeciationExtinctionProcess::numericallyIntegrateProcess(state_type &likelihoods, double begin_age, double end_age, bool backward_time, bool extinction_only) const
+void StateDependentSpeciationExtinctionProcess::touchExtinctionProbabilities( void )
 {
-    const std::vector<double> &extinction_rates = mu->getValue();
-    SSE_ODE ode = SSE_ODE(extinction_rates, &Q->getValue(), rate->getValue(), backward_time, extinction_only);
-    if ( use_cladogenetic_events == true )
+    
+    if ( extinction_probabilities_touched == false )
     {
-        cladogenesis_matrix->getValue(); // we must call getValue() to update the speciation and extinction rates in the event map
+        stored_extinction_probabilities.swap( extinction_probabilities );
+        stored_extinction_derivatives.swap( extinction_derivatives );
+        extinction_probabilities_touched = true;
         
-        // get cladogenesis event map (sparse speciation rate matrix)
-        const DeterministicNode<MatrixReal>* cpn = static_cast<const DeterministicNode<MatrixReal>* >( cladogenesis_matrix );
-        const TypedFunction<MatrixReal>& tf = cpn->getFunction();
-        const AbstractCladogenicStateFunction* csf = dynamic_cast<const AbstractCladogenicStateFunction*>( &tf );
-        std::map<std::vector<unsigned>, double> event_map = csf->getEventMap();
-        
-        ode.setEventMap( event_map );
-    }
-    else
-    {
-        const std::vector<double> &speciation_rates = lambda->getValue();
-        ode.setSpeciationRate( speciation_rates );
+        // there is nothing to restore if the extinction probabilities have not been computed for the current rates
+        if ( extinction_probabilities_dirty == true )
+        {
+            stored_extinction_probabilities.clear();
+            stored_extinction_derivatives.clear();
+        }
     }
+    
+    extinction_probabilities_dirty = true;
+    
+}
 
-    typedef boost::numeric::odeint::runge_kutta_dopri5< state_type > stepper_type;
-    boost::numeric::odeint::integrate_adaptive( make_controlled( 1E-7 , 1E-7 , stepper_type() ) , ode , likelihoods , begin_age , end_age , dt );
 
+/**
+ * Integrate the ODE from begin_age to end_age.
+ * The ODE is passed by reference, so that the same ODE can be used by several threads.
+ */
+void StateDependentSpeciationExtinctionProcess::integrateODE(const SSE_ODE &ode, state_type &likelihoods, double begin_age, double end_age) const
+{
+    
+    typedef boost::numeric::odeint::runge_kutta_dopri5< state_type > stepper_type;
+    boost::numeric::odeint::integrate_adaptive( make_controlled( 1E-7 , 1E-7 , stepper_type() ) , boost::cref( ode ) , likelihoods , begin_age , end_age , dt );
+    
     // catch negative extinction probabilities that can result from
     // rounding errors in the ODE stepper
     for (size_t i = 0; i < num_states; ++i)
     {
         likelihoods[i] = ( likelihoods[i] < 0.0 ? 0.0 : likelihoods[i] );
     }
+    
+}
+
+
+/**
+ * Wrapper function for the ODE time stepper function.
+ */
+void StateDependentSpeciationExtinctionProcess::numericallyIntegrateProcess(state_type &likelihoods, double begin_age, double end_age, bool backward_time, bool extinction_only) const
+{
+    
+    SSE_ODE ode = createODE( backward_time, extinction_only );
+    integrateODE( ode, likelihoods, begin_age, end_age );
+    
+}
+
+
+/**
+ * Collect the dirty branches below this node by their height, i.e., a branch is computed after all dirty branches below it.
+ * All ancestors of a dirty node are dirty too, so we do not need to look below clean nodes.
+ * Returns the number of heights used by the branches below and including this node.
+ */
+size_t StateDependentSpeciationExtinctionProcess::recursivelyCollectBranches(const TopologyNode &node, std::vector<std::vector<const TopologyNode*> > &branches) const
+{
+    
+    if ( dirty_nodes[node.getIndex()] == false )
+    {
+        return 0;
+    }
+    
+    size_t height = 0;
+    if ( node.isTip() == false )
+    {
+        size_t left_height  = recursivelyCollectBranches( node.getChild(0), branches );
+        size_t right_height = recursivelyCollectBranches( node.getChild(1), branches );
+        height = std::max( left_height, right_height );
+    }
+    
+    if ( branches.size() <= height )
+    {
+        branches.resize( height + 1 );
+    }
+    branches[height].push_back( &node );
+    
+    return height + 1;
+}
+
+
+void StateDependentSpeciationExtinctionProcess::recursivelyFlagNodeDirty( const TopologyNode &n )
+{
+    
+    // we need to flag this node and all ancestral nodes for recomputation
+    size_t index = n.getIndex();
+    
+    // if this node is already dirty, the also all the ancestral nodes must have been flagged as dirty
+    if ( dirty_nodes[index] == false )
+    {
+        // the root doesn't have an ancestor
+        if ( n.isRoot() == false )
+        {
+            recursivelyFlagNodeDirty( n.getParent() );
+        }
+        
+        // set the flag
+        dirty_nodes[index] = true;
+        
+        // if we previously haven't touched this node, then we need to change the active likelihood pointer
+        if ( changed_nodes[index] == false )
+        {
+            active_likelihood[index] = (active_likelihood[index] == 0 ? 1 : 0);
+            changed_nodes[index] = true;
+        }
+        
+    }
+    
 }
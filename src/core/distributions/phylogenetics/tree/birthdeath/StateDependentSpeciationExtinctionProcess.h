@@ -3,10 +3,12 @@
 
 #include "TreeDiscreteCharacterData.h"
 #include "CDCladoSE.h"
+#include "SSE_ODE.h"
 #include "MatrixReal.h"
 #include "RateMatrix.h"
 #include "Taxon.h"
 #include "Tree.h"
+#include "TreeChangeEventListener.h"
 #include "TypedDagNode.h"
 
 
@@ -23,8 +25,19 @@ namespace RevBayesCore {
      *
      * Will Freyman 6/22/16
      *
+     * The extinction probabilities E(t) do not depend on the tree, so we integrate them once per likelihood computation
+     * on a grid of ages with spacing root_age/NUM_TIME_SLICES and interpolate them along the branches
+     * (shifted by the age of the tip where the extinction probabilities of the branch start).
+     * Hence, only the observation probabilities D(t) are integrated per branch.
+     * Branches of the same height (the number of branches to the furthest tip) are independent
+     * and are integrated in parallel.
+     *
+     * The grid of extinction probabilities is kept until one of the rates or the sampling probability changes,
+     * and it is stored and restored with the move. We listen to the changes of the tree, so that after a move
+     * on the tree only the branches of the changed nodes and their ancestors are integrated again.
+     *
      */
-    class StateDependentSpeciationExtinctionProcess : public TypedDistribution<Tree> {
+    class StateDependentSpeciationExtinctionProcess : public TypedDistribution<Tree>, public TreeChangeEventListener {
         
     public:
         StateDependentSpeciationExtinctionProcess(const TypedDagNode<double> *root,
@@ -36,6 +49,8 @@ namespace RevBayesCore {
                                                  const std::string &cdt,
                                                  const std::vector<Taxon> &tn);
         
+        virtual                                            ~StateDependentSpeciationExtinctionProcess(void);                                                   //!< Virtual destructor
+        
         // pure virtual member functions
         virtual StateDependentSpeciationExtinctionProcess*  clone(void) const;                                                                                  //!< Create an independent clone
         
@@ -47,6 +62,7 @@ namespace RevBayesCore {
         void                                                setNumberOfTimeSlices(double n);                                                                    //!< Set the number of time slices for the numerical ODE.
         virtual void                                        setValue(Tree *v, bool f=false);                                                                    //!< Set the current value, e.g. attach an observation (clamp)
         
+        void                                                fireTreeChangeEvent(const TopologyNode &n, const unsigned& m=0);                                  //!< The tree has changed and we want to know which part.
         void                                                drawJointConditionalAncestralStates(std::vector<size_t>& startStates, std::vector<size_t>& endStates);
         void                                                recursivelyDrawJointConditionalAncestralStates(const TopologyNode &node, std::vector<size_t>& startStates, std::vector<size_t>& endStates);
         void                                                numericallyIntegrateProcess(state_type &likelihoods, double begin_age, double end_age, bool use_backward, bool extinction_only) const; //!< Wrapper function for the ODE time stepper function.
@@ -67,8 +83,14 @@ namespace RevBayesCore {
         void                                                buildRandomBinaryTree(std::vector<TopologyNode *> &tips);
         virtual double                                      pSurvival(double start, double end) const;                                                          //!< Compute the probability of survival of the process (without incomplete taxon sampling).
         void                                                simulateTree(void);
-        void                                                computeNodeProbability(const TopologyNode &n, size_t nIdx) const;
+        void                                                computeNodeProbability(const TopologyNode &n, size_t nIdx, const SSE_ODE &ode, const std::map<std::vector<unsigned>, double> &event_map, const std::vector<double> &speciation_rates, double sampling_probability) const;
+        void                                                computeExtinctionProbabilities(void) const;                                                         //!< Integrate the extinction probabilities on the grid of ages up to the root age.
         double                                              computeRootLikelihood() const;
+        SSE_ODE                                             createODE(bool backward_time, bool extinction_only) const;                                          //!< Create the ODE for the current rates.
+        void                                                integrateODE(const SSE_ODE &ode, state_type &likelihoods, double begin_age, double end_age) const;
+        size_t                                              recursivelyCollectBranches(const TopologyNode &n, std::vector<std::vector<const TopologyNode*> > &branches) const;
+        void                                                recursivelyFlagNodeDirty(const TopologyNode& n);
+        void                                                touchExtinctionProbabilities(void);                                                                 //!< The rates have changed, so we need new extinction probabilities
         
         // members
         std::string                                         condition;                                                                                          //!< The condition of the process (none/survival/#taxa).
@@ -80,7 +102,12 @@ namespace RevBayesCore {
         mutable std::vector<bool>                           changed_nodes;
         mutable std::vector<bool>                           dirty_nodes;
         mutable std::vector<std::vector<std::vector<double> > >           partial_likelihoods;
-        mutable std::vector<std::vector<double> >           extinction_probabilities;
+        mutable std::vector<double>                         extinction_probabilities;                                                                           //!< E at the ages k*dt (k*num_states+i)
+        mutable std::vector<double>                         extinction_derivatives;                                                                             //!< dE/dt at the ages k*dt
+        mutable bool                                        extinction_probabilities_dirty;                                                                     //!< Do we need to integrate the extinction probabilities again?
+        bool                                                extinction_probabilities_touched;                                                                   //!< Have the stored extinction probabilities been set in this move?
+        std::vector<double>                                 stored_extinction_probabilities;
+        std::vector<double>                                 stored_extinction_derivatives;
         size_t                                              num_states;
         mutable std::vector<std::vector<double> >           scaling_factors;
         mutable double                                      total_scaling;
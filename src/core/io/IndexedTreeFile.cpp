@@ -0,0 +1,404 @@
+#include "IndexedTreeFile.h"
+#include "NewickConverter.h"
+#include "RbException.h"
+#include "RbFileManager.h"
+#include "StringUtilities.h"
+#include "TreeUtilities.h"
+
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+using namespace RevBayesCore;
+
+
+IndexedTreeFile::IndexedTreeFile( void ) :
+    file_name( "" ),
+    index_file_name( "" ),
+    clock( true ),
+    file_size( 0 ),
+    file_time( 0 ),
+    file_checksum( 0 ),
+    index_delimiter( "" ),
+    max_cache_size( 0 ),
+    num_requests( 0 ),
+    tree_stream( NULL )
+{
+
+}
+
+
+/**
+ * Constructor.
+ * We read the index of the file if it exists and still fits the file, otherwise we index the file and store the index.
+ */
+IndexedTreeFile::IndexedTreeFile( const std::string &fn, bool c, const std::string &delimiter, size_t cs ) :
+    file_name( fn ),
+    index_file_name( fn + ".idx" ),
+    clock( c ),
+    file_size( 0 ),
+    file_time( 0 ),
+    file_checksum( 0 ),
+    index_delimiter( "" ),
+    max_cache_size( cs > 0 ? cs : 1 ),
+    num_requests( 0 ),
+    tree_stream( NULL )
+{
+
+    // check that the file/path name has been correctly specified
+    RbFileManager myFileManager( fn );
+    if ( !myFileManager.testFile() || !myFileManager.testDirectory() )
+    {
+        std::string errorStr = "";
+        myFileManager.formatError( errorStr );
+        throw RbException( errorStr );
+    }
+
+    getFileSignature( file_size, file_time, file_checksum );
+
+    std::stringstream ss;
+    ss << int( delimiter.empty() ? '\t' : delimiter[0] );
+    if ( readIndex() == false || ss.str() != index_delimiter )
+    {
+        buildIndex( delimiter );
+        writeIndex();
+    }
+
+    if ( tree_offsets.empty() == true )
+    {
+        throw RbException( "The file \"" + fn + "\" does not contain any trees." );
+    }
+
+}
+
+
+/**
+ * Copy constructor.
+ * The copy shares nothing with the original but opens its own stream, e.g., if the copies are used by different threads.
+ */
+IndexedTreeFile::IndexedTreeFile( const IndexedTreeFile &f ) :
+    file_name( f.file_name ),
+    index_file_name( f.index_file_name ),
+    clock( f.clock ),
+    file_size( f.file_size ),
+    file_time( f.file_time ),
+    file_checksum( f.file_checksum ),
+    index_delimiter( f.index_delimiter ),
+    tree_offsets( f.tree_offsets ),
+    tree_lengths( f.tree_lengths ),
+    max_cache_size( f.max_cache_size ),
+    cached_trees( f.cached_trees ),
+    cached_indices( f.cached_indices ),
+    cached_last_use( f.cached_last_use ),
+    num_requests( f.num_requests ),
+    tree_stream( NULL )
+{
+
+}
+
+
+IndexedTreeFile::~IndexedTreeFile( void )
+{
+
+    delete tree_stream;
+}
+
+
+IndexedTreeFile& IndexedTreeFile::operator=( const IndexedTreeFile &f )
+{
+
+    if ( this != &f )
+    {
+        file_name       = f.file_name;
+        index_file_name = f.index_file_name;
+        clock           = f.clock;
+        file_size       = f.file_size;
+        file_time       = f.file_time;
+        file_checksum   = f.file_checksum;
+        index_delimiter = f.index_delimiter;
+        tree_offsets    = f.tree_offsets;
+        tree_lengths    = f.tree_lengths;
+        max_cache_size  = f.max_cache_size;
+        cached_trees    = f.cached_trees;
+        cached_indices  = f.cached_indices;
+        cached_last_use = f.cached_last_use;
+        num_requests    = f.num_requests;
+
+        // the stream belongs to the old file
+        delete tree_stream;
+        tree_stream = NULL;
+    }
+
+    return *this;
+}
+
+
+/**
+ * Scan the file and store the position and length of the newick string of every tree.
+ * As for tree traces, the first line is the header and the trees are in the last column that is not a probability.
+ */
+void IndexedTreeFile::buildIndex( const std::string &delimiter )
+{
+
+    tree_offsets.clear();
+    tree_lengths.clear();
+
+    std::ifstream in( file_name.c_str(), std::ios::in | std::ios::binary );
+    if ( !in )
+    {
+        throw RbException( "Could not open file \"" + file_name + "\"" );
+    }
+
+    const char d = ( delimiter.empty() ? '\t' : delimiter[0] );
+    std::stringstream ss;
+    ss << int( d );
+    index_delimiter = ss.str();
+
+    bool hasHeaderBeenRead = false;
+    size_t index = 0;
+    boost::uint64_t offset = 0;
+    std::string line;
+    while ( getline( in, line ) )
+    {
+
+        boost::uint64_t line_offset = offset;
+        offset += line.size() + 1;
+
+        // skip empty lines and comments
+        if ( line.length() == 0 || line[0] == '#' )
+        {
+            continue;
+        }
+
+        // we assume a header at the first line of the file
+        if ( hasHeaderBeenRead == false )
+        {
+            std::vector<std::string> columns;
+            StringUtilities::stringSplit( line, delimiter, columns );
+
+            for (size_t j=1; j<columns.size(); ++j)
+            {
+                if ( columns[j] == "Posterior" || columns[j] == "Likelihood" || columns[j] == "Prior" )
+                {
+                    continue;
+                }
+                index = j;
+            }
+
+            hasHeaderBeenRead = true;
+
+            continue;
+        }
+
+        // find the column with the tree
+        size_t begin = 0;
+        for (size_t j=0; j<index; ++j)
+        {
+            begin = line.find( d, begin );
+            if ( begin == std::string::npos )
+            {
+                throw RbException( "Could not find a tree in the line \"" + line + "\"" );
+            }
+            ++begin;
+        }
+
+        size_t end = line.find( d, begin );
+        if ( end == std::string::npos )
+        {
+            end = line.size();
+        }
+        if ( end > begin && line[end-1] == '\r' )
+        {
+            --end;
+        }
+
+        tree_offsets.push_back( line_offset + begin );
+        tree_lengths.push_back( boost::uint32_t( end - begin ) );
+    }
+
+}
+
+
+/**
+ * Get the size and the modification time of the file, and a checksum of its first and last few kilobytes.
+ * The modification time only has a resolution of seconds, so the checksum catches a file that was rewritten with the same size
+ * within the same second, e.g., by a rerun of the same analysis.
+ */
+void IndexedTreeFile::getFileSignature( boost::uint64_t &size, boost::uint64_t &time, boost::uint64_t &checksum ) const
+{
+
+    struct stat info;
+    if ( stat( file_name.c_str(), &info ) != 0 )
+    {
+        throw RbException( "Could not determine the size of file \"" + file_name + "\"" );
+    }
+    size = boost::uint64_t( info.st_size );
+    time = boost::uint64_t( info.st_mtime );
+
+    std::ifstream in( file_name.c_str(), std::ios::in | std::ios::binary );
+    if ( !in )
+    {
+        throw RbException( "Could not open file \"" + file_name + "\"" );
+    }
+
+    // FNV-1a hash of the first and the last block of the file
+    const boost::uint64_t block_size = 4096;
+    std::vector<char> buffer( block_size );
+    checksum = 14695981039346656037ULL;
+    for (size_t b = 0; b < 2; ++b)
+    {
+        boost::uint64_t start = ( b == 0 || size <= block_size ? 0 : size - block_size );
+        std::streamsize length = std::streamsize( size < block_size ? size : block_size );
+
+        in.clear();
+        in.seekg( std::streamoff( start ) );
+        in.read( &buffer[0], length );
+        for (std::streamsize i = 0; i < in.gcount(); ++i)
+        {
+            checksum ^= boost::uint64_t( static_cast<unsigned char>( buffer[i] ) );
+            checksum *= 1099511628211ULL;
+        }
+    }
+
+}
+
+
+/**
+ * Get the i-th tree of the file.
+ * The tree is parsed unless it is one of the recently used trees in the cache.
+ * The returned reference is only valid until the next call.
+ */
+const Tree& IndexedTreeFile::getTree( size_t i ) const
+{
+
+    if ( i >= tree_offsets.size() )
+    {
+        throw RbException( "Tree index out of bounds of the tree file." );
+    }
+
+    ++num_requests;
+
+    for (size_t k=0; k<cached_indices.size(); ++k)
+    {
+        if ( cached_indices[k] == i )
+        {
+            cached_last_use[k] = num_requests;
+            return cached_trees[k];
+        }
+    }
+
+    // read the newick string of the tree from the stream that we keep open
+    if ( tree_stream == NULL )
+    {
+        tree_stream = new std::ifstream( file_name.c_str(), std::ios::in | std::ios::binary );
+    }
+    std::ifstream &in = *tree_stream;
+    std::vector<char> newick( tree_lengths[i] + 1, '\0' );
+    in.clear();
+    in.seekg( std::streamoff( tree_offsets[i] ) );
+    in.read( &newick[0], tree_lengths[i] );
+    if ( !in )
+    {
+        throw RbException( "Could not read tree " + StringUtilities::toString( i + 1 ) + " from file \"" + file_name + "\". Has the file changed since it was indexed?" );
+    }
+
+    NewickConverter c;
+    Tree *tree = c.convertFromNewick( &newick[0], &newick[0] + tree_lengths[i] );
+    if ( clock == true )
+    {
+        Tree *time_tree = TreeUtilities::convertTree( *tree );
+        delete tree;
+        tree = time_tree;
+    }
+
+    // replace the least recently used tree if the cache is full
+    size_t k = cached_indices.size();
+    if ( k < max_cache_size )
+    {
+        cached_trees.push_back( *tree );
+        cached_indices.push_back( i );
+        cached_last_use.push_back( num_requests );
+    }
+    else
+    {
+        k = 0;
+        for (size_t j=1; j<cached_last_use.size(); ++j)
+        {
+            if ( cached_last_use[j] < cached_last_use[k] )
+            {
+                k = j;
+            }
+        }
+
+        cached_trees[k] = *tree;
+        cached_indices[k] = i;
+        cached_last_use[k] = num_requests;
+    }
+
+    delete tree;
+
+    return cached_trees[k];
+}
+
+
+/** Read the index of the file, which is only used if it was built for the current size, modification time and checksum of the file */
+bool IndexedTreeFile::readIndex( void )
+{
+
+    std::ifstream in( index_file_name.c_str() );
+    if ( !in )
+    {
+        return false;
+    }
+
+    std::string header;
+    getline( in, header );
+    if ( header != "#RevBayes tree file index 2" )
+    {
+        return false;
+    }
+
+    boost::uint64_t size = 0, time = 0, checksum = 0;
+    size_t num_trees = 0;
+    in >> size >> time >> checksum >> num_trees >> index_delimiter;
+    if ( !in || size != file_size || time != file_time || checksum != file_checksum )
+    {
+        return false;
+    }
+
+    tree_offsets.resize( num_trees );
+    tree_lengths.resize( num_trees );
+    for (size_t i=0; i<num_trees; ++i)
+    {
+        in >> tree_offsets[i] >> tree_lengths[i];
+    }
+
+    if ( !in )
+    {
+        tree_offsets.clear();
+        tree_lengths.clear();
+        return false;
+    }
+
+    return true;
+}
+
+
+/** Store the index next to the file. If we cannot write the file, e.g., in a read-only directory, we just index the file again next time. */
+void IndexedTreeFile::writeIndex( void ) const
+{
+
+    std::ofstream out( index_file_name.c_str() );
+    if ( !out )
+    {
+        return;
+    }
+
+    out << "#RevBayes tree file index 2\n";
+    out << file_size << " " << file_time << " " << file_checksum << " " << tree_offsets.size() << " " << index_delimiter << "\n";
+    for (size_t i=0; i<tree_offsets.size(); ++i)
+    {
+        out << tree_offsets[i] << " " << tree_lengths[i] << "\n";
+    }
+
+}
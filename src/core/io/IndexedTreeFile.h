@@ -0,0 +1,77 @@
+#ifndef IndexedTreeFile_H
+#define IndexedTreeFile_H
+
+#include "Tree.h"
+
+#include <boost/cstdint.hpp>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace RevBayesCore {
+
+
+    /**
+     * Random access to the trees of a tree trace file without reading all trees into memory.
+     *
+     * We scan the file once and store the position and length of the newick string of every tree in an index,
+     * which is written next to the file (with the extension .idx) and reused as long as the size, the modification time
+     * and a checksum of the beginning and the end of the file do not change.
+     * A tree is only parsed when it is requested, and the most recently used trees are kept in a small cache,
+     * so that, e.g., the tree of a rejected proposal does not need to be parsed again.
+     * Hence, the memory only grows with the number of trees in the index and not with the trees themselves.
+     *
+     * The file has the same format as for the tree traces, i.e., a header line and then one sample per line,
+     * with the trees in the last column that is not a probability.
+     *
+     * @copyright Copyright 2009-
+     * @author The RevBayes Development Core Team
+     * @since 2016-10-16, version 1.0
+     *
+     */
+    class IndexedTreeFile {
+
+    public:
+
+        IndexedTreeFile(void);                                                                                      //!< Empty file without trees
+        IndexedTreeFile(const std::string &fn, bool c, const std::string &delimiter, size_t cs = 16);              //!< Index the trees of file fn and cache up to cs trees
+        IndexedTreeFile(const IndexedTreeFile &f);                                                                  //!< Copy constructor (the copy opens its own stream)
+                                           ~IndexedTreeFile(void);
+
+        IndexedTreeFile&                    operator=(const IndexedTreeFile &f);
+
+        const Tree&                         getTree(size_t i) const;                                                //!< Get the i-th tree of the file
+        const std::string&                  getFileName(void) const                     { return file_name; }
+        bool                                isClock(void) const                         { return clock; }
+        size_t                              size(void) const                            { return tree_offsets.size(); }
+
+    private:
+
+        void                                buildIndex(const std::string &delimiter);
+        void                                getFileSignature(boost::uint64_t &size, boost::uint64_t &time, boost::uint64_t &checksum) const;
+        bool                                readIndex(void);
+        void                                writeIndex(void) const;
+
+        std::string                         file_name;
+        std::string                         index_file_name;
+        bool                                clock;                                                                  //!< Are the trees time trees?
+        boost::uint64_t                     file_size;                                                              //!< The size of the file when it was indexed
+        boost::uint64_t                     file_time;                                                              //!< The modification time of the file when it was indexed
+        boost::uint64_t                     file_checksum;                                                          //!< The checksum of the beginning and the end of the file when it was indexed
+        std::string                         index_delimiter;                                                        //!< The character code of the delimiter used for the index
+        std::vector<boost::uint64_t>        tree_offsets;                                                           //!< The position of the newick string of each tree in the file
+        std::vector<boost::uint32_t>        tree_lengths;                                                           //!< The length of the newick string of each tree
+
+        // the least recently used cache of parsed trees
+        size_t                              max_cache_size;
+        mutable std::vector<Tree>           cached_trees;
+        mutable std::vector<size_t>         cached_indices;                                                         //!< The index of each cached tree
+        mutable std::vector<size_t>         cached_last_use;                                                        //!< The request when each cached tree was used last
+        mutable size_t                      num_requests;
+        mutable std::ifstream*              tree_stream;                                                            //!< The file, which is opened at the first request and kept open
+
+    };
+
+}
+
+#endif
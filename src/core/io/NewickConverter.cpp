@@ -3,9 +3,10 @@
 #include "TopologyNode.h"
 #include "Tree.h"
 
-#include <stdio.h>
+#include <algorithm>
+#include <iterator>
 #include <stdlib.h>
-#include <sstream>
+#include <string>
 #include <vector>
 
 using namespace RevBayesCore;
@@ -23,53 +24,50 @@ NewickConverter::~NewickConverter()
 
 
 
+/**
+ * Convert a newick string into a tree.
+ * All blanks are ignored, as are any characters after the root.
+ */
 Tree* NewickConverter::convertFromNewick(std::string const &n, bool reindex)
 {
     
-    // create and allocate the tree object
-    Tree *t = new Tree();
-    
-    std::vector<TopologyNode*> nodes;
-    std::vector<double> brlens;
-    
-    // create a string-stream and throw the string into it
-    std::stringstream ss (std::stringstream::in | std::stringstream::out);
-    ss << n;
+    return convertFromNewick( n.data(), n.data() + n.size(), reindex );
+}
+
+
+/**
+ * Convert the newick string between begin and end into a tree.
+ *
+ * The string is parsed in a single pass with a pointer, so we neither copy substrings of the string for the subtrees
+ * nor read it character by character through a stream. Only the labels and comments are copied into the nodes.
+ */
+Tree* NewickConverter::convertFromNewick(const char *begin, const char *end, bool reindex)
+{
     
-    // ignore white spaces
-    std::string trimmed = "";
-    char c;
-    while ( ss.good() )
+    // ignore white spaces, which we only need to remove if there are any
+    if ( std::find( begin, end, ' ' ) != end )
     {
-        // check for EOF
-        int c_int = ss.get();
-        if (c_int != EOF)
-        {
-            c = char( c_int );
-            if ( c != ' ')
-            {
-                trimmed += c;
-            }
-            
-        }
+        std::string trimmed;
+        trimmed.reserve( end - begin );
+        std::remove_copy( begin, end, std::back_inserter( trimmed ), ' ' );
         
+        return convertFromNewick( trimmed.data(), trimmed.data() + trimmed.size(), reindex );
     }
-	
-    // construct the tree starting from the root
-    TopologyNode *root = createNode( trimmed, nodes, brlens );
     
-    // set up the tree
-    t->setRoot( root, reindex );
+    // create and allocate the tree object
+    Tree *t = new Tree();
+    
+    // construct the tree starting from the root
+    const char *p = begin;
+    TopologyNode *root = createNode( p, end );
+    readNodeInformation( p, end, root, true );
     
-    // set the branch lengths
-    for (size_t i = 0; i < nodes.size(); ++i)
-    {
-        t->getNode( nodes[i]->getIndex() ).setBranchLength( brlens[i] );
-    }
-
     // make all internal nodes bifurcating
     // this is important for fossil trees which have sampled ancestors
-    t->makeInternalNodesBifurcating( reindex );
+    root->makeBifurcating();
+    
+    // set up the tree, which we only need to do once all nodes exist
+    t->setRoot( root, reindex );
     
     // trees with 2-degree root nodes should not be rerooted
     t->setRooted( root->getNumberOfChildren() == 2 );
@@ -79,211 +77,44 @@ Tree* NewickConverter::convertFromNewick(std::string const &n, bool reindex)
 }
 
 
-
-TopologyNode* NewickConverter::createNode(const std::string &n, std::vector<TopologyNode*> &nodes, std::vector<double> &brlens) {
-    
-    // create a string-stream and throw the string into it
-    std::stringstream ss (std::stringstream::in | std::stringstream::out);
-    ss << n;
-    
-    char c = ' ';
-    ss.get(c);
+/**
+ * Create the node of the subtree starting at p, which has to be an opening parenthesis, together with all its descendants.
+ * Afterwards p points behind the closing parenthesis, i.e., to the label of the node, which is read by the caller.
+ */
+TopologyNode* NewickConverter::createNode(const char *&p, const char *end) const
+{
     
     // the initial character has to be '('
-    if ( c != '(')
+    if ( p == end || *p != '(' )
     {
         throw RbException("Error while converting Newick tree. We expected an opening parenthesis, but didn't get one.");
     }
+    ++p;
     
-    TopologyNode *node = new TopologyNode(); 
-    while ( ss.good() && ss.peek() != ')' )
+    TopologyNode *node = new TopologyNode();
+    while ( p != end && *p != ')' )
     {
         
-        TopologyNode *childNode;
-        if (ss.peek() == '(' )
-        {
-            // we received an internal node
-            int depth = 0;
-            std::string child = "";
-            do
-            {
-                ss.get(c);
-                child += c;
-                if ( c == '(' )
-                {
-                    depth++;
-                }
-                else if ( c == ')' )
-                {
-                    depth--;
-                }
-                
-            } while ( ss.good() && depth > 0 );
+        const char *start = p;
         
-            // construct the child node
-            childNode = createNode( child, nodes, brlens );
-        }
-        else
-        {
-            // construct the node
-            childNode = new TopologyNode();
-        }
+        // we either received an internal node or a tip
+        TopologyNode *childNode = ( *p == '(' ? createNode( p, end ) : new TopologyNode() );
         
         // set the parent child relationship
         node->addChild( childNode );
         childNode->setParent( node );
         
-        // read the optional label
-        std::string lbl = "";
-        while ( ss.good() && (c = char( ss.peek() ) ) != ':' && c != '[' && c != ';' && c != ',' && c != ')')
-        {
-            lbl += char( ss.get() );
-        }
-        childNode->setName( lbl );
-        
-        // read the optional node parameters
-        if ( ss.peek() == '[' )
-        {
-            
-            do
-            {
-                
-                ss.ignore();
-                // ignore the '&' before parameter name
-                if ( ss.peek() == '&') 
-                {
-                    ss.ignore();
-                }
-                
-                // read the parameter name
-                std::string paramName = "";
-                while ( ss.good() && (c = char( ss.peek() ) ) != '=' && c != ',' && c != ']')
-                {
-                    paramName += char( ss.get() );
-                }
-                
-                // ignore the equal sign between parameter name and value
-                if ( ss.peek() == '=') 
-                {
-                    ss.ignore();
-                }
-                
-                // read the parameter name
-                std::string paramValue = "";
-                while ( ss.good() && (c = char( ss.peek() ) ) != ']' && c != ',' && c != ':')
-                {
-                    paramValue += char( ss.get() );
-                }
-                
-				if (paramName == "index")
-                {
-					// subtract by 1 to correct RevLanguage 1-based indexing
-                    childNode->setIndex( atoi(paramValue.c_str()) - 1 );
-					
-                }
-                else if (paramName=="species")
-                {
-                    childNode->setSpeciesName(paramValue);
-				}
-                else
-                {
-                    childNode->addNodeParameter(paramName, paramValue);
-                }
-				
-            } while ( (c = char( ss.peek() ) ) == ',' );
-            
-            // ignore the final ']'
-            if ( (c = char( ss.peek( ) ) ) == ']' )
-            {
-                ss.ignore();
-            }
-            
-        }
-        
-        // read the optional branch length
-        if ( ss.peek() == ':' )
-        {
-            ss.ignore();
-            std::string time = "";
-            while ( ss.good() && (c = char( ss.peek( ) ) ) != ';' && c != ',' && c != ')' && c != '[' )
-            {
-                time += char( ss.get() );
-            }
-            
-            std::istringstream stm;
-            stm.str(time);
-            double d;
-            stm >> d;
-            nodes.push_back( childNode );
-            brlens.push_back( d );
-        }
-        else
-        {
-            nodes.push_back( childNode );
-            brlens.push_back( 0.0 );
-        }
+        readNodeInformation( p, end, childNode, false );
         
-        // read the optional branch parameters
-        if ( char( ss.peek() ) == '[' )
+        if ( p == start )
         {
-            
-            do
-            {
-                
-                ss.ignore();
-                
-                // ignore the '&' before parameter name
-                if ( char( ss.peek() ) == '&')
-                {
-                    ss.ignore();
-                }
-                
-                // read the parameter name
-                std::string paramName = "";
-                while ( ss.good() && (c = char( ss.peek() )) != '=' && c != ',')
-                {
-                    paramName += char( ss.get() );
-                }
-                
-                // ignore the equal sign between parameter name and value
-                if ( char( ss.peek() ) == '=')
-                {
-                    ss.ignore();
-                }
-                
-                // read the parameter name
-                std::string paramValue = "";
-                while ( ss.good() && (c = char( ss.peek() )) != ']' && c != ',' && c != ':')
-                {
-                    paramValue += char( ss.get() );
-                }
-                
-                if (paramName=="index")
-                {
-                    // subtract by 1 to correct RevLanguage 1-based indexing
-                    childNode->setIndex( atoi(paramValue.c_str()) - 1 );
-                }
-                else if (paramName=="species")
-                {
-                    childNode->setSpeciesName(paramValue);
-                }
-                else
-                {
-                    childNode->addBranchParameter(paramName, paramValue);
-                }
-                
-                
-            } while ( (c = char( ss.peek() )) != ']' );
-            
-            ss.ignore();
-            
+            throw RbException("Error while converting Newick tree. We did not expect the character '" + std::string(1, *p) + "'.");
         }
         
-        
         // skip comma
-        if ( char( ss.peek() ) == ',' )
+        if ( p != end && *p == ',' )
         {
-            ss.ignore();
+            ++p;
         }
         
     }
@@ -295,161 +126,141 @@ TopologyNode* NewickConverter::createNode(const std::string &n, std::vector<Topo
     }
 
     // remove closing parenthesis
-    ss.ignore();
+    if ( p != end )
+    {
+        ++p;
+    }
     
-    // read the optional label, checking for EOF = '\377'
-    std::string lbl = "";
-    while ( ss.good() && (c = char( ss.peek() )) != ':' && c != ';' && c != ',' && c != '[' && c != '\377')
+    return node;
+}
+
+
+/**
+ * Read the optional label, node parameters, branch length and branch parameters of a node, in this order.
+ * The label and the branch length of a child end at its parent's closing parenthesis, but the ones of the root do not.
+ * Nodes without a branch length get a branch length of 0.
+ */
+void NewickConverter::readNodeInformation(const char *&p, const char *end, TopologyNode *node, bool is_root) const
+{
+    
+    // read the optional label
+    const char *lbl = p;
+    while ( p != end && *p != ':' && *p != '[' && *p != ';' && *p != ',' && (*p != ')' || is_root == true) )
     {
-        lbl += char( ss.get() );
+        ++p;
     }
-    node->setName( lbl );
+    node->setName( std::string( lbl, p ) );
     
     // read the optional node parameters
-    if ( char( ss.peek() ) == '[' )
+    if ( p != end && *p == '[' )
     {
-        
-        do
-        {
-            
-            ss.ignore();
-
-            // ignore the '&' before parameter name
-            if ( char( ss.peek() ) == '&') 
-            {
-                ss.ignore();
-            }
-            
-            // read the parameter name
-            std::string paramName = "";
-            while ( ss.good() && (c = char( ss.peek() )) != '=' && c != ',')
-            {
-                paramName += char( ss.get() );
-            }
-            
-            // ignore the equal sign between parameter name and value
-            if ( char( ss.peek() ) == '=') 
-            {
-                ss.ignore();
-            }
-            
-            // read the parameter name
-            std::string paramValue = "";
-            while ( ss.good() && (c = char( ss.peek() )) != ']' && c != ',' && c != ':') 
-            {
-                paramValue += char( ss.get() );
-            }
-			
-			if (paramName=="index")
-            {
-				// subtract by 1 to correct RevLanguage 1-based indexing
-				node->setIndex( atoi(paramValue.c_str()) - 1 );
-				
-			}
-            else if (paramName=="species")
-            {
-				node->setSpeciesName(paramValue);
-            }
-            else
-            {
-                node->addNodeParameter(paramName, paramValue);
-            }
-
-            
-        } while ( (c = char( ss.peek() )) == ',' );
-        
-        // ignore the final ']'
-        if ( (c = char( ss.peek() )) == ']' )
-        {
-            ss.ignore();
-        }
-        
+        readParameters( p, end, node, false );
     }
     
     // read the optional branch length
-    if ( char( ss.peek() ) == ':' )
+    double brlen = 0.0;
+    if ( p != end && *p == ':' )
     {
-        ss.ignore();
-        std::string time = "";
-        while ( ss.good() && (c = char( ss.peek() )) != ';' && c != ',' && c != '[' )
+        const char *time = ++p;
+        while ( p != end && *p != ';' && *p != ',' && *p != '[' && (*p != ')' || is_root == true) )
         {
-            time += char( ss.get() );
+            ++p;
         }
         
-        std::istringstream stm;
-        stm.str(time);
-        double d;
-        stm >> d;
-        nodes.push_back( node );
-        brlens.push_back( d );
+        // strtod needs a terminated string, so we copy the few characters of the number
+        char buffer[64];
+        std::string long_time;
+        const char *number = buffer;
+        if ( size_t(p - time) < sizeof(buffer) )
+        {
+            std::copy( time, p, buffer );
+            buffer[p - time] = '\0';
+        }
+        else
+        {
+            long_time.assign( time, p );
+            number = long_time.c_str();
+        }
+        brlen = strtod( number, NULL );
     }
-    else
+    node->setBranchLength( brlen );
+    
+    // read the optional branch parameters
+    if ( p != end && *p == '[' )
     {
-        nodes.push_back( node );
-        brlens.push_back( 0.0 );
+        readParameters( p, end, node, true );
     }
     
+}
+
+
+/**
+ * Read the parameters of a comment of the form [&name=value,name=value,...] and add them to the node or its branch.
+ * The index (1-based in Rev) and the species name are set on the node directly.
+ */
+void NewickConverter::readParameters(const char *&p, const char *end, TopologyNode *node, bool is_branch) const
+{
     
-    
-    // read the optional branch parameters
-    if ( char( ss.peek() ) == '[' )
+    do
     {
         
-        do
+        // skip the '[' or the ',' before the parameter
+        ++p;
+        
+        // ignore the '&' before parameter name
+        if ( p != end && *p == '&' )
         {
-            
-            ss.ignore();
-            
-            // ignore the '&' before parameter name
-            if ( char( ss.peek() ) == '&')
-            {
-                ss.ignore();
-            }
-            
-            // read the parameter name
-            std::string paramName = "";
-            while ( ss.good() && (c = char( ss.peek() )) != '=' && c != ',')
-            {
-                paramName += char( ss.get() );
-            }
-            
-            // ignore the equal sign between parameter name and value
-            if ( char( ss.peek() ) == '=')
-            {
-                ss.ignore();
-            }
-            
-            // read the parameter name
-            std::string paramValue = "";
-            while ( ss.good() && (c = char( ss.peek() )) != ']' && c != ',' && c != ':')
-            {
-                paramValue += char( ss.get() );
-            }
-            
-            if (paramName=="index")
-            {
-                // subtract by 1 to correct RevLanguage 1-based indexing
-                node->setIndex( atoi(paramValue.c_str()) - 1 );
-                
-            }
-            else if (paramName=="species")
-            {
-                node->setSpeciesName(paramValue);
-            }
-            else
-            {
-                node->addBranchParameter(paramName, paramValue);
-            }
-            
-            
-        } while ( (c = char( ss.peek() )) != ']' );
+            ++p;
+        }
         
-        ss.ignore();
+        // read the parameter name
+        const char *name = p;
+        while ( p != end && *p != '=' && *p != ',' && *p != ']' )
+        {
+            ++p;
+        }
+        std::string paramName( name, p );
         
-    }
+        // ignore the equal sign between parameter name and value
+        if ( p != end && *p == '=' )
+        {
+            ++p;
+        }
+        
+        // read the parameter value
+        const char *value = p;
+        while ( p != end && *p != ']' && *p != ',' && *p != ':' )
+        {
+            ++p;
+        }
+        std::string paramValue( value, p );
+        
+        if ( paramName == "index" )
+        {
+            // subtract by 1 to correct RevLanguage 1-based indexing
+            node->setIndex( atoi( paramValue.c_str() ) - 1 );
+        }
+        else if ( paramName == "species" )
+        {
+            node->setSpeciesName( paramValue );
+        }
+        else if ( is_branch == true )
+        {
+            node->addBranchParameter( paramName, paramValue );
+        }
+        else
+        {
+            node->addNodeParameter( paramName, paramValue );
+        }
+        
+    } while ( p != end && *p == ',' );
     
+    // ignore the final ']'
+    if ( p != end && *p == ']' )
+    {
+        ++p;
+    }
     
-    return node;
 }
 
 
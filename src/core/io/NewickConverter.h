@@ -35,10 +35,13 @@ namespace RevBayesCore {
         virtual                 ~NewickConverter();
     
         Tree*                   convertFromNewick(const std::string &n, bool reindex = true );
+        Tree*                   convertFromNewick(const char *begin, const char *end, bool reindex = true );                 //!< Convert the newick string between begin and end
 //        AdmixtureTree*          getAdmixtureTreeFromNewick(const std::string &n);
 
     private:
-        TopologyNode*           createNode(const std::string &n, std::vector<TopologyNode*> &nodes, std::vector<double> &brlens);
+        TopologyNode*           createNode(const char *&p, const char *end) const;
+        void                    readNodeInformation(const char *&p, const char *end, TopologyNode *node, bool is_root) const;
+        void                    readParameters(const char *&p, const char *end, TopologyNode *node, bool is_branch) const;
     };
 
 }
@@ -3,7 +3,9 @@
 #include "NewickTreeReader.h"
 #include "RbException.h"
 
+#include <algorithm>
 #include <fstream>
+#include <vector>
 
 using namespace RevBayesCore;
 
@@ -21,39 +23,55 @@ NewickTreeReader::NewickTreeReader()
 
 
 /**
- *
+ * Read one tree per line from a file.
+ * The whole file is read into memory at once and each line is converted directly from this buffer.
  */
 std::vector<Tree*>* NewickTreeReader::readBranchLengthTrees(std::string const &fn)
 {
     /* Open file */
-    std::ifstream inFile( fn.c_str() );
+    std::ifstream inFile( fn.c_str(), std::ios::in | std::ios::binary );
     
     if ( !inFile )
         throw RbException( "Could not open file \"" + fn + "\"" );
     
+    /* Read the whole file */
+    inFile.seekg( 0, std::ios::end );
+    std::streampos file_size = inFile.tellg();
+    if ( file_size == std::streampos( -1 ) )
+    {
+        throw RbException( "Could not determine the size of file \"" + fn + "\"" );
+    }
+    
+    std::vector<char> buffer = std::vector<char>( size_t( file_size ) );
+    inFile.seekg( 0, std::ios::beg );
+    if ( buffer.empty() == false )
+    {
+        inFile.read( &buffer[0], buffer.size() );
+        if ( !inFile )
+        {
+            throw RbException( "Could not read file \"" + fn + "\"" );
+        }
+    }
+    
     /* Initialize */
     std::vector<Tree*>* trees = new std::vector<Tree*>();
-    std::string commandLine;
+    NewickConverter c;
     
     /* line-processing loop */
-    while ( inFile.good() ) 
+    const char *begin = buffer.empty() ? NULL : &buffer[0];
+    const char *end = begin + buffer.size();
+    while ( begin < end )
     {
         
-        // Read a line
-        std::string line;
-        getline( inFile, line );
+        const char *line_end = std::find( begin, end, '\n' );
         
         // skip empty lines
-        if (line.length() == 0) 
+        if ( line_end != begin )
         {
-            continue;
+            trees->push_back( c.convertFromNewick( begin, line_end ) );
         }
-                
-        
-        NewickConverter c;
-        Tree *blTree = c.convertFromNewick( line );
         
-        trees->push_back( blTree );
+        begin = line_end + 1;
     }
     
     return trees;
@@ -1,8 +1,16 @@
+#include "CompactTreeTrace.h"
+#include "NewickConverter.h"
 #include "RbException.h"
 #include "RbFileManager.h"
+#include "RbSettings.h"
 #include "StringUtilities.h"
 #include "TraceReader.h"
+#include "TraceTree.h"
+#include "Tree.h"
+#include "TreeUtilities.h"
 
+#include <algorithm>
+#include <exception>
 #include <map>
 
 using namespace RevBayesCore;
@@ -96,3 +104,228 @@ std::vector<ModelTrace> TraceReader::readStochasticVariableTrace( const std::str
     // return the vector of traces
     return data;
 }
+
+
+/**
+ * Read a tree trace file and append its trees to the tree trace t.
+ *
+ * The file is streamed in blocks of trees, so that only the newick strings of one block are held in memory.
+ * The first burnin trees of the file are skipped without parsing them, and afterwards only every thinning-th tree is kept.
+ * The trace only keeps the trees encoded as splits (see CompactTreeTrace), which needs a small fraction of the memory of the trees,
+ * and drops their node parameters unless the trace keeps them.
+ */
+void TraceReader::readTreeTrace( const std::string &fn, const std::string &delimiter, size_t burnin, size_t thinning, TraceTree &t )
+{
+    
+    if ( thinning == 0 )
+    {
+        throw RbException( "The thinning of a tree trace needs to be at least 1." );
+    }
+    
+    // check that the file/path name has been correctly specified
+    RevBayesCore::RbFileManager myFileManager( fn );
+    if ( !myFileManager.testFile() || !myFileManager.testDirectory() )
+    {
+        std::string errorStr = "";
+        myFileManager.formatError( errorStr );
+        throw( RbException(errorStr) );
+    }
+    
+    // Open file
+    std::ifstream inFile( fn.c_str() );
+    
+    if ( !inFile )
+    {
+        throw RbException( "Could not open file \"" + fn + "\"" );
+    }
+    
+    // the number of trees we parse at once
+    const size_t block_size = 1000;
+    
+    bool hasHeaderBeenRead = false;
+    size_t index = 0;
+    size_t sample = 0;
+    std::vector<std::string> lines;
+    
+    // Command-processing loop
+    while ( inFile.good() )
+    {
+        
+        // Read a line
+        std::string line;
+        getline( inFile, line );
+        
+        // skip empty lines
+        if (line.length() == 0)
+        {
+            continue;
+        }
+        
+        // removing comments
+        if (line[0] == '#')
+        {
+            continue;
+        }
+        
+        // we assume a header at the first line of the file
+        if ( hasHeaderBeenRead == false )
+        {
+            std::vector<std::string> columns;
+            StringUtilities::stringSplit(line, delimiter, columns);
+            
+            // the trees are in the last column that is not a probability
+            for (size_t j=1; j<columns.size(); ++j)
+            {
+                if ( columns[j] == "Posterior" || columns[j] == "Likelihood" || columns[j] == "Prior" )
+                {
+                    continue;
+                }
+                index = j;
+            }
+            
+            if ( t.size() == 0 )
+            {
+                t.setParameterName( columns[index] );
+                t.setFileName( fn );
+            }
+            
+            hasHeaderBeenRead = true;
+            
+            continue;
+        }
+        
+        // burnin and thinning are applied before we parse the tree
+        ++sample;
+        if ( sample <= burnin || (sample - burnin - 1) % thinning != 0 )
+        {
+            continue;
+        }
+        
+        lines.push_back( line );
+        if ( lines.size() == block_size )
+        {
+            addTrees( lines, index, delimiter, t );
+            lines.clear();
+        }
+        
+    }
+    
+    if ( lines.empty() == false )
+    {
+        addTrees( lines, index, delimiter, t );
+    }
+    
+}
+
+
+/**
+ * Parse a block of lines and append their trees to the trace.
+ * Every thread parses a contiguous part of the block and encodes its trees in a separate compact trace with the same taxa.
+ * These are merged in the order of the lines, so the result does not depend on the number of threads.
+ */
+void TraceReader::addTrees( const std::vector<std::string> &lines, size_t index, const std::string &delimiter, TraceTree &t ) const
+{
+    
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+    const int num_parts = std::max( 1, std::min( num_threads, int(lines.size()) ) );
+    
+    std::vector<CompactTreeTrace> compact_traces( num_parts, CompactTreeTrace( t.isClock(), t.hasNodeParameters() ) );
+    
+    // all parts need the taxa of the trace, or of the first tree if the trace is empty
+    if ( t.size() == 0 )
+    {
+        Tree *first = parseTree( lines[0], index, delimiter, t.isClock() );
+        compact_traces[0].initialize( *first );
+        delete first;
+    }
+    else
+    {
+        compact_traces[0].initialize( t.getCompactTrace() );
+    }
+    
+    for (int i=1; i<num_parts; ++i)
+    {
+        compact_traces[i].initialize( compact_traces[0] );
+    }
+    
+    // the flags are chars because threads may not write neighbouring elements of a std::vector<bool>
+    std::vector<std::string> errors = std::vector<std::string>(num_parts, "");
+    std::vector<char> failed = std::vector<char>(num_parts, false);
+#   pragma omp parallel for schedule(static) num_threads(num_threads) if(num_parts > 1)
+    for (int i=0; i<num_parts; ++i)
+    {
+        size_t begin = lines.size() * i / num_parts;
+        size_t end   = lines.size() * (i + 1) / num_parts;
+        
+        // the tree being encoded, which we need to delete if anything throws
+        Tree *tree = NULL;
+        try
+        {
+            for (size_t j=begin; j<end; ++j)
+            {
+                tree = parseTree( lines[j], index, delimiter, t.isClock() );
+                compact_traces[i].addTree( *tree );
+                delete tree;
+                tree = NULL;
+            }
+        }
+        catch (RbException &e)
+        {
+            errors[i] = e.getMessage();
+            failed[i] = true;
+        }
+        catch (std::exception &e)
+        {
+            errors[i] = e.what();
+            failed[i] = true;
+        }
+        catch (...)
+        {
+            errors[i] = "Unknown error while reading the tree trace.";
+            failed[i] = true;
+        }
+        
+        delete tree;
+    }
+    
+    for (int i=0; i<num_parts; ++i)
+    {
+        if ( failed[i] == true )
+        {
+            throw RbException( errors[i] );
+        }
+    }
+    
+    // now append the trees in order
+    for (size_t i=0; i<compact_traces.size(); ++i)
+    {
+        t.addCompactTrace( compact_traces[i] );
+    }
+    
+}
+
+
+/** Parse the tree in the column index of a line, and convert it into a time tree for clock trees */
+Tree* TraceReader::parseTree( const std::string &line, size_t index, const std::string &delimiter, bool clock ) const
+{
+    
+    std::vector<std::string> columns;
+    StringUtilities::stringSplit(line, delimiter, columns);
+    
+    if ( index >= columns.size() )
+    {
+        throw RbException( "Could not find a tree in the line \"" + line + "\"" );
+    }
+    
+    NewickConverter c;
+    Tree *tree = c.convertFromNewick( columns[index] );
+    
+    if ( clock == true )
+    {
+        Tree *time_tree = TreeUtilities::convertTree( *tree );
+        delete tree;
+        tree = time_tree;
+    }
+    
+    return tree;
+}
@@ -8,11 +8,14 @@
 
 namespace RevBayesCore {
     
+    class TraceTree;
+    class Tree;
     
     /**
      * Reader for trace files.
      *
      * This reader is a reader of a trace files, e.g., tree-traces or stochastic variable traces.
+     * Tree traces are streamed in blocks of trees, which are parsed in parallel.
      *
      *
      * @copyright Copyright 2009-
@@ -26,11 +29,17 @@ namespace RevBayesCore {
 //        TraceReader();
         
         std::vector<ModelTrace>             readStochasticVariableTrace( const std::string &fn, const std::string &delimiter );
+        void                                readTreeTrace( const std::string &fn, const std::string &delimiter, size_t burnin, size_t thinning, TraceTree &t );   //!< Append the trees of a file to a tree trace
 
         
     protected:
         
         
+    private:
+        
+        void                                addTrees( const std::vector<std::string> &lines, size_t index, const std::string &delimiter, TraceTree &t ) const;
+        Tree*                               parseTree( const std::string &line, size_t index, const std::string &delimiter, bool clock ) const;
+        
     };
     
 }
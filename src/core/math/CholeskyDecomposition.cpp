@@ -0,0 +1,304 @@
+/**
+ * @file
+ * This class constructs and stores the Cholesky decomposition of
+ * a symmetric positive definite matrix.
+ *
+ * @brief Implementation of CholeskyDecomposition
+ *
+ * (c) Copyright 2009-
+ * @date Last modified: $Date$
+ * @author The RevBayes Development Core Team
+ * @license GPL version 3
+ * @version 1.0
+ * @since 2016-10-16, version 1.0
+ *
+ * $Id$
+ */
+
+#include "CholeskyDecomposition.h"
+#include "MatrixReal.h"
+#include "RbConstants.h"
+#include "RbException.h"
+
+#include <cmath>
+
+using namespace RevBayesCore;
+
+
+CholeskyDecomposition::CholeskyDecomposition( void ) :
+    n( 0 ),
+    factor(),
+    positive_definite( false )
+{
+
+}
+
+
+CholeskyDecomposition::CholeskyDecomposition( const MatrixReal &m ) :
+    n( 0 ),
+    factor(),
+    positive_definite( false )
+{
+
+    decompose( m );
+}
+
+
+/**
+ * Solve L^T y = x in place by backward substitution.
+ * We subtract each solved element from the remaining ones, so that we only need row i of L in step i.
+ */
+void CholeskyDecomposition::backSubstitution( std::vector<double> &x ) const
+{
+
+    for (size_t i = n; i-- > 0; )
+    {
+        const double *l = &factor[i*n];
+        double xi = x[i] / l[i];
+        x[i] = xi;
+        for (size_t k = 0; k < i; ++k)
+        {
+            x[k] -= l[k] * xi;
+        }
+    }
+
+}
+
+
+/**
+ * Compute the inverse A^{-1} = L^{-T} L^{-1}.
+ * We store the transpose of L^{-1}, i.e., column j of L^{-1} is row j of u,
+ * so that every element of the inverse is a dot product of two contiguous rows.
+ */
+void CholeskyDecomposition::computeInverse( MatrixReal &inv ) const
+{
+
+    if ( positive_definite == false )
+    {
+        throw RbException("Cannot compute the inverse because the matrix is not positive definite.");
+    }
+
+    std::vector<double> u = std::vector<double>(n*n, 0.0);
+    for (size_t j = 0; j < n; ++j)
+    {
+        // solve L x = e_j, where x_k = 0 for k < j
+        double *x = &u[j*n];
+        x[j] = 1.0 / factor[j*n+j];
+        for (size_t k = j+1; k < n; ++k)
+        {
+            const double *l = &factor[k*n];
+            double sum = 0.0;
+            for (size_t m = j; m < k; ++m)
+            {
+                sum += l[m] * x[m];
+            }
+            x[k] = -sum / l[k];
+        }
+    }
+
+    inv.resize(n, n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double *ui = &u[i*n];
+        for (size_t j = i; j < n; ++j)
+        {
+            const double *uj = &u[j*n];
+            double sum = 0.0;
+            for (size_t k = j; k < n; ++k)
+            {
+                sum += ui[k] * uj[k];
+            }
+            inv[i][j] = sum;
+            inv[j][i] = sum;
+        }
+    }
+
+}
+
+
+/**
+ * Compute the quadratic form x^T A^{-1} x = y^T y with L y = x.
+ */
+double CholeskyDecomposition::computeQuadraticForm( const std::vector<double> &x ) const
+{
+
+    if ( positive_definite == false )
+    {
+        throw RbException("Cannot compute the quadratic form because the matrix is not positive definite.");
+    }
+
+    std::vector<double> y = x;
+    forwardSubstitution( y );
+
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        sum += y[i] * y[i];
+    }
+
+    return sum;
+}
+
+
+/**
+ * Compute the factor L row by row (Cholesky-Banachiewicz).
+ * Element L_ij is the dot product of the first j elements of the rows i and j, which are both contiguous.
+ */
+void CholeskyDecomposition::decompose( const MatrixReal &m )
+{
+
+    if ( m.getNumberOfRows() != m.getNumberOfColumns() )
+    {
+        throw RbException("Cannot compute the Cholesky decomposition of a non-square matrix.");
+    }
+
+    n = m.getNumberOfRows();
+    factor.assign( n*n, 0.0 );
+    positive_definite = true;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const RbVector<double> &a = m[i];
+        double *li = &factor[i*n];
+        for (size_t j = 0; j <= i; ++j)
+        {
+            const double *lj = &factor[j*n];
+            double sum = a[j];
+            for (size_t k = 0; k < j; ++k)
+            {
+                sum -= li[k] * lj[k];
+            }
+
+            if ( j < i )
+            {
+                li[j] = sum / lj[j];
+            }
+            else if ( sum > 0.0 )
+            {
+                li[i] = std::sqrt( sum );
+            }
+            else
+            {
+                positive_definite = false;
+                return;
+            }
+        }
+    }
+
+}
+
+
+/**
+ * Solve L y = x in place by forward substitution.
+ */
+void CholeskyDecomposition::forwardSubstitution( std::vector<double> &x ) const
+{
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double *l = &factor[i*n];
+        double sum = x[i];
+        for (size_t k = 0; k < i; ++k)
+        {
+            sum -= l[k] * x[k];
+        }
+        x[i] = sum / l[i];
+    }
+
+}
+
+
+double CholeskyDecomposition::getLogDeterminant( void ) const
+{
+
+    if ( positive_definite == false )
+    {
+        return RbConstants::Double::nan;
+    }
+
+    double log_det = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        log_det += std::log( factor[i*n+i] );
+    }
+
+    return 2.0 * log_det;
+}
+
+
+/**
+ * Solve A x = b, i.e., L y = b and then L^T x = y.
+ */
+void CholeskyDecomposition::solve( const std::vector<double> &b, std::vector<double> &x ) const
+{
+
+    if ( positive_definite == false )
+    {
+        throw RbException("Cannot solve the linear system because the matrix is not positive definite.");
+    }
+
+    x = b;
+    forwardSubstitution( x );
+    backSubstitution( x );
+
+}
+
+
+/**
+ * Update the factor to the decomposition of A + alpha x x^T by a sequence of rotations (rank-one update if alpha > 0 and downdate if alpha < 0).
+ * A column only changes if x_k is non-zero after the previous rotations, so we skip all columns before the first non-zero element of x.
+ * If the downdated matrix is not positive definite, then we return false and the factor is not valid anymore.
+ */
+bool CholeskyDecomposition::update( const std::vector<double> &v, double alpha )
+{
+
+    if ( positive_definite == false )
+    {
+        return false;
+    }
+
+    if ( alpha == 0.0 )
+    {
+        return true;
+    }
+
+    const double sign = ( alpha > 0.0 ? 1.0 : -1.0 );
+    const double scale = std::sqrt( std::fabs( alpha ) );
+
+    std::vector<double> x = std::vector<double>(n, 0.0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        x[i] = scale * v[i];
+    }
+
+    for (size_t k = 0; k < n; ++k)
+    {
+        double xk = x[k];
+        if ( xk == 0.0 )
+        {
+            continue;
+        }
+
+        double lkk = factor[k*n+k];
+        double r2 = lkk * lkk + sign * xk * xk;
+        if ( r2 <= 0.0 )
+        {
+            positive_definite = false;
+            return false;
+        }
+
+        double r = std::sqrt( r2 );
+        double c = r / lkk;
+        double s = xk / lkk;
+        factor[k*n+k] = r;
+
+        for (size_t i = k+1; i < n; ++i)
+        {
+            double &lik = factor[i*n+k];
+            lik = ( lik + sign * s * x[i] ) / c;
+            x[i] = c * x[i] - s * lik;
+        }
+    }
+
+    return true;
+}
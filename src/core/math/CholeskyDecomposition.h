@@ -0,0 +1,70 @@
+/**
+ * @file
+ * This file contains the declaration of CholeskyDecomposition, which is
+ * used to contain the Cholesky factor of a symmetric positive definite matrix.
+ *
+ * @brief Declaration of CholeskyDecomposition
+ *
+ * (c) Copyright 2009-
+ * @date Last modified: $Date$
+ * @author The RevBayes Development Core Team
+ * @license GPL version 3
+ * @version 1.0
+ * @since 2016-10-16, version 1.0
+ *
+ * $Id$
+ */
+
+#ifndef CholeskyDecomposition_H
+#define CholeskyDecomposition_H
+
+#include <cstddef>
+#include <vector>
+
+
+namespace RevBayesCore {
+
+    class MatrixReal;
+
+    /**
+     * The Cholesky decomposition A = L L^T of a symmetric positive definite matrix A.
+     *
+     * The lower triangular factor L is stored row by row in a single contiguous array,
+     * so that all kernels (the factorization itself, solving, the inverse and the quadratic form)
+     * only compute dot products and updates of contiguous rows.
+     * This is much cheaper than the eigen decomposition, which we otherwise need
+     * for the inverse and the determinant of covariance and precision matrices.
+     *
+     * If the matrix is not positive definite, then the decomposition fails and isPositiveDefinite() returns false.
+     * Only the lower triangle of the matrix is used.
+     *
+     * A rank-one change A + alpha x x^T of the matrix can be applied to the factor in O(n^2) instead of decomposing the matrix again in O(n^3).
+     */
+    class CholeskyDecomposition {
+
+    public:
+                                                CholeskyDecomposition(void);                                                                                        //!< Empty decomposition
+                                                CholeskyDecomposition(const MatrixReal &m);                                                                         //!< Decompose the matrix m
+
+        double                                  computeQuadraticForm(const std::vector<double> &x) const;                                                           //!< Compute x^T A^{-1} x
+        void                                    computeInverse(MatrixReal &inv) const;                                                                              //!< Compute the inverse A^{-1}
+        void                                    decompose(const MatrixReal &m);                                                                                     //!< Decompose the matrix m
+        size_t                                  getDim(void) const { return n; }
+        const double*                           getFactor(void) const { return factor.empty() ? NULL : &factor[0]; }                                                    //!< The lower triangular factor L stored row by row (L_ij at i*n+j)
+        double                                  getLogDeterminant(void) const;                                                                                      //!< Compute the log-determinant of A
+        bool                                    isPositiveDefinite(void) const { return positive_definite; }
+        void                                    solve(const std::vector<double> &b, std::vector<double> &x) const;                                                 //!< Solve A x = b
+        bool                                    update(const std::vector<double> &x, double alpha);                                                                 //!< Update the decomposition to the matrix A + alpha x x^T
+
+    private:
+        void                                    forwardSubstitution(std::vector<double> &x) const;                                                                  //!< Solve L y = x in place
+        void                                    backSubstitution(std::vector<double> &x) const;                                                                     //!< Solve L^T y = x in place
+
+        size_t                                  n;                                                                                                                  //!< Row and column dimension (square matrix)
+        std::vector<double>                     factor;                                                                                                             //!< The lower triangular factor L (row-major, n*n)
+        bool                                    positive_definite;                                                                                                  //!< Did the decomposition succeed?
+    };
+
+}
+
+#endif
@@ -28,6 +28,15 @@
 
 using namespace RevBayesCore;
 
+
+/**
+ * The random number object used instead of the global one by the current thread.
+ * Threads that run independent analyses, e.g., replicates, use this to have their own random number stream.
+ */
+static RandomNumberGenerator *thread_random_number_generator = NULL;
+#pragma omp threadprivate(thread_random_number_generator)
+
+
 /** Default constructor */
 RandomNumberFactory::RandomNumberFactory(void)
 {
@@ -43,6 +52,27 @@ RandomNumberFactory::~RandomNumberFactory(void) {
 }
 
 
+/** Get the random number object of the current thread, which is the global one unless another one was set for this thread */
+RandomNumberGenerator* RandomNumberFactory::getGlobalRandomNumberGenerator(void)
+{
+    
+    if ( thread_random_number_generator != NULL )
+    {
+        return thread_random_number_generator;
+    }
+    
+    return seedGenerator;
+}
+
+
+/** Set the random number object used by the current thread (NULL restores the global random number object) */
+void RandomNumberFactory::setThreadRandomNumberGenerator(RandomNumberGenerator* r)
+{
+    
+    thread_random_number_generator = r;
+}
+
+
 /** Delete a random number object (remove it from the pool too) */
 void RandomNumberFactory::deleteRandomNumberGenerator(RandomNumberGenerator* r) {
 
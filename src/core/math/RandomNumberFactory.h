@@ -39,7 +39,8 @@ namespace RevBayesCore {
                                                         return singleRandomNumberFactory;
                                                     }
 		void                                        deleteRandomNumberGenerator(RandomNumberGenerator* r);                                 //!< Return a random number object to the pool
-		RandomNumberGenerator*                      getGlobalRandomNumberGenerator(void) { return seedGenerator; }                         //!< Return a pointer to the global random number object
+		RandomNumberGenerator*                      getGlobalRandomNumberGenerator(void);                                                  //!< Return a pointer to the global random number object (or the one set for the current thread)
+        void                                        setThreadRandomNumberGenerator(RandomNumberGenerator* r);                              //!< Use a separate random number object in the current thread (NULL for the global one)
 
 	private:
                                                     RandomNumberFactory(void);                                                             //!< Default constructor
@@ -1,60 +1,268 @@
 #include "RandomNumberGenerator.h"
 #include "RbException.h"
 #include <ctime>
+#include <sstream>
 
 
 using namespace RevBayesCore;
 
+namespace {
+    
+    // the constants of the Philox4x32 round function and key schedule
+    const boost::uint32_t PHILOX_M0 = 0xD2511F53;
+    const boost::uint32_t PHILOX_M1 = 0xCD9E8D57;
+    const boost::uint32_t PHILOX_W0 = 0x9E3779B9;
+    const boost::uint32_t PHILOX_W1 = 0xBB67AE85;
+    
+    // the 64-bit finalizer of SplitMix64, used to derive the substreams
+    boost::uint64_t mix64(boost::uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    
+    // a double in [0,1) with 53 random bits
+    inline double toUniform01(boost::uint32_t a, boost::uint32_t b)
+    {
+        return ( (a >> 5) * 67108864.0 + (b >> 6) ) * (1.0 / 9007199254740992.0);
+    }
+    
+}
+
+
 /** Default constructor calling time to get the initial seeds */
 RandomNumberGenerator::RandomNumberGenerator(void) :
-        seed((unsigned int)( time(0) ) ),
-        rng(),
-        zeroone(rng)
+        seed( boost::uint64_t( time(0) ) ),
+        stream( 0 ),
+        counter( 0 ),
+        block_position( 4 )
 {
 
-    rng.seed( seed );
-    zeroone = boost::uniform_01<boost::rand48>(rng);
+}
+
+
+/** Constructor for a given seed and stream */
+RandomNumberGenerator::RandomNumberGenerator(boost::uint64_t s, boost::uint64_t st) :
+        seed( s ),
+        stream( st ),
+        counter( 0 ),
+        block_position( 4 )
+{
 
 }
 
 
+/**
+ * Compute the block of random numbers for the counter c of our stream.
+ * These are the ten rounds of Philox4x32 with the 128-bit counter (c,stream) and the 64-bit key seed.
+ */
+void RandomNumberGenerator::computeBlock(boost::uint64_t c, boost::uint32_t *out) const
+{
+    
+    boost::uint32_t c0 = boost::uint32_t( c );
+    boost::uint32_t c1 = boost::uint32_t( c >> 32 );
+    boost::uint32_t c2 = boost::uint32_t( stream );
+    boost::uint32_t c3 = boost::uint32_t( stream >> 32 );
+    boost::uint32_t k0 = boost::uint32_t( seed );
+    boost::uint32_t k1 = boost::uint32_t( seed >> 32 );
+    
+    for (size_t round = 0; round < 10; ++round)
+    {
+        boost::uint64_t p0 = boost::uint64_t( PHILOX_M0 ) * c0;
+        boost::uint64_t p1 = boost::uint64_t( PHILOX_M1 ) * c2;
+        
+        boost::uint32_t hi0 = boost::uint32_t( p0 >> 32 );
+        boost::uint32_t lo0 = boost::uint32_t( p0 );
+        boost::uint32_t hi1 = boost::uint32_t( p1 >> 32 );
+        boost::uint32_t lo1 = boost::uint32_t( p1 );
+        
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+    
+}
+
+
 /* Get the seed values */
-unsigned int RandomNumberGenerator::getSeed( void ) const
+boost::uint64_t RandomNumberGenerator::getSeed( void ) const
 {
     return seed;
 }
 
 
+/**
+ * Get the complete internal state of the generator as a string.
+ * In contrast to the seed, the state also captures how many numbers have been drawn,
+ * so that restoring it with setState continues the stream exactly where it was (e.g., when resuming from a checkpoint).
+ */
+std::string RandomNumberGenerator::getState( void ) const
+{
+
+    std::stringstream ss;
+    ss << seed << " " << stream << " " << counter << " " << block_position;
+
+    return ss.str();
+}
+
+
+/* Get the stream */
+boost::uint64_t RandomNumberGenerator::getStream( void ) const
+{
+    return stream;
+}
+
+
+/**
+ * Get the i-th substream of this generator.
+ * The substream has the same seed but a different stream, which is derived from our stream and i.
+ * Different substreams never overlap (up to 2^64 blocks each), so they can be used in parallel,
+ * e.g., one per replicate or per thread, and substreams can be split further.
+ */
+RandomNumberGenerator RandomNumberGenerator::getSubstream(boost::uint64_t i) const
+{
+
+    return RandomNumberGenerator( seed, mix64( mix64( stream ) + i + 1 ) );
+}
+
+
 /** Set the seed of the random number generator */
-void RandomNumberGenerator::setSeed(unsigned int s)
+void RandomNumberGenerator::setSeed(boost::uint64_t s)
 {
 
     seed = s;
-    rng.seed( seed );
-    zeroone = boost::uniform_01<boost::rand48>(rng);
+    counter = 0;
+    block_position = 4;
 
 }
 
 
-/*!
+/** Restore the internal state of the random number generator from a string produced by getState */
+void RandomNumberGenerator::setState(const std::string &s)
+{
+
+    std::stringstream ss(s);
+    ss >> seed >> stream >> counter >> block_position;
+
+    if ( ss.fail() || block_position > 4 || (block_position < 4 && counter == 0) )
+    {
+        throw RbException("Could not restore the state of the random number generator from \"" + s + "\".");
+    }
+    
+    if ( block_position < 4 )
+    {
+        computeBlock( counter - 1, block );
+    }
+
+}
+
+
+/** Switch to another stream of the generator with the same seed */
+void RandomNumberGenerator::setStream(boost::uint64_t st)
+{
+
+    stream = st;
+    counter = 0;
+    block_position = 4;
+
+}
+
+
+/**
  * This function generates a uniformly-distributed random variable on the interval [0,1).
- * It is a version of the Marsaglia Multi-Carry.
- *
- * Taken from:
- *   Mathlib : A C Library of Special Functions
- *   Copyright (C) 2000, 2003  The R Development Core Team
- *
- * This random generator has a period of 2^60, which ensures it has the maximum
- * period of 2^32 for unsigned ints (32 bit ints).
+ * Each variable uses two 32-bit numbers of the current block, which gives 53 random bits.
  *
  * \brief Uniform[0,1) random variable.
  * \return Returns a uniformly-distributed random variable on the interval [0,1).
  * \throws Does not throw an error.
- * \see http://stat.fsu.edu/~geo/diehard.html
  */
 double RandomNumberGenerator::uniform01(void)
 {
 
-	// Returns a pseudo-random number between 0 and 1.
-    return zeroone();
+    if ( block_position >= 4 )
+    {
+        computeBlock( counter, block );
+        ++counter;
+        block_position = 0;
+    }
+    
+    double u = toUniform01( block[block_position], block[block_position+1] );
+    block_position += 2;
+    
+    return u;
+}
+
+
+/**
+ * Fill the array x with n uniformly-distributed random variables on the interval [0,1).
+ * The values are the same as for n calls of uniform01(), but whole blocks are computed
+ * without going through the block buffer, which is considerably faster for large n.
+ */
+void RandomNumberGenerator::uniform01(double *x, size_t n)
+{
+    
+    size_t i = 0;
+    
+    // use the remainder of the current block
+    while ( i < n && block_position < 4 )
+    {
+        x[i++] = uniform01();
+    }
+    
+    // fill with whole blocks
+    boost::uint32_t b[4];
+    for ( ; i + 2 <= n; i += 2)
+    {
+        computeBlock( counter, b );
+        ++counter;
+        x[i]   = toUniform01( b[0], b[1] );
+        x[i+1] = toUniform01( b[2], b[3] );
+    }
+    
+    // the last odd value
+    if ( i < n )
+    {
+        x[i] = uniform01();
+    }
+    
+}
+
+
+/** Fill the vector x with uniformly-distributed random variables on the interval [0,1) */
+void RandomNumberGenerator::uniform01(std::vector<double> &x)
+{
+    
+    if ( x.empty() == false )
+    {
+        uniform01( &x[0], x.size() );
+    }
+    
+}
+
+
+/** Get a uniformly distributed 64-bit integer, e.g., to seed another generator */
+boost::uint64_t RandomNumberGenerator::uniform64(void)
+{
+    
+    if ( block_position >= 4 )
+    {
+        computeBlock( counter, block );
+        ++counter;
+        block_position = 0;
+    }
+    
+    boost::uint64_t r = ( boost::uint64_t( block[block_position] ) << 32 ) | block[block_position+1];
+    block_position += 2;
+    
+    return r;
 }
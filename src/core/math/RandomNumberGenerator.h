@@ -18,29 +18,49 @@
 #ifndef RandomNumberGenerator_H
 #define RandomNumberGenerator_H
 
+#include <string>
 #include <vector>
-#include "boost/random.hpp"
+#include "boost/cstdint.hpp"
 
 namespace RevBayesCore {
 
+    /**
+     * The random number generator is the counter-based generator Philox4x32-10 (Salmon et al. 2011).
+     * The n-th block of four 32-bit random numbers is obtained by encrypting the counter (n, stream) with the seed as key.
+     * Hence, the state is just the seed, the stream and the counter, and any stream
+     * can be split into independent substreams (e.g., one per replicate, chain or thread) without any communication.
+     */
     class RandomNumberGenerator {
 
     public:
 
                                             RandomNumberGenerator(void);                            //!< Default constructor using time seed
-                                            
+                                            RandomNumberGenerator(boost::uint64_t s, boost::uint64_t st = 0);  //!< Constructor for a given seed and stream
+
         // Regular functions
-        unsigned int                        getSeed(void) const;                                    //!< Get the seed values
-        void                                setSeed(unsigned int s);                                //!< Set the seeds of the RNG
+        boost::uint64_t                     getSeed(void) const;                                    //!< Get the seed values
+        std::string                         getState(void) const;                                   //!< Get the complete internal state of the RNG
+        boost::uint64_t                     getStream(void) const;                                  //!< Get the stream of the RNG
+        RandomNumberGenerator               getSubstream(boost::uint64_t i) const;                  //!< Get the i-th independent substream of this RNG
+        void                                setSeed(boost::uint64_t s);                             //!< Set the seeds of the RNG
+        void                                setState(const std::string &s);                         //!< Restore the internal state from getState()
+        void                                setStream(boost::uint64_t st);                          //!< Switch to another stream (restarts the counter)
 		double                              uniform01(void);                                        //!< Get a random [0,1) var
+        void                                uniform01(double *x, size_t n);                         //!< Fill an array with random [0,1) vars
+        void                                uniform01(std::vector<double> &x);                      //!< Fill a vector with random [0,1) vars
+        boost::uint64_t                     uniform64(void);                                        //!< Get 64 random bits (e.g., to seed other generators)
 
 	private:
-        unsigned int                        seed;
-        boost::rand48                       rng;
-        boost::uniform_01<boost::rand48>    zeroone;
+        void                                computeBlock(boost::uint64_t c, boost::uint32_t *out) const;  //!< Encrypt the counter c of our stream
+
+        boost::uint64_t                     seed;                                                   //!< The key of the generator
+        boost::uint64_t                     stream;                                                 //!< The upper 64 bits of the counter
+        boost::uint64_t                     counter;                                                //!< The number of blocks generated so far
+        boost::uint32_t                     block[4];                                               //!< The current block of random numbers
+        size_t                              block_position;                                         //!< The next unused number of the block (4 if exhausted)
 
     };
-    
+
 }
 
 #endif
@@ -196,15 +196,9 @@ double RbStatistics::Helper::pointChi2(double prob, double v) {
 int RbStatistics::Helper::poissonInver(double lambda, RandomNumberGenerator& rng) {
     
 	const int bound = 130;
-	static double p_L_last = -1.0;
-	static double p_f0;
+	double p_f0 = exp(-lambda);
 	int x;
     
-	if (lambda != p_L_last) {
-		p_L_last = lambda;
-		p_f0 = exp(-lambda);
-    } 
-    
 	while (1) {  
 		double r = rng.uniform01();  
 		x = 0;  
@@ -257,28 +251,17 @@ int RbStatistics::Helper::poissonLow(double lambda, RandomNumberGenerator& rng)
  */
 int RbStatistics::Helper::poissonRatioUniforms(double lambda, RandomNumberGenerator& rng) {
     
-	static double p_L_last = -1.0;  /* previous L */
-	static double p_a;              /* hat center */
-	static double p_h;              /* hat width */
-	static double p_g;              /* ln(L) */
-	static double p_q;              /* value at mode */
-	static int p_bound;             /* upper bound */
-	int mode;                       /* mode */
+	int mode = (int)lambda;                                                     /* mode */
+	double p_a = lambda + 0.5;                                                  /* hat center */
+	double p_g = log(lambda);                                                   /* ln(L) */
+	double p_q = mode * p_g - RbMath::lnFactorial(mode);                        /* value at mode */
+	double p_h = sqrt(2.943035529371538573 * (lambda + 0.5)) + 0.8989161620588987408; /* hat width */
+	int p_bound = (int)(p_a + 6.0 * p_h);                                       /* upper bound */
 	double u;                       /* uniform random */
 	double lf;                      /* ln(f(x)) */
 	double x;                       /* real sample */
 	int k;                          /* integer sample */
     
-	if (p_L_last != lambda) {
-		p_L_last = lambda;
-		p_a = lambda + 0.5;
-		mode = (int)lambda;
-		p_g  = log(lambda);
-		p_q = mode * p_g - RbMath::lnFactorial(mode);
-		p_h = sqrt(2.943035529371538573 * (lambda + 0.5)) + 0.8989161620588987408;
-		p_bound = (int)(p_a + 6.0 * p_h);
-    }
-    
 	while(1) {
 		u = rng.uniform01();
 		if (u == 0.0) 
@@ -344,11 +327,10 @@ double RbStatistics::Helper::rndGamma(double a, RandomNumberGenerator& rng) {
     const static double a6 = -0.1367177;
     const static double a7 = 0.1233795;
     
-    /* State variables [FIXME for threading!] :*/
-    static double aa = 0.;
-    static double aaa = 0.;
-    static double s, s2, d;    /* no. 1 (step 1) */
-    static double q0, b, si, c;/* no. 2 (step 4) */
+    /* The state variables are local (instead of static as in R) so that
+     * random variables can be drawn concurrently by several threads. */
+    double s, s2, d;           /* no. 1 (step 1) */
+    double q0, b, si, c;       /* no. 2 (step 4) */
     
     double e, p, q, r, t, u, v, w, x, ret_val;
     
@@ -364,11 +346,11 @@ double RbStatistics::Helper::rndGamma(double a, RandomNumberGenerator& rng) {
             p = e * rng.uniform01();
             if (p >= 1.0) {
                 x = -log((e - p) / a);
-                if (exp( rng.uniform01() ) >= (1.0 - a) * log(x))
+                if (-log( 1.0 - rng.uniform01() ) >= (1.0 - a) * log(x))
                     break;
             } else {
                 x = exp(log(p) / a);
-                if (exp( rng.uniform01() ) >= x)
+                if (-log( 1.0 - rng.uniform01() ) >= x)
                     break;
             }
         }
@@ -377,13 +359,10 @@ double RbStatistics::Helper::rndGamma(double a, RandomNumberGenerator& rng) {
     
     /* --- a >= 1 : GD algorithm --- */
     
-    /* Step 1: Recalculations of s2, s, d if a has changed */
-    if (a != aa) {
-        aa = a;
-        s2 = a - 0.5;
-        s = sqrt(s2);
-        d = sqrt32 - s * 12.0;
-    }
+    /* Step 1: Calculations of s2, s, d */
+    s2 = a - 0.5;
+    s = sqrt(s2);
+    d = sqrt32 - s * 12.0;
     /* Step 2: t = standard normal deviate,
      x = (s,1/2) -normal deviate. */
     
@@ -399,10 +378,9 @@ double RbStatistics::Helper::rndGamma(double a, RandomNumberGenerator& rng) {
     if (d * u <= t * t * t)
         return ret_val;
     
-    /* Step 4: recalculations of q0, b, si, c if necessary */
+    /* Step 4: calculations of q0, b, si, c */
     
-    if (a != aaa) {
-        aaa = a;
+    {
         r = 1.0 / a;
         q0 = ((((((q7 * r + q6) * r + q5) * r + q4) * r + q3) * r
                + q2) * r + q1) * r;
@@ -446,7 +424,7 @@ double RbStatistics::Helper::rndGamma(double a, RandomNumberGenerator& rng) {
         /* Step 8: e = standard exponential deviate
          *	u =  0,1 -uniform deviate
          *	t = (b,si)-double exponential (laplace) sample */
-        e = exp( rng.uniform01() );
+        e = -log( 1.0 - rng.uniform01() );
         u = rng.uniform01();
         u = u + u - 1.0;
         if (u < 0.0)
@@ -492,15 +470,11 @@ double RbStatistics::Helper::rndGamma1(double s, RandomNumberGenerator& rng)
 {
     
 	double			r, x = 0.0, small = 1e-37, w;
-	static double   a, p, uf, ss = 10.0, d;
-	
-	if (s != ss) {
-		a  = 1.0 - s;
-		p  = a / (a + s * exp(-a));
-		uf = p * pow(small / a, s);
-		d  = a * log(a);
-		ss = s;
-    }
+	double          a  = 1.0 - s;
+	double          p  = a / (a + s * exp(-a));
+	double          uf = p * pow(small / a, s);
+	double          d  = a * log(a);
+
 	for (;;) {
 		r = rng.uniform01();
 		if (r > p)        
@@ -530,13 +504,9 @@ double RbStatistics::Helper::rndGamma1(double s, RandomNumberGenerator& rng)
 double RbStatistics::Helper::rndGamma2(double s, RandomNumberGenerator& rng) {
     
 	double			r, d, f, g, x;
-	static double	b, h, ss = 0.0;
-	
-	if (s != ss) {
-		b  = s - 1.0;
-		h  = sqrt(3.0 * s - 0.75);
-		ss = s;
-    }
+	double          b = s - 1.0;
+	double          h = sqrt(3.0 * s - 0.75);
+
 	for (;;) {
 		r = rng.uniform01();
 		g = r - r * r;
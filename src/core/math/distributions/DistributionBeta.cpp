@@ -191,12 +191,10 @@ double RbStatistics::Beta::rv(double aa, double bb, RandomNumberGenerator& rng)
     double a, b, alpha;
     double r, s, t, u1, u2, v, w, y, z;
 
-    int qsame;
-    /* FIXME:  Keep Globals (properly) for threading */
-    /* Uses these GLOBALS to save time when many rv's are generated : */
-    static double beta, gamma, delta, k1, k2;
-    static double olda = -1.0;
-    static double oldb = -1.0;
+    /* The constants of the algorithms are local (instead of static as in R) so that
+     * random variables can be drawn concurrently by several threads.
+     * Computing them is cheap compared to the rejection loop. */
+    double beta, gamma, delta, k1, k2;
 
     if (aa <= 0. || bb <= 0. || (!RbMath::isFinite(aa) && !RbMath::isFinite(bb)))
     {
@@ -215,14 +213,6 @@ double RbStatistics::Beta::rv(double aa, double bb, RandomNumberGenerator& rng)
     	return 0.0;
     }
     
-    /* Test if we need new "initializing" */
-    qsame = (olda == aa) && (oldb == bb);
-    if (!qsame)
-    {
-        olda = aa;
-        oldb = bb;
-    }
-
     a = RbMath::min(aa, bb);
     b = RbMath::max(aa, bb); /* a <= b */
     alpha = a + b;
@@ -240,14 +230,11 @@ w = RbConstants::Double::max
         /* --- Algorithm BC --- */
 
         /* changed notation, now also a <= b (was reversed) */
-        if (!qsame)
-        {
-            /* initialize */
-            beta = 1.0 / a;
-            delta = 1.0 + b - a;
-            k1 = delta * (0.0138889 + 0.0416667 * a) / (b * beta - 0.777778);
-            k2 = 0.25 + (0.5 + 0.25 / delta) * a;
-        }
+        /* initialize */
+        beta = 1.0 / a;
+        delta = 1.0 + b - a;
+        k1 = delta * (0.0138889 + 0.0416667 * a) / (b * beta - 0.777778);
+        k2 = 0.25 + (0.5 + 0.25 / delta) * a;
         /* FIXME: "do { } while()", but not trivially because of "continue"s:*/
         for(;;)
         {
@@ -290,12 +277,9 @@ w = RbConstants::Double::max
     {
         /* Algorithm BB */
 
-        if (!qsame)
-        {
-            /* initialize */
-            beta = sqrt((alpha - 2.0) / (2.0 * a * b - alpha));
-            gamma = a + 1.0 / beta;
-        }
+        /* initialize */
+        beta = sqrt((alpha - 2.0) / (2.0 * a * b - alpha));
+        gamma = a + 1.0 / beta;
         
         do {
             u1 = rng.uniform01();
@@ -323,14 +323,12 @@ double RbStatistics::Binomial::quantile(double quantile_prob, double n, double p
 
 int RbStatistics::Binomial::rv(double nin, double pp, RevBayesCore::RandomNumberGenerator &rng)
 {
-    /* FIXME: These should become THREAD_specific globals : */
+    /* The setup variables are local (instead of static as in R) so that
+     * random variables can be drawn concurrently by several threads. */
     
-    static double c, fm, npq, p1, p2, p3, p4, qn;
-    static double xl, xll, xlr, xm, xr;
-    
-    static double psave = -1.0;
-    static int nsave = -1;
-    static int m;
+    double c = 0.0, fm = 0.0, npq = 0.0, p1 = 0.0, p2 = 0.0, p3 = 0.0, p4 = 0.0, qn = 0.0;
+    double xl = 0.0, xll = 0.0, xlr = 0.0, xm = 0.0, xr = 0.0;
+    int m = 0;
     
     double f, f1, f2, u, v, w, w2, x, x1, x2, z, z2;
     double p, q, np, g, r, al, alv, amaxp, ffm, ynorm;
@@ -358,39 +356,28 @@ int RbStatistics::Binomial::rv(double nin, double pp, RevBayesCore::RandomNumber
     r = p / q;
     g = r * (n + 1);
     
-    /* Setup, perform only when parameters change [using static (globals): */
-    
-    /* FIXING: Want this thread safe
-     -- use as little (thread globals) as possible
-     */
-    if (pp != psave || n != nsave) {
-        psave = pp;
-        nsave = n;
-        if (np < 30.0) {
-            /* inverse cdf logic for mean less than 30 */
-            qn = pow(q, (double) n);
-            goto L_np_small;
-        } else {
-            ffm = np + p;
-            m = int(ffm);
-            fm = m;
-            npq = np * q;
-            p1 = (int)(2.195 * sqrt(npq) - 4.6 * q) + 0.5;
-            xm = fm + 0.5;
-            xl = xm - p1;
-            xr = xm + p1;
-            c = 0.134 + 20.5 / (15.3 + fm);
-            al = (ffm - xl) / (ffm - xl * p);
-            xll = al * (1.0 + 0.5 * al);
-            al = (xr - ffm) / (xr * q);
-            xlr = al * (1.0 + 0.5 * al);
-            p2 = p1 * (1.0 + c + c);
-            p3 = p2 + c / xll;
-            p4 = p3 + c / xlr;
-        }
-    } else if (n == nsave) {
-        if (np < 30.0)
-            goto L_np_small;
+    /* Setup */
+    if (np < 30.0) {
+        /* inverse cdf logic for mean less than 30 */
+        qn = pow(q, (double) n);
+        goto L_np_small;
+    } else {
+        ffm = np + p;
+        m = int(ffm);
+        fm = m;
+        npq = np * q;
+        p1 = (int)(2.195 * sqrt(npq) - 4.6 * q) + 0.5;
+        xm = fm + 0.5;
+        xl = xm - p1;
+        xr = xm + p1;
+        c = 0.134 + 20.5 / (15.3 + fm);
+        al = (ffm - xl) / (ffm - xl * p);
+        xll = al * (1.0 + 0.5 * al);
+        al = (xr - ffm) / (xr * q);
+        xlr = al * (1.0 + 0.5 * al);
+        p2 = p1 * (1.0 + c + c);
+        p3 = p2 + c / xll;
+        p4 = p3 + c / xlr;
     }
     
     /*-------------------------- np = n*p >= 30 : ------------------- */
@@ -478,7 +465,7 @@ L_np_small:
         }
     }
 finis:
-    if (psave > 0.5)
+    if (pp > 0.5)
         ix = n - ix;
     return ix;
 }
@@ -23,6 +23,8 @@
 #include "RbConstants.h"
 #include "RbMathFunctions.h"
 #include "RbMathLogic.h"
+#include "RbException.h"
+#include "RandomNumberGenerator.h"
 
 using namespace RevBayesCore;
 
@@ -141,3 +143,106 @@ double RbStatistics::Gamma::rv(double shape, double rate, RandomNumberGenerator&
 	return (RbStatistics::Helper::rndGamma(shape, rng) / rate);
 }
 
+
+/*!
+ * This function fills the array x with n gamma-distributed random variables.
+ * We use the method of Marsaglia and Tsang (2000) on batches of normal and uniform variables.
+ * Its acceptance rate is above 95% for any shape, so a batch of candidates slightly larger than
+ * the number of missing variables is usually enough.
+ * For a shape smaller than 1, we draw Gamma(shape+1) variables and multiply them by U^(1/shape).
+ *
+ * \brief Array of Gamma(a,b) random variables.
+ * \param shape is the shape parameter.
+ * \param rate is the rate parameter.
+ * \param rng is a pointer to a random number object.
+ * \param x is the array to fill.
+ * \param n is the number of random variables.
+ * \throws Throws an RbException if the shape is negative or not finite.
+ * \see Marsaglia, G. and Tsang, W. W. 2000. A simple method for generating gamma variables.
+ *      ACM Transactions on Mathematical Software 26:363-372.
+ */
+void RbStatistics::Gamma::rv(double shape, double rate, RandomNumberGenerator& rng, double *x, size_t n) {
+    
+    if ( RbMath::isFinite(shape) == false || shape < 0.0 )
+    {
+        throw RbException("Infinite parameters for rgamma.");
+    }
+    
+    if ( shape == 0.0 )
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            x[i] = 0.0;
+        }
+        return;
+    }
+    
+    double a = ( shape < 1.0 ? shape + 1.0 : shape );
+    double d = a - 1.0 / 3.0;
+    double c = 1.0 / sqrt( 9.0 * d );
+    
+    std::vector<double> z;
+    std::vector<double> u;
+    size_t i = 0;
+    while ( i < n )
+    {
+        size_t num_candidates = (n - i) + (n - i) / 16 + 1;
+        z.resize( num_candidates );
+        u.resize( num_candidates );
+        RbStatistics::Normal::rv(0.0, 1.0, rng, z);
+        rng.uniform01( u );
+        
+        for (size_t j = 0; j < num_candidates && i < n; ++j)
+        {
+            double v = 1.0 + c * z[j];
+            if ( v > 0.0 )
+            {
+                v = v * v * v;
+                double z2 = z[j] * z[j];
+                if ( u[j] < 1.0 - 0.0331 * z2 * z2 || log( u[j] ) < 0.5 * z2 + d * (1.0 - v + log( v )) )
+                {
+                    x[i] = d * v;
+                    ++i;
+                }
+            }
+        }
+    }
+    
+    if ( shape < 1.0 )
+    {
+        u.resize( n );
+        rng.uniform01( u );
+        double inv_shape = 1.0 / shape;
+        for (size_t j = 0; j < n; ++j)
+        {
+            x[j] *= pow( 1.0 - u[j], inv_shape );
+        }
+    }
+    
+    for (size_t j = 0; j < n; ++j)
+    {
+        x[j] /= rate;
+    }
+    
+}
+
+
+/*!
+ * This function fills the vector x with gamma-distributed random variables.
+ *
+ * \brief Vector of Gamma(a,b) random variables.
+ * \param shape is the shape parameter.
+ * \param rate is the rate parameter.
+ * \param rng is a pointer to a random number object.
+ * \param x is the vector to fill.
+ * \throws Throws an RbException if the shape is negative or not finite.
+ */
+void RbStatistics::Gamma::rv(double shape, double rate, RandomNumberGenerator& rng, std::vector<double> &x) {
+    
+    if ( x.empty() == false )
+    {
+        rv( shape, rate, rng, &x[0], x.size() );
+    }
+    
+}
+
@@ -18,6 +18,9 @@
 #ifndef DistributionGamma_H
 #define DistributionGamma_H
 
+#include <cstddef>
+#include <vector>
+
 namespace RevBayesCore {
     
     class RandomNumberGenerator;
@@ -32,6 +35,8 @@ namespace RevBayesCore {
             double                      cdf(double a, double b, double x);                                    /*!< Gamma(a,b) cumulative probability */
             double                      quantile(double a, double b, double p);                               /*!< Gamma(a,b) quantile */
             double                      rv(double a, double b, RandomNumberGenerator& rng);                   /*!< Gamma(a,b) random variable */
+            void                        rv(double a, double b, RandomNumberGenerator& rng, double *x, size_t n);        /*!< Fill an array with n Gamma(a,b) random variables */
+            void                        rv(double a, double b, RandomNumberGenerator& rng, std::vector<double> &x);     /*!< Fill a vector with Gamma(a,b) random variables */
         
         }
     }
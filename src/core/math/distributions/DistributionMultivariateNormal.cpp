@@ -7,6 +7,7 @@
 //
 
 
+#include "CholeskyDecomposition.h"
 #include "DistributionMultivariateNormal.h"
 #include "DistributionNormal.h"
 #include "EigenSystem.h"
@@ -51,7 +52,29 @@ double RbStatistics::MultivariateNormal::pdfCovariance(const std::vector<double>
  */
 double RbStatistics::MultivariateNormal::lnPdfCovariance(const std::vector<double>& mu, const MatrixReal& sigma, const std::vector<double> &x, double scale)
 {
-    // we compute the precision matrix, which is the inverse of the covariance matrix
+    
+    // a valid covariance matrix is symmetric positive definite,
+    // so we can get the determinant and the quadratic form from its Cholesky decomposition without inverting it
+    if ( sigma.isSymmetric() == true && sigma.getCholeskyDecomposition().isPositiveDefinite() == true )
+    {
+        const CholeskyDecomposition &cholesky = sigma.getCholeskyDecomposition();
+        
+        double logNormalize = -0.5 * log( RbConstants::TwoPI );
+        
+        size_t dim = x.size();
+        std::vector<double> diff = std::vector<double>(dim,0.0);
+        for (size_t i=0; i<dim; i++)
+        {
+            diff[i] = x[i] - mu[i];
+        }
+        
+        double s2 = cholesky.computeQuadraticForm( diff );
+        double logDet = cholesky.getLogDeterminant();
+        
+        return dim * logNormalize + 0.5 * (-logDet - dim * log(scale) - s2 / scale);
+    }
+    
+    // otherwise we compute the precision matrix, which is the inverse of the covariance matrix
     // and then simply call the lnPDF for the precision matrix.
     // This simplifies the coding.
     MatrixReal omega = sigma.computeInverse();
@@ -84,16 +107,16 @@ std::vector<double> RbStatistics::MultivariateNormal::rvCovariance(const std::ve
     const std::vector<double>& eigen = eigensystem.getRealEigenvalues();
     
     // draw the normal variate in eigen basis
+    RbStatistics::Normal::rv(0.0, 1.0, rng, w);
     for (size_t i=0; i<dim; i++)
     {
-//        w[i] = RbStatistics::Normal::rv(0, sqrtScale, rng);
         
         if ( eigen[i] < 0.0 )
         {
             throw RbException("Cannot draw random value of multivariate normal distribution because eigenvalues of the covariance matrix are negative.");
         }
         
-        w[i] = RbStatistics::Normal::rv(0, sqrtScale * sqrt(eigen[i]), rng);
+        w[i] *= sqrtScale * sqrt(eigen[i]);
     }
     
     // get the eigenvector
@@ -155,17 +178,22 @@ double RbStatistics::MultivariateNormal::lnPdfPrecision(const std::vector<double
         }
     
     size_t dim = x.size();
-    std::vector<double> tmp = std::vector<double>(dim,0.0);
+    std::vector<double> diff = std::vector<double>(dim,0.0);
+    for (size_t i=0; i<dim; i++)
+        {
+        diff[i] = x[i] - mu[i];
+        }
     
     double s2 = 0;
     for (size_t i=0; i<dim; i++)
         {
+        const RbVector<double> &omega_i = omega[i];
         double tmp = 0;
         for (size_t j=0; j<dim; j++)
             {
-            tmp += omega[i][j] * (x[j] - mu[j]);
+            tmp += omega_i[j] * diff[j];
             }
-        s2 += (x[i] - mu[i]) * tmp;
+        s2 += diff[i] * tmp;
         }
     
     double lnProb = dim * logNormalize + 0.5 * (logDet - dim * log(scale) - s2 / scale);
@@ -198,15 +226,15 @@ std::vector<double> RbStatistics::MultivariateNormal::rvPrecision(const std::vec
     const std::vector<double>& eigen = eigensystem.getRealEigenvalues();
     
     // draw the normal variate in eigen basis
+    RbStatistics::Normal::rv(0.0, 1.0, rng, w);
     for (size_t i=0; i<dim; i++)
     {
-//        w[i] = RbStatistics::Normal::rv(0, sqrtScale, rng);
         if ( eigen[i] < 0.0 )
         {
             throw RbException("Cannot draw random value of multivariate normal distribution because eigenvalues of the covariance matrix are negative.");
         }
 
-        w[i] = RbStatistics::Normal::rv(0, sqrtScale / sqrt(eigen[i]), rng);
+        w[i] *= sqrtScale / sqrt(eigen[i]);
     }
     
     // get the eigenvector
@@ -297,3 +297,60 @@ double RbStatistics::Normal::rv(double mu, double sigma, RandomNumberGenerator&
 	//availableNormalRv = true;
 	return ( mu + sigma * (v2 * fac) );
 }
+
+/*!
+ * This function fills the array x with n normally-distributed random variables.
+ * In contrast to the scalar version, we use the Box-Muller transform on a batch of uniforms,
+ * which needs no rejection step and uses both variables of each pair.
+ * The loop has no branches, so that the compiler can vectorize the transform.
+ *
+ * \brief Array of Normal(mu,sigma) random variables.
+ * \param mu is the mean parameter of the normal.
+ * \param sigma is the variance parameter of the normal.
+ * \param rng is a pointer to a random number object.
+ * \param x is the array to fill.
+ * \param n is the number of random variables.
+ * \throws Does not throw an error.
+ */
+void RbStatistics::Normal::rv(double mu, double sigma, RandomNumberGenerator& rng, double *x, size_t n) {
+    
+    size_t num_pairs = n / 2;
+    std::vector<double> u = std::vector<double>( 2 * num_pairs + 2 );
+    rng.uniform01( &u[0], 2 * num_pairs + (n % 2) * 2 );
+    
+    for (size_t i = 0; i < num_pairs; ++i)
+    {
+        // we use 1-u for the radius so that the argument of the log is in (0,1]
+        double r     = sigma * sqrt( -2.0 * log( 1.0 - u[2*i] ) );
+        double theta = RbConstants::TwoPI * u[2*i+1];
+        x[2*i]   = mu + r * cos( theta );
+        x[2*i+1] = mu + r * sin( theta );
+    }
+    
+    if ( n % 2 == 1 )
+    {
+        double r     = sigma * sqrt( -2.0 * log( 1.0 - u[2*num_pairs] ) );
+        double theta = RbConstants::TwoPI * u[2*num_pairs+1];
+        x[n-1] = mu + r * cos( theta );
+    }
+    
+}
+
+/*!
+ * This function fills the vector x with normally-distributed random variables.
+ *
+ * \brief Vector of Normal(mu,sigma) random variables.
+ * \param mu is the mean parameter of the normal.
+ * \param sigma is the variance parameter of the normal.
+ * \param rng is a pointer to a random number object.
+ * \param x is the vector to fill.
+ * \throws Does not throw an error.
+ */
+void RbStatistics::Normal::rv(double mu, double sigma, RandomNumberGenerator& rng, std::vector<double> &x) {
+    
+    if ( x.empty() == false )
+    {
+        rv( mu, sigma, rng, &x[0], x.size() );
+    }
+    
+}
@@ -18,6 +18,9 @@
 #ifndef DistributionNormal_H
 #define DistributionNormal_H
 
+#include <cstddef>
+#include <vector>
+
 namespace RevBayesCore {
     
     class RandomNumberGenerator;
@@ -36,6 +39,8 @@ namespace RevBayesCore {
             double                      quantile(double mu, double sigma, double p);                            /*!< Normal(mu,sigma) quantile */
             double                      rv(RandomNumberGenerator& rng);                                         /*!< Normal(0,1) random variable */
             double                      rv(double mu, double sigma, RandomNumberGenerator& rng);                /*!< Normal(mu,sigma) random variable */
+            void                        rv(double mu, double sigma, RandomNumberGenerator& rng, double *x, size_t n);       /*!< Fill an array with n Normal(mu,sigma) random variables */
+            void                        rv(double mu, double sigma, RandomNumberGenerator& rng, std::vector<double> &x);    /*!< Fill a vector with Normal(mu,sigma) random variables */
         }
     }
 }
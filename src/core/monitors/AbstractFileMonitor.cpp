@@ -186,6 +186,25 @@ void AbstractFileMonitor::combineReplicates( size_t n_reps )
 }
 
 
+/**
+ * Get the current size of the output file, i.e., the offset where the next sample will be written.
+ * We flush the stream first so that the offset matches the content of the file on disk.
+ */
+std::streamoff AbstractFileMonitor::getFileOffset( void )
+{
+    
+    if ( out_stream.is_open() == false )
+    {
+        return -1;
+    }
+    
+    out_stream.flush();
+    out_stream.seekp(0, std::ios::end);
+    
+    return out_stream.tellp();
+}
+
+
 bool AbstractFileMonitor::isFileMonitor( void ) const
 {
     return true;
@@ -460,3 +479,53 @@ void AbstractFileMonitor::setPrintVersion(bool tf)
     writeVersion = tf;
     
 }
+
+
+/**
+ * Truncate the output file to the given size.
+ * This removes the samples that were written after a checkpoint so that a resumed analysis
+ * continues the file exactly where the checkpoint was taken.
+ *
+ * \param[in]   o   The size of the file (in bytes) at the time of the checkpoint.
+ */
+void AbstractFileMonitor::truncateFile(std::streamoff o)
+{
+    
+    if ( o < 0 )
+    {
+        return;
+    }
+    
+    bool was_open = out_stream.is_open();
+    if ( was_open == true )
+    {
+        out_stream.close();
+    }
+    
+    // read the part of the file that we keep
+    std::ifstream in_stream( working_file_name.c_str(), std::ios::in | std::ios::binary );
+    std::vector<char> buffer = std::vector<char>( size_t(o), ' ' );
+    if ( o > 0 )
+    {
+        in_stream.read( &buffer[0], o );
+    }
+    if ( in_stream.fail() )
+    {
+        throw RbException( "Could not restore monitor file '" + working_file_name + "' because it is shorter than expected." );
+    }
+    in_stream.close();
+    
+    // and write it back
+    std::ofstream trunc_stream( working_file_name.c_str(), std::ios::out | std::ios::binary | std::ios::trunc );
+    if ( o > 0 )
+    {
+        trunc_stream.write( &buffer[0], o );
+    }
+    trunc_stream.close();
+    
+    if ( was_open == true )
+    {
+        openStream( true );
+    }
+    
+}
@@ -49,6 +49,7 @@ namespace RevBayesCore {
         // FileMonitor functions
         void                                closeStream(void);                                                  //!< Close stream after finish writing
         void                                combineReplicates(size_t n);                                        //!< Combine results after finish writing
+        std::streamoff                      getFileOffset(void);                                                //!< Get the current size of the output file
         bool                                isFileMonitor( void ) const;
         void                                openStream(bool reopen);                                            //!< Open the stream for writing
         void                                setAppend(bool tf);                                                 //!< Set if the monitor should append to an existing file
@@ -56,6 +57,7 @@ namespace RevBayesCore {
         void                                setPrintPosterior(bool tf);                                         //!< Set flag whether to print the posterior probability
         void                                setPrintPrior(bool tf);                                             //!< Set flag whether to print the prior probability
         void                                setPrintVersion(bool tf);                                           //!< Set flag whether to print the version
+        void                                truncateFile(std::streamoff o);                                     //!< Truncate the output file to the given size
 
         // functions you may want to overwrite
         virtual void                        monitorVariables(unsigned long gen);                                //!< Monitor at generation gen
@@ -224,6 +224,17 @@ bool Monitor::isEnabled( void ) const
 }
 
 
+/**
+ * Get the current size of the output of this monitor, i.e., the offset where the next sample will be written.
+ * Monitors without an output file return -1.
+ * Overwrite this method if necessary.
+ */
+std::streamoff Monitor::getFileOffset( void )
+{
+    return -1;
+}
+
+
 /**
  * Is this a file monitor?
  * Overwrite this method if necessary.
@@ -416,6 +427,16 @@ void Monitor::reset(size_t numCycles)
 }
 
 
+/**
+ * Truncate the output file to the given size, e.g., to remove the samples written after the last checkpoint.
+ * Overwrite this method for monitors that write into a file.
+ */
+void Monitor::truncateFile(std::streamoff o)
+{
+    // dummy implementation
+}
+
+
 std::ostream& RevBayesCore::operator<<(std::ostream& o, const Monitor& x)
 {
     o << "Monitor";
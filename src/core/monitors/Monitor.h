@@ -37,6 +37,7 @@ namespace RevBayesCore {
         virtual void                                combineReplicates(size_t n);                                        //!< Combine results from several replicate analyses
         virtual void                                disable(void);                                                      //!< Disable this monitor (momentarily)
         virtual void                                enable(void);                                                       //!< Enable this monitor
+        virtual std::streamoff                      getFileOffset(void);                                                //!< Get the current size of the output (-1 if there is no output file)
         virtual bool                                isEnabled(void) const;                                              //!< Is the monitor currently enabled?
         virtual bool                                isScreenMonitor(void) const;                                        //!< Is this a screen monitor?
         virtual bool                                isFileMonitor(void) const;
@@ -46,6 +47,7 @@ namespace RevBayesCore {
         virtual void                                swapNode(DagNode *oldN, DagNode *newN);
         virtual void                                removeVariable(DagNode *n);
         virtual void                                reset(size_t numCycles);                                            //!< Reset the monitor for a new start.
+        virtual void                                truncateFile(std::streamoff o);                                     //!< Truncate the output file to the given size (e.g., when resuming from a checkpoint)
 
         // getters and setters
         const std::vector<DagNode *>&               getDagNodes(void) const;                                            //!< Get the nodes vector
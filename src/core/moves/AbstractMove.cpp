@@ -1,5 +1,6 @@
 #include "AbstractMove.h"
 #include "DagNode.h"
+#include "RbConstants.h"
 #include "RbException.h"
 
 using namespace RevBayesCore;
@@ -17,7 +18,8 @@ AbstractMove::AbstractMove( double w, bool t ) :
     nodes(  ),
     affected_nodes(  ),
     weight( w ),
-    auto_tuning( t )
+    auto_tuning( t ),
+    evaluation_plan_valid( false )
 {
     
 }
@@ -35,7 +37,8 @@ AbstractMove::AbstractMove( const std::vector<DagNode*> &n, double w, bool t ) :
     nodes( n ),
     affected_nodes( ),
     weight( w ),
-    auto_tuning( t )
+    auto_tuning( t ),
+    evaluation_plan_valid( false )
 {
     
     for (std::vector<DagNode*>::iterator it = nodes.begin(); it != nodes.end(); ++it)
@@ -78,7 +81,8 @@ AbstractMove::AbstractMove( const AbstractMove &m ) : Move( m ),
     nodes( m.nodes ),
     affected_nodes( m.affected_nodes ),
     weight( m.weight ),
-    auto_tuning( m.auto_tuning  )
+    auto_tuning( m.auto_tuning  ),
+    evaluation_plan_valid( false )
 {
     
     
@@ -155,6 +159,8 @@ AbstractMove& AbstractMove::operator=(const RevBayesCore::AbstractMove &m)
         affected_nodes  = m.affected_nodes;
         nodes           = m.nodes;
         
+        evaluation_plan_valid = false;
+        
         
         for (size_t i = 0; i < nodes.size(); ++i)
         {
@@ -195,6 +201,7 @@ void AbstractMove::addNode( DagNode *n )
     if ( exists == false )
     {
         nodes.push_back( n );
+        evaluation_plan_valid = false;
         
         // add myself to the set of moves
         n->addMove( this );
@@ -226,6 +233,46 @@ void AbstractMove::autoTune( void )
 
 
 
+/**
+ * Compile the evaluation plan of this move.
+ * The move's own nodes and the affected nodes do not change unless the DAG is rewired (e.g., by swapNode),
+ * so we collect the stochastic nodes among them once into flat lists and only evaluate those at every step.
+ * Deterministic nodes never contribute to the probability ratio and are skipped.
+ * We split the nodes into the prior and the likelihood nodes, so that the (usually cheap) prior can be
+ * evaluated first and the likelihood is not computed at all if the prior ratio is not a valid number.
+ */
+void AbstractMove::compileEvaluationPlan( void )
+{
+    
+    prior_nodes.clear();
+    likelihood_nodes.clear();
+    
+    std::vector<DagNode*> plan_nodes = nodes;
+    plan_nodes.insert( plan_nodes.end(), affected_nodes.begin(), affected_nodes.end() );
+    
+    for (size_t i = 0; i < plan_nodes.size(); ++i)
+    {
+        DagNode *the_node = plan_nodes[i];
+        
+        if ( the_node->isStochastic() == false )
+        {
+            continue;
+        }
+        
+        if ( the_node->isClamped() == true )
+        {
+            likelihood_nodes.push_back( the_node );
+        }
+        else
+        {
+            prior_nodes.push_back( the_node );
+        }
+    }
+    
+    evaluation_plan_valid = true;
+}
+
+
 /**
  * Decrement the counter for the number of tried attempts.
  */
@@ -261,6 +308,18 @@ const std::vector<DagNode*>& AbstractMove::getDagNodes( void ) const
 }
 
 
+/**
+ * Get the current tuning parameter of the move.
+ * Moves without a tuning parameter return NaN.
+ *
+ * \return    The tuning parameter.
+ */
+double AbstractMove::getMoveTuningParameter( void ) const
+{
+    return RbConstants::Double::nan;
+}
+
+
 /**
  * Get the number of how often the move has been used.
  *
@@ -360,6 +419,7 @@ void AbstractMove::removeNode( RevBayesCore::DagNode *n )
         if ( *it == n )
         {
             nodes.erase( it );
+            evaluation_plan_valid = false;
             break;
         }
     }
@@ -401,6 +461,43 @@ void AbstractMove::resetMoveCounters( void )
 }
 
 
+/**
+ * Set the tuning parameter of the move, e.g., when resuming from a checkpoint.
+ * This is only a hook for derived classes that have a tuning parameter,
+ * and here we provide only a dummy implementation.
+ *
+ * \param[in]     tp     The new tuning parameter.
+ */
+void AbstractMove::setMoveTuningParameter( double tp )
+{
+    // dummy implementation
+}
+
+
+/**
+ * Set the number of accepted proposals, e.g., when resuming from a checkpoint.
+ * The base class does not count acceptances (see getNumberAccepted),
+ * so here we provide only a dummy implementation.
+ *
+ * \param[in]     n     The number of accepted proposals.
+ */
+void AbstractMove::setNumberAccepted( size_t n )
+{
+    // dummy implementation
+}
+
+
+/**
+ * Set the number of how often the move has been tried, e.g., when resuming from a checkpoint.
+ *
+ * \param[in]     n     The number of tries.
+ */
+void AbstractMove::setNumberTried( size_t n )
+{
+    num_tried = (unsigned int)n;
+}
+
+
 /**
  * Swap the current variable for a new one.
  *
@@ -465,6 +562,9 @@ void AbstractMove::swapNode(DagNode *oldN, DagNode *newN)
         
     }
     
+    // the DAG has been rewired so we need a new evaluation plan
+    evaluation_plan_valid = false;
+    
     swapNodeInternal(oldN, newN);
     
 }
@@ -43,6 +43,7 @@ namespace RevBayesCore {
         void                                                    addNode(DagNode* p);                                                //!< add a node to the proposal
         void                                                    autoTune(void);                                                     //!< Automatic tuning of the move.
         void                                                    decrementTriedCounter(void);                        //!< Get update weight of InferenceMove
+        virtual double                                          getMoveTuningParameter(void) const;                                 //!< Get the tuning parameter of the move (NaN if the move has none)
         virtual size_t                                          getNumberAccepted(void) const;                                      //!< Get update weight of InferenceMove
         size_t                                                  getNumberTried(void) const;                                         //!< Get the number of tries for this move since the last reset
         double                                                  getUpdateWeight(void) const;                                        //!< Get update weight of move
@@ -51,6 +52,9 @@ namespace RevBayesCore {
         void                                                    performHillClimbingStep(double lHeat, double pHeat);                //!< Perform the move.
         void                                                    removeNode(DagNode* p);                                             //!< remove a node from the proposal
         void                                                    resetCounters(void);                                                //!< Reset the counters such as numTried.
+        virtual void                                            setMoveTuningParameter(double tp);                                  //!< Set the tuning parameter of the move (ignored if the move has none)
+        virtual void                                            setNumberAccepted(size_t n);                                        //!< Set the number of accepted proposals
+        void                                                    setNumberTried(size_t n);                                           //!< Set the number of tries
         
     protected:
         AbstractMove(double w, bool autoTune = false);                                              //!< Constructor
@@ -69,12 +73,20 @@ namespace RevBayesCore {
         // virtual methods
         virtual void                                            resetMoveCounters(void);                                            //!< Reset the counters such as numTried and numAccepted.
         
+        // protected methods
+        void                                                    compileEvaluationPlan(void);                                        //!< Collect the nodes whose probabilities need to be evaluated by this move
+        
         // parameters
         std::vector<DagNode*>                                   nodes;
         RbOrderedSet<DagNode*>                                  affected_nodes;                                                      //!< The affected nodes by this move.
         double                                                  weight;
         bool                                                    auto_tuning;
         unsigned int                                            num_tried;                                                           //!< Number of times tried
+        
+        // the evaluation plan, i.e., the flat list of stochastic nodes among the move's nodes and the affected nodes
+        std::vector<DagNode*>                                   prior_nodes;                                                         //!< The unclamped stochastic nodes (prior ratio)
+        std::vector<DagNode*>                                   likelihood_nodes;                                                    //!< The clamped stochastic nodes (likelihood ratio)
+        bool                                                    evaluation_plan_valid;                                               //!< Do we need to compile the plan again, e.g., after swapping a node?
                 
     };
     
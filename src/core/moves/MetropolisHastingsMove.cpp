@@ -5,8 +5,10 @@
 #include "RandomNumberGenerator.h"
 #include "RbException.h"
 #include "RbMathLogic.h"
+#include "RbSettings.h"
 
 #include <cmath>
+#include <exception>
 #include <iomanip>
 #include <sstream>
 #include <iostream>
@@ -110,6 +112,16 @@ const std::string& MetropolisHastingsMove::getMoveName( void ) const
 }
 
 
+/**
+ * Get the tuning parameter of the move, which is the tuning parameter of the proposal.
+ */
+double MetropolisHastingsMove::getMoveTuningParameter( void ) const
+{
+    
+    return proposal->getProposalTuningParameter();
+}
+
+
 /**
  * How often was the move accepted
  */
@@ -132,101 +144,169 @@ Proposal& MetropolisHastingsMove::getProposal( void )
 }
 
 
-void MetropolisHastingsMove::performHillClimbingMove( double lHeat, double pHeat )
+/**
+ * Compute the prior and likelihood ratios of the proposed state from the evaluation plan.
+ * We stop as soon as one of the ratios is not a valid number, because the proposal will be rejected anyway.
+ *
+ * If the move affects many likelihood nodes (e.g., a parameter shared by many partitions or gene trees),
+ * then we evaluate these nodes concurrently.
+ * The likelihood nodes are conditionally independent given their parents, so we only need to update
+ * the lazily computed values of the parents first. The ratios are summed afterwards in the order of the plan,
+ * so that the result does not depend on the number of threads.
+ * We only do this if there are at least as many nodes as threads, because otherwise the threads
+ * are better used within the likelihood computation of each node.
+ */
+void MetropolisHastingsMove::computeLnProbabilityRatios( double ln_hastings_ratio, double &ln_prior_ratio, double &ln_likelihood_ratio )
 {
     
-    // Propose a new value
-    proposal->prepareProposal();
-    double ln_hastings_ratio = proposal->doProposal();
-    
+    if ( evaluation_plan_valid == false )
+    {
+        compileEvaluationPlan();
+    }
     
-    const RbOrderedSet<DagNode*> &affectedNodes = getAffectedNodes();
-    const std::vector<DagNode*> nodes = getDagNodes();
+    ln_prior_ratio = 0.0;
+    ln_likelihood_ratio = 0.0;
     
-    // first we touch all the nodes
-    // that will set the flags for recomputation
-    for (size_t i = 0; i < nodes.size(); ++i)
+    if ( RbMath::isAComputableNumber(ln_hastings_ratio) == false )
     {
-        // get the pointer to the current node
-        DagNode* the_node = nodes[i];
-        the_node->touch();
+        return;
     }
     
-    double lnPriorRatio = 0.0;
-    double lnLikelihoodRatio = 0.0;
-    
+    // first the prior ratio, which is usually cheap
+    for (size_t i = 0; i < prior_nodes.size(); ++i)
+    {
+        ln_prior_ratio += prior_nodes[i]->getLnProbabilityRatio();
+        
+        if ( RbMath::isAComputableNumber(ln_prior_ratio) == false )
+        {
+            return;
+        }
+    }
     
-    // compute the probability of the current value for each node
-    for (size_t i = 0; i < nodes.size(); ++i)
+    // then the likelihood ratio
+    const int num_threads = int( RbSettings::userSettings().getNumberOfThreads() );
+    const int num_likelihood_nodes = int( likelihood_nodes.size() );
+    if ( num_threads > 1 && num_likelihood_nodes > 1 && num_likelihood_nodes >= num_threads )
     {
-        // get the pointer to the current node
-        DagNode* the_node = nodes[i];
         
-        if ( RbMath::isAComputableNumber(lnPriorRatio) && RbMath::isAComputableNumber(lnLikelihoodRatio) && RbMath::isAComputableNumber(ln_hastings_ratio) )
+        // update the values of all parents because this is not thread safe
+        for (size_t i = 0; i < likelihood_nodes.size(); ++i)
         {
-            if ( the_node->isClamped() )
+            std::vector<const DagNode*> parents = likelihood_nodes[i]->getParents();
+            for (size_t j = 0; j < parents.size(); ++j)
             {
-                lnLikelihoodRatio += the_node->getLnProbabilityRatio();
+                parents[j]->updateValue();
             }
-            else
+        }
+        
+        // exceptions must not leave the parallel region, so we rethrow the first one afterwards
+        std::vector<double> ln_ratios = std::vector<double>(num_likelihood_nodes, 0.0);
+        std::vector<std::string> errors = std::vector<std::string>(num_likelihood_nodes, "");
+        std::vector<char> failed = std::vector<char>(num_likelihood_nodes, false);
+#       pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+        for (int i = 0; i < num_likelihood_nodes; ++i)
+        {
+            
+            try
+            {
+                ln_ratios[i] = likelihood_nodes[i]->getLnProbabilityRatio();
+            }
+            catch (RbException &e)
+            {
+                errors[i] = e.getMessage();
+                failed[i] = true;
+            }
+            catch (std::exception &e)
+            {
+                errors[i] = e.what();
+                failed[i] = true;
+            }
+            catch (...)
             {
-                lnPriorRatio += the_node->getLnProbabilityRatio();
+                errors[i] = "Unknown error while computing the probability of '" + likelihood_nodes[i]->getName() + "'.";
+                failed[i] = true;
             }
             
         }
         
+        for (size_t i = 0; i < failed.size(); ++i)
+        {
+            if ( failed[i] == true )
+            {
+                throw RbException( errors[i] );
+            }
+        }
+        
+        for (size_t i = 0; i < ln_ratios.size(); ++i)
+        {
+            ln_likelihood_ratio += ln_ratios[i];
+        }
+        
     }
-    
-    // then we recompute the probability for all the affected nodes
-    for (RbOrderedSet<DagNode*>::const_iterator it = affectedNodes.begin(); it != affectedNodes.end(); ++it)
+    else
     {
-        DagNode *the_node = *it;
         
-        if ( RbMath::isAComputableNumber(lnPriorRatio) && RbMath::isAComputableNumber(lnLikelihoodRatio) && RbMath::isAComputableNumber(ln_hastings_ratio) )
+        for (size_t i = 0; i < likelihood_nodes.size(); ++i)
         {
-            if ( the_node->isClamped() )
-            {
-                lnLikelihoodRatio += the_node->getLnProbabilityRatio();
-            }
-            else
+            ln_likelihood_ratio += likelihood_nodes[i]->getLnProbabilityRatio();
+            
+            if ( RbMath::isAComputableNumber(ln_likelihood_ratio) == false )
             {
-                lnPriorRatio += the_node->getLnProbabilityRatio();
+                return;
             }
         }
         
     }
     
+}
+
+
+/**
+ * Accept the proposal by calling keep for each node.
+ */
+void MetropolisHastingsMove::keepNodes( void )
+{
+    
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        nodes[i]->keep();
+    }
+    
+}
+
+
+void MetropolisHastingsMove::performHillClimbingMove( double lHeat, double pHeat )
+{
+    
+    // Propose a new value
+    proposal->prepareProposal();
+    double ln_hastings_ratio = proposal->doProposal();
+    
+    // first we touch all the nodes
+    // that will set the flags for recomputation
+    touchNodes();
+    
+    // compute the probability ratios of all nodes in the evaluation plan
+    double lnPriorRatio = 0.0;
+    double lnLikelihoodRatio = 0.0;
+    computeLnProbabilityRatios( ln_hastings_ratio, lnPriorRatio, lnLikelihoodRatio );
+    
     // exponentiate with the chain heat
     double ln_posterior_ratio = pHeat * (lHeat * lnLikelihoodRatio + lnPriorRatio);
     
     if ( RbMath::isAComputableNumber(ln_posterior_ratio) == false || ln_posterior_ratio < 0.0 )
     {
-        //        std::cerr << "Reject.\n";
-        
         
         proposal->undoProposal();
         
-        // call restore for each node
-        for (size_t i = 0; i < nodes.size(); ++i)
-        {
-            // get the pointer to the current node
-            DagNode* the_node = nodes[i];
-            the_node->restore();
-        }
+        restoreNodes();
     }
     else
     {
         
         numAccepted++;
-            
-        // call accept for each node
-        for (size_t i = 0; i < nodes.size(); ++i)
-        {
-            // get the pointer to the current node
-            DagNode* the_node = nodes[i];
-            the_node->keep();
-        }
         
+        keepNodes();
     }
     
 }
@@ -237,88 +317,29 @@ void MetropolisHastingsMove::performHillClimbingMove( double lHeat, double pHeat
 void MetropolisHastingsMove::performMcmcMove( double lHeat, double pHeat )
 {
     
-    const RbOrderedSet<DagNode*> &affected_nodes = getAffectedNodes();
-    const std::vector<DagNode*> nodes = getDagNodes();
-    
     // Propose a new value
     proposal->prepareProposal();
     double ln_hastings_ratio = proposal->doProposal();
     
     // first we touch all the nodes
     // that will set the flags for recomputation
-    for (size_t i = 0; i < nodes.size(); ++i)
-    {
-        
-        // get the pointer to the current node
-        DagNode* the_node = nodes[i];
-        
-        // flag for recomputation
-        the_node->touch();
-    }
+    touchNodes();
     
+    // compute the probability ratios of all nodes in the evaluation plan
     double lnPriorRatio = 0.0;
     double lnLikelihoodRatio = 0.0;
-
-    
-    // compute the probability of the current value for each node
-    for (size_t i = 0; i < nodes.size(); ++i)
-    {
-        // get the pointer to the current node
-        DagNode* the_node = nodes[i];
-        
-        if ( RbMath::isAComputableNumber(lnPriorRatio) && RbMath::isAComputableNumber(lnLikelihoodRatio) && RbMath::isAComputableNumber(ln_hastings_ratio) )
-        {
-            if ( the_node->isClamped() )
-            {
-                lnLikelihoodRatio += the_node->getLnProbabilityRatio();
-            }
-            else
-            {
-                lnPriorRatio += the_node->getLnProbabilityRatio();
-            }
-            
-        }
-        
-    }
-    
-    // then we recompute the probability for all the affected nodes
-    for (RbOrderedSet<DagNode*>::const_iterator it = affected_nodes.begin(); it != affected_nodes.end(); ++it)
-    {
-        DagNode *the_node = *it;
-
-        if ( RbMath::isAComputableNumber(lnPriorRatio) && RbMath::isAComputableNumber(lnLikelihoodRatio) && RbMath::isAComputableNumber(ln_hastings_ratio) )
-        {
-            if ( the_node->isClamped() )
-            {
-                lnLikelihoodRatio += the_node->getLnProbabilityRatio();
-            }
-            else
-            {
-                lnPriorRatio += the_node->getLnProbabilityRatio();
-            }
-        }
-
-    }
+    computeLnProbabilityRatios( ln_hastings_ratio, lnPriorRatio, lnLikelihoodRatio );
     
     // exponentiate with the chain heat
     double ln_posterior_ratio;
     ln_posterior_ratio = pHeat * (lHeat * lnLikelihoodRatio + lnPriorRatio);
 	
-    bool rejected = false;
-    
 	if ( RbMath::isAComputableNumber(ln_posterior_ratio) == false )
     {
-        rejected = true;
         
         proposal->undoProposal();
-            
-        // call restore for each node
-        for (size_t i = 0; i < nodes.size(); ++i)
-        {
-            // get the pointer to the current node
-            DagNode* the_node = nodes[i];
-            the_node->restore();
-        }
+        
+        restoreNodes();
 	}
     else
     {
@@ -328,32 +349,17 @@ void MetropolisHastingsMove::performMcmcMove( double lHeat, double pHeat )
 
         if (ln_acceptance_ratio >= 0.0)
         {
-
             
             numAccepted++;
         
-            // call accept for each node
-            for (size_t i = 0; i < nodes.size(); ++i)
-            {
-                // get the pointer to the current node
-                DagNode* the_node = nodes[i];
-                the_node->keep();
-            }
-        
+            keepNodes();
         }
         else if (ln_acceptance_ratio < -300.0)
         {
-            rejected = true;
             
             proposal->undoProposal();
         
-            // call restore for each node
-            for (size_t i = 0; i < nodes.size(); ++i)
-            {
-                // get the pointer to the current node
-                DagNode* the_node = nodes[i];
-                the_node->restore();
-            }
+            restoreNodes();
         }
         else
         {
@@ -365,30 +371,16 @@ void MetropolisHastingsMove::performMcmcMove( double lHeat, double pHeat )
                 
                 numAccepted++;
             
-                // call accept for each node
-                for (size_t i = 0; i < nodes.size(); ++i)
-                {
-                    // get the pointer to the current node
-                    DagNode* the_node = nodes[i];
-                    the_node->keep();
-                }
+                keepNodes();
             
                 proposal->cleanProposal();
             }
             else
             {
-                rejected = true;
                 
                 proposal->undoProposal();
             
-                // call restore for each node
-                for (size_t i = 0; i < nodes.size(); ++i)
-                {
-                    // get the pointer to the current node
-                    DagNode* the_node = nodes[i];
-                    the_node->restore();
-                }
-                
+                restoreNodes();
             }
             
         }
@@ -495,6 +487,40 @@ void MetropolisHastingsMove::resetMoveCounters( void )
 }
 
 
+/**
+ * Reject the proposal by calling restore for each node.
+ */
+void MetropolisHastingsMove::restoreNodes( void )
+{
+    
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        nodes[i]->restore();
+    }
+    
+}
+
+
+/**
+ * Set the tuning parameter of the move, which is the tuning parameter of the proposal.
+ */
+void MetropolisHastingsMove::setMoveTuningParameter( double tp )
+{
+    
+    proposal->setProposalTuningParameter( tp );
+}
+
+
+/**
+ * Set how often the move was accepted, e.g., when resuming from a checkpoint.
+ */
+void MetropolisHastingsMove::setNumberAccepted( size_t n )
+{
+    
+    numAccepted = (unsigned int)n;
+}
+
+
 /**
  * Swap the current variable for a new one.
  *
@@ -525,3 +551,16 @@ void MetropolisHastingsMove::tune( void )
     
 }
 
+
+/**
+ * Touch all the nodes of the move, which flags them and their affected nodes for recomputation.
+ */
+void MetropolisHastingsMove::touchNodes( void )
+{
+    
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        nodes[i]->touch();
+    }
+    
+}
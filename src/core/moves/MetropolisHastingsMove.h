@@ -35,9 +35,12 @@ namespace RevBayesCore {
         // pure virtual public methods
         virtual MetropolisHastingsMove*                         clone(void) const;
         const std::string&                                      getMoveName(void) const;                                //!< Get the name of the move for summary printing
+        double                                                  getMoveTuningParameter(void) const;                     //!< Get the tuning parameter of the proposal
         size_t                                                  getNumberAccepted(void) const;                        //!< Get update weight of InferenceMove
         Proposal&                                               getProposal(void);                                      //!< Get the proposal of the move
         void                                                    printSummary(std::ostream &o) const;                    //!< Print the move summary
+        void                                                    setMoveTuningParameter(double tp);                      //!< Set the tuning parameter of the proposal
+        void                                                    setNumberAccepted(size_t n);                            //!< Set the number of accepted proposals
         void                                                    tune(void);                                             //!< Specific tuning of the move
         
     protected:
@@ -50,6 +53,11 @@ namespace RevBayesCore {
         
     private:
         
+        void                                                    computeLnProbabilityRatios(double ln_hastings_ratio, double &ln_prior_ratio, double &ln_likelihood_ratio);    //!< Evaluate the probability ratios of the evaluation plan
+        void                                                    keepNodes(void);                                        //!< Keep the new values of all nodes
+        void                                                    restoreNodes(void);                                     //!< Restore the old values of all nodes
+        void                                                    touchNodes(void);                                       //!< Flag all nodes for recomputation
+        
         // parameters
         unsigned int                                            numAccepted;                                            //!< Number of times accepted
         Proposal*                                               proposal;                                               //!< The proposal distribution
@@ -34,6 +34,7 @@ namespace RevBayesCore {
         virtual void                                            decrementTriedCounter(void) = 0;                        //!< Get update weight of InferenceMove
         virtual const std::vector<DagNode*>&                    getDagNodes(void) const = 0;                            //!< Get the nodes vector
         virtual const std::string&                              getMoveName(void) const = 0;                            //!< Get the name of the move for summary printing
+        virtual double                                          getMoveTuningParameter(void) const = 0;                 //!< Get the current tuning parameter of the move
         virtual size_t                                          getNumberAccepted(void) const = 0;                        //!< Get update weight of InferenceMove
         virtual size_t                                          getNumberTried(void) const = 0;                        //!< Get update weight of InferenceMove
         virtual double                                          getUpdateWeight(void) const = 0;                        //!< Get update weight of InferenceMove
@@ -44,6 +45,9 @@ namespace RevBayesCore {
         virtual void                                            printSummary(std::ostream &o) const = 0;                //!< Print the move summary
         virtual void                                            removeNode(DagNode* p) = 0;                             //!< remove a node from the proposal
         virtual void                                            resetCounters(void) = 0;                                //!< Reset the counters such as numTried and numAccepted.
+        virtual void                                            setMoveTuningParameter(double tp) = 0;                  //!< Set the tuning parameter of the move
+        virtual void                                            setNumberAccepted(size_t n) = 0;                        //!< Set the number of accepted proposals (used when resuming from a checkpoint)
+        virtual void                                            setNumberTried(size_t n) = 0;                           //!< Set the number of tries (used when resuming from a checkpoint)
         virtual void                                            swapNode(DagNode *oldN, DagNode *newN) = 0;             //!< Swap the pointers to the variable on which the move works on.
         
         
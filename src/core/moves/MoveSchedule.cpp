@@ -15,6 +15,27 @@ MoveSchedule::~MoveSchedule()
 }
 
 
+/**
+ * Get the internal state of the schedule, e.g., the position within a sequential schedule.
+ * Schedules that only draw the next move randomly have no state beyond the random number generator,
+ * so here we return an empty string.
+ */
+std::string MoveSchedule::getState( void ) const
+{
+    
+    return "";
+}
+
+
+/**
+ * Restore the internal state of the schedule from a string produced by getState.
+ * Here we provide only a dummy implementation for stateless schedules.
+ */
+void MoveSchedule::setState( const std::string &s )
+{
+    // dummy implementation
+}
+
 
 void MoveSchedule::tune( void )
 {
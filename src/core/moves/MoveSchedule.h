@@ -4,6 +4,7 @@
 #include "Move.h"
 #include "RbVector.h"
 
+#include <string>
 #include <vector>
 
 namespace RevBayesCore {
@@ -19,6 +20,8 @@ namespace RevBayesCore {
         virtual Move&                                           nextMove(unsigned long g) = 0;
         
         // public methods
+        virtual std::string                                     getState(void) const;                                                                           //!< Get the internal state of the schedule (e.g., for checkpointing)
+        virtual void                                            setState(const std::string &s);                                                                 //!< Restore the internal state from getState()
         void                                                    tune(void);                                                                                     //!< The the moves to achieve better performance.
         
     protected:
@@ -7,7 +7,9 @@
 
 using namespace RevBayesCore;
 
-RandomMoveSchedule::RandomMoveSchedule(RbVector<Move> *s) : MoveSchedule( s )
+RandomMoveSchedule::RandomMoveSchedule(RbVector<Move> *s) : MoveSchedule( s ),
+    last_generation( 0 ),
+    alias_table_valid( false )
 {
     
     movesPerIteration = 0.0;
@@ -16,6 +18,9 @@ RandomMoveSchedule::RandomMoveSchedule(RbVector<Move> *s) : MoveSchedule( s )
         movesPerIteration += it->getUpdateWeight();
         weights.push_back( it->getUpdateWeight() );
     }
+    
+    // the alias table is only built at the first draw, once we know which moves are active at that generation
+    active = std::vector<bool>( weights.size(), true );
 }
 
 
@@ -25,6 +30,74 @@ RandomMoveSchedule::~RandomMoveSchedule()
 }
 
 
+/**
+ * Build the alias table of the active moves (Vose's version of Walker's alias method).
+ * Every active move gets a column with the probability to be picked itself and otherwise its alias,
+ * such that each move is picked in total with probability proportional to its weight.
+ */
+void RandomMoveSchedule::buildAliasTable( void )
+{
+    
+    active_moves.clear();
+    movesPerIteration = 0.0;
+    for (size_t i = 0; i < weights.size(); ++i)
+    {
+        if ( active[i] == true && weights[i] > 0.0 )
+        {
+            active_moves.push_back( i );
+            movesPerIteration += weights[i];
+        }
+    }
+    
+    size_t n = active_moves.size();
+    alias_probabilities = std::vector<double>( n, 1.0 );
+    alias_indices = std::vector<size_t>( n, 0 );
+    for (size_t k = 0; k < n; ++k)
+    {
+        alias_indices[k] = k;
+    }
+    
+    // split the scaled weights into the columns with too little and too much probability
+    std::vector<double> scaled_weights = std::vector<double>( n, 0.0 );
+    std::vector<size_t> small;
+    std::vector<size_t> large;
+    for (size_t k = 0; k < n; ++k)
+    {
+        scaled_weights[k] = weights[ active_moves[k] ] * n / movesPerIteration;
+        if ( scaled_weights[k] < 1.0 )
+        {
+            small.push_back( k );
+        }
+        else
+        {
+            large.push_back( k );
+        }
+    }
+    
+    // fill up every small column with the probability of a large one
+    while ( small.empty() == false && large.empty() == false )
+    {
+        size_t s = small.back();
+        small.pop_back();
+        size_t l = large.back();
+        
+        alias_probabilities[s] = scaled_weights[s];
+        alias_indices[s] = l;
+        
+        scaled_weights[l] = (scaled_weights[l] + scaled_weights[s]) - 1.0;
+        if ( scaled_weights[l] < 1.0 )
+        {
+            large.pop_back();
+            small.push_back( l );
+        }
+    }
+    
+    // the remaining columns are full up to rounding errors
+    
+    alias_table_valid = true;
+}
+
+
 RandomMoveSchedule* RandomMoveSchedule::clone( void ) const
 {
     return new RandomMoveSchedule(*this);
@@ -37,39 +110,65 @@ double RandomMoveSchedule::getNumberMovesPerIteration( void ) const
 }
 
 
+/**
+ * Draw the next move from the alias table.
+ * We use the integer part of the scaled random number to pick a column and the fractional part
+ * to decide between the move of the column and its alias.
+ */
 Move& RandomMoveSchedule::nextMove( unsigned long gen )
 {
     
-    movesPerIteration = 0.0;
-    for (size_t i = 0; i < weights.size(); ++i)
+    if ( alias_table_valid == false || gen != last_generation )
     {
-        if ( (*moves)[i].isActive( gen ) )
-        {
-            movesPerIteration += weights[i];
-        }
+        updateActiveMoves( gen );
     }
     
+    size_t n = active_moves.size();
+    if ( n == 0 )
+    {
+        // there is no active move, so we simply return the last one as before
+        return (*moves)[moves->size() - 1];
+    }
     
     RandomNumberGenerator* rng = GLOBAL_RNG;
-    double u = movesPerIteration * rng->uniform01();
+    double u = n * rng->uniform01();
+    
+    size_t k = size_t( u );
+    if ( k >= n )
+    {
+        k = n - 1;
+    }
+    u -= k;
     
-    size_t index = 0;
-    // only if the move is inactive or the weight of the move is smaller than u
-    while ( !(*moves)[index].isActive(gen) || weights[index] <= u )
+    size_t index = ( u < alias_probabilities[k] ? active_moves[k] : active_moves[ alias_indices[k] ] );
+    
+    return (*moves)[index];
+}
+
+
+/**
+ * Check which moves are active at the given generation and rebuild the alias table only if this has changed.
+ * The moves are switched on and off only at few generations (e.g., after a delay), so this is usually just one pass over the moves per generation.
+ */
+void RandomMoveSchedule::updateActiveMoves( unsigned long gen )
+{
+    
+    bool changed = false;
+    for (size_t i = 0; i < weights.size(); ++i)
     {
-        // check if this move is active
-        // if not, then we just subtract the weight of this move
-        if ( (*moves)[index].isActive( gen ) )
+        bool a = (*moves)[i].isActive( gen );
+        if ( a != active[i] )
         {
-            u -= weights[index];
+            active[i] = a;
+            changed = true;
         }
-        ++index;
     }
-
-    if (index >= moves->size())
+    
+    last_generation = gen;
+    
+    if ( changed == true || alias_table_valid == false )
     {
-        index = moves->size() - 1;
+        buildAliasTable();
     }
-        
-    return (*moves)[index];
+    
 }
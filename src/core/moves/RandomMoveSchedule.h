@@ -9,6 +9,14 @@
 
 namespace RevBayesCore {
     
+    /**
+     * The random move schedule picks the moves randomly proportional to their weights.
+     *
+     * We draw the moves from an alias table (Walker's alias method) so that every draw needs only
+     * one random number and constant time, independent of the number of moves.
+     * Moves can be switched on and off by generation (see Move::isActive), so we check the active
+     * moves only once per generation and rebuild the table only if the set of active moves has changed.
+     */
     class RandomMoveSchedule : public MoveSchedule  {
         
     public:
@@ -22,9 +30,20 @@ namespace RevBayesCore {
 
     private:
         
+        void                                            buildAliasTable(void);                                                                  //!< Build the alias table of the active moves
+        void                                            updateActiveMoves(unsigned long g);                                                     //!< Check which moves are active at generation g
+        
         // Hidden member variables
         double                                          movesPerIteration;
         std::vector<double>                             weights;
+        
+        // the alias table of the active moves
+        std::vector<bool>                               active;                                                                                 //!< Is the move active?
+        std::vector<size_t>                             active_moves;                                                                           //!< The indices of the active moves
+        std::vector<double>                             alias_probabilities;                                                                    //!< The probability to pick the active move itself instead of its alias
+        std::vector<size_t>                             alias_indices;                                                                          //!< The index of the alias (into active_moves) of each active move
+        unsigned long                                   last_generation;                                                                        //!< The generation for which we checked the active moves
+        bool                                            alias_table_valid;
     };
     
 }
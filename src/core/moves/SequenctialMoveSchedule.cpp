@@ -9,8 +9,11 @@
 #include "SequenctialMoveSchedule.h"
 #include "RandomNumberFactory.h"
 #include "RandomNumberGenerator.h"
+#include "RbException.h"
 #include "RbIterator.h"
 
+#include <sstream>
+
 using namespace RevBayesCore;
 
 SequentialMoveSchedule::SequentialMoveSchedule(RbVector<Move> *s) : MoveSchedule( s ), currentMove( 0 ), usedPropOfCurrentMove( 0 ) {
@@ -37,6 +40,15 @@ double SequentialMoveSchedule::getNumberMovesPerIteration( void ) const {
 }
 
 
+std::string SequentialMoveSchedule::getState( void ) const {
+    
+    std::stringstream ss;
+    ss << currentMove << " " << usedPropOfCurrentMove;
+    
+    return ss.str();
+}
+
+
 Move& SequentialMoveSchedule::nextMove( unsigned long gen )
 {
     
@@ -72,3 +84,16 @@ Move& SequentialMoveSchedule::nextMove( unsigned long gen )
     
     return (*moves)[currentMove];
 }
+
+
+void SequentialMoveSchedule::setState( const std::string &s ) {
+    
+    std::stringstream ss(s);
+    ss >> currentMove >> usedPropOfCurrentMove;
+    
+    if ( ss.fail() || currentMove >= moves->size() )
+    {
+        throw RbException("Could not restore the state of the sequential move schedule from \"" + s + "\".");
+    }
+    
+}
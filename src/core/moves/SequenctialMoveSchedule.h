@@ -35,7 +35,9 @@ namespace RevBayesCore {
         // pure virtual public methods
         SequentialMoveSchedule*                         clone(void) const;
         double                                          getNumberMovesPerIteration(void) const;
+        std::string                                     getState(void) const;
         Move&                                           nextMove(unsigned long g);
+        void                                            setState(const std::string &s);
         
     private:
         
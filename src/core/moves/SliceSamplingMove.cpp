@@ -66,6 +66,12 @@ const std::string& SliceSamplingMove::getMoveName( void ) const
     return name;
 }
 
+
+double SliceSamplingMove::getMoveTuningParameter( void ) const
+{
+    return window;
+}
+
 double uniform()
 {
     RandomNumberGenerator* rng     = GLOBAL_RNG;
@@ -369,6 +375,15 @@ void SliceSamplingMove::resetMoveCounters( void )
 }
 
 
+/**
+ * Set the window width, e.g., when resuming from a checkpoint.
+ */
+void SliceSamplingMove::setMoveTuningParameter( double tp )
+{
+    window = tp;
+}
+
+
 /**
  * Swap the current variable for a new one.
  *
@@ -32,7 +32,9 @@ namespace RevBayesCore {
         // public methods
         virtual SliceSamplingMove*                              clone(void) const;
         const std::string&                                      getMoveName(void) const;                            //!< Get the name of the move for summary printing
+        double                                                  getMoveTuningParameter(void) const;                 //!< Get the window width
         void                                                    printSummary(std::ostream &o) const;                //!< Print the move summary
+        void                                                    setMoveTuningParameter(double tp);                  //!< Set the window width
         void                                                    tune(void);                                         //!< Specific tuning of the move
 
     protected:
@@ -145,6 +145,16 @@ void EventBranchTimeBetaProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (delta).
+ */
+double EventBranchTimeBetaProposal::getProposalTuningParameter( void ) const
+{
+    
+    return delta;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -207,6 +217,16 @@ void EventBranchTimeBetaProposal::swapNodeInternal(DagNode *oldN, DagNode *newN)
 }
 
 
+/**
+ * Set the value of the tuning parameter (delta), e.g., when resuming from a checkpoint.
+ */
+void EventBranchTimeBetaProposal::setProposalTuningParameter( double tp )
+{
+    
+    delta = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
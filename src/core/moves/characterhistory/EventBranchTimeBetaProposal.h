@@ -29,7 +29,9 @@ namespace RevBayesCore {
         EventBranchTimeBetaProposal*                    clone(void) const;                                                                  //!< Clone object
         double                                          doProposal(void);                                                                   //!< Perform proposal
         const std::string&                              getProposalName(void) const;                                                        //!< Get the name of the proposal for summary printing
+        double                                          getProposalTuningParameter(void) const;                                             //!< Get the current tuning parameter
         void                                            printParameterSummary(std::ostream &o) const;                                       //!< Print the parameter summary
+        void                                            setProposalTuningParameter(double tp);                                              //!< Set the tuning parameter
         void                                            prepareProposal(void);                                                              //!< Prepare the proposal
         void                                            tune(double r);                                                                     //!< Tune the proposal to achieve a better acceptance/rejection ratio
         void                                            undoProposal(void);                                                                 //!< Reject the proposal
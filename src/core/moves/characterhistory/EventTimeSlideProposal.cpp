@@ -219,6 +219,16 @@ void EventTimeSlideProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (delta).
+ */
+double EventTimeSlideProposal::getProposalTuningParameter( void ) const
+{
+    
+    return delta;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -279,6 +289,16 @@ void EventTimeSlideProposal::swapNodeInternal(DagNode *oldN, DagNode *newN)
 }
 
 
+/**
+ * Set the value of the tuning parameter (delta), e.g., when resuming from a checkpoint.
+ */
+void EventTimeSlideProposal::setProposalTuningParameter( double tp )
+{
+    
+    delta = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
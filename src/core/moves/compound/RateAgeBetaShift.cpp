@@ -64,6 +64,13 @@ const std::string& RateAgeBetaShift::getMoveName( void ) const
 }
 
 
+double RateAgeBetaShift::getMoveTuningParameter( void ) const
+{
+    
+    return delta;
+}
+
+
 /** Perform the move */
 void RateAgeBetaShift::performMcmcMove( double lHeat, double pHeat )
 {
@@ -373,6 +380,18 @@ void RateAgeBetaShift::resetMoveCounters( void )
 }
 
 
+void RateAgeBetaShift::setMoveTuningParameter( double tp )
+{
+    delta = tp;
+}
+
+
+void RateAgeBetaShift::setNumberAccepted( size_t n )
+{
+    numAccepted = n;
+}
+
+
 void RateAgeBetaShift::swapNodeInternal(DagNode *oldN, DagNode *newN)
 {
     
@@ -21,7 +21,10 @@ namespace RevBayesCore {
         // Basic utility functions
         RateAgeBetaShift*                       clone(void) const;                                                                  //!< Clone object
         const std::string&                      getMoveName(void) const;                                                            //!< Get the name of the move for summary printing
+        double                                  getMoveTuningParameter(void) const;                                                 //!< Get the tuning parameter (delta)
         void                                    printSummary(std::ostream &o) const;                                                //!< Print the move summary
+        void                                    setMoveTuningParameter(double tp);                                                  //!< Set the tuning parameter (delta)
+        void                                    setNumberAccepted(size_t n);                                                        //!< Set the number of accepted proposals
         
     protected:
         void                                    performMcmcMove(double lHeat, double pHeat);                                        //!< Perform move
@@ -1,6 +1,7 @@
 #include "DagNode.h"
 #include "Move.h"
 #include "Proposal.h"
+#include "RbConstants.h"
 #include "RbException.h"
 
 
@@ -125,6 +126,19 @@ const std::vector<DagNode*>& Proposal::getNodes( void ) const
 }
 
 
+/**
+ * Get the current value of the tuning parameter of this proposal.
+ * Proposals without a tuning parameter return NaN, so this default implementation is only overwritten by proposals that tune themselves.
+ *
+ * \return  The tuning parameter.
+ */
+double Proposal::getProposalTuningParameter( void ) const
+{
+    
+    return RbConstants::Double::nan;
+}
+
+
 
 
 
@@ -163,6 +177,17 @@ void Proposal::setMove(Move *m)
     
 }
 
+
+/**
+ * Set the value of the tuning parameter of this proposal, e.g., when resuming from a checkpoint.
+ * Proposals without a tuning parameter simply ignore the value.
+ */
+void Proposal::setProposalTuningParameter( double tp )
+{
+    // nothing to do
+}
+
+
 /**
  * Swap the old node with a new one.
  * This will be called for example when the entire model graph is cloned or
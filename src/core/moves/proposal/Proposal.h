@@ -29,6 +29,8 @@ namespace RevBayesCore {
         
         // public methods
         const std::vector<DagNode*>&                            getNodes(void) const;                                                                   //!< Get the vector of nodes for which the proposal is drawing new values.
+        virtual double                                          getProposalTuningParameter(void) const;                                                 //!< Get the current tuning parameter (NaN if the proposal has none).
+        virtual void                                            setProposalTuningParameter(double tp);                                                  //!< Set the tuning parameter (ignored if the proposal has none).
         void                                                    swapNode(DagNode *oldN, DagNode *newN);                                                 //!< Swap the pointers to the variable on which the move works on.
         void                                                    setMove(Move *m);                                                                       //!< Set the pointer to move object holding this proposal
         
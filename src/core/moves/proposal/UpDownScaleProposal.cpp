@@ -256,6 +256,16 @@ void UpDownScaleProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (lambda).
+ */
+double UpDownScaleProposal::getProposalTuningParameter( void ) const
+{
+    
+    return lambda;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -470,6 +480,16 @@ void UpDownScaleProposal::swapNodeInternal(DagNode *oldN, DagNode *newN)
 }
 
 
+/**
+ * Set the value of the tuning parameter (lambda), e.g., when resuming from a checkpoint.
+ */
+void UpDownScaleProposal::setProposalTuningParameter( double tp )
+{
+    
+    lambda = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
@@ -38,7 +38,9 @@ namespace RevBayesCore {
         UpDownScaleProposal*                        clone(void) const;                                                                  //!< Clone object
         double                                      doProposal(void);                                                                   //!< Perform proposal
         const std::string&                          getProposalName(void) const;                                                        //!< Get the name of the proposal for summary printing
+        double                                      getProposalTuningParameter(void) const;                                             //!< Get the current tuning parameter
         void                                        printParameterSummary(std::ostream &o) const;                                       //!< Print the parameter summary
+        void                                        setProposalTuningParameter(double tp);                                              //!< Set the tuning parameter
         void                                        prepareProposal(void);                                                              //!< Prepare the proposal
         void                                        removeVariable(StochasticNode<double> *v, bool up);                                 //!< Add an up-scaling variable
         void                                        removeVariable(StochasticNode<RbVector<double> > *v, bool up);                      //!< Add an up-scaling variable
@@ -182,6 +182,16 @@ void UpDownSlideProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (lambda).
+ */
+double UpDownSlideProposal::getProposalTuningParameter( void ) const
+{
+    
+    return lambda;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -335,6 +345,16 @@ void UpDownSlideProposal::swapNodeInternal(DagNode *oldN, DagNode *newN)
 }
 
 
+/**
+ * Set the value of the tuning parameter (lambda), e.g., when resuming from a checkpoint.
+ */
+void UpDownSlideProposal::setProposalTuningParameter( double tp )
+{
+    
+    lambda = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
@@ -189,6 +189,16 @@ void CorrelationMatrixProposal::prepareProposal( void ) {
 }
 
 
+/**
+ * Get the current value of the tuning parameter (lambda).
+ */
+double CorrelationMatrixProposal::getProposalTuningParameter( void ) const
+{
+    
+    return lambda;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -231,6 +241,16 @@ void CorrelationMatrixProposal::swapNodeInternal(DagNode *oldN, DagNode *newN) {
 }
 
 
+/**
+ * Set the value of the tuning parameter (lambda), e.g., when resuming from a checkpoint.
+ */
+void CorrelationMatrixProposal::setProposalTuningParameter( double tp )
+{
+    
+    lambda = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
@@ -112,6 +112,16 @@ void MatrixRealSingleElementSlidingProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (lambda).
+ */
+double MatrixRealSingleElementSlidingProposal::getProposalTuningParameter( void ) const
+{
+    
+    return lambda;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -160,6 +170,16 @@ void MatrixRealSingleElementSlidingProposal::swapNodeInternal(DagNode *oldN, Dag
 }
 
 
+/**
+ * Set the value of the tuning parameter (lambda), e.g., when resuming from a checkpoint.
+ */
+void MatrixRealSingleElementSlidingProposal::setProposalTuningParameter( double tp )
+{
+    
+    lambda = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
@@ -107,6 +107,16 @@ void MatrixRealSymmetricSingleElementSlidingProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (lambda).
+ */
+double MatrixRealSymmetricSingleElementSlidingProposal::getProposalTuningParameter( void ) const
+{
+    
+    return lambda;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -154,6 +164,16 @@ void MatrixRealSymmetricSingleElementSlidingProposal::swapNodeInternal(DagNode *
 }
 
 
+/**
+ * Set the value of the tuning parameter (lambda), e.g., when resuming from a checkpoint.
+ */
+void MatrixRealSymmetricSingleElementSlidingProposal::setProposalTuningParameter( double tp )
+{
+    
+    lambda = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
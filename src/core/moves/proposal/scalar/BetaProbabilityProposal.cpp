@@ -124,6 +124,16 @@ void BetaProbabilityProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (delta).
+ */
+double BetaProbabilityProposal::getProposalTuningParameter( void ) const
+{
+    
+    return delta;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -169,6 +179,16 @@ void BetaProbabilityProposal::swapNodeInternal(DagNode *oldN, DagNode *newN)
 }
 
 
+/**
+ * Set the value of the tuning parameter (delta), e.g., when resuming from a checkpoint.
+ */
+void BetaProbabilityProposal::setProposalTuningParameter( double tp )
+{
+    
+    delta = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
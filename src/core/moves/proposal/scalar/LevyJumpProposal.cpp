@@ -105,6 +105,16 @@ void LevyJumpProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (delta).
+ */
+double LevyJumpProposal::getProposalTuningParameter( void ) const
+{
+    
+    return delta;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -150,6 +160,16 @@ void LevyJumpProposal::swapNodeInternal(DagNode *oldN, DagNode *newN)
 }
 
 
+/**
+ * Set the value of the tuning parameter (delta), e.g., when resuming from a checkpoint.
+ */
+void LevyJumpProposal::setProposalTuningParameter( double tp )
+{
+    
+    delta = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
@@ -148,6 +148,16 @@ void LevyJumpSumProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (lambda).
+ */
+double LevyJumpSumProposal::getProposalTuningParameter( void ) const
+{
+    
+    return lambda;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -202,6 +212,16 @@ void LevyJumpSumProposal::swapNodeInternal(DagNode *oldN, DagNode *newN)
 }
 
 
+/**
+ * Set the value of the tuning parameter (lambda), e.g., when resuming from a checkpoint.
+ */
+void LevyJumpSumProposal::setProposalTuningParameter( double tp )
+{
+    
+    lambda = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
@@ -105,6 +105,16 @@ void RandomGeometricWalkProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (alpha).
+ */
+double RandomGeometricWalkProposal::getProposalTuningParameter( void ) const
+{
+    
+    return alpha;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -150,6 +160,16 @@ void RandomGeometricWalkProposal::swapNodeInternal(DagNode *oldN, DagNode *newN)
 }
 
 
+/**
+ * Set the value of the tuning parameter (alpha), e.g., when resuming from a checkpoint.
+ */
+void RandomGeometricWalkProposal::setProposalTuningParameter( double tp )
+{
+    
+    alpha = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
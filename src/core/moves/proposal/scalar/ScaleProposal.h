@@ -31,8 +31,10 @@ namespace RevBayesCore {
         void                                cleanProposal(void);                                                                //!< Clean up proposal
         ScaleProposal*                      clone(void) const;                                                                  //!< Clone object
         const std::string&                  getProposalName(void) const;                                                        //!< Get the name of the proposal for summary printing
+        double                              getProposalTuningParameter(void) const;                                             //!< Get the current tuning parameter
         void                                prepareProposal(void);                                                              //!< Prepare the proposal
         void                                printParameterSummary(std::ostream &o) const;                                       //!< Print the parameter summary
+        void                                setProposalTuningParameter(double tp);                                              //!< Set the tuning parameter
         double                              propose(double &v);                                                                   //!< Perform proposal
         void                                tune(double r);                                                                     //!< Tune the proposal to achieve a better acceptance/rejection ratio
         void                                undoProposal(void);                                                                 //!< Reject the proposal
@@ -141,6 +141,16 @@ void BetaSimplexProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (alpha).
+ */
+double BetaSimplexProposal::getProposalTuningParameter( void ) const
+{
+    
+    return alpha;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -186,6 +196,16 @@ void BetaSimplexProposal::swapNodeInternal(DagNode *oldN, DagNode *newN)
 }
 
 
+/**
+ * Set the value of the tuning parameter (alpha), e.g., when resuming from a checkpoint.
+ */
+void BetaSimplexProposal::setProposalTuningParameter( double tp )
+{
+    
+    alpha = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
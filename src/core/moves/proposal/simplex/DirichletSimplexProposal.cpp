@@ -262,6 +262,16 @@ void DirichletSimplexProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (alpha).
+ */
+double DirichletSimplexProposal::getProposalTuningParameter( void ) const
+{
+    
+    return alpha;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -307,6 +317,16 @@ void DirichletSimplexProposal::swapNodeInternal(DagNode *oldN, DagNode *newN)
 }
 
 
+/**
+ * Set the value of the tuning parameter (alpha), e.g., when resuming from a checkpoint.
+ */
+void DirichletSimplexProposal::setProposalTuningParameter( double tp )
+{
+    
+    alpha = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
@@ -136,6 +136,16 @@ void NodeTimeSlideBetaProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (delta).
+ */
+double NodeTimeSlideBetaProposal::getProposalTuningParameter( void ) const
+{
+    
+    return delta;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -182,6 +192,16 @@ void NodeTimeSlideBetaProposal::swapNodeInternal(DagNode *oldN, DagNode *newN)
 }
 
 
+/**
+ * Set the value of the tuning parameter (delta), e.g., when resuming from a checkpoint.
+ */
+void NodeTimeSlideBetaProposal::setProposalTuningParameter( double tp )
+{
+    
+    delta = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
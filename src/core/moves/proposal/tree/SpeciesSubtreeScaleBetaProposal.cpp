@@ -271,6 +271,16 @@ void SpeciesSubtreeScaleBetaProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (alpha).
+ */
+double SpeciesSubtreeScaleBetaProposal::getProposalTuningParameter( void ) const
+{
+    
+    return alpha;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -356,6 +366,16 @@ void SpeciesSubtreeScaleBetaProposal::swapNodeInternal(DagNode *oldN, DagNode *n
 }
 
 
+/**
+ * Set the value of the tuning parameter (alpha), e.g., when resuming from a checkpoint.
+ */
+void SpeciesSubtreeScaleBetaProposal::setProposalTuningParameter( double tp )
+{
+    
+    alpha = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
@@ -34,8 +34,10 @@ namespace RevBayesCore {
         SpeciesSubtreeScaleBetaProposal*                clone(void) const;                                          //!< Clone object
         double                                          doProposal(void);                                           //!< Perform proposal
         const std::string&                              getProposalName(void) const;                                //!< Get the name of the proposal for summary printing
+        double                                          getProposalTuningParameter(void) const;                     //!< Get the current tuning parameter
         void                                            prepareProposal(void);                                      //!< Prepare the proposal
         void                                            printParameterSummary(std::ostream &o) const;               //!< Print the parameter summary
+        void                                            setProposalTuningParameter(double tp);                      //!< Set the tuning parameter
         void                                            removeGeneTree(StochasticNode<Tree> *gt);                   //!< Remove a DAG Node holding a gene tree on which this move should operate on
         void                                            tune(double r);                                             //!< Tune the proposal to achieve a better acceptance/rejection ratio
         void                                            undoProposal(void);                                         //!< Reject the proposal
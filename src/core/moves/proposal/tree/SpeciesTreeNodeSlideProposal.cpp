@@ -312,6 +312,16 @@ void SpeciesTreeNodeSlideProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (delta).
+ */
+double SpeciesTreeNodeSlideProposal::getProposalTuningParameter( void ) const
+{
+    
+    return delta;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -407,6 +417,16 @@ void SpeciesTreeNodeSlideProposal::swapNodeInternal(DagNode *oldN, DagNode *newN
 }
 
 
+/**
+ * Set the value of the tuning parameter (delta), e.g., when resuming from a checkpoint.
+ */
+void SpeciesTreeNodeSlideProposal::setProposalTuningParameter( double tp )
+{
+    
+    delta = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
@@ -117,6 +117,16 @@ void SynchronizedVectorFixedSingleElementSlideProposal::prepareProposal( void )
 }
 
 
+/**
+ * Get the current value of the tuning parameter (lambda).
+ */
+double SynchronizedVectorFixedSingleElementSlideProposal::getProposalTuningParameter( void ) const
+{
+    
+    return lambda;
+}
+
+
 /**
  * Print the summary of the Proposal.
  *
@@ -178,6 +188,16 @@ void SynchronizedVectorFixedSingleElementSlideProposal::swapNodeInternal(DagNode
 }
 
 
+/**
+ * Set the value of the tuning parameter (lambda), e.g., when resuming from a checkpoint.
+ */
+void SynchronizedVectorFixedSingleElementSlideProposal::setProposalTuningParameter( double tp )
+{
+    
+    lambda = tp;
+}
+
+
 /**
  * Tune the Proposal to accept the desired acceptance ratio.
  *
@@ -18,6 +18,9 @@
 #define SSE_ENABLED
 //#define AVX_ENABLED
 
+/* Shared-memory parallelization is enabled by compiling with OpenMP (e.g. -fopenmp),
+   which defines _OPENMP. The number of threads is set by the user option 'numThreads'. */
+
 
 /* Test whether we should use linenoise */
 #if !defined (NO_LINENOISE)
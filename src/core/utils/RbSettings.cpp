@@ -40,6 +40,12 @@ size_t RbSettings::getLineWidth( void ) const
     return lineWidth;
 }
 
+size_t RbSettings::getNumberOfThreads( void ) const
+{
+    // return the internal value
+    return numThreads;
+}
+
 size_t RbSettings::getScalingDensity( void ) const
 {
     // return the internal value
@@ -80,6 +86,10 @@ std::string RbSettings::getOption(const std::string &key) const
     {
         return StringUtilities::to_string(scalingDensity);
     }
+    else if ( key == "numThreads" )
+    {
+        return StringUtilities::to_string(numThreads);
+    }
     else if ( key == "useScaling" )
     {
         return useScaling ? "TRUE" : "FALSE";
@@ -125,6 +135,7 @@ void RbSettings::initializeUserSettings(void)
     moduleDir = "modules";      // the default module directory
     useScaling = false;          // the default useScaling
     scalingDensity = 4;         // the default scaling density
+    numThreads = 1;             // the default number of threads
     lineWidth = 160;            // the default line width
     tolerance = 10E-10;         // set default value for tolerance comparing doubles
     printNodeIndex = true;      // print node indices of tree nodes as comments
@@ -228,6 +239,20 @@ void RbSettings::setUseScaling(bool w)
     writeUserSettings();
 }
 
+void RbSettings::setNumberOfThreads(size_t n)
+{
+    if ( n < 1 )
+    {
+        throw RbException("numThreads must be an integer greater than 0");
+    }
+    
+    // replace the internal value with this new value
+    numThreads = n;
+    
+    // save the current settings for the future.
+    writeUserSettings();
+}
+
 void RbSettings::setScalingDensity(size_t w)
 {
     // replace the internal value with this new value
@@ -283,6 +308,14 @@ void RbSettings::setOption(const std::string &key, const std::string &value, boo
         
         scalingDensity = atoi(value.c_str());
     }
+    else if ( key == "numThreads" )
+    {
+        int n = atoi(value.c_str());
+        if(n < 1)
+            throw(RbException("numThreads must be an integer greater than 0"));
+        
+        numThreads = n;
+    }
     else if ( key == "collapseSampledAncestors" )
     {
         collapseSampledAncestors = value == "TRUE";
@@ -350,6 +383,7 @@ void RbSettings::writeUserSettings( void )
     writeStream << "linewidth=" << lineWidth << std::endl;
     writeStream << "useScaling=" << useScaling << std::endl;
     writeStream << "scalingDensity=" << scalingDensity << std::endl;
+    writeStream << "numThreads=" << numThreads << std::endl;
     writeStream << "collapseSampledAncestors=" << (collapseSampledAncestors ? "TRUE" : "FALSE") << std::endl;
     fm.closeFile( writeStream );
 
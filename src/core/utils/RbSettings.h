@@ -19,6 +19,7 @@ class RbSettings {
         bool                        getCollapseSampledAncestors(void) const;            //!< Retrieve the whether to should display sampled ancestors as 2-degree nodes when printing
         size_t                      getLineWidth(void) const;                           //!< Retrieve the line width that will be used for the screen width when printing
         const std::string&          getModuleDir(void) const;                           //!< Retrieve the module directory name
+        size_t                      getNumberOfThreads(void) const;                     //!< Retrieve the number of threads used for shared-memory parallel computations
         std::string                 getOption(const std::string &k) const;              //!< Retrieve a user option
         bool                        getPrintNodeIndex(void) const;                      //!< Retrieve the flag whether we should print node indices
         size_t                      getScalingDensity(void) const;                      //!< Retrieve the scaling density that determines how often to scale the likelihood in CTMC models
@@ -30,6 +31,7 @@ class RbSettings {
         void                        setCollapseSampledAncestors(bool);                  //!< Set whether to should display sampled ancestors as 2-degree nodes when printing
         void                        setLineWidth(size_t w);                             //!< Set the line width that will be used for the screen width when printing
         void                        setModuleDir(const std::string &md);                //!< Set the module directory name
+        void                        setNumberOfThreads(size_t n);                       //!< Set the number of threads used for shared-memory parallel computations (min 1)
         void                        setOption(const std::string &k, const std::string &v, bool write);  //!< Set the key value pair.
         void                        setPrintNodeIndex(bool tf);                         //!< Set the flag whether we should print node indices
         void                        setScalingDensity(size_t w);                        //!< Set the scaling density n, where CTMC likelihoods are scaled every n-th node (min 1)
@@ -50,6 +52,7 @@ class RbSettings {
         bool                        collapseSampledAncestors;
         size_t                      lineWidth;
         std::string                 moduleDir;
+        size_t                      numThreads;                                         //!< Number of threads used to split the work of likelihood computations
         bool                        printNodeIndex;                                     //!< Should the node index of a tree be printed as a comment?
         size_t                      scalingDensity;
         double                      tolerance;                                          //!< Tolerance for comparison of doubles
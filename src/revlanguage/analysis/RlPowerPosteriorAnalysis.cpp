@@ -95,8 +95,11 @@ void PowerPosteriorAnalysis::constructInternalObject( void )
         }
     }
 
+    const int                                       as      = static_cast<const Natural &>( adaptive_stones->getRevObject() ).getValue();
+
     value->setPowers( beta );
     value->setSampleFreq( sf );
+    value->setAdaptiveStones( size_t(as) );
 }
 
 
@@ -183,6 +186,7 @@ const MemberRules& PowerPosteriorAnalysis::getParameterRules(void) const
         memberRules.push_back( new ArgumentRule("alpha"      , RealPos::getClassTypeSpec()                 , "The alpha parameter of the beta distribution if no powers are specified.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RealPos(0.2) ) );
         memberRules.push_back( new ArgumentRule("sampleFreq" , Natural::getClassTypeSpec()                 , "The sampling frequency of the likelihood values.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(100) ) );
         memberRules.push_back( new ArgumentRule("procPerLikelihood" , Natural::getClassTypeSpec()          , "Number of processors used to compute the likelihood.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(1) ) );
+        memberRules.push_back( new ArgumentRule("adaptiveStones"    , Natural::getClassTypeSpec()          , "The number of additional stones placed where the variance of the stepping-stone ratio is largest.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(0) ) );
 
         rules_set = true;
     }
@@ -249,6 +253,10 @@ void PowerPosteriorAnalysis::setConstParameter(const std::string& name, const Re
     {
         proc_per_lik = var;
     }
+    else if ( name == "adaptiveStones" )
+    {
+        adaptive_stones = var;
+    }
     else
     {
         RevObject::setConstParameter(name, var);
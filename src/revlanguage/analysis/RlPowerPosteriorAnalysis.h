@@ -55,6 +55,7 @@ namespace RevLanguage {
         RevPtr<const RevVariable>                   alphaVal;
         RevPtr<const RevVariable>                   sampFreq;
         RevPtr<const RevVariable>                   proc_per_lik;
+        RevPtr<const RevVariable>                   adaptive_stones;
 
     };
 
@@ -63,7 +63,12 @@ void Mcmcmc::constructInternalObject( void )
     int                                                     si      = static_cast<const Natural &>( swap_interval->getRevObject() ).getValue();
     double                                                  delta   = static_cast<const RealPos &>( delta_heat->getRevObject() ).getValue();
     int                                                     nreps   = static_cast<const Natural &>( num_runs->getRevObject() ).getValue();
-    RevBayesCore::Mcmcmc *m = new RevBayesCore::Mcmcmc(mdl, mvs, mntr, sched, nchains, si, delta);
+    int                                                     ns      = nchains;
+    if ( swaps_per_round->getRevObject() != RevNullObject::getInstance() )
+    {
+        ns = static_cast<const Natural &>( swaps_per_round->getRevObject() ).getValue();
+    }
+    RevBayesCore::Mcmcmc *m = new RevBayesCore::Mcmcmc(mdl, mvs, mntr, sched, nchains, si, delta, ns);
     
     value = new RevBayesCore::MonteCarloAnalysis(m,nreps);
     
@@ -262,6 +267,7 @@ const MemberRules& Mcmcmc::getParameterRules(void) const
         memberRules.push_back( new ArgumentRule("nchains"    , Natural::getClassTypeSpec()  , "The number of chains to run.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(4) ) );
         memberRules.push_back( new ArgumentRule("swapInterval" , Natural::getClassTypeSpec(), "The interval at which swaps will be attempted.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(10)) );
         memberRules.push_back( new ArgumentRule("deltaHeat"    , RealPos::getClassTypeSpec(), "The delta parameter for the heat function.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RealPos(0.2) ) );
+        memberRules.push_back( new ArgumentRule("swapsPerRound", Natural::getClassTypeSpec(), "The number of swaps attempted at each swap interval (by default one per chain).", ArgumentRule::BY_VALUE, ArgumentRule::ANY, NULL ) );
 
         
         rules_set = true;
@@ -305,6 +311,10 @@ void Mcmcmc::setConstParameter(const std::string& name, const RevPtr<const RevVa
     {
         delta_heat = var;
     }
+    else if ( name == "swapsPerRound" )
+    {
+        swaps_per_round = var;
+    }
     else
     {
         MonteCarloAnalysis::setConstParameter(name, var);
@@ -52,6 +52,7 @@ namespace RevLanguage {
         RevPtr<const RevVariable>                       num_chains;
         RevPtr<const RevVariable>                       swap_interval;
         RevPtr<const RevVariable>                       delta_heat;
+        RevPtr<const RevVariable>                       swaps_per_round;
 
     };
     
@@ -91,6 +91,11 @@ RevPtr<RevVariable> MonteCarloAnalysis::executeMethod(std::string const &name, c
         rules.push_back( RevBayesCore::MaxIterationStoppingRule(gen) );
         
         bool prior = static_cast<const RlBoolean &>( args[2].getVariable()->getRevObject() ).getValue();
+        
+        const std::string &checkpoint_file = static_cast<const RlString &>( args[3].getVariable()->getRevObject() ).getValue();
+        int checkpoint_interval = static_cast<const Natural &>( args[4].getVariable()->getRevObject() ).getValue();
+        value->setCheckpointFile( checkpoint_file, checkpoint_interval );
+        
         if ( prior == true )
         {
             value->runPriorSampler( gen, rules );
@@ -127,6 +132,15 @@ RevPtr<RevVariable> MonteCarloAnalysis::executeMethod(std::string const &name, c
         
         return NULL;
     }
+    else if ( name == "initializeFromCheckpoint")
+    {
+        found = true;
+        
+        const std::string &checkpoint_file = static_cast<const RlString &>( args[0].getVariable()->getRevObject() ).getValue();
+        value->initializeFromCheckpoint( checkpoint_file );
+        
+        return NULL;
+    }
     else if ( name == "initializeFromTrace")
     {
         found = true;
@@ -212,6 +226,8 @@ void MonteCarloAnalysis::initializeMethods()
     runArgRules->push_back( new ArgumentRule( "generations", Natural::getClassTypeSpec(), "The number of generations to run.", ArgumentRule::BY_VALUE, ArgumentRule::ANY ) );
     runArgRules->push_back( new ArgumentRule( "rules", WorkspaceVector<StoppingRule>::getClassTypeSpec(), "The rules when to automatically stop the run.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, NULL ) );
     runArgRules->push_back( new ArgumentRule( "underPrior" , RlBoolean::getClassTypeSpec(), "Should we run this analysis under the prior only?", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean(false) ) );
+    runArgRules->push_back( new ArgumentRule( "checkpointFile", RlString::getClassTypeSpec(), "The file into which we write checkpoints of the complete state of the analysis.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlString("") ) );
+    runArgRules->push_back( new ArgumentRule( "checkpointInterval", Natural::getClassTypeSpec(), "The interval (in generations) when to write a checkpoint.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(0) ) );
     methods.addFunction( new MemberProcedure( "run", RlUtils::Void, runArgRules) );
     
     ArgumentRules* burninArgRules = new ArgumentRules();
@@ -224,6 +240,10 @@ void MonteCarloAnalysis::initializeMethods()
     ArgumentRules* operatorSummaryArgRules = new ArgumentRules();
     methods.addFunction( new MemberProcedure( "operatorSummary", RlUtils::Void, operatorSummaryArgRules) );
     
+    ArgumentRules* initializeCheckpointArgRules = new ArgumentRules();
+    initializeCheckpointArgRules->push_back( new ArgumentRule("checkpointFile", RlString::getClassTypeSpec(), "The checkpoint file written by a previous run.", ArgumentRule::BY_VALUE, ArgumentRule::ANY ) );
+    methods.addFunction( new MemberProcedure( "initializeFromCheckpoint", RlUtils::Void, initializeCheckpointArgRules) );
+    
     ArgumentRules* initializeTraceArgRules = new ArgumentRules();
     initializeTraceArgRules->push_back( new ArgumentRule("trace", WorkspaceVector<ModelTrace>::getClassTypeSpec(), "The sample trace object.", ArgumentRule::BY_CONSTANT_REFERENCE, ArgumentRule::ANY ) );
     methods.addFunction( new MemberProcedure( "initializeFromTrace", RlUtils::Void, initializeTraceArgRules) );
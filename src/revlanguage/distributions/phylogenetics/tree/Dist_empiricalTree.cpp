@@ -9,6 +9,7 @@
 #include "RlString.h"
 #include "StochasticNode.h"
 #include "EmpiricalTreeDistribution.h"
+#include "IndexedTreeFile.h"
 #include "RlTraceTree.h"
 
 using namespace RevLanguage;
@@ -48,11 +49,24 @@ RevBayesCore::EmpiricalTreeDistribution* Dist_empiricalTree::createDistribution(
     
     // get the parameters
     
-    // tree trace
-    const RevBayesCore::TraceTree &tt = static_cast<const TraceTree &>( trace->getRevObject() ).getValue().getTreeTrace();
     // burnin
     int b = static_cast<const Natural &>( burnin->getRevObject() ).getDagNode()->getValue();
     
+    // a file name means that we only index the file and read the trees when they are drawn
+    if ( trace->getRevObject().isType( RlString::getClassTypeSpec() ) )
+    {
+        const std::string &fn  = static_cast<const RlString &>( trace->getRevObject() ).getValue();
+        const std::string &tt  = static_cast<const RlString &>( treetype->getRevObject() ).getValue();
+        const std::string &sep = static_cast<const RlString &>( separator->getRevObject() ).getValue();
+        
+        RevBayesCore::IndexedTreeFile tree_file = RevBayesCore::IndexedTreeFile( fn, tt == "clock", sep );
+        
+        return new RevBayesCore::EmpiricalTreeDistribution( tree_file, b );
+    }
+    
+    // tree trace
+    const RevBayesCore::TraceTree &tt = static_cast<const TraceTree &>( trace->getRevObject() ).getValue().getTreeTrace();
+    
     // create the internal distribution object
     RevBayesCore::EmpiricalTreeDistribution*   d = new RevBayesCore::EmpiricalTreeDistribution( tt, b );
     
@@ -105,9 +119,18 @@ const MemberRules& Dist_empiricalTree::getParameterRules(void) const
     
     if ( !rules_set )
     {
-        memberRules.push_back( new ArgumentRule( "trace", TraceTree::getClassTypeSpec(), "The trace of tree samples.", ArgumentRule::BY_VALUE, ArgumentRule::ANY ) );
+        std::vector<TypeSpec> traceTypes;
+        traceTypes.push_back( TraceTree::getClassTypeSpec() );
+        traceTypes.push_back( RlString::getClassTypeSpec() );
+        memberRules.push_back( new ArgumentRule( "trace", traceTypes, "The trace of tree samples, or the name of a tree trace file of which only the drawn trees are read.", ArgumentRule::BY_VALUE, ArgumentRule::ANY ) );
         memberRules.push_back( new ArgumentRule( "burnin", Integer::getClassTypeSpec(), "The number of samples to discard.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Integer(-1) ) );
         
+        std::vector<std::string> treeOptions;
+        treeOptions.push_back( "clock" );
+        treeOptions.push_back( "non-clock" );
+        memberRules.push_back( new OptionRule( "treetype", new RlString("clock"), treeOptions, "The type of trees in the tree trace file." ) );
+        memberRules.push_back( new ArgumentRule( "separator", RlString::getClassTypeSpec(), "The separator/delimiter between values in the tree trace file.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlString("\t") ) );
+        
         rules_set = true;
     }
     
@@ -134,6 +157,12 @@ void Dist_empiricalTree::setConstParameter(const std::string& name, const RevPtr
     else if ( name == "burnin" ) {
         burnin = var;
     }
+    else if ( name == "treetype" ) {
+        treetype = var;
+    }
+    else if ( name == "separator" ) {
+        separator = var;
+    }
     else {
         Distribution::setConstParameter(name, var);
     }
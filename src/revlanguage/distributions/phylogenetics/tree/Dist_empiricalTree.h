@@ -54,6 +54,8 @@ namespace RevLanguage {
         
         RevPtr<const RevVariable>                               trace;
         RevPtr<const RevVariable>                               burnin;
+        RevPtr<const RevVariable>                               treetype;
+        RevPtr<const RevVariable>                               separator;
     };
 	
 }
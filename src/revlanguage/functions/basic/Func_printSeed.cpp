@@ -33,7 +33,7 @@ RevPtr<RevVariable> Func_printSeed::execute( void )
     
     
     RevBayesCore::RandomNumberGenerator *rng = RevBayesCore::GLOBAL_RNG;
-	unsigned int s = rng->getSeed();
+	boost::uint64_t s = rng->getSeed();
 
 	std::cout << "Current RNG Seed = " << s << "" << std::endl;
     
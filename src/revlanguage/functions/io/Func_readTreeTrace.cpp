@@ -3,20 +3,17 @@
 #include "Ellipsis.h"
 #include "Func_readTreeTrace.h"
 #include "ModelVector.h"
-#include "NclReader.h"
-#include "NewickConverter.h"
+#include "Natural.h"
 #include "OptionRule.h"
 #include "RbException.h"
 #include "RbFileManager.h"
-#include "RlBranchLengthTree.h"
+#include "RlBoolean.h"
 #include "RlString.h"
-#include "RlTimeTree.h"
 #include "RlTraceTree.h"
 #include "RlUserInterface.h"
 #include "RlUtils.h"
-#include "StringUtilities.h"
+#include "TraceReader.h"
 #include "TraceTree.h"
-#include "TreeUtilities.h"
 
 #include <map>
 #include <set>
@@ -46,6 +43,9 @@ RevPtr<RevVariable> Func_readTreeTrace::execute( void )
     
     const std::string&  treetype = static_cast<const RlString&>( args[1].getVariable()->getRevObject() ).getValue();
     const std::string&  sep      = static_cast<const RlString&>( args[2].getVariable()->getRevObject() ).getValue();
+    size_t              burnin   = static_cast<const Natural&>( args[3].getVariable()->getRevObject() ).getValue();
+    size_t              thinning = static_cast<const Natural&>( args[4].getVariable()->getRevObject() ).getValue();
+    bool                compact  = static_cast<const RlBoolean&>( args[5].getVariable()->getRevObject() ).getValue();
     
     std::vector<std::string> vectorOfFileNames;
     
@@ -104,21 +104,21 @@ RevPtr<RevVariable> Func_readTreeTrace::execute( void )
         }
     }
     
-    RevObject *rv;
-    if ( treetype == "clock" )
+    if ( treetype != "clock" && treetype != "non-clock" )
     {
-        rv = readTimeTrees(vectorOfFileNames, sep);
-    }
-    else if ( treetype == "non-clock" )
-    {
-        rv = readBranchLengthTrees(vectorOfFileNames, sep);
+        throw RbException("Unknown tree type to read.");
     }
-    else
+    
+    // the trees of all files are appended to the same trace
+    RevBayesCore::TraceTree t = RevBayesCore::TraceTree( treetype == "clock", compact == false );
+    RevBayesCore::TraceReader reader;
+    for (std::vector<std::string>::const_iterator p = vectorOfFileNames.begin(); p != vectorOfFileNames.end(); p++)
     {
-        throw RbException("Unknown tree type to read.");
+        RBOUT( "Processing file \"" + *p + "\"");
+        reader.readTreeTrace( *p, sep, burnin, thinning, t );
     }
     
-    return new RevVariable( rv );
+    return new RevVariable( new TraceTree( t ) );
 }
 
 
@@ -143,6 +143,9 @@ const ArgumentRules& Func_readTreeTrace::getArgumentRules( void ) const
         treeOptions.push_back( "non-clock" );
         argumentRules.push_back( new OptionRule( "treetype", new RlString("clock"), treeOptions, "The type of trees." ) );
         argumentRules.push_back( new ArgumentRule( "separator", RlString::getClassTypeSpec(), "The separator/delimiter between values in the file.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlString("\t") ) );
+        argumentRules.push_back( new ArgumentRule( "burnin"   , Natural::getClassTypeSpec(), "The number of trees skipped at the beginning of each file.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(0) ) );
+        argumentRules.push_back( new ArgumentRule( "thinning" , Natural::getClassTypeSpec(), "Keep only every n-th tree after the burnin.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new Natural(1) ) );
+        argumentRules.push_back( new ArgumentRule( "compact"  , RlBoolean::getClassTypeSpec(), "Drop the node and branch parameters of the trees, which saves memory for annotated trees.", ArgumentRule::BY_VALUE, ArgumentRule::ANY, new RlBoolean(false) ) );
         rules_set = true;
     }
     
@@ -201,211 +204,3 @@ const TypeSpec& Func_readTreeTrace::getReturnType( void ) const
 }
 
 
-TraceTree* Func_readTreeTrace::readBranchLengthTrees(const std::vector<std::string> &vectorOfFileNames, const std::string &delimitter)
-{
-    
-    
-    std::vector<RevBayesCore::TraceTree > data;
-    
-    
-    // Set up a map with the file name to be read as the key and the file type as the value. Note that we may not
-    // read all of the files in the string called "vectorOfFileNames" because some of them may not be in a format
-    // that can be read.
-    std::map<std::string,std::string> fileMap;
-    for (std::vector<std::string>::const_iterator p = vectorOfFileNames.begin(); p != vectorOfFileNames.end(); p++)
-    {
-        bool hasHeaderBeenRead = false;
-        const std::string &fn = *p;
-        
-        /* Open file */
-        std::ifstream inFile( fn.c_str() );
-        
-        if ( !inFile )
-            throw RbException( "Could not open file \"" + fn + "\"" );
-        
-        /* Initialize */
-        std::string commandLine;
-        RBOUT( "Processing file \"" + fn + "\"");
-        
-        size_t index = 0;
-        
-        std::string outgroup = "";
-        
-        /* Command-processing loop */
-        while ( inFile.good() )
-        {
-            
-            // Read a line
-            std::string line;
-            getline( inFile, line );
-            
-            // skip empty lines
-            //line = StringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-            if (line.length() == 0)
-            {
-                continue;
-            }
-            
-            
-            // removing comments
-            if (line[0] == '#') {
-                continue;
-            }
-            
-            // splitting every line into its columns
-            std::vector<std::string> columns;
-            
-            // we should provide other delimiters too
-            StringUtilities::stringSplit(line, delimitter, columns);
-            
-            // we assume a header at the first line of the file
-            if (!hasHeaderBeenRead) {
-                
-                for (size_t j=1; j<columns.size(); j++)
-                {
-                    
-                    std::string parmName = columns[j];
-                    if ( parmName == "Posterior" || parmName == "Likelihood" || parmName == "Prior")
-                    {
-                        continue;
-                    }
-                    index = j;
-                    
-                    RevBayesCore::TraceTree t = RevBayesCore::TraceTree( false );
-                    
-                    t.setParameterName(parmName);
-                    t.setFileName(fn);
-                    
-                    data.push_back( t );
-                }
-                
-                hasHeaderBeenRead = true;
-                
-                continue;
-            }
-            
-            // adding values to the Traces
-            RevBayesCore::TraceTree& t = data[0];
-            
-            RevBayesCore::NewickConverter c;
-            RevBayesCore::Tree *tau = c.convertFromNewick( columns[index] );
-            
-            // moved the reroot functionality below into
-            // RevBayesCore::TreeSummary<BranchLengthTree>::summarizeTrees()
-            // so that tree traces retain their original topology
-            // will freyman 12/12/14
-            
-            //            if ( outgroup == "" )
-            //            {
-            //                RevBayesCore::BranchLengthTree& referenceTree = *tau;
-            //                outgroup = referenceTree.getTipNode(0).getName();
-            //            }
-            //            // re-root the tree so that we can compare the the trees
-            //            tau->reroot( outgroup );
-            
-            t.addObject( tau );
-        }
-    }
-    
-    return new TraceTree( data[0] );
-}
-
-
-TraceTree* Func_readTreeTrace::readTimeTrees(const std::vector<std::string> &vectorOfFileNames, const std::string &delimitter) {
-    
-    
-    std::vector<RevBayesCore::TraceTree> data;
-    
-    
-    // Set up a map with the file name to be read as the key and the file type as the value. Note that we may not
-    // read all of the files in the string called "vectorOfFileNames" because some of them may not be in a format
-    // that can be read.
-    std::map<std::string,std::string> fileMap;
-    for (std::vector<std::string>::const_iterator p = vectorOfFileNames.begin(); p != vectorOfFileNames.end(); p++)
-    {
-        bool hasHeaderBeenRead = false;
-        const std::string &fn = *p;
-        
-        /* Open file */
-        std::ifstream inFile( fn.c_str() );
-        
-        if ( !inFile )
-            throw RbException( "Could not open file \"" + fn + "\"" );
-        
-        /* Initialize */
-        std::string commandLine;
-        RBOUT( "Processing file \"" + fn + "\"");
-        
-        size_t index = 0;
-        
-        /* Command-processing loop */
-        while ( inFile.good() )
-        {
-            
-            // Read a line
-            std::string line;
-            getline( inFile, line );
-            
-            // skip empty lines
-            //line = StringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
-            if (line.length() == 0)
-            {
-                continue;
-            }
-            
-            
-            // removing comments
-            if (line[0] == '#')
-            {
-                continue;
-            }
-            
-            // splitting every line into its columns
-            std::vector<std::string> columns;
-            
-            // we should provide other delimiters too
-            StringUtilities::stringSplit(line, delimitter, columns);
-            
-            // we assume a header at the first line of the file
-            if (!hasHeaderBeenRead)
-            {
-                
-                for (size_t j=1; j<columns.size(); j++)
-                {
-                    
-                    std::string parmName = columns[j];
-                    if ( parmName == "Posterior" || parmName == "Likelihood" || parmName == "Prior")
-                    {
-                        continue;
-                    }
-                    index = j;
-                    
-                    RevBayesCore::TraceTree t = RevBayesCore::TraceTree( true );
-                    
-                    t.setParameterName(parmName);
-                    t.setFileName(fn);
-                    
-                    data.push_back( t );
-                }
-                
-                hasHeaderBeenRead = true;
-                
-                continue;
-            }
-            
-            // adding values to the Traces
-            //            for (size_t j=1; j<columns.size(); j++) {
-            RevBayesCore::TraceTree& t = data[0];
-            
-            RevBayesCore::NewickConverter c;
-            RevBayesCore::Tree *blTree = c.convertFromNewick( columns[index] );
-            RevBayesCore::Tree *tau = RevBayesCore::TreeUtilities::convertTree( *blTree );
-            
-            t.addObject( tau );
-        }
-    }
-    
-    return new TraceTree( data[0] );
-}
-
-
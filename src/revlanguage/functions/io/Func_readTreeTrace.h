@@ -45,10 +45,6 @@ namespace RevLanguage {
         const ArgumentRules&                getArgumentRules(void) const;                                                       //!< Get argument rules
         const TypeSpec&                     getReturnType(void) const;                                                          //!< Get type of return value
         
-    private:
-        
-        TraceTree*                          readBranchLengthTrees(const std::vector<std::string> &fns, const std::string &d);
-        TraceTree*                          readTimeTrees(const std::vector<std::string> &fns, const std::string &d);
     };
     
 }